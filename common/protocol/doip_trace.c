@@ -0,0 +1,260 @@
+/**
+ * @file doip_trace.c
+ * @brief DoIP traffic capture format Implementation
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "doip_trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static uint64_t wall_clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static size_t put_varint(uint8_t* out, uint64_t value) {
+    size_t n = 0;
+    while (value >= 0x80U) {
+        out[n++] = (uint8_t)(value | 0x80U);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+/* 1 = ok, 0 = clean EOF before the first byte, -1 = truncated / overlong */
+static int get_varint(FILE* file, uint64_t* value) {
+    uint64_t result = 0;
+    unsigned shift = 0;
+
+    for (;;) {
+        int c = fgetc(file);
+        if (c == EOF) {
+            return (shift == 0) ? 0 : -1;
+        }
+        if (shift > 63) {
+            return -1;
+        }
+        result |= (uint64_t)(c & 0x7F) << shift;
+        if ((c & 0x80) == 0) {
+            *value = result;
+            return 1;
+        }
+        shift += 7;
+    }
+}
+
+static void put_le(uint8_t* out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint64_t get_le(const uint8_t* in, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+/* Caller holds the mutex */
+static int flush_locked(DoIPTraceWriter* writer) {
+    if (writer->used == 0) {
+        return 0;
+    }
+    size_t written = fwrite(writer->buffer, 1, writer->used, writer->file);
+    int ok = (written == writer->used);
+    writer->used = 0;
+    return ok ? 0 : -1;
+}
+
+int doip_trace_writer_open(DoIPTraceWriter* writer, const char* path) {
+    memset(writer, 0, sizeof(*writer));
+
+    writer->buffer = (uint8_t*)malloc(DOIP_TRACE_BUFFER_SIZE);
+    if (writer->buffer == NULL) {
+        return -1;
+    }
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        free(writer->buffer);
+        writer->buffer = NULL;
+        return -1;
+    }
+    pthread_mutex_init(&writer->mutex, NULL);
+
+    uint8_t header[DOIP_TRACE_FILE_HEADER_SIZE] = {0};
+    memcpy(header, DOIP_TRACE_MAGIC, 8);
+    put_le(header + 8, DOIP_TRACE_VERSION, 2);
+    put_le(header + 10, DOIP_TRACE_FILE_HEADER_SIZE, 2);
+    put_le(header + 16, wall_clock_us(), 8);
+    memcpy(writer->buffer, header, sizeof(header));
+    writer->used = sizeof(header);
+    writer->bytes = sizeof(header);
+
+    writer->last_us = monotonic_us();
+    return 0;
+}
+
+int doip_trace_writer_flush(DoIPTraceWriter* writer) {
+    pthread_mutex_lock(&writer->mutex);
+    int result = flush_locked(writer);
+    if (result == 0 && fflush(writer->file) != 0) {
+        result = -1;
+    }
+    pthread_mutex_unlock(&writer->mutex);
+    return result;
+}
+
+int doip_trace_writer_close(DoIPTraceWriter* writer) {
+    if (writer->file == NULL) {
+        return -1;
+    }
+    int result = doip_trace_writer_flush(writer);
+    if (fclose(writer->file) != 0) {
+        result = -1;
+    }
+    pthread_mutex_destroy(&writer->mutex);
+    free(writer->buffer);
+    writer->file = NULL;
+    writer->buffer = NULL;
+    return result;
+}
+
+/* Caller holds the mutex */
+static void record_locked(DoIPTraceWriter* writer, uint32_t connection, uint8_t kind,
+                          const uint8_t* frame, size_t length) {
+    if (length > DOIP_TRACE_MAX_FRAME) {
+        writer->dropped++;
+        return;
+    }
+    /* Worst case record header: 3 varints (10 + 5 + 5) + kind */
+    if (writer->used + 21U + length > DOIP_TRACE_BUFFER_SIZE) {
+        if (flush_locked(writer) != 0) {
+            writer->dropped++;
+        }
+    }
+
+    /* Timestamp taken under the lock keeps deltas non-negative across threads */
+    uint64_t now = monotonic_us();
+    uint64_t delta = (now > writer->last_us) ? now - writer->last_us : 0;
+    writer->last_us += delta;
+
+    uint8_t* out = writer->buffer + writer->used;
+    size_t n = put_varint(out, delta);
+    n += put_varint(out + n, connection);
+    out[n++] = kind;
+    n += put_varint(out + n, length);
+    if (length > 0) {
+        memcpy(out + n, frame, length);
+        n += length;
+    }
+
+    writer->used += n;
+    writer->bytes += n;
+    writer->records++;
+}
+
+void doip_trace_record(DoIPTraceWriter* writer, uint32_t connection, uint8_t kind,
+                       const uint8_t* frame, size_t length) {
+    pthread_mutex_lock(&writer->mutex);
+    record_locked(writer, connection, kind, frame, length);
+    pthread_mutex_unlock(&writer->mutex);
+}
+
+// ============================================================================
+// Reader
+// ============================================================================
+
+int doip_trace_reader_open(DoIPTraceReader* reader, const char* path) {
+    memset(reader, 0, sizeof(*reader));
+
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL) {
+        return -1;
+    }
+
+    uint8_t header[DOIP_TRACE_FILE_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), reader->file) != sizeof(header) ||
+        memcmp(header, DOIP_TRACE_MAGIC, 8) != 0 ||
+        get_le(header + 8, 2) != DOIP_TRACE_VERSION) {
+        fclose(reader->file);
+        reader->file = NULL;
+        return -1;
+    }
+
+    /* Later versions may grow the header; skip what this reader does not know */
+    uint64_t header_size = get_le(header + 10, 2);
+    if (header_size > sizeof(header)) {
+        fseek(reader->file, (long)header_size, SEEK_SET);
+    }
+    reader->start_unix_us = get_le(header + 16, 8);
+    return 0;
+}
+
+void doip_trace_reader_close(DoIPTraceReader* reader) {
+    if (reader->file != NULL) {
+        fclose(reader->file);
+        reader->file = NULL;
+    }
+    free(reader->frame);
+    reader->frame = NULL;
+    reader->capacity = 0;
+}
+
+int doip_trace_read(DoIPTraceReader* reader, DoIPTraceRecord* record) {
+    uint64_t delta = 0;
+    uint64_t connection = 0;
+    uint64_t length = 0;
+
+    int result = get_varint(reader->file, &delta);
+    if (result <= 0) {
+        return result;
+    }
+    if (get_varint(reader->file, &connection) != 1 || connection > UINT32_MAX) {
+        return -1;
+    }
+    int kind = fgetc(reader->file);
+    if (kind == EOF || get_varint(reader->file, &length) != 1 || length > DOIP_TRACE_MAX_FRAME) {
+        return -1;
+    }
+
+    if (length > reader->capacity) {
+        uint8_t* frame = (uint8_t*)realloc(reader->frame, (size_t)length);
+        if (frame == NULL) {
+            return -1;
+        }
+        reader->frame = frame;
+        reader->capacity = (size_t)length;
+    }
+    if (length > 0 && fread(reader->frame, 1, (size_t)length, reader->file) != (size_t)length) {
+        return -1;
+    }
+
+    reader->time_us += delta;
+    record->time_us = reader->time_us;
+    record->connection = (uint32_t)connection;
+    record->kind = (uint8_t)kind;
+    record->length = (uint32_t)length;
+    record->frame = reader->frame;
+    return 1;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file doip_trace.h
+ * @brief DoIP traffic capture format (record / replay)
+ *
+ * Compact binary trace of DoIP frames as seen by a server (VMG DoIP server,
+ * Linux Zonal Gateway), replayed by tools/doip_replay.
+ *
+ * File layout (all multi-byte header fields little-endian):
+ *   File header (24 bytes):
+ *     magic[8] = "DOIPTRC1", u16 version, u16 header_size, u32 reserved,
+ *     u64 start_unix_us (wall clock at capture start, informational)
+ *   Records:
+ *     varint delta_us   - monotonic time since the previous record
+ *     varint connection - server-assigned connection id (0 = UDP)
+ *     u8     kind       - DOIP_TRACE_* (direction / event)
+ *     varint length     - frame length (0 for OPEN / CLOSE)
+ *     u8     frame[length] - complete DoIP frame, header included
+ *
+ * A typical record header is 4-6 bytes, so the trace is only slightly larger
+ * than the DoIP traffic itself.
+ */
+
+#ifndef DOIP_TRACE_H
+#define DOIP_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DOIP_TRACE_MAGIC            "DOIPTRC1"
+#define DOIP_TRACE_VERSION          1U
+#define DOIP_TRACE_FILE_HEADER_SIZE 24U
+#define DOIP_TRACE_BUFFER_SIZE      65536U  /* Writer flushes when this fills */
+#define DOIP_TRACE_MAX_FRAME        (DOIP_TRACE_BUFFER_SIZE - 32U)
+
+/* Record kinds */
+#define DOIP_TRACE_RX               0x01    /* Tester -> server frame */
+#define DOIP_TRACE_TX               0x02    /* Server -> tester frame */
+#define DOIP_TRACE_OPEN             0x03    /* TCP connection accepted */
+#define DOIP_TRACE_CLOSE            0x04    /* TCP connection closed */
+
+#define DOIP_TRACE_UDP_CONNECTION   0U
+
+/**
+ * @brief Trace writer (thread-safe; records are serialized by the mutex)
+ *
+ * Records are encoded into an in-memory buffer and written out in 64 KB
+ * chunks, so capture costs one small memcpy per frame on the I/O path.
+ */
+typedef struct {
+    FILE*           file;
+    pthread_mutex_t mutex;
+    uint8_t*        buffer;
+    size_t          used;
+    uint64_t        last_us;
+    uint64_t        records;
+    uint64_t        bytes;          /* Trace bytes produced (header included) */
+    uint64_t        dropped;        /* Oversized frames or write errors */
+} DoIPTraceWriter;
+
+/**
+ * @brief One decoded record; frame points into the reader's buffer
+ */
+typedef struct {
+    uint64_t       time_us;         /* Since capture start */
+    uint32_t       connection;
+    uint8_t        kind;
+    uint32_t       length;
+    const uint8_t* frame;
+} DoIPTraceRecord;
+
+typedef struct {
+    FILE*    file;
+    uint64_t start_unix_us;
+    uint64_t time_us;
+    uint8_t* frame;
+    size_t   capacity;
+} DoIPTraceReader;
+
+/* Writer: 0 on success, -1 on error */
+int doip_trace_writer_open(DoIPTraceWriter* writer, const char* path);
+int doip_trace_writer_close(DoIPTraceWriter* writer);
+int doip_trace_writer_flush(DoIPTraceWriter* writer);
+
+/* connection: id assigned by the server per accepted TCP connection (never 0) */
+void doip_trace_record(DoIPTraceWriter* writer, uint32_t connection, uint8_t kind,
+                       const uint8_t* frame, size_t length);
+
+/* Reader: 0 on success, -1 on error */
+int doip_trace_reader_open(DoIPTraceReader* reader, const char* path);
+void doip_trace_reader_close(DoIPTraceReader* reader);
+
+/* 1 = record read, 0 = end of trace, -1 = corrupt / truncated */
+int doip_trace_read(DoIPTraceReader* reader, DoIPTraceRecord* record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DOIP_TRACE_H */
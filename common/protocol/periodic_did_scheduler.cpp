@@ -0,0 +1,101 @@
+/**
+ * @file periodic_did_scheduler.cpp
+ * @brief Rate-grouped 0x2A scheduler Implementation
+ */
+
+#include "periodic_did_scheduler.hpp"
+#include <algorithm>
+
+namespace vmg {
+
+PeriodicDIDScheduler::PeriodicDIDScheduler(const PeriodicSchedulerConfig& config)
+    : config_(config), scheduled_(0) {
+    groups_[groupIndex(PeriodicRate::Slow)].period_ms = std::max<uint32_t>(config_.slow_ms, 1);
+    groups_[groupIndex(PeriodicRate::Medium)].period_ms = std::max<uint32_t>(config_.medium_ms, 1);
+    groups_[groupIndex(PeriodicRate::Fast)].period_ms = std::max<uint32_t>(config_.fast_ms, 1);
+    for (auto& group : groups_) {
+        group.next_due_ms = 0;
+    }
+}
+
+bool PeriodicDIDScheduler::schedule(uint8_t pdid, PeriodicRate rate) {
+    if (rate < PeriodicRate::Slow || rate > PeriodicRate::Fast) {
+        return false;
+    }
+
+    RateGroup& target = groups_[groupIndex(rate)];
+    if (std::find(target.pdids.begin(), target.pdids.end(), pdid) != target.pdids.end()) {
+        return true;
+    }
+
+    bool moving = false;
+    for (auto& group : groups_) {
+        if (std::find(group.pdids.begin(), group.pdids.end(), pdid) != group.pdids.end()) {
+            moving = true;
+        }
+    }
+    if (!moving && scheduled_ >= config_.max_scheduled) {
+        return false;
+    }
+
+    stop(pdid);
+    if (target.pdids.empty()) {
+        target.next_due_ms = 0;  // Send first sample right away
+    }
+    target.pdids.push_back(pdid);
+    scheduled_++;
+    return true;
+}
+
+void PeriodicDIDScheduler::stop(uint8_t pdid) {
+    for (auto& group : groups_) {
+        auto it = std::find(group.pdids.begin(), group.pdids.end(), pdid);
+        if (it != group.pdids.end()) {
+            group.pdids.erase(it);
+            scheduled_--;
+        }
+    }
+}
+
+void PeriodicDIDScheduler::stopAll() {
+    for (auto& group : groups_) {
+        group.pdids.clear();
+    }
+    scheduled_ = 0;
+}
+
+size_t PeriodicDIDScheduler::collectDue(uint64_t now_ms, uint8_t* pdids, size_t cap) {
+    size_t count = 0;
+
+    for (auto& group : groups_) {
+        if (group.pdids.empty() || group.next_due_ms > now_ms) {
+            continue;
+        }
+
+        for (uint8_t pdid : group.pdids) {
+            if (count < cap) {
+                pdids[count++] = pdid;
+            }
+        }
+
+        // Next multiple of the period: groups stay aligned, late wakeups do not burst
+        uint64_t next = (now_ms / group.period_ms + 1) * group.period_ms;
+        if (group.next_due_ms != 0 && next - group.next_due_ms > group.period_ms) {
+            stats_.skipped_slots += (next - group.next_due_ms) / group.period_ms - 1;
+        }
+        group.next_due_ms = next;
+    }
+    return count;
+}
+
+uint64_t PeriodicDIDScheduler::nextDueMs() const {
+    uint64_t next = PERIODIC_NONE_DUE;
+    for (const auto& group : groups_) {
+        if (!group.pdids.empty()) {
+            next = std::min(next, group.next_due_ms);
+        }
+    }
+    return next;
+}
+
+} // namespace vmg
@@ -0,0 +1,117 @@
+/**
+ * @file periodic_did_scheduler.hpp
+ * @brief Rate-grouped scheduler for UDS 0x2A (ReadDataByPeriodicIdentifier)
+ *
+ * Periodic identifiers (PDID, DID 0xF2xx) are kept in three rate groups
+ * (slow / medium / fast). Deadlines are aligned to multiples of each
+ * group's period, so groups whose periods divide each other fall due
+ * together and their PDIDs go out in one frame.
+ *
+ * Shared by the VMG UDS handler and the TC375 simulator UdsHandler, so
+ * both sides have the same grouping and the same PDID limit.
+ */
+
+#ifndef PERIODIC_DID_SCHEDULER_HPP
+#define PERIODIC_DID_SCHEDULER_HPP
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace vmg {
+
+/**
+ * @brief 0x2A transmissionMode
+ */
+enum class PeriodicRate : uint8_t {
+    Slow = 0x01,
+    Medium = 0x02,
+    Fast = 0x03,
+    Stop = 0x04
+};
+
+constexpr uint16_t PERIODIC_DID_BASE = 0xF200;  // PDID n reads DID 0xF200 | n
+constexpr uint64_t PERIODIC_NONE_DUE = UINT64_MAX;
+
+/**
+ * @brief Periodic scheduler configuration
+ */
+struct PeriodicSchedulerConfig {
+    uint32_t slow_ms = 1000;
+    uint32_t medium_ms = 200;
+    uint32_t fast_ms = 50;
+    size_t max_scheduled = 32;  // PDIDs across all groups, per tester
+};
+
+/**
+ * @brief Periodic scheduler statistics
+ */
+struct PeriodicSchedulerStats {
+    uint64_t frames = 0;          // Batched frames produced
+    uint64_t records = 0;         // PDID records across all frames
+    uint64_t skipped_slots = 0;   // Deadlines missed (no catch-up burst)
+};
+
+/**
+ * @brief Rate-grouped PDID scheduler
+ *
+ * One schedule per tester. Not thread-safe; the owner serializes access
+ * (UDSServiceHandler is called under the DoIP server's UDS mutex).
+ */
+class PeriodicDIDScheduler {
+public:
+    explicit PeriodicDIDScheduler(const PeriodicSchedulerConfig& config = PeriodicSchedulerConfig());
+
+    /**
+     * @brief Add PDID to a rate group (moves it if already scheduled)
+     *
+     * A newly started group is due immediately.
+     *
+     * @return false if max_scheduled would be exceeded
+     */
+    bool schedule(uint8_t pdid, PeriodicRate rate);
+
+    void stop(uint8_t pdid);
+    void stopAll();
+
+    bool empty() const { return scheduled_ == 0; }
+    size_t size() const { return scheduled_; }
+
+    /**
+     * @brief Collect PDIDs of every group due at now_ms
+     *
+     * Due groups advance to their next aligned deadline after now_ms.
+     *
+     * @param pdids Output PDIDs (slow group first)
+     * @param cap Output capacity
+     * @return Number of PDIDs written
+     */
+    size_t collectDue(uint64_t now_ms, uint8_t* pdids, size_t cap);
+
+    /**
+     * @brief Earliest deadline, PERIODIC_NONE_DUE if nothing scheduled
+     */
+    uint64_t nextDueMs() const;
+
+    void recordFrame(size_t records) { stats_.frames++; stats_.records += records; }
+    const PeriodicSchedulerStats& getStats() const { return stats_; }
+
+private:
+    struct RateGroup {
+        uint32_t period_ms;
+        uint64_t next_due_ms;
+        std::vector<uint8_t> pdids;
+    };
+
+    static size_t groupIndex(PeriodicRate rate) { return static_cast<size_t>(rate) - 1; }
+
+    PeriodicSchedulerConfig config_;
+    std::array<RateGroup, 3> groups_;
+    size_t scheduled_;
+    PeriodicSchedulerStats stats_;
+};
+
+} // namespace vmg
+
+#endif // PERIODIC_DID_SCHEDULER_HPP
@@ -50,6 +50,7 @@ extern "C" {
 
 /* UDS Positive Response Offset */
 #define UDS_POSITIVE_RESPONSE_OFFSET            0x40
+#define UDS_NEGATIVE_RESPONSE                   0x7F
 
 /* Diagnostic Session Types */
 #define UDS_SESSION_DEFAULT                     0x01
@@ -88,6 +89,10 @@ extern "C" {
 #define UDS_DID_PROGRAMMING_COUNTER             0xF199
 #define UDS_DID_FINGERPRINT                     0xF15B
 
+/* Vehicle manufacturer specific DIDs (VCI reporting, written with 0x2E) */
+#define UDS_DID_ECU_VCI_RECORD                  0xF1A0  /* ECU -> ZG: own VCI record */
+#define UDS_DID_ZONE_VCI_REPORT                 0xF1A1  /* ZG -> VMG: zone VCI snapshot/delta */
+
 /* Routine Identifiers */
 #define UDS_ROUTINE_ERASE_MEMORY                0xFF00
 #define UDS_ROUTINE_CHECK_PROGRAMMING_DEPS      0xFF01
@@ -0,0 +1,182 @@
+/**
+ * @file zone_vci_codec.cpp
+ * @brief Zone VCI binary codec implementation
+ */
+
+#include "zone_vci_codec.hpp"
+#include <algorithm>
+
+namespace vmg {
+
+static void putU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+}
+
+static void putU32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+}
+
+static void putString(std::vector<uint8_t>& out, const std::string& value) {
+    size_t len = std::min<size_t>(value.size(), 255);
+    out.push_back(static_cast<uint8_t>(len));
+    out.insert(out.end(), value.begin(), value.begin() + len);
+}
+
+static bool getU8(const uint8_t*& p, const uint8_t* end, uint8_t& value) {
+    if (end - p < 1) return false;
+    value = *p++;
+    return true;
+}
+
+static bool getU16(const uint8_t*& p, const uint8_t* end, uint16_t& value) {
+    if (end - p < 2) return false;
+    value = static_cast<uint16_t>((p[0] << 8) | p[1]);
+    p += 2;
+    return true;
+}
+
+static bool getU32(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+    if (end - p < 4) return false;
+    value = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+            (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    p += 4;
+    return true;
+}
+
+static bool getString(const uint8_t*& p, const uint8_t* end, std::string& value) {
+    uint8_t len;
+    if (!getU8(p, end, len) || end - p < len) return false;
+    value.assign(reinterpret_cast<const char*>(p), len);
+    p += len;
+    return true;
+}
+
+void ZoneVCICodec::encodeECURecord(const ZoneECUInfo& ecu, std::vector<uint8_t>& out) {
+    uint8_t flags = (ecu.is_online ? 0x01 : 0) |
+                    (ecu.ota_capable ? 0x02 : 0) |
+                    (ecu.delta_update_supported ? 0x04 : 0);
+
+    putU16(out, ecu.logical_address);
+    out.push_back(flags);
+    putU32(out, ecu.max_package_size);
+    putString(out, ecu.ecu_id);
+    putString(out, ecu.firmware_version);
+    putString(out, ecu.hardware_version);
+}
+
+bool ZoneVCICodec::decodeECURecord(const uint8_t*& p, const uint8_t* end, ZoneECUInfo& ecu) {
+    uint8_t flags;
+    if (!getU16(p, end, ecu.logical_address) ||
+        !getU8(p, end, flags) ||
+        !getU32(p, end, ecu.max_package_size) ||
+        !getString(p, end, ecu.ecu_id) ||
+        !getString(p, end, ecu.firmware_version) ||
+        !getString(p, end, ecu.hardware_version)) {
+        return false;
+    }
+
+    ecu.is_online = (flags & 0x01) != 0;
+    ecu.ota_capable = (flags & 0x02) != 0;
+    ecu.delta_update_supported = (flags & 0x04) != 0;
+    return true;
+}
+
+std::vector<uint8_t> ZoneVCICodec::encodeReport(const ZoneVCIData& vci, uint32_t since_generation) {
+    bool full = (since_generation == 0);
+    std::vector<uint8_t> out;
+    out.reserve(32 + (full ? vci.ecus.size() * 64 : 64));
+
+    out.push_back('Z');
+    out.push_back('V');
+    out.push_back(ZONE_VCI_REPORT_VERSION);
+    out.push_back(full ? ZONE_VCI_FLAG_FULL : 0);
+    out.push_back(vci.zone_id);
+    putU32(out, since_generation);
+    putU32(out, vci.generation);
+    putU32(out, vci.total_storage_mb);
+    putU32(out, vci.available_storage_mb);
+    out.push_back(vci.average_battery_level);
+
+    size_t count_pos = out.size();
+    out.push_back(0);
+
+    uint8_t count = 0;
+    for (const auto& ecu : vci.ecus) {
+        if (full || ecu.generation > since_generation) {
+            putU32(out, ecu.generation);
+            encodeECURecord(ecu, out);
+            count++;
+        }
+    }
+    out[count_pos] = count;
+
+    return out;
+}
+
+bool ZoneVCICodec::applyReport(const uint8_t* data, size_t len, ZoneVCIData& vci) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + len;
+
+    uint8_t magic0, magic1, version, flags, zone_id, battery, count;
+    uint32_t base_generation, generation, total_storage, available_storage;
+    if (!getU8(p, end, magic0) || !getU8(p, end, magic1) || magic0 != 'Z' || magic1 != 'V' ||
+        !getU8(p, end, version) || version != ZONE_VCI_REPORT_VERSION ||
+        !getU8(p, end, flags) || !getU8(p, end, zone_id) ||
+        !getU32(p, end, base_generation) || !getU32(p, end, generation) ||
+        !getU32(p, end, total_storage) || !getU32(p, end, available_storage) ||
+        !getU8(p, end, battery) || !getU8(p, end, count)) {
+        return false;
+    }
+
+    bool full = (flags & ZONE_VCI_FLAG_FULL) != 0;
+    if (!full && (vci.zone_id != zone_id || vci.generation != base_generation)) {
+        return false;  // Missed an update: receiver must wait for a full snapshot
+    }
+
+    std::vector<ZoneECUInfo> records(count);
+    for (auto& record : records) {
+        record = ZoneECUInfo{};
+        if (!getU32(p, end, record.generation) || !decodeECURecord(p, end, record)) {
+            return false;
+        }
+    }
+
+    if (full) {
+        vci.ecus = std::move(records);
+    } else {
+        for (auto& record : records) {
+            auto it = std::find_if(vci.ecus.begin(), vci.ecus.end(), [&](const ZoneECUInfo& ecu) {
+                // DoIP ECUs are keyed by address, JSON-only ECUs (address 0) by ID
+                return record.logical_address != 0 ? ecu.logical_address == record.logical_address
+                                                   : ecu.ecu_id == record.ecu_id;
+            });
+            if (it != vci.ecus.end()) {
+                *it = std::move(record);
+            } else {
+                vci.ecus.push_back(std::move(record));
+            }
+        }
+    }
+
+    vci.zone_id = zone_id;
+    vci.generation = generation;
+    vci.total_storage_mb = total_storage;
+    vci.available_storage_mb = available_storage;
+    vci.average_battery_level = battery;
+    return true;
+}
+
+bool ZoneVCICodec::reportZoneID(const uint8_t* data, size_t len, uint8_t& zone_id) {
+    // 'Z' 'V' | version | flags | zone_id
+    if (len < 5 || data[0] != 'Z' || data[1] != 'V' || data[2] != ZONE_VCI_REPORT_VERSION) {
+        return false;
+    }
+    zone_id = data[4];
+    return true;
+}
+
+} // namespace vmg
@@ -0,0 +1,104 @@
+/**
+ * @file zone_vci_codec.hpp
+ * @brief Compact binary encoding of Zone VCI (snapshot / delta)
+ *
+ * ECU record (ECU -> ZG, UDS 0x2E F1A0), big-endian:
+ *   logical_address(2) | flags(1) | max_package_size(4) |
+ *   ecu_id_len(1) ecu_id | fw_len(1) fw | hw_len(1) hw
+ *   flags: bit0 online, bit1 ota_capable, bit2 delta_update_supported
+ *
+ * Zone report (ZG -> VMG, UDS 0x2E F1A1):
+ *   'Z' 'V' | version(1) | flags(1) | zone_id(1) |
+ *   base_generation(4) | generation(4) |
+ *   total_storage_mb(4) | available_storage_mb(4) | battery(1) |
+ *   count(1) | count x [ generation(4) | ECU record ]
+ *   flags: bit0 full snapshot (receiver replaces its copy)
+ *
+ * A delta carries only ECUs changed after base_generation; the receiver
+ * applies it only if base_generation matches what it holds.
+ *
+ * Shared by the zonal gateway (encoder) and the VMG (decoder). The VMG
+ * answers 0x6E F1A1 once a report is applied and NRC 0x22 when it is not,
+ * and the ZG then falls back to a full snapshot.
+ */
+
+#ifndef ZONE_VCI_CODEC_HPP
+#define ZONE_VCI_CODEC_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace vmg {
+
+/**
+ * @brief Zone 내 ECU 정보
+ */
+struct ZoneECUInfo {
+    std::string ecu_id;                 /* ECU ID */
+    uint16_t logical_address;           /* DoIP 논리 주소 */
+    std::string firmware_version;
+    std::string hardware_version;
+    bool is_online;
+    uint64_t last_heartbeat_time;       /* Not part of VCI: does not bump generation */
+    
+    /* Capabilities */
+    bool ota_capable;
+    bool delta_update_supported;
+    uint32_t max_package_size;
+    
+    uint32_t generation;                /* Store generation of last VCI change */
+};
+
+/**
+ * @brief Zone VCI 집계 데이터
+ */
+struct ZoneVCIData {
+    uint8_t zone_id;
+    std::vector<ZoneECUInfo> ecus;
+    
+    /* Zone 통계 */
+    uint32_t total_storage_mb;
+    uint32_t available_storage_mb;
+    uint8_t average_battery_level;
+    
+    uint32_t generation;                /* Bumped on every ECU VCI or zone status change */
+};
+
+
+constexpr uint8_t ZONE_VCI_REPORT_VERSION = 1;
+constexpr uint8_t ZONE_VCI_FLAG_FULL = 0x01;
+
+/**
+ * @brief Zone VCI binary codec
+ */
+class ZoneVCICodec {
+public:
+    /* ECU record */
+    static void encodeECURecord(const ZoneECUInfo& ecu, std::vector<uint8_t>& out);
+    static bool decodeECURecord(const uint8_t*& p, const uint8_t* end, ZoneECUInfo& ecu);
+
+    /**
+     * @brief Encode zone report
+     *
+     * @param vci Zone VCI store
+     * @param since_generation 0 for full snapshot, else last generation the receiver holds
+     * @return Encoded report
+     */
+    static std::vector<uint8_t> encodeReport(const ZoneVCIData& vci, uint32_t since_generation);
+
+    /**
+     * @brief Apply zone report to receiver copy (VMG side)
+     *
+     * @return false if malformed or a delta does not match the copy's generation
+     */
+    static bool applyReport(const uint8_t* data, size_t len, ZoneVCIData& vci);
+
+    // Zone ID of a report, so the receiver can pick the copy to apply it to
+    static bool reportZoneID(const uint8_t* data, size_t len, uint8_t& zone_id);
+};
+
+} // namespace vmg
+
+#endif /* ZONE_VCI_CODEC_HPP */
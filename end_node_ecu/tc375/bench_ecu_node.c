@@ -0,0 +1,510 @@
+/**
+ * @file bench_ecu_node.c
+ * @brief ECU node host build: CPU usage and response latency at N ECUs per host
+ *
+ * Runs N ECUNode_t instances (default 1000) in one thread against an
+ * in-process Zone Gateway on loopback. The ZG answers heartbeats and VCI
+ * reports and sends TesterPresent (0x3E 0x00) probes to random ECUs at a
+ * fixed rate, timing each response. Like the real ZG it only accepts ECU
+ * requests addressed to its own logical address (0x0200 + zone_id) and NACKs
+ * the rest; a mode fails unless every started node's F1A0 VCI report arrived.
+ *
+ * Two node loops are compared:
+ *   polled - ecu_run() on every node each 10 ms (the previous ecu_main loop)
+ *   event  - one epoll_wait() until the earliest timer deadline or a frame,
+ *            then ecu_process_rx() / ecu_process_timers() on those nodes only
+ *
+ * CPU is the node thread's CPU time over wall time; the ZG thread is not
+ * counted.
+ *
+ * Build:
+ *   gcc -O2 -o ecu_node_bench bench_ecu_node.c src/ecu_node.c \
+ *       ../../tc375_bootloader/common/doip_client.c \
+ *       ../../tc375_bootloader/common/doip_message.c \
+ *       ../../tc375_bootloader/common/doip_socket_lwip.c \
+ *       ../../tc375_bootloader/common/uds_handler.c \
+ *       -Iinclude -I../../tc375_bootloader/common -lpthread
+ *
+ * Usage: ./ecu_node_bench [ecus] [seconds] [probes_per_sec]
+ */
+
+#define _GNU_SOURCE     // epoll, accept4
+
+#include "ecu_node.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define ZG_ADDRESS          0x0201  // Zone 1
+#define TESTER_ADDRESS      0x0E00
+#define ECU_BASE_ADDRESS    0x1000
+#define EPOLL_BATCH         64
+
+typedef struct {
+    int fd;
+    uint16_t ecu_address;
+    uint8_t rx[1024];
+    size_t rx_len;
+    uint64_t probe_sent_us;         /* 0 = no probe outstanding */
+    int vci_received;
+} ZGConn_t;
+
+typedef struct {
+    int listen_fd;
+    uint16_t port;
+    uint32_t probes_per_sec;
+    volatile int running;
+    volatile int measuring;
+
+    ZGConn_t* conns;
+    uint32_t conn_count;
+    uint32_t conn_cap;
+
+    uint32_t* latency_us;
+    uint32_t latency_count;
+    uint32_t latency_cap;
+    uint32_t probes_sent;
+    uint32_t heartbeats;
+    uint32_t vci_reports;
+    uint32_t nacks;
+} BenchZG_t;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static uint64_t thread_cpu_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static uint32_t xorshift32(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void send_all(int fd, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+// UDS platform hooks used by uds_handler.c (not exercised by the probes)
+uint32_t uds_platform_get_tick_ms(void) { return ecu_get_tick_ms(); }
+void uds_platform_ecu_reset(uint8_t reset_type) { (void)reset_type; }
+int uds_platform_fill_random(uint8_t* out, size_t len) { memset(out, 0x5A, len); return 0; }
+int uds_platform_calculate_key(uint8_t level, const uint8_t* seed, size_t seed_len,
+                               uint8_t* key, size_t key_len) {
+    (void)level;
+    for (size_t i = 0; i < key_len; i++) {
+        key[i] = (uint8_t)(seed[i % seed_len] ^ 0xA5);
+    }
+    return 0;
+}
+int uds_platform_write_firmware(uint32_t address, const uint8_t* data, size_t len) {
+    (void)address; (void)data; (void)len;
+    return 0;
+}
+
+// ============================================================================
+// Zone Gateway side
+// ============================================================================
+
+static void zg_handle_frame(BenchZG_t* zg, ZGConn_t* conn, const DoIPHeader_t* header,
+                            const uint8_t* payload) {
+    uint8_t out[64];
+    size_t len = 0;
+
+    if (header->payload_type == DOIP_ROUTING_ACTIVATION_REQ && header->payload_length >= 2) {
+        conn->ecu_address = (uint16_t)((payload[0] << 8) | payload[1]);
+        uint8_t res[9] = { payload[0], payload[1], ZG_ADDRESS >> 8, ZG_ADDRESS & 0xFF,
+                           DOIP_RA_RES_SUCCESS, 0, 0, 0, 0 };
+        len = doip_build_message(DOIP_ROUTING_ACTIVATION_RES, res, sizeof(res), out, sizeof(out));
+        send_all(conn->fd, out, len);
+        return;
+    }
+
+    if (header->payload_type != DOIP_DIAGNOSTIC_MESSAGE) {
+        return;     // ACKs from the ECU
+    }
+
+    uint16_t source, target;
+    const uint8_t* uds = NULL;
+    size_t uds_len = 0;
+    if (doip_parse_diagnostic_message(payload, header->payload_length, &source, &target,
+                                      &uds, &uds_len) != 0 || uds_len == 0) {
+        return;
+    }
+
+    if (uds[0] & UDS_POSITIVE_RESPONSE_OFFSET) {
+        // Answer to our probe
+        if (conn->probe_sent_us != 0) {
+            if (zg->measuring && zg->latency_count < zg->latency_cap) {
+                zg->latency_us[zg->latency_count++] = (uint32_t)(now_us() - conn->probe_sent_us);
+            }
+            conn->probe_sent_us = 0;
+        }
+        return;
+    }
+
+    if (target != ZG_ADDRESS) {
+        uint8_t nack[5] = { (uint8_t)(target >> 8), (uint8_t)(target & 0xFF), (uint8_t)(source >> 8),
+                            (uint8_t)(source & 0xFF), DOIP_DIAG_NACK_UNKNOWN_TA };
+        len = doip_build_message(DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK, nack, sizeof(nack), out, sizeof(out));
+        send_all(conn->fd, out, len);
+        zg->nacks++;
+        return;
+    }
+
+    // ECU request: ACK + response
+    uint8_t ack[5] = { ZG_ADDRESS >> 8, ZG_ADDRESS & 0xFF, (uint8_t)(source >> 8),
+                       (uint8_t)(source & 0xFF), DOIP_DIAG_ACK_CONFIRM };
+    len = doip_build_message(DOIP_DIAGNOSTIC_MESSAGE_POS_ACK, ack, sizeof(ack), out, sizeof(out));
+
+    uint8_t rsp[3];
+    size_t rsp_len;
+    if (uds[0] == UDS_SID_TESTER_PRESENT) {
+        rsp[0] = UDS_SID_TESTER_PRESENT + UDS_POSITIVE_RESPONSE_OFFSET;
+        rsp[1] = 0x00;
+        rsp_len = 2;
+        zg->heartbeats++;
+    } else if (uds[0] == UDS_SID_WRITE_DATA_BY_IDENTIFIER && uds_len >= 3) {
+        rsp[0] = UDS_SID_WRITE_DATA_BY_IDENTIFIER + UDS_POSITIVE_RESPONSE_OFFSET;
+        rsp[1] = uds[1];
+        rsp[2] = uds[2];
+        rsp_len = 3;
+        if (uds[1] == 0xF1 && uds[2] == 0xA0 && !conn->vci_received) {
+            conn->vci_received = 1;
+            zg->vci_reports++;
+        }
+    } else {
+        rsp[0] = UDS_NRC;
+        rsp[1] = uds[0];
+        rsp[2] = UDS_NRC_SERVICE_NOT_SUPPORTED;
+        rsp_len = 3;
+    }
+    len += doip_build_diagnostic_message(ZG_ADDRESS, source, rsp, rsp_len, out + len, sizeof(out) - len);
+    send_all(conn->fd, out, len);
+}
+
+static void zg_read(BenchZG_t* zg, ZGConn_t* conn) {
+    ssize_t n = recv(conn->fd, conn->rx + conn->rx_len, sizeof(conn->rx) - conn->rx_len, 0);
+    if (n <= 0) {
+        return;
+    }
+    conn->rx_len += (size_t)n;
+
+    size_t pos = 0;
+    DoIPHeader_t header;
+    const uint8_t* payload = NULL;
+    while (doip_parse_message(conn->rx + pos, conn->rx_len - pos, &header, &payload) == 0) {
+        zg_handle_frame(zg, conn, &header, payload);
+        pos += DOIP_HEADER_SIZE + header.payload_length;
+    }
+    memmove(conn->rx, conn->rx + pos, conn->rx_len - pos);
+    conn->rx_len -= pos;
+}
+
+static void zg_send_probe(BenchZG_t* zg, uint32_t* seed) {
+    if (zg->conn_count == 0) {
+        return;
+    }
+
+    ZGConn_t* conn = &zg->conns[xorshift32(seed) % zg->conn_count];
+    if (conn->probe_sent_us != 0 || conn->ecu_address == 0) {
+        return;     // Previous probe still open
+    }
+
+    static const uint8_t probe[] = { UDS_SID_TESTER_PRESENT, 0x00 };
+    uint8_t out[DOIP_HEADER_SIZE + 4 + sizeof(probe)];
+    size_t len = doip_build_diagnostic_message(TESTER_ADDRESS, conn->ecu_address, probe, sizeof(probe),
+                                               out, sizeof(out));
+    conn->probe_sent_us = now_us();
+    send_all(conn->fd, out, len);
+    if (zg->measuring) {
+        zg->probes_sent++;
+    }
+}
+
+static void* zg_thread(void* arg) {
+    BenchZG_t* zg = (BenchZG_t*)arg;
+    struct epoll_event events[EPOLL_BATCH];
+    uint32_t seed = 0xC0FFEEu;
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = UINT32_MAX };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, zg->listen_fd, &ev);
+
+    uint64_t probe_interval_us = zg->probes_per_sec ? 1000000u / zg->probes_per_sec : 0;
+    uint64_t next_probe_us = now_us();
+
+    while (zg->running) {
+        int timeout_ms = 1;
+        int n = epoll_wait(epfd, events, EPOLL_BATCH, timeout_ms);
+
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u32 == UINT32_MAX) {
+                int fd = accept4(zg->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+                if (fd < 0 || zg->conn_count >= zg->conn_cap) {
+                    if (fd >= 0) close(fd);
+                    continue;
+                }
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                ZGConn_t* conn = &zg->conns[zg->conn_count];
+                memset(conn, 0, sizeof(*conn));
+                conn->fd = fd;
+                struct epoll_event cev = { .events = EPOLLIN, .data.u32 = zg->conn_count };
+                epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &cev);
+                zg->conn_count++;
+            } else {
+                zg_read(zg, &zg->conns[events[i].data.u32]);
+            }
+        }
+
+        if (probe_interval_us) {
+            uint64_t now = now_us();
+            while (next_probe_us <= now) {
+                if (zg->measuring) {
+                    zg_send_probe(zg, &seed);
+                }
+                next_probe_us += probe_interval_us;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < zg->conn_count; i++) {
+        close(zg->conns[i].fd);
+    }
+    close(epfd);
+    return NULL;
+}
+
+// ============================================================================
+// Node loops
+// ============================================================================
+
+static uint32_t run_polled(ECUNode_t* ecus, uint32_t count, uint64_t end_us) {
+    uint32_t wakeups = 0;
+    struct timespec tick = { 0, 10 * 1000000L };
+
+    while (now_us() < end_us) {
+        for (uint32_t i = 0; i < count; i++) {
+            ecu_run(&ecus[i]);
+        }
+        wakeups++;
+        nanosleep(&tick, NULL);
+    }
+    return wakeups;
+}
+
+static uint32_t run_event(ECUNode_t* ecus, uint32_t count, uint64_t end_us) {
+    struct epoll_event events[EPOLL_BATCH];
+    uint32_t wakeups = 0;
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    for (uint32_t i = 0; i < count; i++) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = i };
+        epoll_ctl(epfd, EPOLL_CTL_ADD, ecus[i].zg_client.tcp_socket, &ev);
+    }
+
+    for (;;) {
+        uint64_t now = now_us();
+        if (now >= end_us) {
+            break;
+        }
+
+        // Earliest deadline over all nodes: each queue is sorted, so only
+        // timers[0] is looked at
+        uint32_t tick = ecu_get_tick_ms();
+        uint32_t timeout_ms = (uint32_t)((end_us - now + 999) / 1000);
+        for (uint32_t i = 0; i < count; i++) {
+            if (ecus[i].timers.count > 0) {
+                int32_t left = (int32_t)(ecus[i].timers.timers[0].deadline_ms - tick);
+                uint32_t wait = left > 0 ? (uint32_t)left : 0;
+                if (wait < timeout_ms) timeout_ms = wait;
+            }
+        }
+
+        int n = epoll_wait(epfd, events, EPOLL_BATCH, (int)timeout_ms);
+        wakeups++;
+
+        for (int i = 0; i < n; i++) {
+            ecu_process_rx(&ecus[events[i].data.u32]);
+        }
+
+        tick = ecu_get_tick_ms();
+        for (uint32_t i = 0; i < count; i++) {
+            if (ecus[i].timers.count > 0 &&
+                (int32_t)(tick - ecus[i].timers.timers[0].deadline_ms) >= 0) {
+                ecu_process_timers(&ecus[i]);
+            }
+        }
+    }
+
+    close(epfd);
+    return wakeups;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t* sorted, uint32_t count, uint32_t pct) {
+    if (count == 0) return 0;
+    uint32_t rank = (pct * count + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static int run_mode(const char* name, int event_driven, uint32_t count, uint32_t seconds,
+                    uint32_t probes_per_sec) {
+    static BenchZG_t zg;
+    memset(&zg, 0, sizeof(zg));
+    zg.probes_per_sec = probes_per_sec;
+    zg.conn_cap = count;
+    zg.conns = calloc(count, sizeof(ZGConn_t));
+    zg.latency_cap = probes_per_sec * seconds + 1;
+    zg.latency_us = calloc(zg.latency_cap, sizeof(uint32_t));
+    ECUNode_t* ecus = calloc(count, sizeof(ECUNode_t));
+    if (!zg.conns || !zg.latency_us || !ecus) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+
+    zg.listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(zg.listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(zg.listen_fd, 1024) != 0 ||
+        getsockname(zg.listen_fd, (struct sockaddr*)&addr, &addr_len) != 0) {
+        perror("listen");
+        return -1;
+    }
+    zg.port = ntohs(addr.sin_port);
+    zg.running = 1;
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, zg_thread, &zg);
+
+    // Node start-up is chatty; keep the report readable
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+
+    uint32_t started = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        char ecu_id[32];
+        snprintf(ecu_id, sizeof(ecu_id), "BENCH-ECU-%04u", i);
+        ecu_init(&ecus[i], ecu_id, (uint16_t)(ECU_BASE_ADDRESS + i), "127.0.0.1", zg.port);
+        if (ecu_start(&ecus[i]) == 0) {
+            started++;
+        }
+        int one = 1;
+        setsockopt(ecus[i].zg_client.tcp_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    // Let the initial VCI reports settle before measuring
+    for (uint32_t i = 0; i < 50; i++) {
+        for (uint32_t j = 0; j < count; j++) {
+            ecu_run(&ecus[j]);
+        }
+    }
+
+    zg.measuring = 1;
+    uint64_t t0 = now_us();
+    uint64_t c0 = thread_cpu_us();
+    uint32_t wakeups = event_driven ? run_event(ecus, count, t0 + seconds * 1000000ull)
+                                    : run_polled(ecus, count, t0 + seconds * 1000000ull);
+    uint64_t c1 = thread_cpu_us();
+    uint64_t t1 = now_us();
+    zg.measuring = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        ecu_stop(&ecus[i]);
+    }
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    close(devnull);
+
+    zg.running = 0;
+    pthread_join(thread, NULL);
+    close(zg.listen_fd);
+
+    qsort(zg.latency_us, zg.latency_count, sizeof(uint32_t), compare_u32);
+    double wall = (double)(t1 - t0) / 1e6;
+    printf("  %-7s %5u/%-5u %7.2f%% %10.0f %8u/%-8u %8u %8u %8u %6u %5u %5u\n",
+           name, started, count,
+           100.0 * (double)(c1 - c0) / (double)(t1 - t0),
+           wakeups / wall,
+           zg.latency_count, zg.probes_sent,
+           percentile(zg.latency_us, zg.latency_count, 50),
+           percentile(zg.latency_us, zg.latency_count, 99),
+           zg.latency_count ? zg.latency_us[zg.latency_count - 1] : 0,
+           zg.heartbeats, zg.vci_reports, zg.nacks);
+    if (zg.vci_reports != started || zg.nacks != 0) {
+        fprintf(stderr, "  %s: %u/%u VCI reports arrived, %u frames NACKed\n",
+                name, zg.vci_reports, started, zg.nacks);
+    }
+
+    free(ecus);
+    free(zg.conns);
+    free(zg.latency_us);
+    return (started == count && zg.vci_reports == started && zg.nacks == 0) ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 1000u;
+    uint32_t seconds = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 20u;
+    uint32_t probes = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 10) : 200u;
+    if (count == 0 || count > 0xE000 || seconds == 0) {
+        fprintf(stderr, "Usage: %s [ecus] [seconds] [probes_per_sec]\n", argv[0]);
+        return 1;
+    }
+
+    // Two sockets per ECU in this process
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < 2 * count + 64) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    printf("ECU node benchmark (%u ECUs, %u s, %u probes/s, heartbeat %u ms)\n",
+           count, seconds, probes, ECU_HEARTBEAT_INTERVAL_MS);
+    printf("  %-7s %11s %8s %10s %17s %8s %8s %8s %6s %5s %5s\n",
+           "loop", "started", "cpu", "wakeups/s", "answered/probes", "p50 us", "p99 us", "max us", "hb",
+           "vci", "nack");
+
+    int ret = 0;
+    ret |= run_mode("polled", 0, count, seconds, probes);
+    ret |= run_mode("event", 1, count, seconds, probes);
+    return ret ? 1 : 0;
+}
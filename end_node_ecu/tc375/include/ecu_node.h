@@ -25,6 +25,31 @@ extern "C" {
 #define ECU_MAX_DIAG_BUFFER_SIZE    4096
 #define ECU_HEARTBEAT_INTERVAL_MS   10000
 #define ECU_VCI_UPDATE_INTERVAL_MS  60000
+#define ECU_RECONNECT_INTERVAL_MS   5000
+#define ECU_VCI_RECORD_MAX_SIZE     96      /* 0x2E F1A0 request: header + record */
+
+/**
+ * @brief ECU Node 타이머
+ */
+typedef enum {
+    ECU_TIMER_HEARTBEAT = 0,
+    ECU_TIMER_VCI_UPDATE,
+    ECU_TIMER_RECONNECT,
+    ECU_TIMER_COUNT
+} ECUTimerId_t;
+
+typedef struct {
+    uint32_t deadline_ms;
+    ECUTimerId_t id;
+} ECUTimer_t;
+
+/**
+ * @brief Deadline 순으로 정렬된 타이머 큐 (타이머 ID당 최대 1개)
+ */
+typedef struct {
+    ECUTimer_t timers[ECU_TIMER_COUNT];     /* timers[0] = 가장 이른 deadline */
+    uint8_t count;
+} ECUTimerQueue_t;
 
 /**
  * @brief ECU Node 상태
@@ -44,7 +69,7 @@ typedef enum {
 typedef struct {
     /* Identity */
     char ecu_id[32];                    /* ECU ID (e.g., "TC375-ECU-002") */
-    uint16_t logical_address;           /* DoIP 논리 주소 (e.g., 0x0201) */
+    uint16_t logical_address;           /* DoIP 논리 주소 (e.g., 0x0211) */
     char firmware_version[16];          /* 현재 펌웨어 버전 */
     char hardware_version[32];          /* 하드웨어 버전 */
     
@@ -66,11 +91,19 @@ typedef struct {
     uint32_t max_package_size;
     
     /* Timing */
-    uint32_t last_heartbeat_time;
-    uint32_t last_vci_update_time;
+    ECUTimerQueue_t timers;
+    
+    /* Last VCI record acknowledged by ZG (sent again only when it changes) */
+    uint8_t vci_reported[ECU_VCI_RECORD_MAX_SIZE];
+    size_t vci_reported_len;            /* 0 = not reported on this connection */
+    
+    /* VCI record sent, waiting for 0x6E (responses arrive via ecu_process_rx) */
+    uint8_t vci_pending[ECU_VCI_RECORD_MAX_SIZE];
+    size_t vci_pending_len;
     
     /* Buffers */
     uint8_t rx_buffer[ECU_MAX_DIAG_BUFFER_SIZE];
+    size_t rx_len;                      /* Partial DoIP frames from ZG */
     uint8_t tx_buffer[ECU_MAX_DIAG_BUFFER_SIZE];
     
 } ECUNode_t;
@@ -80,7 +113,7 @@ typedef struct {
  * 
  * @param ecu ECU Node context
  * @param ecu_id ECU ID string
- * @param logical_addr DoIP logical address
+ * @param logical_addr DoIP logical address (must not collide with a ZG 0x0200 + zone_id)
  * @param zg_ip Zone Gateway IP
  * @param zg_port Zone Gateway port
  * @return 0 on success, -1 on error
@@ -106,10 +139,49 @@ void ecu_stop(ECUNode_t* ecu);
 /**
  * @brief Main loop (non-blocking)
  * 
+ * Runs expired timers and handles frames already received; never waits.
+ * 
  * @param ecu ECU Node context
  */
 void ecu_run(ECUNode_t* ecu);
 
+/**
+ * @brief Sleep until the next timer deadline or a frame from ZG, then handle it
+ * 
+ * @param ecu ECU Node context
+ * @param max_wait_ms Upper bound on the wait (DOIP_WAIT_FOREVER = next event)
+ * @return 0 on success, -1 on error
+ */
+int ecu_poll(ECUNode_t* ecu, uint32_t max_wait_ms);
+
+/**
+ * @brief Time until the earliest timer deadline
+ * 
+ * For hosts that multiplex many nodes in one event loop.
+ * 
+ * @param ecu ECU Node context
+ * @return ms until the next deadline (0 if due), DOIP_WAIT_FOREVER if none
+ */
+uint32_t ecu_next_timeout_ms(const ECUNode_t* ecu);
+
+/**
+ * @brief Run timers whose deadline has passed
+ * 
+ * @param ecu ECU Node context
+ */
+void ecu_process_timers(ECUNode_t* ecu);
+
+/**
+ * @brief Read and handle frames from ZG (call when the socket is readable)
+ * 
+ * Answers diagnostic requests and alive checks, and completes the node's
+ * own heartbeat / VCI requests.
+ * 
+ * @param ecu ECU Node context
+ * @return 0 on success, -1 if the connection was lost
+ */
+int ecu_process_rx(ECUNode_t* ecu);
+
 /* ========== Zone Gateway Connection ========== */
 
 /**
@@ -131,6 +203,8 @@ int ecu_connect_to_zg(ECUNode_t* ecu);
 /**
  * @brief Send heartbeat to Zone Gateway
  * 
+ * Does not wait for the response; it is consumed by ecu_process_rx().
+ * 
  * @param ecu ECU Node context
  * @return 0 on success, -1 on error
  */
@@ -138,6 +212,10 @@ int ecu_send_heartbeat(ECUNode_t* ecu);
 
 /**
  * @brief Send VCI info to Zone Gateway
+ *
+ * UDS 0x2E F1A0 with the binary ECU record (see zone_vci_codec.hpp).
+ * Skipped when the record is unchanged since the last acknowledged send
+ * or already in flight. The 0x6E response is handled by ecu_process_rx().
  * 
  * @param ecu ECU Node context
  * @return 0 on success, -1 on error
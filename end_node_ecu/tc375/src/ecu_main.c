@@ -5,11 +5,10 @@
 
 #include "ecu_node.h"
 #include <stdio.h>
-#include <unistd.h>
 
 /* ECU Configuration */
 #define ECU_ID              "TC375-ECU-002-Zone1-ECU1"
-#define ECU_LOGICAL_ADDR    0x0201
+#define ECU_LOGICAL_ADDR    0x0211  /* Zone 1, ECU 1; 0x0201 is the ZG itself */
 #define ZG_IP               "192.168.1.10"
 #define ZG_PORT             13400
 
@@ -40,11 +39,10 @@ int main(void) {
     /* Main loop */
     printf("[OPERATION] Entering main loop...\n");
     printf("  - Heartbeat to ZG: Every 10 seconds\n");
-    printf("  - VCI update: Every 60 seconds\n\n");
+    printf("  - VCI update: Every 60 seconds (sent only if changed)\n\n");
     
-    while (1) {
-        ecu_run(&ecu);
-        usleep(10000); // 10ms
+    /* Sleeps until the next timer deadline or a frame from ZG */
+    while (ecu_poll(&ecu, DOIP_WAIT_FOREVER) == 0) {
     }
     
     /* Cleanup */
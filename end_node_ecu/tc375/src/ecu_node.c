@@ -3,12 +3,142 @@
  * @brief End Node ECU Implementation for TC375
  */
 
+#if defined(__unix__) && !defined(USE_FREERTOS) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L     // clock_gettime(), nanosleep()
+#endif
+
 #include "ecu_node.h"
 #include "doip_client.h"
+#include "doip_message.h"
 #include "uds_handler.h"
 #include <stdio.h>
 #include <string.h>
 
+#ifdef USE_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#elif defined(__unix__)
+#include <time.h>
+#else
+#include "IfxStm.h"
+#include "IfxCpu_Irq.h"
+#endif
+
+/* ========== Timer Queue ========== */
+
+static bool ecu_deadline_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;    /* Wraps with the 32-bit tick */
+}
+
+static void ecu_timer_cancel(ECUNode_t* ecu, ECUTimerId_t id) {
+    ECUTimerQueue_t* q = &ecu->timers;
+    
+    for (uint8_t i = 0; i < q->count; i++) {
+        if (q->timers[i].id == id) {
+            memmove(&q->timers[i], &q->timers[i + 1], (q->count - i - 1) * sizeof(ECUTimer_t));
+            q->count--;
+            return;
+        }
+    }
+}
+
+/* Re-arming an active timer moves it; the queue stays sorted by deadline */
+static void ecu_timer_schedule(ECUNode_t* ecu, ECUTimerId_t id, uint32_t deadline_ms) {
+    ECUTimerQueue_t* q = &ecu->timers;
+    
+    ecu_timer_cancel(ecu, id);
+    
+    uint8_t pos = q->count;
+    while (pos > 0 && ecu_deadline_before(deadline_ms, q->timers[pos - 1].deadline_ms)) {
+        q->timers[pos] = q->timers[pos - 1];
+        pos--;
+    }
+    q->timers[pos].deadline_ms = deadline_ms;
+    q->timers[pos].id = id;
+    q->count++;
+}
+
+#if !defined(USE_FREERTOS) && !defined(__unix__)
+/* Bare metal: STM0 is the tick, comparator 0 wakes the core from WAIT */
+#define ECU_STM_ISR_PRIORITY    10
+
+static bool ecu_stm_compare_ready = false;
+
+/* Nothing to do: the compare request only has to end the WAIT */
+IFX_INTERRUPT(ecu_stm_compare_isr, 0, ECU_STM_ISR_PRIORITY) {
+}
+
+static uint32_t ecu_stm_ticks_per_ms(void) {
+    return (uint32_t)(IfxStm_getFrequency(&MODULE_STM0) / 1000.0f);
+}
+#endif
+
+static void ecu_sleep_ms(uint32_t ms) {
+#ifdef USE_FREERTOS
+    vTaskDelay(pdMS_TO_TICKS(ms));
+#elif defined(__unix__)
+    struct timespec ts = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+#else
+    Ifx_STM* stm = &MODULE_STM0;
+    uint32_t deadline = ecu_get_tick_ms() + ms;
+    
+    if (!ecu_stm_compare_ready) {
+        IfxStm_CompareConfig config;
+        IfxStm_initCompareConfig(&config);
+        config.comparator = IfxStm_Comparator_0;
+        config.comparatorInterrupt = IfxStm_ComparatorInterrupt_ir0;
+        config.triggerPriority = ECU_STM_ISR_PRIORITY;
+        config.typeOfService = IfxSrc_Tos_cpu0;
+        config.ticks = ms * ecu_stm_ticks_per_ms();
+        IfxStm_initCompare(stm, &config);
+        ecu_stm_compare_ready = true;
+    } else {
+        IfxStm_updateCompare(stm, IfxStm_Comparator_0,
+                             IfxStm_getLower(stm) + ms * ecu_stm_ticks_per_ms());
+    }
+    
+    /* Other interrupts (Ethernet) also end WAIT; sleep again until the deadline */
+    while (ecu_deadline_before(ecu_get_tick_ms(), deadline)) {
+        __asm__ volatile ("wait");
+    }
+#endif
+}
+
+/* ========== ZG Link ========== */
+
+static void ecu_connection_lost(ECUNode_t* ecu) {
+    fprintf(stderr, "[ECU] Connection to Zone Gateway lost\n");
+    
+    doip_client_disconnect(&ecu->zg_client);
+    ecu->zg_connected = false;
+    ecu->rx_len = 0;
+    ecu->state = ECU_STATE_CONNECTING;
+    
+    ecu_timer_cancel(ecu, ECU_TIMER_HEARTBEAT);
+    ecu_timer_cancel(ecu, ECU_TIMER_VCI_UPDATE);
+    ecu_timer_schedule(ecu, ECU_TIMER_RECONNECT, ecu_get_tick_ms() + ECU_RECONNECT_INTERVAL_MS);
+}
+
+static int ecu_send_frame(ECUNode_t* ecu, const uint8_t* frame, size_t len) {
+    if (len == 0) return -1;
+    
+    if (doip_socket_tcp_send(ecu->zg_client.tcp_socket, frame, len) != (int)len) {
+        ecu_connection_lost(ecu);
+        return -1;
+    }
+    return 0;
+}
+
+/* Fire and forget: the response is matched in ecu_handle_response() */
+static int ecu_send_request(ECUNode_t* ecu, const uint8_t* uds, size_t uds_len) {
+    size_t msg_len = doip_build_diagnostic_message(ecu->zg_client.source_address,
+                                                   ecu->zg_client.target_address,
+                                                   uds, uds_len,
+                                                   ecu->tx_buffer, sizeof(ecu->tx_buffer));
+    return ecu_send_frame(ecu, ecu->tx_buffer, msg_len);
+}
+
 int ecu_init(ECUNode_t* ecu, const char* ecu_id, uint16_t logical_addr,
              const char* zg_ip, uint16_t zg_port) {
     if (!ecu || !ecu_id || !zg_ip) return -1;
@@ -25,8 +155,8 @@ int ecu_init(ECUNode_t* ecu, const char* ecu_id, uint16_t logical_addr,
     strncpy(ecu->zg_ip, zg_ip, sizeof(ecu->zg_ip) - 1);
     ecu->zg_port = zg_port;
     
-    /* Initialize DoIP client */
-    doip_client_init(&ecu->zg_client, zg_ip, zg_port, logical_addr, 0x0200);
+    /* Initialize DoIP client; the ZG address comes from routing activation */
+    doip_client_init(&ecu->zg_client, zg_ip, zg_port, logical_addr, 0x0000);
     
     /* Initialize UDS handler */
     uds_handler_init(&ecu->uds_handler);
@@ -64,6 +194,7 @@ void ecu_stop(ECUNode_t* ecu) {
         doip_client_disconnect(&ecu->zg_client);
         ecu->zg_connected = false;
     }
+    ecu->timers.count = 0;
     
     ecu->state = ECU_STATE_INIT;
     printf("[ECU] ECU Node stopped: %s\n", ecu->ecu_id);
@@ -72,22 +203,78 @@ void ecu_stop(ECUNode_t* ecu) {
 void ecu_run(ECUNode_t* ecu) {
     if (!ecu) return;
     
-    uint32_t current_time = ecu_get_tick_ms();
+    ecu_poll(ecu, 0);
+}
+
+int ecu_poll(ECUNode_t* ecu, uint32_t max_wait_ms) {
+    if (!ecu) return -1;
     
-    /* Send heartbeat */
-    if (current_time - ecu->last_heartbeat_time >= ECU_HEARTBEAT_INTERVAL_MS) {
-        ecu_send_heartbeat(ecu);
-        ecu->last_heartbeat_time = current_time;
+    uint32_t wait_ms = ecu_next_timeout_ms(ecu);
+    if (wait_ms > max_wait_ms) {
+        wait_ms = max_wait_ms;
     }
     
-    /* Send VCI update */
-    if (current_time - ecu->last_vci_update_time >= ECU_VCI_UPDATE_INTERVAL_MS) {
-        ecu_send_vci_info(ecu);
-        ecu->last_vci_update_time = current_time;
+    if (ecu->zg_connected) {
+        /* Sleeps in the network stack until a frame or the next deadline */
+        int ready = doip_socket_wait_readable(ecu->zg_client.tcp_socket, wait_ms);
+        if (ready < 0) {
+            ecu_connection_lost(ecu);
+        } else if (ready > 0) {
+            ecu_process_rx(ecu);
+        }
+    } else if (wait_ms == DOIP_WAIT_FOREVER) {
+        return -1;  /* Not started: nothing would ever wake us */
+    } else if (wait_ms > 0) {
+        ecu_sleep_ms(wait_ms);
     }
     
-    /* Handle incoming messages */
-    /* TODO: Implement message handling */
+    ecu_process_timers(ecu);
+    uds_handler_idle(&ecu->uds_handler);  /* Top up the 0x27 seed pool */
+    return 0;
+}
+
+uint32_t ecu_next_timeout_ms(const ECUNode_t* ecu) {
+    if (!ecu || ecu->timers.count == 0) return DOIP_WAIT_FOREVER;
+    
+    uint32_t now = ecu_get_tick_ms();
+    uint32_t deadline = ecu->timers.timers[0].deadline_ms;
+    return ecu_deadline_before(now, deadline) ? deadline - now : 0;
+}
+
+void ecu_process_timers(ECUNode_t* ecu) {
+    if (!ecu) return;
+    
+    uint32_t now = ecu_get_tick_ms();
+    
+    while (ecu->timers.count > 0 && !ecu_deadline_before(now, ecu->timers.timers[0].deadline_ms)) {
+        ECUTimerId_t id = ecu->timers.timers[0].id;
+        ecu_timer_cancel(ecu, id);
+        
+        /* Re-arm before sending: a lost connection cancels it again */
+        switch (id) {
+        case ECU_TIMER_HEARTBEAT:
+            ecu_timer_schedule(ecu, id, now + ECU_HEARTBEAT_INTERVAL_MS);
+            ecu_send_heartbeat(ecu);
+            break;
+            
+        case ECU_TIMER_VCI_UPDATE:
+            ecu_timer_schedule(ecu, id, now + ECU_VCI_UPDATE_INTERVAL_MS);
+            ecu->vci_pending_len = 0;   /* Never answered: send it again */
+            ecu_send_vci_info(ecu);
+            break;
+            
+        case ECU_TIMER_RECONNECT:
+            if (ecu_connect_to_zg(ecu) == 0) {
+                ecu->state = ECU_STATE_READY;
+            } else {
+                ecu_timer_schedule(ecu, id, now + ECU_RECONNECT_INTERVAL_MS);
+            }
+            break;
+            
+        default:
+            break;
+        }
+    }
 }
 
 int ecu_discover_zone_gateway(ECUNode_t* ecu) {
@@ -121,9 +308,23 @@ int ecu_connect_to_zg(ECUNode_t* ecu) {
         return -1;
     }
     
+    /* The ZG only accepts frames addressed to its own 0x0200 + zone_id */
+    ecu->zg_client.target_address = ecu->zg_client.entity_address;
+    
     ecu->zg_connected = true;
+    ecu->rx_len = 0;
     printf("[ECU] Connected to Zone Gateway\n");
     
+    uint32_t now = ecu_get_tick_ms();
+    ecu_timer_cancel(ecu, ECU_TIMER_RECONNECT);
+    ecu_timer_schedule(ecu, ECU_TIMER_HEARTBEAT, now + ECU_HEARTBEAT_INTERVAL_MS);
+    ecu_timer_schedule(ecu, ECU_TIMER_VCI_UPDATE, now + ECU_VCI_UPDATE_INTERVAL_MS);
+    
+    /* New ZG session: report VCI right away instead of at the next interval */
+    ecu->vci_reported_len = 0;
+    ecu->vci_pending_len = 0;
+    ecu_send_vci_info(ecu);
+    
     return 0;
 }
 
@@ -132,21 +333,183 @@ int ecu_send_heartbeat(ECUNode_t* ecu) {
     
     /* Send Tester Present (0x3E 0x00) */
     uint8_t request[] = {0x3E, 0x00};
-    uint8_t response[256];
-    size_t resp_len;
     
-    return doip_client_send_diagnostic(&ecu->zg_client,
-                                       request, sizeof(request),
-                                       response, sizeof(response), &resp_len);
+    return ecu_send_request(ecu, request, sizeof(request));
+}
+
+static size_t ecu_put_string(uint8_t* out, const char* value) {
+    size_t len = strlen(value);
+    if (len > 255) len = 255;
+    out[0] = (uint8_t)len;
+    memcpy(&out[1], value, len);
+    return len + 1;
+}
+
+static size_t ecu_encode_vci_request(const ECUNode_t* ecu, uint8_t* out) {
+    size_t pos = 0;
+    
+    out[pos++] = UDS_SID_WRITE_DATA_BY_IDENTIFIER;
+    out[pos++] = (uint8_t)(UDS_DID_ECU_VCI_RECORD >> 8);
+    out[pos++] = (uint8_t)(UDS_DID_ECU_VCI_RECORD & 0xFF);
+    
+    out[pos++] = (uint8_t)(ecu->logical_address >> 8);
+    out[pos++] = (uint8_t)(ecu->logical_address & 0xFF);
+    out[pos++] = 0x01 |                                     /* online */
+                 (ecu->ota_capable ? 0x02 : 0) |
+                 (ecu->delta_update_supported ? 0x04 : 0);
+    out[pos++] = (uint8_t)(ecu->max_package_size >> 24);
+    out[pos++] = (uint8_t)(ecu->max_package_size >> 16);
+    out[pos++] = (uint8_t)(ecu->max_package_size >> 8);
+    out[pos++] = (uint8_t)(ecu->max_package_size & 0xFF);
+    pos += ecu_put_string(&out[pos], ecu->ecu_id);
+    pos += ecu_put_string(&out[pos], ecu->firmware_version);
+    pos += ecu_put_string(&out[pos], ecu->hardware_version);
+    
+    return pos;
 }
 
 int ecu_send_vci_info(ECUNode_t* ecu) {
     if (!ecu || !ecu->zg_connected) return -1;
     
-    /* Send VCI information to Zone Gateway */
-    /* TODO: Implement VCI data serialization and send */
+    /* SID + DID + 7 fixed + 3 length-prefixed strings bounded by the ECUNode_t fields */
+    uint8_t request[ECU_VCI_RECORD_MAX_SIZE];
+    size_t req_len = ecu_encode_vci_request(ecu, request);
+    
+    if (req_len == ecu->vci_reported_len &&
+        memcmp(request, ecu->vci_reported, req_len) == 0) {
+        return 0;  /* ZG already holds this record */
+    }
+    if (req_len == ecu->vci_pending_len &&
+        memcmp(request, ecu->vci_pending, req_len) == 0) {
+        return 0;  /* Already on its way */
+    }
     
-    printf("[ECU] Sent VCI info to Zone Gateway\n");
+    if (ecu_send_request(ecu, request, req_len) != 0) {
+        return -1;
+    }
+    
+    memcpy(ecu->vci_pending, request, req_len);
+    ecu->vci_pending_len = req_len;
+    return 0;
+}
+
+static void ecu_handle_response(ECUNode_t* ecu, const uint8_t* uds, size_t uds_len) {
+    if (uds[0] == UDS_SID_WRITE_DATA_BY_IDENTIFIER + UDS_POSITIVE_RESPONSE_OFFSET &&
+        uds_len >= 3 && ((uds[1] << 8) | uds[2]) == UDS_DID_ECU_VCI_RECORD) {
+        if (ecu->vci_pending_len > 0) {
+            memcpy(ecu->vci_reported, ecu->vci_pending, ecu->vci_pending_len);
+            ecu->vci_reported_len = ecu->vci_pending_len;
+            ecu->vci_pending_len = 0;
+            printf("[ECU] Sent VCI info to Zone Gateway (%u bytes)\n", (unsigned)ecu->vci_reported_len);
+        }
+    } else if (uds[0] == UDS_NRC && uds_len >= 3 && uds[1] == UDS_SID_WRITE_DATA_BY_IDENTIFIER &&
+               uds[2] != UDS_NRC_RESPONSE_PENDING) {
+        fprintf(stderr, "[ECU] VCI report rejected by Zone Gateway\n");
+        ecu->vci_pending_len = 0;
+    }
+    
+    /* Tester Present response needs no action */
+}
+
+/* Request from ZG / tester: ACK and response leave in one send */
+static void ecu_answer_request(ECUNode_t* ecu, uint16_t tester,
+                               const uint8_t* uds, size_t uds_len) {
+    uint8_t ack_payload[5] = {
+        (uint8_t)(ecu->logical_address >> 8), (uint8_t)(ecu->logical_address & 0xFF),
+        (uint8_t)(tester >> 8), (uint8_t)(tester & 0xFF),
+        DOIP_DIAG_ACK_CONFIRM
+    };
+    size_t len = doip_build_message(DOIP_DIAGNOSTIC_MESSAGE_POS_ACK, ack_payload, sizeof(ack_payload),
+                                    ecu->tx_buffer, sizeof(ecu->tx_buffer));
+    if (len == 0) return;
+    
+    uint8_t response[256];
+    size_t resp_len = 0;
+    if (ecu_handle_uds_request(ecu, uds, uds_len, response, sizeof(response), &resp_len) == 0 &&
+        resp_len > 0) {
+        bool suppress = uds[0] == UDS_SID_TESTER_PRESENT && uds_len >= 2 &&
+                        (uds[1] & 0x80) != 0 && response[0] != UDS_NRC;
+        if (!suppress) {
+            len += doip_build_diagnostic_message(ecu->logical_address, tester, response, resp_len,
+                                                 ecu->tx_buffer + len, sizeof(ecu->tx_buffer) - len);
+        }
+    }
+    
+    ecu_send_frame(ecu, ecu->tx_buffer, len);
+}
+
+static void ecu_handle_frame(ECUNode_t* ecu, const DoIPHeader_t* header, const uint8_t* payload) {
+    switch (header->payload_type) {
+    case DOIP_ALIVE_CHECK_REQ:
+        if (doip_client_alive_check_response(&ecu->zg_client, ecu->logical_address) != 0) {
+            ecu_connection_lost(ecu);
+        }
+        break;
+        
+    case DOIP_DIAGNOSTIC_MESSAGE: {
+        uint16_t source, target;
+        const uint8_t* uds = NULL;
+        size_t uds_len = 0;
+        if (doip_parse_diagnostic_message(payload, header->payload_length, &source, &target,
+                                          &uds, &uds_len) != 0 ||
+            uds_len == 0 || target != ecu->logical_address) {
+            break;
+        }
+        
+        /* Response SIDs (and 0x7F) have bit 6 set, request SIDs do not */
+        if (uds[0] & UDS_POSITIVE_RESPONSE_OFFSET) {
+            ecu_handle_response(ecu, uds, uds_len);
+        } else {
+            ecu_answer_request(ecu, source, uds, uds_len);
+        }
+        break;
+    }
+    
+    case DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK:
+        ecu->vci_pending_len = 0;   /* Not delivered; the next send retries */
+        break;
+        
+    default:
+        break;  /* ACKs need no action */
+    }
+}
+
+int ecu_process_rx(ECUNode_t* ecu) {
+    if (!ecu || !ecu->zg_connected) return -1;
+    
+    /* Caller saw the socket readable, so 0 bytes means the ZG closed it */
+    int n = doip_socket_tcp_recv(ecu->zg_client.tcp_socket, ecu->rx_buffer + ecu->rx_len,
+                                 sizeof(ecu->rx_buffer) - ecu->rx_len, 1);
+    if (n <= 0) {
+        ecu_connection_lost(ecu);
+        return -1;
+    }
+    ecu->rx_len += (size_t)n;
+    
+    size_t pos = 0;
+    while (ecu->zg_connected) {
+        DoIPHeader_t header;
+        const uint8_t* payload = NULL;
+        int parsed = doip_parse_message(ecu->rx_buffer + pos, ecu->rx_len - pos, &header, &payload);
+        
+        if (parsed == 0) {
+            ecu_handle_frame(ecu, &header, payload);
+            pos += DOIP_HEADER_SIZE + header.payload_length;
+            continue;
+        }
+        
+        if (parsed == -2 ||
+            (ecu->rx_len - pos >= DOIP_HEADER_SIZE &&
+             DOIP_HEADER_SIZE + header.payload_length > sizeof(ecu->rx_buffer))) {
+            ecu_connection_lost(ecu);   /* Out of sync or frame larger than the buffer */
+        }
+        break;
+    }
+    
+    if (!ecu->zg_connected) return -1;
+    
+    memmove(ecu->rx_buffer, ecu->rx_buffer + pos, ecu->rx_len - pos);
+    ecu->rx_len -= pos;
     return 0;
 }
 
@@ -156,8 +519,8 @@ int ecu_handle_uds_request(ECUNode_t* ecu,
     if (!ecu || !request || !response || !resp_len) return -1;
     
     /* Handle UDS request using UDS handler */
-    return uds_handle_request(&ecu->uds_handler, request, req_len,
-                              response, resp_cap, resp_len);
+    return uds_handler_process(&ecu->uds_handler, request, req_len,
+                               response, resp_cap, resp_len);
 }
 
 bool ecu_check_ota_readiness(ECUNode_t* ecu) {
@@ -228,9 +591,16 @@ void ecu_print_info(const ECUNode_t* ecu) {
 }
 
 uint32_t ecu_get_tick_ms(void) {
-    /* Platform-specific implementation */
-    /* For TC375, this would use STM (System Timer Module) */
-    /* TODO: Implement actual timer */
-    return 0;
+#ifdef USE_FREERTOS
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+#elif defined(__unix__)
+    /* Host build (bench_ecu_node.c) */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000u);
+#else
+    /* Full 64-bit STM0 count so the millisecond tick wraps at 2^32 like the others */
+    return (uint32_t)(IfxStm_get(&MODULE_STM0) / ecu_stm_ticks_per_ms());
+#endif
 }
 
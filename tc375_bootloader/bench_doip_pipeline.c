@@ -0,0 +1,316 @@
+/**
+ * @file bench_doip_pipeline.c
+ * @brief Pipelined DoIP client throughput benchmark (Linux host)
+ *
+ * Runs an in-process DoIP server on loopback that models a gateway
+ * link: each request is answered after a fixed latency, and the ECU
+ * serves requests one at a time with a fixed service time. The client
+ * side is the bootloader doip_client (doip_pipeline_*) over the POSIX
+ * socket layer in common/doip_socket_lwip.c.
+ *
+ * Reports requests/s and payload KB/s per window size for bulk DID
+ * reads (0x22) and flashing-style TransferData (0x36). Every 64th
+ * request is answered with NRC 0x78 first to exercise response pending.
+ *
+ * Build:
+ *   gcc -O2 -o doip_pipeline_bench bench_doip_pipeline.c \
+ *       common/doip_client.c common/doip_message.c common/doip_socket_lwip.c \
+ *       -Icommon -lpthread
+ *
+ * Usage: ./doip_pipeline_bench [requests] [latency_us] [service_us]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "doip_client.h"
+#include "uds_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define BENCH_PORT              13499
+#define TESTER_ADDRESS          0x0E00
+#define ECU_ADDRESS             0x0100
+#define TRANSFER_BLOCK_SIZE     1024
+#define MAX_SCHEDULED           64
+
+typedef struct {
+    uint32_t latency_us;
+    uint32_t service_us;
+    int listen_fd;
+} BenchServer_t;
+
+typedef struct {
+    uint64_t due_us;
+    uint8_t frame[DOIP_HEADER_SIZE + 4 + 32];
+    size_t len;
+} ScheduledFrame_t;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static void send_all(int fd, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, 0);
+        if (n <= 0) {
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static size_t build_diag(uint16_t payload_type, const uint8_t* uds, size_t uds_len, uint8_t* out) {
+    uint8_t payload[4 + 32];
+    payload[0] = ECU_ADDRESS >> 8;
+    payload[1] = ECU_ADDRESS & 0xFF;
+    payload[2] = TESTER_ADDRESS >> 8;
+    payload[3] = TESTER_ADDRESS & 0xFF;
+    memcpy(&payload[4], uds, uds_len);
+    return doip_build_message(payload_type, payload, 4 + uds_len, out, DOIP_HEADER_SIZE + sizeof(payload));
+}
+
+// Answer one request: ACK now, response(s) scheduled
+static void handle_request(BenchServer_t* server, int fd, const uint8_t* uds, size_t uds_len,
+                           ScheduledFrame_t* queue, int* queued, uint64_t* ecu_free_us,
+                           uint32_t* served) {
+    uint8_t ack[DOIP_HEADER_SIZE + 5];
+    uint8_t ack_payload[5] = { ECU_ADDRESS >> 8, ECU_ADDRESS & 0xFF,
+                               TESTER_ADDRESS >> 8, TESTER_ADDRESS & 0xFF, DOIP_DIAG_ACK_CONFIRM };
+    size_t ack_len = doip_build_message(DOIP_DIAGNOSTIC_MESSAGE_POS_ACK, ack_payload,
+                                        sizeof(ack_payload), ack, sizeof(ack));
+    send_all(fd, ack, ack_len);
+
+    uint8_t rsp[32];
+    size_t rsp_len;
+    if (uds[0] == UDS_SID_READ_DATA_BY_IDENTIFIER) {
+        rsp[0] = UDS_SID_READ_DATA_BY_IDENTIFIER + UDS_POSITIVE_RESPONSE_OFFSET;
+        rsp[1] = uds[1];
+        rsp[2] = uds[2];
+        memcpy(&rsp[3], "KMHXX00XXXX000000", 17);
+        rsp_len = 20;
+    } else {
+        rsp[0] = (uint8_t)(uds[0] + UDS_POSITIVE_RESPONSE_OFFSET);
+        rsp[1] = uds_len > 1 ? uds[1] : 0;
+        rsp_len = 2;
+    }
+
+    // ECU is serial; the link latency overlaps across requests
+    uint64_t arrival = now_us();
+    uint64_t start = arrival > *ecu_free_us ? arrival : *ecu_free_us;
+    *ecu_free_us = start + server->service_us;
+    uint64_t due = *ecu_free_us + server->latency_us;
+
+    if (++(*served) % 64 == 0 && *queued < MAX_SCHEDULED) {
+        uint8_t pending[3] = { UDS_NRC, uds[0], UDS_NRC_RESPONSE_PENDING };
+        ScheduledFrame_t* f = &queue[(*queued)++];
+        f->due_us = due;
+        f->len = build_diag(DOIP_DIAGNOSTIC_MESSAGE, pending, sizeof(pending), f->frame);
+    }
+    if (*queued < MAX_SCHEDULED) {
+        ScheduledFrame_t* f = &queue[(*queued)++];
+        f->due_us = due;
+        f->len = build_diag(DOIP_DIAGNOSTIC_MESSAGE, rsp, rsp_len, f->frame);
+    }
+}
+
+static void* server_thread(void* arg) {
+    BenchServer_t* server = (BenchServer_t*)arg;
+    static uint8_t rx[DOIP_HEADER_SIZE + DOIP_MAX_PAYLOAD_SIZE + 64];
+    static ScheduledFrame_t queue[MAX_SCHEDULED];
+
+    int fd;
+    while ((fd = accept(server->listen_fd, NULL, NULL)) >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        size_t rx_len = 0;
+        int queued = 0;
+        uint64_t ecu_free_us = 0;
+        uint32_t served = 0;
+        int open = 1;
+
+        while (open) {
+            // Flush due responses (queue is in due order)
+            uint64_t now = now_us();
+            int sent = 0;
+            while (sent < queued && queue[sent].due_us <= now) {
+                send_all(fd, queue[sent].frame, queue[sent].len);
+                sent++;
+            }
+            if (sent > 0) {
+                memmove(queue, queue + sent, (size_t)(queued - sent) * sizeof(queue[0]));
+                queued -= sent;
+            }
+
+            int wait_ms = -1;
+            if (queued > 0) {
+                uint64_t delta = queue[0].due_us > now ? queue[0].due_us - now : 0;
+                wait_ms = (int)(delta / 1000);
+            }
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            if (poll(&pfd, 1, wait_ms) <= 0) {
+                continue;
+            }
+
+            ssize_t n = recv(fd, rx + rx_len, sizeof(rx) - rx_len, 0);
+            if (n <= 0) {
+                break;
+            }
+            rx_len += (size_t)n;
+
+            DoIPHeader_t header;
+            const uint8_t* payload;
+            while (doip_parse_message(rx, rx_len, &header, &payload) == 0) {
+                size_t frame_len = DOIP_HEADER_SIZE + header.payload_length;
+
+                if (header.payload_type == DOIP_ROUTING_ACTIVATION_REQ) {
+                    uint8_t ra[9] = { TESTER_ADDRESS >> 8, TESTER_ADDRESS & 0xFF,
+                                      ECU_ADDRESS >> 8, ECU_ADDRESS & 0xFF, DOIP_RA_RES_SUCCESS };
+                    uint8_t out[DOIP_HEADER_SIZE + sizeof(ra)];
+                    size_t out_len = doip_build_message(DOIP_ROUTING_ACTIVATION_RES, ra, sizeof(ra),
+                                                        out, sizeof(out));
+                    send_all(fd, out, out_len);
+                } else if (header.payload_type == DOIP_DIAGNOSTIC_MESSAGE && header.payload_length > 4) {
+                    handle_request(server, fd, payload + 4, header.payload_length - 4,
+                                   queue, &queued, &ecu_free_us, &served);
+                }
+
+                memmove(rx, rx + frame_len, rx_len - frame_len);
+                rx_len -= frame_len;
+            }
+        }
+        close(fd);
+    }
+
+    return NULL;
+}
+
+static int run_case(uint8_t window, uint32_t requests, int transfer, double* rate, double* kbps) {
+    static DoIPClient_t client;
+    static DoIPPipeline_t pipeline;
+    static uint8_t request[3 + TRANSFER_BLOCK_SIZE];
+
+    if (doip_client_init(&client, "127.0.0.1", BENCH_PORT, TESTER_ADDRESS, ECU_ADDRESS) != 0 ||
+        doip_client_connect(&client) != 0 ||
+        doip_client_routing_activation(&client, 0x00) != 0 ||
+        doip_pipeline_init(&pipeline, &client, window) != 0) {
+        fprintf(stderr, "Connection setup failed\n");
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(client.tcp_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    size_t req_len;
+    size_t payload_bytes;
+    if (transfer) {
+        memset(request, 0xA5, sizeof(request));
+        request[0] = UDS_SID_TRANSFER_DATA;
+        req_len = 2 + TRANSFER_BLOCK_SIZE;
+        payload_bytes = TRANSFER_BLOCK_SIZE;
+    } else {
+        request[0] = UDS_SID_READ_DATA_BY_IDENTIFIER;
+        request[1] = UDS_DID_VIN >> 8;
+        request[2] = UDS_DID_VIN & 0xFF;
+        req_len = 3;
+        payload_bytes = 17;
+    }
+
+    uint32_t submitted = 0;
+    uint32_t completed = 0;
+    uint64_t t0 = now_us();
+
+    while (completed < requests) {
+        while (submitted < requests) {
+            if (transfer) {
+                request[1] = (uint8_t)(submitted + 1);  // Block sequence counter
+            }
+            int rc = doip_pipeline_submit(&pipeline, request, req_len, submitted);
+            if (rc == 1) break;
+            if (rc < 0) {
+                fprintf(stderr, "Submit failed\n");
+                return -1;
+            }
+            submitted++;
+        }
+
+        DoIPPipelineResult_t result;
+        int rc = doip_pipeline_poll(&pipeline, &result, DOIP_SOCKET_TIMEOUT_MS);
+        if (rc <= 0) {
+            fprintf(stderr, "Poll failed (%d) after %u responses\n", rc, completed);
+            return -1;
+        }
+        if (result.status != DOIP_PIPELINE_OK || result.tag != completed) {
+            fprintf(stderr, "Mismatched response: tag %u status %d (expected %u)\n",
+                    result.tag, (int)result.status, completed);
+            return -1;
+        }
+        completed++;
+    }
+
+    double elapsed = (now_us() - t0) / 1e6;
+    doip_client_disconnect(&client);
+
+    *rate = requests / elapsed;
+    *kbps = (double)requests * payload_bytes / 1024.0 / elapsed;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    uint32_t requests = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 2000u;
+    static BenchServer_t server;
+    server.latency_us = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 1000u;
+    server.service_us = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 10) : 50u;
+    if (requests == 0) {
+        fprintf(stderr, "Usage: %s [requests] [latency_us] [service_us]\n", argv[0]);
+        return 1;
+    }
+
+    server.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(server.listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(BENCH_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(server.listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(server.listen_fd, 1) != 0) {
+        perror("listen");
+        return 1;
+    }
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, server_thread, &server);
+
+    static const uint8_t windows[] = { 1, 2, 4, 8 };
+
+    printf("DoIP pipeline benchmark (%u requests, latency %u us, ECU service %u us)\n",
+           requests, server.latency_us, server.service_us);
+    printf("  %-8s %12s %12s %14s %12s\n", "window", "0x22 req/s", "0x22 KB/s", "0x36 req/s", "0x36 KB/s");
+
+    for (size_t i = 0; i < sizeof(windows) / sizeof(windows[0]); i++) {
+        double did_rate, did_kbps, xfer_rate, xfer_kbps;
+        if (run_case(windows[i], requests, 0, &did_rate, &did_kbps) != 0 ||
+            run_case(windows[i], requests, 1, &xfer_rate, &xfer_kbps) != 0) {
+            return 1;
+        }
+        printf("  %-8u %12.0f %12.1f %14.0f %12.1f\n", windows[i],
+               did_rate, did_kbps, xfer_rate, xfer_kbps);
+    }
+
+    close(server.listen_fd);
+    return 0;
+}
@@ -4,6 +4,7 @@
  */
 
 #include "doip_client.h"
+#include "uds_handler.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -198,6 +199,7 @@ int doip_client_routing_activation(DoIPClient_t* client, uint8_t activation_type
     /* Check response code */
     if (response.response_code == DOIP_RA_RES_SUCCESS) {
         client->routing_active = true;
+        client->entity_address = response.entity_address;
         return 0;
     }
 
@@ -309,6 +311,302 @@ int doip_client_send_diagnostic(
     return 0;
 }
 
+/* Pipelined diagnostics */
+
+int doip_pipeline_init(DoIPPipeline_t* pipeline, DoIPClient_t* client, uint8_t window) {
+    if (!pipeline || !client || window == 0 || window > DOIP_PIPELINE_MAX_WINDOW) {
+        return -1;
+    }
+
+    memset(pipeline, 0, sizeof(DoIPPipeline_t));
+    pipeline->client = client;
+    pipeline->window = window;
+
+    return 0;
+}
+
+uint8_t doip_pipeline_in_flight(const DoIPPipeline_t* pipeline) {
+    return pipeline ? pipeline->count : 0;
+}
+
+int doip_pipeline_submit(DoIPPipeline_t* pipeline, const uint8_t* uds_request,
+                         size_t req_len, uint32_t tag) {
+    if (!pipeline || !uds_request || req_len == 0) {
+        return -1;
+    }
+
+    DoIPClient_t* client = pipeline->client;
+    if (!client->is_connected || !client->routing_active) {
+        return -1;
+    }
+
+    if (pipeline->count >= pipeline->window) {
+        return 1;
+    }
+
+    size_t msg_len = doip_build_diagnostic_message(
+        client->source_address,
+        client->target_address,
+        uds_request,
+        req_len,
+        client->tx_buffer,
+        sizeof(client->tx_buffer)
+    );
+
+    if (msg_len == 0) {
+        return -1;
+    }
+
+    if (doip_socket_tcp_send(client->tcp_socket, client->tx_buffer, msg_len) < 0) {
+        return -1;
+    }
+
+    DoIPPipelineSlot_t* slot =
+        &pipeline->slots[(pipeline->head + pipeline->count) % DOIP_PIPELINE_MAX_WINDOW];
+    memset(slot, 0, sizeof(*slot));
+    slot->tag = tag;
+    slot->sid = uds_request[0];
+    
+    /* What the positive response repeats back: block counter, DID, routine */
+    switch (uds_request[0]) {
+    case UDS_SID_TRANSFER_DATA:
+        slot->echo_len = 1;
+        break;
+    case UDS_SID_READ_DATA_BY_IDENTIFIER:
+    case UDS_SID_WRITE_DATA_BY_IDENTIFIER:
+        slot->echo_len = 2;
+        break;
+    case UDS_SID_ROUTINE_CONTROL:
+        slot->echo_len = 3;
+        break;
+    default:
+        break;
+    }
+    if (slot->echo_len > req_len - 1) {
+        slot->echo_len = (uint8_t)(req_len - 1);
+    }
+    memcpy(slot->echo, &uds_request[1], slot->echo_len);
+    slot->deadline_ms = doip_socket_time_ms() + DOIP_PIPELINE_P2_MS;
+    pipeline->count++;
+
+    return 0;
+}
+
+static void pipeline_complete_head(DoIPPipeline_t* pipeline, DoIPPipelineResult_t* result,
+                                   DoIPPipelineStatus_t status,
+                                   const uint8_t* uds_data, size_t uds_len) {
+    DoIPPipelineSlot_t* slot = &pipeline->slots[pipeline->head];
+
+    result->tag = slot->tag;
+    result->status = status;
+    result->nack_code = slot->nack_code;
+    result->uds_data = uds_data;
+    result->uds_len = uds_len;
+
+    pipeline->head = (uint8_t)((pipeline->head + 1) % DOIP_PIPELINE_MAX_WINDOW);
+    pipeline->count--;
+}
+
+static DoIPPipelineSlot_t* pipeline_oldest_unacked(DoIPPipeline_t* pipeline) {
+    for (uint8_t i = 0; i < pipeline->count; i++) {
+        DoIPPipelineSlot_t* slot = &pipeline->slots[(pipeline->head + i) % DOIP_PIPELINE_MAX_WINDOW];
+        if (!slot->acked) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+static bool pipeline_response_matches(const DoIPPipelineSlot_t* slot,
+                                      const uint8_t* uds_data, size_t uds_len) {
+    if (uds_data[0] == UDS_NRC) {
+        return uds_len >= 3 && uds_data[1] == slot->sid;
+    }
+    return uds_data[0] == (uint8_t)(slot->sid + UDS_POSITIVE_RESPONSE_OFFSET) &&
+           uds_len > slot->echo_len &&
+           memcmp(&uds_data[1], slot->echo, slot->echo_len) == 0;
+}
+
+/* Returns 1 if the frame completed the head request, 0 otherwise */
+static int pipeline_handle_frame(DoIPPipeline_t* pipeline, const DoIPHeader_t* header,
+                                 const uint8_t* payload, DoIPPipelineResult_t* result) {
+    DoIPClient_t* client = pipeline->client;
+    uint16_t source_addr, target_addr;
+    const uint8_t* uds_data = NULL;
+    size_t uds_len = 0;
+
+    switch (header->payload_type) {
+    case DOIP_DIAGNOSTIC_MESSAGE_POS_ACK:
+    case DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK: {
+        /* ACKs arrive in submission order, owed ones for timed-out requests first */
+        if (pipeline->stale_acks > 0) {
+            pipeline->stale_acks--;
+            return 0;
+        }
+        DoIPPipelineSlot_t* slot = pipeline_oldest_unacked(pipeline);
+        if (!slot || header->payload_length < 5) {
+            return 0;
+        }
+        slot->acked = true;
+        if (header->payload_type == DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK) {
+            slot->nacked = true;
+            slot->nack_code = payload[4];
+        }
+        return 0;
+    }
+
+    case DOIP_DIAGNOSTIC_MESSAGE:
+        if (pipeline->count == 0 ||
+            doip_parse_diagnostic_message(payload, header->payload_length, &source_addr,
+                                          &target_addr, &uds_data, &uds_len) != 0 ||
+            source_addr != client->target_address || target_addr != client->source_address ||
+            uds_len == 0) {
+            return 0;
+        }
+
+        /* Response for the head request (NACKed heads are retired before this) */
+        DoIPPipelineSlot_t* head = &pipeline->slots[pipeline->head];
+        bool pending = uds_data[0] == UDS_NRC && uds_len >= 3 &&
+                       uds_data[2] == UDS_NRC_RESPONSE_PENDING;
+        if (!pipeline_response_matches(head, uds_data, uds_len)) {
+            if (pipeline->stale_responses > 0) {
+                /* Late answer to a timed-out request */
+                if (!pending) {
+                    pipeline->stale_responses--;
+                }
+                return 0;
+            }
+            pipeline_complete_head(pipeline, result, DOIP_PIPELINE_ERROR, uds_data, uds_len);
+            return 1;
+        }
+
+        head->acked = true;
+        if (pending) {
+            /* Final response still to come */
+            head->deadline_ms = doip_socket_time_ms() + DOIP_PIPELINE_P2_EXT_MS;
+            return 0;
+        }
+        pipeline_complete_head(pipeline, result, DOIP_PIPELINE_OK, uds_data, uds_len);
+        return 1;
+
+    case DOIP_ALIVE_CHECK_REQ:
+        doip_client_alive_check_response(client, client->source_address);
+        return 0;
+
+    default:
+        return 0;
+    }
+}
+
+int doip_pipeline_poll(DoIPPipeline_t* pipeline, DoIPPipelineResult_t* result, uint32_t timeout_ms) {
+    if (!pipeline || !result) {
+        return -1;
+    }
+
+    DoIPClient_t* client = pipeline->client;
+
+    /* Release the frame handed out by the previous call */
+    if (pipeline->rx_consumed > 0) {
+        memmove(pipeline->rx_buffer, pipeline->rx_buffer + pipeline->rx_consumed,
+                pipeline->rx_len - pipeline->rx_consumed);
+        pipeline->rx_len -= pipeline->rx_consumed;
+        pipeline->rx_consumed = 0;
+    }
+
+    while (pipeline->count > 0) {
+        /* A NACKed request gets no response; retire it once it is oldest */
+        if (pipeline->slots[pipeline->head].nacked) {
+            pipeline_complete_head(pipeline, result, DOIP_PIPELINE_NACK, NULL, 0);
+            return 1;
+        }
+        if (pipeline->slots[pipeline->head].timed_out) {
+            pipeline_complete_head(pipeline, result, DOIP_PIPELINE_TIMEOUT, NULL, 0);
+            return 1;
+        }
+
+        /* Process complete frames already buffered */
+        DoIPHeader_t header;
+        const uint8_t* payload = NULL;
+        int parsed = doip_parse_message(pipeline->rx_buffer, pipeline->rx_len, &header, &payload);
+
+        if (parsed == 0) {
+            size_t frame_len = DOIP_HEADER_SIZE + header.payload_length;
+            int done = pipeline_handle_frame(pipeline, &header, payload, result);
+            if (done) {
+                pipeline->rx_consumed = frame_len;
+                return 1;
+            }
+            memmove(pipeline->rx_buffer, pipeline->rx_buffer + frame_len, pipeline->rx_len - frame_len);
+            pipeline->rx_len -= frame_len;
+            continue;
+        }
+
+        if (parsed == -2 ||
+            (pipeline->rx_len >= DOIP_HEADER_SIZE &&
+             DOIP_HEADER_SIZE + header.payload_length > sizeof(pipeline->rx_buffer))) {
+            break;  /* Bad header or frame larger than the buffer */
+        }
+
+        /* Lost response: the server answers in order, so nothing behind it
+         * can be matched reliably. Fail the whole window and skip whatever
+         * is still owed for it. */
+        int32_t left = (int32_t)(pipeline->slots[pipeline->head].deadline_ms - doip_socket_time_ms());
+        if (left <= 0) {
+            for (uint8_t i = 0; i < pipeline->count; i++) {
+                DoIPPipelineSlot_t* slot =
+                    &pipeline->slots[(pipeline->head + i) % DOIP_PIPELINE_MAX_WINDOW];
+                slot->timed_out = true;
+                if (!slot->acked && pipeline->stale_acks < UINT8_MAX) {
+                    pipeline->stale_acks++;
+                }
+                if (!slot->nacked && pipeline->stale_responses < UINT8_MAX) {
+                    pipeline->stale_responses++;
+                }
+            }
+            continue;
+        }
+
+        /* Need more data; wake at the head's deadline if that comes first */
+        bool deadline_first = (uint32_t)left < timeout_ms;
+        int ready = doip_socket_wait_readable(client->tcp_socket,
+                                              deadline_first ? (uint32_t)left : timeout_ms);
+        if (ready == 0) {
+            if (deadline_first) {
+                continue;
+            }
+            return 0;
+        }
+        if (ready < 0) {
+            break;
+        }
+
+        /* Readable, so 0 here is the peer closing, not a timeout */
+        int recv_len = doip_socket_tcp_recv(
+            client->tcp_socket,
+            pipeline->rx_buffer + pipeline->rx_len,
+            sizeof(pipeline->rx_buffer) - pipeline->rx_len,
+            timeout_ms
+        );
+
+        if (recv_len <= 0) {
+            break;
+        }
+        pipeline->rx_len += (size_t)recv_len;
+    }
+
+    if (pipeline->count == 0) {
+        return 0;
+    }
+
+    /* Connection lost or stream out of sync: nothing in flight can be
+     * matched any more */
+    pipeline->count = 0;
+    pipeline->stale_acks = 0;
+    pipeline->stale_responses = 0;
+    pipeline->rx_len = 0;
+    return -1;
+}
+
 int doip_client_alive_check_response(DoIPClient_t* client, uint16_t source_address) {
     if (!client || !client->is_connected) {
         return -1;
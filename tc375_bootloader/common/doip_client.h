@@ -22,6 +22,13 @@ extern "C" {
 #define DOIP_MAX_RESPONSE_SIZE      4096
 #define DOIP_SOCKET_TIMEOUT_MS      5000
 #define DOIP_ROUTING_TIMEOUT_MS     2000
+#define DOIP_WAIT_FOREVER           0xFFFFFFFFu
+
+/* Pipelined diagnostics */
+#define DOIP_PIPELINE_MAX_WINDOW    8       /* Max requests in flight */
+#define DOIP_PIPELINE_RX_SIZE       (DOIP_HEADER_SIZE + DOIP_MAX_RESPONSE_SIZE)
+#define DOIP_PIPELINE_P2_MS         DOIP_SOCKET_TIMEOUT_MS  /* Submit -> response */
+#define DOIP_PIPELINE_P2_EXT_MS     5000    /* After each NRC 0x78 */
 
 /* Socket Handle Types (platform-specific) */
 typedef int DoIPSocket_t;  /* Use lwIP socket descriptor or platform-specific */
@@ -49,13 +56,81 @@ typedef struct {
     
     /* Vehicle info (from identification) */
     char vin[DOIP_VIN_LENGTH + 1];  /* Null-terminated */
-    uint16_t entity_address;
+    uint16_t entity_address;   /* Identification / routing activation response */
     
     /* Buffers */
     uint8_t tx_buffer[DOIP_MAX_RESPONSE_SIZE];
     uint8_t rx_buffer[DOIP_MAX_RESPONSE_SIZE];
 } DoIPClient_t;
 
+/**
+ * @brief Pipelined request status
+ */
+typedef enum {
+    DOIP_PIPELINE_OK = 0,           /* Final UDS response received */
+    DOIP_PIPELINE_NACK,             /* DoIP diagnostic NACK (0x8003) */
+    DOIP_PIPELINE_TIMEOUT,          /* No response before the request's deadline */
+    DOIP_PIPELINE_ERROR             /* Connection lost or protocol error */
+} DoIPPipelineStatus_t;
+
+/**
+ * @brief In-flight request slot
+ */
+typedef struct {
+    uint32_t tag;                   /* Caller tag, returned with the result */
+    uint8_t sid;                    /* Request SID, used for response matching */
+    uint8_t echo[3];                /* Request bytes the positive response echoes */
+    uint8_t echo_len;               /* (blockSequenceCounter, DID, routine) */
+    uint32_t deadline_ms;           /* P2, pushed out to P2* by NRC 0x78 */
+    bool acked;                     /* DoIP ACK/NACK already received */
+    bool nacked;
+    bool timed_out;                 /* Failed with the window after a timeout */
+    uint8_t nack_code;
+} DoIPPipelineSlot_t;
+
+/**
+ * @brief Completed request
+ *
+ * uds_data points into the pipeline receive buffer and stays valid
+ * until the next doip_pipeline_poll() call.
+ */
+typedef struct {
+    uint32_t tag;
+    DoIPPipelineStatus_t status;
+    uint8_t nack_code;              /* DOIP_DIAG_NACK_* when status == NACK */
+    const uint8_t* uds_data;
+    size_t uds_len;
+} DoIPPipelineResult_t;
+
+/**
+ * @brief Pipelined diagnostic session over a connected client
+ *
+ * Keeps up to `window` requests in flight on one TCP connection. The
+ * server answers a tester in order, so ACKs and responses are matched
+ * FIFO against the oldest outstanding request; the response SID (or the
+ * NRC's echoed SID) and the echoed blockSequenceCounter / DID / routine
+ * are checked against it, and NRC 0x78 keeps the slot open. All storage
+ * is static inside this struct (no heap).
+ */
+typedef struct {
+    DoIPClient_t* client;
+    uint8_t window;
+    
+    /* Ring of in-flight requests, oldest at head */
+    DoIPPipelineSlot_t slots[DOIP_PIPELINE_MAX_WINDOW];
+    uint8_t head;
+    uint8_t count;
+    
+    /* Answers still owed for timed-out requests, skipped when they arrive */
+    uint8_t stale_acks;
+    uint8_t stale_responses;
+    
+    /* Stream reassembly (several frames may arrive per recv) */
+    uint8_t rx_buffer[DOIP_PIPELINE_RX_SIZE];
+    size_t rx_len;
+    size_t rx_consumed;             /* Bytes handed out by the last poll */
+} DoIPPipeline_t;
+
 /**
  * @brief Initialize DoIP client
  * 
@@ -127,6 +202,51 @@ int doip_client_send_diagnostic(
     size_t* resp_len_out
 );
 
+/**
+ * @brief Initialize pipelined diagnostics on a connected client
+ *
+ * @param pipeline Pipeline context
+ * @param client Client with routing active (must outlive the pipeline)
+ * @param window Max requests in flight (1..DOIP_PIPELINE_MAX_WINDOW)
+ * @return 0 on success, -1 on error
+ */
+int doip_pipeline_init(DoIPPipeline_t* pipeline, DoIPClient_t* client, uint8_t window);
+
+/**
+ * @brief Send a request without waiting for its response
+ *
+ * @param pipeline Pipeline context
+ * @param uds_request UDS request data
+ * @param req_len Length of UDS request
+ * @param tag Caller tag returned in DoIPPipelineResult_t
+ * @return 0 on success, 1 if the window is full (poll first), -1 on error
+ */
+int doip_pipeline_submit(DoIPPipeline_t* pipeline, const uint8_t* uds_request,
+                         size_t req_len, uint32_t tag);
+
+/**
+ * @brief Wait for the next completed request
+ *
+ * Handles ACKs, NRC 0x78 and alive check requests internally. Once the
+ * oldest request's deadline passes, every request in flight is completed
+ * with DOIP_PIPELINE_TIMEOUT (oldest first): behind a lost response the
+ * FIFO order can no longer be trusted. Their late ACKs and responses are
+ * skipped when they arrive instead of being matched to newer requests.
+ *
+ * @param pipeline Pipeline context
+ * @param result Output: completed request (oldest first)
+ * @param timeout_ms Max time to wait per receive
+ * @return 1 if result filled, 0 on timeout or nothing in flight,
+ *         -1 on connection error or peer close (all in-flight requests
+ *         are dropped)
+ */
+int doip_pipeline_poll(DoIPPipeline_t* pipeline, DoIPPipelineResult_t* result, uint32_t timeout_ms);
+
+/**
+ * @brief Number of requests in flight
+ */
+uint8_t doip_pipeline_in_flight(const DoIPPipeline_t* pipeline);
+
 /**
  * @brief Send Alive Check Response
  * 
@@ -178,6 +298,20 @@ int doip_socket_tcp_send(DoIPSocket_t sock, const uint8_t* data, size_t len);
  */
 int doip_socket_tcp_recv(DoIPSocket_t sock, uint8_t* buf, size_t cap, uint32_t timeout_ms);
 
+/**
+ * @brief Wait until a socket has data (or EOF) to read
+ * @param sock Socket descriptor
+ * @param timeout_ms Max wait (0 = check only, DOIP_WAIT_FOREVER = no limit)
+ * @return 1 if readable, 0 on timeout, -1 on error
+ */
+int doip_socket_wait_readable(DoIPSocket_t sock, uint32_t timeout_ms);
+
+/**
+ * @brief Monotonic time for request deadlines
+ * @return Milliseconds since an arbitrary start (wraps at 2^32)
+ */
+uint32_t doip_socket_time_ms(void);
+
 /**
  * @brief Send UDP broadcast
  * @param sock Socket descriptor
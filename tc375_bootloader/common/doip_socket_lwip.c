@@ -34,6 +34,8 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
+#include <time.h>
 #endif
 
 DoIPSocket_t doip_socket_tcp_create(void) {
@@ -170,6 +172,52 @@ int doip_socket_udp_recv(DoIPSocket_t sock, uint8_t* buf, size_t cap, uint32_t t
     return received;
 }
 
+int doip_socket_wait_readable(DoIPSocket_t sock, uint32_t timeout_ms) {
+    if (sock == DOIP_INVALID_SOCKET) {
+        return -1;
+    }
+
+#ifdef _WIN32
+    fd_set readfds;
+    FD_ZERO(&readfds);
+    FD_SET(sock, &readfds);
+
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    int ready = select(0, &readfds, NULL, NULL, timeout_ms == DOIP_WAIT_FOREVER ? NULL : &tv);
+#else
+    /* poll() rather than select(): no FD_SETSIZE limit on host builds */
+    struct pollfd pfd;
+    pfd.fd = sock;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int ready = poll(&pfd, 1, timeout_ms == DOIP_WAIT_FOREVER ? -1 :
+                              (timeout_ms > 0x7FFFFFFFu ? 0x7FFFFFFF : (int)timeout_ms));
+    if (ready < 0 && errno == EINTR) {
+        return 0;
+    }
+#endif
+
+    if (ready < 0) {
+        return -1;
+    }
+    return ready > 0 ? 1 : 0;
+}
+
+uint32_t doip_socket_time_ms(void) {
+#ifdef _WIN32
+    return (uint32_t)GetTickCount();
+#else
+    /* lwIP port: return sys_now() */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000u);
+#endif
+}
+
 void doip_socket_close(DoIPSocket_t sock) {
     if (sock != DOIP_INVALID_SOCKET) {
 #ifdef _WIN32
@@ -34,6 +34,44 @@ void uds_handler_init(UDSHandler_t* handler) {
     memset(handler, 0, sizeof(UDSHandler_t));
     handler->session = UDS_SESSION_STATE_DEFAULT;
     handler->security = UDS_SECURITY_LOCKED;
+
+    /* Prime the seed pool at startup */
+    for (size_t i = 0; i < UDS_SECURITY_SEED_POOL_SIZE; i++) {
+        uds_handler_idle(handler);
+    }
+}
+
+void uds_handler_idle(UDSHandler_t* handler) {
+    if (!handler || handler->seed_pool_count >= UDS_SECURITY_SEED_POOL_SIZE) {
+        return;
+    }
+
+    if (uds_platform_fill_random(handler->seed_pool[handler->seed_pool_count],
+                                 UDS_SECURITY_SEED_SIZE) == 0) {
+        handler->seed_pool_count++;
+    }
+}
+
+/* Take a pooled seed, or generate one inline when the pool is empty */
+static int uds_take_seed(UDSHandler_t* handler, uint8_t* seed) {
+    if (handler->seed_pool_count > 0) {
+        handler->seed_pool_count--;
+        memcpy(seed, handler->seed_pool[handler->seed_pool_count], UDS_SECURITY_SEED_SIZE);
+        memset(handler->seed_pool[handler->seed_pool_count], 0, UDS_SECURITY_SEED_SIZE);
+        return 0;
+    }
+
+    handler->security_stats.pool_misses++;
+    return uds_platform_fill_random(seed, UDS_SECURITY_SEED_SIZE);
+}
+
+/* Compare without early exit so timing does not reveal the matching prefix */
+static bool uds_constant_time_equal(const uint8_t* a, const uint8_t* b, size_t len) {
+    volatile uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++) {
+        diff |= (uint8_t)(a[i] ^ b[i]);
+    }
+    return diff == 0;
 }
 
 int uds_handler_process(
@@ -136,11 +174,13 @@ int uds_service_diagnostic_session_control(
         case UDS_SESSION_DEFAULT:
             handler->session = UDS_SESSION_STATE_DEFAULT;
             handler->security = UDS_SECURITY_LOCKED;
+            handler->seed_pending = false;
             break;
 
         case UDS_SESSION_PROGRAMMING:
             handler->session = UDS_SESSION_STATE_PROGRAMMING;
             handler->security = UDS_SECURITY_LOCKED;
+            handler->seed_pending = false;
             break;
 
         case UDS_SESSION_EXTENDED_DIAGNOSTIC:
@@ -226,34 +266,25 @@ int uds_service_security_access(
     }
 
     if (sub_function == UDS_SECURITY_LEVEL_1) {
-        /* Request seed */
+        /* Request seed (all zeros if already unlocked) */
+        uint8_t resp_data[1 + UDS_SECURITY_SEED_SIZE];
+        resp_data[0] = sub_function;
+
         if (handler->security == UDS_SECURITY_UNLOCKED) {
-            /* Already unlocked, return seed = 0 */
-            uint8_t resp_data[5] = {sub_function, 0, 0, 0, 0};
-            return uds_build_positive_response(
-                UDS_SID_SECURITY_ACCESS,
-                resp_data,
-                5,
-                response,
-                resp_cap,
-                resp_len
-            ) == 0 ? 0 : -UDS_NRC_GENERAL_REJECT;
+            memset(&resp_data[1], 0, UDS_SECURITY_SEED_SIZE);
+        } else {
+            if (uds_take_seed(handler, handler->seed) != 0) {
+                return -UDS_NRC_CONDITIONS_NOT_CORRECT;
+            }
+            handler->seed_pending = true;
+            handler->security_stats.seeds++;
+            memcpy(&resp_data[1], handler->seed, UDS_SECURITY_SEED_SIZE);
         }
 
-        /* Generate new seed */
-        handler->seed = uds_platform_generate_seed();
-
-        uint8_t resp_data[5];
-        resp_data[0] = sub_function;
-        resp_data[1] = (uint8_t)(handler->seed >> 24);
-        resp_data[2] = (uint8_t)(handler->seed >> 16);
-        resp_data[3] = (uint8_t)(handler->seed >> 8);
-        resp_data[4] = (uint8_t)(handler->seed);
-
         return uds_build_positive_response(
             UDS_SID_SECURITY_ACCESS,
             resp_data,
-            5,
+            sizeof(resp_data),
             response,
             resp_cap,
             resp_len
@@ -261,20 +292,25 @@ int uds_service_security_access(
 
     } else if (sub_function == UDS_SECURITY_LEVEL_2) {
         /* Send key */
-        if (req_len < 6) {
+        if (req_len != 2 + UDS_SECURITY_KEY_SIZE) {
             return -UDS_NRC_INCORRECT_MESSAGE_LENGTH;
         }
+        if (!handler->seed_pending) {
+            return -UDS_NRC_REQUEST_SEQUENCE_ERROR;
+        }
+        handler->seed_pending = false;  /* One key attempt per seed */
 
-        uint32_t received_key = ((uint32_t)request[2] << 24) |
-                                 ((uint32_t)request[3] << 16) |
-                                 ((uint32_t)request[4] << 8) |
-                                 ((uint32_t)request[5]);
-
-        uint32_t expected_key = uds_platform_calculate_key(handler->seed);
+        uint8_t expected_key[UDS_SECURITY_KEY_SIZE];
+        int key_ok = uds_platform_calculate_key(UDS_SECURITY_LEVEL_1, handler->seed, UDS_SECURITY_SEED_SIZE,
+                                                expected_key, sizeof(expected_key)) == 0 &&
+                     uds_constant_time_equal(&request[2], expected_key, UDS_SECURITY_KEY_SIZE);
+        memset(expected_key, 0, sizeof(expected_key));
+        memset(handler->seed, 0, sizeof(handler->seed));
 
-        if (received_key == expected_key) {
+        if (key_ok) {
             handler->security = UDS_SECURITY_UNLOCKED;
             handler->security_attempts = 0;
+            handler->security_stats.unlocks++;
 
             uint8_t resp_data = sub_function;
             return uds_build_positive_response(
@@ -287,8 +323,10 @@ int uds_service_security_access(
             ) == 0 ? 0 : -UDS_NRC_GENERAL_REJECT;
         } else {
             handler->security_attempts++;
+            handler->security_stats.invalid_keys++;
             if (handler->security_attempts >= UDS_SECURITY_ACCESS_ATTEMPTS) {
                 handler->security_lockout_time = uds_platform_get_tick_ms();
+                handler->security_stats.lockouts++;
                 return -UDS_NRC_EXCEED_NUMBER_OF_ATTEMPTS;
             }
             return -UDS_NRC_INVALID_KEY;
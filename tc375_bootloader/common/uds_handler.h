@@ -84,12 +84,17 @@ extern "C" {
 #define UDS_DID_ECU_HARDWARE_VERSION            0xF191
 #define UDS_DID_BOOTLOADER_VERSION              0xF180
 #define UDS_DID_APPLICATION_VERSION             0xF181
+#define UDS_DID_ECU_VCI_RECORD                  0xF1A0  /* ECU -> ZG: own VCI record */
+#define UDS_DID_ZONE_VCI_REPORT                 0xF1A1  /* ZG -> VMG: zone VCI snapshot/delta */
 
 /* Configuration */
 #define UDS_MAX_REQUEST_SIZE                    4095
 #define UDS_MAX_RESPONSE_SIZE                   4095
 #define UDS_SECURITY_ACCESS_ATTEMPTS            3
 #define UDS_SECURITY_ACCESS_DELAY_MS            10000
+#define UDS_SECURITY_SEED_SIZE                  16
+#define UDS_SECURITY_KEY_SIZE                   16
+#define UDS_SECURITY_SEED_POOL_SIZE             4   /* Seeds pre-generated in idle time */
 
 /**
  * @brief UDS Session State
@@ -108,6 +113,17 @@ typedef enum {
     UDS_SECURITY_UNLOCKED
 } UDSSecurityState_t;
 
+/**
+ * @brief SecurityAccess counters (level 1)
+ */
+typedef struct {
+    uint32_t seeds;
+    uint32_t pool_misses;     /* Seeds generated inside the 0x27 request */
+    uint32_t unlocks;
+    uint32_t invalid_keys;
+    uint32_t lockouts;
+} UDSSecurityStats_t;
+
 /**
  * @brief UDS Handler Context
  */
@@ -117,9 +133,15 @@ typedef struct {
     UDSSecurityState_t security;
     
     /* Security access tracking */
-    uint32_t seed;
+    uint8_t seed[UDS_SECURITY_SEED_SIZE];
+    bool seed_pending;                  /* Seed sent, waiting for sendKey */
     uint8_t security_attempts;
     uint32_t security_lockout_time;
+
+    /* Seed pool, refilled by uds_handler_idle() */
+    uint8_t seed_pool[UDS_SECURITY_SEED_POOL_SIZE][UDS_SECURITY_SEED_SIZE];
+    uint8_t seed_pool_count;
+    UDSSecurityStats_t security_stats;
     
     /* Transfer state (for firmware download) */
     bool transfer_active;
@@ -160,6 +182,16 @@ typedef int (*UDSServiceHandler_fn)(
  */
 void uds_handler_init(UDSHandler_t* handler);
 
+/**
+ * @brief Background work: top up the security seed pool
+ *
+ * Call from the main loop when idle. Generates at most one seed per call,
+ * so 0x27 requestSeed normally answers without touching the RNG.
+ *
+ * @param handler Handler context
+ */
+void uds_handler_idle(UDSHandler_t* handler);
+
 /**
  * @brief Process UDS request
  * 
@@ -343,17 +375,24 @@ void uds_platform_ecu_reset(uint8_t reset_type);
 uint32_t uds_platform_get_tick_ms(void);
 
 /**
- * @brief Generate security seed
- * @return Random seed value
+ * @brief Fill buffer with random bytes (HSM TRNG on target)
+ * @param out Output buffer
+ * @param len Number of bytes
+ * @return 0 on success, -1 on error
  */
-uint32_t uds_platform_generate_seed(void);
+int uds_platform_fill_random(uint8_t* out, size_t len);
 
 /**
- * @brief Calculate security key from seed
- * @param seed Seed value
- * @return Expected key value
+ * @brief Calculate expected security key (HSM CMAC/HMAC on target)
+ * @param level Security level (requestSeed sub-function)
+ * @param seed Seed bytes
+ * @param seed_len Seed length (UDS_SECURITY_SEED_SIZE)
+ * @param key Output: expected key
+ * @param key_len Key length (UDS_SECURITY_KEY_SIZE)
+ * @return 0 on success, -1 on error
  */
-uint32_t uds_platform_calculate_key(uint32_t seed);
+int uds_platform_calculate_key(uint8_t level, const uint8_t* seed, size_t seed_len,
+                               uint8_t* key, size_t key_len);
 
 /**
  * @brief Write firmware data to flash
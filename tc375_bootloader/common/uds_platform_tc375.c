@@ -22,8 +22,11 @@
 #include "flash_driver.h"
 #endif
 
-/* Simple seed/key algorithm (EXAMPLE ONLY - use proper security in production) */
-#define SECURITY_KEY_CONSTANT  0xABCD1234
+/* Level 1 secret (EXAMPLE ONLY - on target the key stays in an HSM key slot) */
+static const uint8_t security_level1_secret[UDS_SECURITY_KEY_SIZE] = {
+    0x56, 0x4D, 0x47, 0x2D, 0x42, 0x4F, 0x4F, 0x54,
+    0x2D, 0x4C, 0x31, 0x2D, 0x4B, 0x45, 0x59, 0x21
+};
 
 void uds_platform_ecu_reset(uint8_t reset_type) {
     /* TODO: Implement actual reset for TC375 */
@@ -68,43 +71,55 @@ uint32_t uds_platform_get_tick_ms(void) {
     return dummy_tick++;
 }
 
-uint32_t uds_platform_generate_seed(void) {
-    /* TODO: Implement secure random number generation */
-    
-    /* Options:
-     * 1. Use TC375 HSM (Hardware Security Module) random number generator
-     * 2. Use system timer + unique device ID for pseudo-random
-     * 3. Use external hardware RNG
+int uds_platform_fill_random(uint8_t* out, size_t len) {
+    /* TODO: Use the TC375 HSM TRNG
+     *
+     * Same source as tc375_hsm.random (tc375_hsm_integration.c), e.g.:
+     *   return tc375_hsm.random(out, len) == 0 ? 0 : -1;
+     *
+     * Called from uds_handler_idle(), so TRNG latency stays out of the
+     * 0x27 request path.
      */
-    
-    /* Placeholder: simple pseudo-random based on tick */
-    uint32_t tick = uds_platform_get_tick_ms();
-    uint32_t seed = (tick * 1103515245U + 12345U) & 0x7FFFFFFF;
-    
-    /* Ensure seed is never 0 */
-    if (seed == 0) {
-        seed = 0x12345678;
+
+    /* Placeholder: xorshift seeded from the tick (INSECURE - example only) */
+    static uint32_t state = 0;
+    if (state == 0) {
+        state = uds_platform_get_tick_ms() * 1103515245U + 12345U;
+        if (state == 0) {
+            state = 0x12345678;
+        }
     }
-    
-    return seed;
+
+    for (size_t i = 0; i < len; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        out[i] = (uint8_t)state;
+    }
+    return 0;
 }
 
-uint32_t uds_platform_calculate_key(uint32_t seed) {
-    /* TODO: Implement secure key derivation algorithm */
-    
-    /* WARNING: This is a WEAK example algorithm for demonstration only.
-     * In production, use:
-     * 1. Cryptographic hash function (SHA-256)
-     * 2. HMAC with device-specific secret
-     * 3. Challenge-response protocol
+int uds_platform_calculate_key(uint8_t level, const uint8_t* seed, size_t seed_len,
+                               uint8_t* key, size_t key_len) {
+    if (level != UDS_SECURITY_LEVEL_1 || seed_len != UDS_SECURITY_SEED_SIZE ||
+        key_len != UDS_SECURITY_KEY_SIZE) {
+        return -1;
+    }
+
+    /* TODO: AES-128-CMAC(level key, seed) on the HSM
+     *
+     * The tester computes the same CMAC with the provisioned level key;
+     * the key never leaves the HSM key slot on the ECU.
      */
-    
-    /* Simple XOR transformation (INSECURE - example only) */
-    uint32_t key = seed ^ SECURITY_KEY_CONSTANT;
-    key = (key << 16) | (key >> 16);  /* Rotate */
-    key ^= 0x5A5A5A5A;
-    
-    return key;
+
+    /* Placeholder: keyed mixing of the seed (INSECURE - example only) */
+    uint8_t acc = 0x5A;
+    for (size_t i = 0; i < key_len; i++) {
+        acc = (uint8_t)((acc << 3) | (acc >> 5));
+        acc ^= (uint8_t)(seed[i] ^ security_level1_secret[i]);
+        key[i] = (uint8_t)(acc + security_level1_secret[(i + 7) % UDS_SECURITY_KEY_SIZE]);
+    }
+    return 0;
 }
 
 int uds_platform_write_firmware(uint32_t address, const uint8_t* data, size_t len) {
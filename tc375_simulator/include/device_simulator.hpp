@@ -2,8 +2,11 @@
 
 #include "tls_client.hpp"
 #include "protocol.hpp"
+#include "sensor_batch.hpp"
+#include "uds_handler.hpp"
 #include <memory>
 #include <atomic>
+#include <mutex>
 #include <thread>
 #include <chrono>
 
@@ -19,8 +22,10 @@ struct SimulatorConfig {
     std::string ca_cert_path;
     int heartbeat_interval_sec;
     int sensor_update_interval_sec;
+    SensorBatchConfig sensor_batch;     // Enabled: sample fast, send one SENSOR_BATCH per window
 
     static SimulatorConfig loadFromFile(const std::string& filepath);
+    static SimulatorConfig fromJSON(const json& j);
 };
 
 class DeviceSimulator {
@@ -49,12 +54,23 @@ private:
     float pressure_;
     float voltage_;
 
+    // Samples waiting for the next SENSOR_BATCH (filled by sensorLoop)
+    std::mutex batch_mutex_;
+    SensorBatch batch_;
+
+    // UDS_REQUEST handling and 0x2A periodic frames (worker thread only)
+    UdsHandler uds_;
+    std::string rx_buffer_;
+
     void workerLoop();
     void sensorLoop();
     
     void sendHeartbeat();
     void sendSensorData();
-    void updateSensors();
+    void sendSensorBatch(bool force);
+    void receiveRequests();
+    void sendPeriodicFrames();
+    void updateSensors(float seconds = 1.0f);
     
     std::string getCurrentTimestamp() const;
 };
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "device_simulator.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <openssl/ssl.h>
+#include <sys/socket.h>
+
+namespace tc375 {
+
+// Load-test scenario: device.json plus a "fleet" section
+struct FleetScenario {
+    SimulatorConfig device;        // Gateway, TLS and message intervals shared by all ECUs
+
+    int ecu_count = 100;
+    int threads = 4;               // Event loops; ECUs are sharded across them
+    int ramp_up_per_sec = 200;     // New connections per second at start
+    int duration_sec = 0;          // 0 = until stopped
+    int report_interval_sec = 5;
+    int heartbeat_interval_ms = 0; // 0 = device heartbeat_interval_sec
+    int sensor_interval_ms = 0;    // 0 = device sensor_update_interval_sec
+    int max_backoff_sec = 30;      // Reconnect backoff cap
+    bool tls_session_resumption = true;
+
+    static FleetScenario loadFromFile(const std::string& filepath);
+};
+
+// Log-linear latency histogram in microseconds (8 sub-buckets per power of two, ~12% error)
+class LatencyHistogram {
+public:
+    void record(uint64_t us);
+    void merge(const LatencyHistogram& other);
+    uint64_t percentile(double p) const;
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+
+private:
+    static constexpr int SUB_BITS = 3;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS;
+    static size_t bucketOf(uint64_t us);
+    static uint64_t bucketUpper(size_t bucket);
+
+    std::array<uint64_t, BUCKETS> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t max_ = 0;
+};
+
+// Aggregate counters and latency distributions
+struct FleetStats {
+    uint64_t connected = 0;        // ECUs currently connected
+    uint64_t messages_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t replies = 0;          // Lines received from the gateway
+    uint64_t connect_failures = 0;
+    uint64_t disconnects = 0;
+    uint64_t dropped_messages = 0; // Send buffer full (gateway not reading)
+    uint64_t tls_resumed = 0;
+    LatencyHistogram connect_us;   // TCP connect + TLS handshake
+    LatencyHistogram send_lag_us;  // Message due -> fully written to the socket
+    LatencyHistogram reply_us;     // Message written -> reply line received
+
+    void merge(const FleetStats& other);
+};
+
+// Simulates many ECUs in one process: each ECU is a small state machine with
+// its own timers, driven by a few epoll loops over non-blocking sockets.
+// One SSL_CTX (and TLS session for resumption) is shared by all connections.
+class FleetSimulator {
+public:
+    explicit FleetSimulator(const FleetScenario& scenario);
+    ~FleetSimulator();
+
+    FleetSimulator(const FleetSimulator&) = delete;
+    FleetSimulator& operator=(const FleetSimulator&) = delete;
+
+    bool start();
+    void stop();
+    bool isRunning() const { return running_; }
+
+    // Aggregated over all shards (consistent per shard)
+    FleetStats getStats() const;
+    std::string getStatusReport() const;
+
+private:
+    enum class EcuState {
+        IDLE,          // Waiting for ramp-up slot or reconnect backoff
+        CONNECTING,    // Non-blocking TCP connect in progress
+        HANDSHAKING,   // TLS handshake in progress
+        RUNNING
+    };
+
+    struct Ecu {
+        std::string device_id;
+        EcuState state = EcuState::IDLE;
+        int fd = -1;
+        SSL* ssl = nullptr;
+
+        uint64_t wake_ms = 0;           // Timer deadline (heap entries with another value are stale)
+        uint64_t next_heartbeat_ms = 0;
+        uint64_t next_sensor_ms = 0;
+        uint64_t connect_start_us = 0;
+        uint32_t backoff_ms = 0;
+
+        std::string out;                // Pending bytes (partial writes)
+        size_t out_offset = 0;
+        uint64_t out_due_us = 0;        // Due time of the oldest unwritten message
+        uint32_t out_messages = 0;
+        std::array<uint64_t, 8> sent_us{};  // Write times awaiting a reply (ring)
+        uint8_t sent_head = 0;
+        uint8_t sent_count = 0;
+        bool want_write = false;
+
+        float temperature = 25.0f;
+        float pressure = 101.3f;
+        float voltage = 12.0f;
+        SensorBatch batch;              // Samples for the next SENSOR_BATCH (batching enabled)
+    };
+
+    struct TimerEntry {
+        uint64_t deadline_ms;
+        uint32_t ecu;
+        bool operator>(const TimerEntry& other) const { return deadline_ms > other.deadline_ms; }
+    };
+
+    struct Shard;
+
+    FleetScenario scenario_;
+    uint32_t heartbeat_ms_;
+    uint32_t sensor_ms_;
+    int64_t epoch_offset_ms_;       // Unix ms minus steady ms, for sample timestamps
+    SSL_CTX* ssl_ctx_;
+    sockaddr_storage gateway_addr_;
+    socklen_t gateway_addr_len_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> running_;
+
+    // Most recent TLS session, reused by new connections
+    mutable std::mutex session_mutex_;
+    SSL_SESSION* session_;
+    static int onNewSession(SSL* ssl, SSL_SESSION* session);
+
+    bool initSSL();
+    void shardLoop(Shard& shard);
+
+    void schedule(Shard& shard, uint32_t index, uint64_t deadline_ms);
+    void onTimer(Shard& shard, uint32_t index, uint64_t now_ms);
+    void onIo(Shard& shard, uint32_t index, uint32_t events);
+
+    void beginConnect(Shard& shard, uint32_t index);
+    void continueHandshake(Shard& shard, uint32_t index);
+    void onConnected(Shard& shard, uint32_t index);
+    void fail(Shard& shard, uint32_t index, bool was_connected);
+    void closeEcu(Shard& shard, Ecu& ecu);
+
+    void queueMessage(Shard& shard, uint32_t index, const std::string& message, uint64_t due_ms);
+    void flush(Shard& shard, uint32_t index);
+    void readReplies(Shard& shard, uint32_t index);
+    void updateInterest(Shard& shard, uint32_t index, bool want_write);
+    void stepSensors(Shard& shard, Ecu& ecu, float seconds);
+};
+
+} // namespace tc375
@@ -3,6 +3,8 @@
 #include <string>
 #include <cstdint>
 #include <functional>
+#include <vector>
+#include <utility>
 
 namespace tc375 {
 
@@ -17,6 +19,13 @@ enum class OtaState {
     FAILED
 };
 
+// Download coverage granularity (one bit per chunk in the coverage bitmap)
+constexpr uint32_t OTA_CHUNK_SIZE = 4096;
+
+// Coverage bitmap is persisted after this many newly completed chunks
+// (bounds flash wear; at most this many chunks are re-fetched after power loss)
+constexpr uint32_t OTA_COVERAGE_SAVE_INTERVAL = 16;
+
 // Boot Bank (A/B partition)
 enum class BootBank {
     BANK_A = 0,
@@ -57,6 +66,11 @@ public:
     // Status
     OtaState getState() const { return state_; }
     int getProgress() const;  // 0-100%
+    bool isResumed() const { return resumed_; }
+    
+    // Missing (offset, length) ranges of the current download, coalesced.
+    // After a resumed startDownload only these need to be requested.
+    std::vector<std::pair<uint32_t, uint32_t>> getMissingRanges() const;
     std::string getStatusReport() const;
     
     // Callbacks
@@ -74,6 +88,13 @@ private:
     uint32_t bytes_written_;
     FirmwareMetadata target_metadata_;
     std::string temp_file_path_;
+    bool resumed_;
+    
+    // Chunk coverage bitmap (bit set = chunk fully written to target bank)
+    std::vector<uint8_t> coverage_;
+    uint32_t chunks_since_save_;
+    uint32_t run_start_;    // Current contiguous write run [run_start_, run_end_)
+    uint32_t run_end_;
     
     // Callbacks
     ProgressCallback progress_callback_;
@@ -85,6 +106,11 @@ private:
         FirmwareMetadata firmware;
         uint32_t boot_count;
         uint32_t last_boot_timestamp;
+        
+        // Interrupted download state (valid while download_in_progress)
+        bool download_in_progress = false;
+        uint32_t chunk_size = OTA_CHUNK_SIZE;
+        std::vector<uint8_t> coverage;
     };
     BankMetadata bank_a_meta_;
     BankMetadata bank_b_meta_;
@@ -97,6 +123,15 @@ private:
     bool verifyCRC(BootBank bank, uint32_t expected_crc);
     bool verifySignature(BootBank bank, const uint8_t* signature);
     
+    // Coverage bitmap
+    uint32_t chunkCount() const;
+    bool isChunkCovered(uint32_t chunk) const;
+    uint32_t markCovered(uint32_t offset, size_t length);
+    uint32_t coveredBytes() const;
+    bool saveDownloadProgress();
+    void clearDownloadProgress();
+    BankMetadata& bankMeta(BootBank bank);
+    
     void updateProgress();
     void handleError(const std::string& error);
     void setState(OtaState state);
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 namespace tc375 {
@@ -13,6 +15,9 @@ enum class MessageType {
     STATUS_REPORT,
     COMMAND_ACK,
     SENSOR_DATA,
+    SENSOR_BATCH,   // Columnar block of many samples (sensor_batch.hpp)
+    UDS_REQUEST,    // Gateway -> device: {"data": "<hex UDS request>"}
+    UDS_RESPONSE,   // Device -> gateway: {"data": "<hex>", "periodic": 0x2A frame?}
     ERROR
 };
 
@@ -37,6 +42,10 @@ ProtocolMessage createStatusReport(const std::string& device_id, const json& sta
 ProtocolMessage createSensorData(const std::string& device_id, const json& data);
 ProtocolMessage createCommandAck(const std::string& device_id, const std::string& command_id, bool success);
 ProtocolMessage createError(const std::string& device_id, const std::string& error_msg);
+ProtocolMessage createUdsResponse(const std::string& device_id, const std::vector<uint8_t>& response, bool periodic);
+
+// UDS bytes of a UDS_REQUEST message; false if the payload is not valid hex
+bool parseUdsRequest(const ProtocolMessage& msg, std::vector<uint8_t>& request);
 
 } // namespace tc375
 
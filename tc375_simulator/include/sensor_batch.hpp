@@ -0,0 +1,90 @@
+#pragma once
+
+#include "protocol.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tc375 {
+
+// Sensor batching: samples are accumulated over a window and sent as one
+// SENSOR_BATCH message with a columnar, Gorilla-style encoded block:
+//
+//   u8     version (1)
+//   varint sample count, varint channel count
+//   varint first timestamp (ms since Unix epoch)
+//   timestamp column (bitstream): delta-of-delta per sample
+//       '0' = same interval, '10'+7, '110'+9, '1110'+12 bit signed value,
+//       '1111'+64 bit escape (raw two's complement, any delta-of-delta)
+//   one column per channel, each starting on a byte boundary:
+//       XOR:    first value as 32 raw bits, then XOR with the previous value
+//               '0' = unchanged, '10' + bits in the previous window,
+//               '11' + 5-bit leading zeros + 5-bit (length - 1) + bits
+//       SCALED: round(value / resolution) as zigzag varint, then zigzag
+//               varint deltas (fixed-point signals, like CAN scaling)
+//
+// The block is base64 in the JSON payload together with the channel list,
+// so a batch can be decoded without out-of-band configuration.
+
+enum class ColumnEncoding {
+    XOR,        // Lossless IEEE-754 float
+    SCALED      // Quantized to `resolution`
+};
+
+struct SensorChannel {
+    std::string name;
+    ColumnEncoding encoding = ColumnEncoding::SCALED;
+    double resolution = 0.01;
+};
+
+// "sensor_batch" section of device.json
+struct SensorBatchConfig {
+    bool enabled = false;
+    int sample_interval_ms = 100;  // Sampling rate while batching
+    int window_ms = 5000;          // Flush when the oldest sample is this old
+    int max_samples = 256;         // ... or when this many samples are buffered
+    std::vector<SensorChannel> channels;
+
+    // Channels: temperature (0.01 degC), pressure (0.01 kPa), voltage (0.001 V)
+    static SensorBatchConfig fromJSON(const json& j);
+};
+
+class SensorBatch {
+public:
+    explicit SensorBatch(size_t channel_count = 0);
+
+    // values: one per channel
+    void add(int64_t timestamp_ms, const float* values);
+    void clear();
+
+    size_t size() const { return timestamps_.size(); }
+    bool empty() const { return timestamps_.empty(); }
+    int64_t firstTimestamp() const { return timestamps_.empty() ? 0 : timestamps_.front(); }
+
+    std::vector<uint8_t> encode(const std::vector<SensorChannel>& channels) const;
+
+private:
+    std::vector<int64_t> timestamps_;
+    std::vector<std::vector<float>> columns_;
+};
+
+struct DecodedSensorBatch {
+    std::vector<std::string> channels;
+    std::vector<int64_t> timestamps_ms;
+    std::vector<std::vector<float>> values;     // [channel][sample]
+};
+
+// Decode a raw block (channels must match the encoder's)
+bool decodeSensorBlock(const uint8_t* data, size_t len, const std::vector<SensorChannel>& channels,
+                       DecodedSensorBatch& out);
+
+// Decode the payload of a SENSOR_BATCH message
+bool decodeSensorBatch(const json& payload, DecodedSensorBatch& out);
+
+ProtocolMessage createSensorBatch(const std::string& device_id, const std::vector<SensorChannel>& channels,
+                                  const SensorBatch& batch);
+
+// Current time in ms since Unix epoch (sample timestamps)
+int64_t currentTimeMs();
+
+} // namespace tc375
@@ -21,6 +21,8 @@ public:
     // Data transfer
     bool send(const std::string& data);
     std::string receive(size_t max_len = 4096);
+    // True if receive() has data (buffered TLS bytes or socket readable) within timeout_ms
+    bool waitReadable(int timeout_ms);
 
     // TLS configuration
     void setVerifyPeer(bool verify) { verify_peer_ = verify; }
@@ -1,9 +1,10 @@
 #pragma once
 
+#include "periodic_did_scheduler.hpp"
 #include <cstdint>
 #include <vector>
 #include <string>
-#include <map>
+#include <array>
 #include <functional>
 
 namespace tc375 {
@@ -16,6 +17,7 @@ enum class UdsService : uint8_t {
     COMMUNICATION_CONTROL = 0x28,
     TESTER_PRESENT = 0x3E,
     READ_DATA_BY_ID = 0x22,
+    READ_DATA_BY_PERIODIC_ID = 0x2A,
     WRITE_DATA_BY_ID = 0x2E,
     ROUTINE_CONTROL = 0x31,
     REQUEST_DOWNLOAD = 0x34,
@@ -40,7 +42,8 @@ enum class NRC : uint8_t {
     TRANSFER_DATA_SUSPENDED = 0x71,
     GENERAL_PROGRAMMING_FAILURE = 0x72,
     WRONG_BLOCK_SEQUENCE_COUNTER = 0x73,
-    REQUEST_CORRECTLY_RECEIVED_RESPONSE_PENDING = 0x78
+    REQUEST_CORRECTLY_RECEIVED_RESPONSE_PENDING = 0x78,
+    SERVICE_NOT_SUPPORTED_IN_ACTIVE_SESSION = 0x7F
 };
 
 // UDS Request/Response
@@ -83,6 +86,7 @@ public:
     UdsResponse handleSecurityAccess(const UdsMessage& request);
     UdsResponse handleTesterPresent(const UdsMessage& request);
     UdsResponse handleReadDataById(const UdsMessage& request);
+    UdsResponse handleReadDataByPeriodicId(const UdsMessage& request);
     UdsResponse handleWriteDataById(const UdsMessage& request);
     UdsResponse handleRoutineControl(const UdsMessage& request);
     
@@ -91,8 +95,17 @@ public:
     UdsResponse handleTransferData(const UdsMessage& request);
     UdsResponse handleRequestTransferExit(const UdsMessage& request);
 
+    // Periodic identifiers for 0x2A (PDID n = DID 0xF200 | n); reader returns the data bytes
+    using PeriodicReader = std::function<std::vector<uint8_t>()>;
+    void registerPeriodicDid(uint8_t pdid, PeriodicReader reader);
+
+    // Serialized 0x6A frame with PDID + data of every PDID due at now_ms (empty if none)
+    std::vector<uint8_t> collectPeriodicFrame(uint64_t now_ms);
+    // Earliest periodic deadline, UINT64_MAX if nothing is scheduled
+    uint64_t nextPeriodicDueMs() const;
+
 private:
-    std::map<UdsService, ServiceHandler> service_handlers_;
+    std::array<ServiceHandler, 256> service_handlers_;  // Indexed by SID
     
     // Security state
     enum class SecurityLevel {
@@ -121,6 +134,10 @@ private:
     };
     DownloadState download_state_;
 
+    // Periodic transmission: the VMG's rate-grouped scheduler (common/protocol)
+    vmg::PeriodicDIDScheduler periodic_;
+    std::array<PeriodicReader, 256> periodic_readers_;  // Indexed by PDID
+
     // Helper functions
     uint32_t generateSeed();
     bool verifySeedKey(uint32_t seed, uint32_t key);
@@ -1,18 +1,26 @@
 #include "device_simulator.hpp"
+#include "fleet_simulator.hpp"
 #include <iostream>
 #include <csignal>
 #include <string>
+#include <atomic>
+#include <sys/resource.h>
 
 using namespace tc375;
 
 // Global simulator instance for signal handling
 DeviceSimulator* g_simulator = nullptr;
 
+// Fleet mode: main loop stops the fleet and prints the final report
+std::atomic<bool> g_fleet_stop{false};
+
 void signalHandler(int signal) {
     std::cout << "\n[Main] Received signal " << signal << ", shutting down..." << std::endl;
-    if (g_simulator) {
-        g_simulator->stop();
+    if (!g_simulator) {
+        g_fleet_stop = true;
+        return;
     }
+    g_simulator->stop();
     exit(0);
 }
 
@@ -21,10 +29,69 @@ void printUsage() {
     std::cout << "Usage: ./tc375_simulator [options]" << std::endl;
     std::cout << "\nOptions:" << std::endl;
     std::cout << "  -c, --config <file>   Configuration file (default: tc375_simulator/config/device.json)" << std::endl;
+    std::cout << "  -f, --fleet <file>    Load test: simulate many ECUs from a scenario file" << std::endl;
+    std::cout << "                        (e.g. tc375_simulator/config/fleet.json)" << std::endl;
     std::cout << "  -h, --help            Show this help message" << std::endl;
     std::cout << std::endl;
 }
 
+int runFleet(const std::string& scenario_file) {
+    std::cout << "[Main] Loading fleet scenario from: " << scenario_file << std::endl;
+    auto scenario = FleetScenario::loadFromFile(scenario_file);
+
+    // One socket per ECU
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < static_cast<rlim_t>(scenario.ecu_count) + 64) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    FleetSimulator fleet(scenario);
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+
+    if (!fleet.start()) {
+        std::cerr << "[Main] Failed to start fleet" << std::endl;
+        return 1;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    auto last_report = started;
+    FleetStats last = fleet.getStats();
+    int report_sec = std::max(scenario.report_interval_sec, 1);
+
+    while (!g_fleet_stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - started).count();
+        if (scenario.duration_sec > 0 && elapsed >= scenario.duration_sec) {
+            break;
+        }
+
+        double window = std::chrono::duration<double>(now - last_report).count();
+        if (window < report_sec) {
+            continue;
+        }
+
+        FleetStats stats = fleet.getStats();
+        std::cout << "[Fleet] t=" << static_cast<int>(elapsed) << "s"
+                  << " connected=" << stats.connected << "/" << scenario.ecu_count
+                  << " msg/s=" << static_cast<uint64_t>((stats.messages_sent - last.messages_sent) / window)
+                  << " KB/s=" << static_cast<uint64_t>((stats.bytes_sent - last.bytes_sent) / window / 1024)
+                  << " replies/s=" << static_cast<uint64_t>((stats.replies - last.replies) / window)
+                  << " lag p99=" << stats.send_lag_us.percentile(99) << "us"
+                  << " connect p99=" << stats.connect_us.percentile(99) << "us"
+                  << " failures=" << stats.connect_failures + stats.disconnects << std::endl;
+        last = stats;
+        last_report = now;
+    }
+
+    std::string report = fleet.getStatusReport();  // Before stop() closes the connections
+    fleet.stop();
+    std::cout << std::endl << report;
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     std::cout << "=== TC375 Device Simulator v1.0 ===" << std::endl;
     std::cout << "Simulating TC375 Lite Kit device" << std::endl;
@@ -33,12 +100,20 @@ int main(int argc, char* argv[]) {
 
     // Parse command line arguments
     std::string config_file = "tc375_simulator/config/device.json";
+    std::string fleet_file;
     
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "-h" || arg == "--help") {
             printUsage();
             return 0;
+        } else if (arg == "-f" || arg == "--fleet") {
+            if (i + 1 < argc) {
+                fleet_file = argv[++i];
+            } else {
+                std::cerr << "Error: -f/--fleet requires a scenario file" << std::endl;
+                return 1;
+            }
         } else if (arg == "-c" || arg == "--config") {
             if (i + 1 < argc) {
                 config_file = argv[++i];
@@ -50,6 +125,10 @@ int main(int argc, char* argv[]) {
     }
 
     try {
+        if (!fleet_file.empty()) {
+            return runFleet(fleet_file);
+        }
+
         // Load configuration
         std::cout << "[Main] Loading configuration from: " << config_file << std::endl;
         auto config = SimulatorConfig::loadFromFile(config_file);
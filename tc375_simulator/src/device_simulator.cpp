@@ -5,9 +5,24 @@
 #include <random>
 #include <iomanip>
 #include <chrono>
+#include <cmath>
 
 namespace tc375 {
 
+namespace {
+
+uint64_t steadyNowMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+std::vector<uint8_t> scaledValue(float value, float resolution) {
+    auto raw = static_cast<uint16_t>(static_cast<int16_t>(std::lround(value / resolution)));
+    return {static_cast<uint8_t>(raw >> 8), static_cast<uint8_t>(raw)};
+}
+
+} // namespace
+
 SimulatorConfig SimulatorConfig::loadFromFile(const std::string& filepath) {
     std::ifstream file(filepath);
     if (!file.is_open()) {
@@ -16,7 +31,10 @@ SimulatorConfig SimulatorConfig::loadFromFile(const std::string& filepath) {
 
     json j;
     file >> j;
+    return fromJSON(j);
+}
 
+SimulatorConfig SimulatorConfig::fromJSON(const json& j) {
     SimulatorConfig config;
     config.device_id = j["device"]["id"].get<std::string>();
     config.device_type = j["device"]["type"].get<std::string>();
@@ -36,6 +54,7 @@ SimulatorConfig SimulatorConfig::loadFromFile(const std::string& filepath) {
     
     config.heartbeat_interval_sec = j.value("heartbeat_interval_sec", 10);
     config.sensor_update_interval_sec = j.value("sensor_update_interval_sec", 5);
+    config.sensor_batch = SensorBatchConfig::fromJSON(j);
 
     return config;
 }
@@ -46,7 +65,13 @@ DeviceSimulator::DeviceSimulator(const SimulatorConfig& config)
     , temperature_(25.0f)
     , pressure_(101.3f)
     , voltage_(12.0f)
+    , batch_(config.sensor_batch.channels.size())
 {
+    // Periodic DIDs for 0x2A, same scaling as the sensor batch channels (int16, big-endian)
+    uds_.registerPeriodicDid(0x01, [this]() { return scaledValue(temperature_, 0.01f); });
+    uds_.registerPeriodicDid(0x02, [this]() { return scaledValue(pressure_, 0.01f); });
+    uds_.registerPeriodicDid(0x03, [this]() { return scaledValue(voltage_, 0.001f); });
+
     client_ = std::make_unique<TlsClient>(config_.gateway_host, config_.gateway_port);
     client_->setVerifyPeer(config_.verify_peer);
     if (!config_.ca_cert_path.empty()) {
@@ -67,6 +92,10 @@ bool DeviceSimulator::start() {
     std::cout << "Device ID: " << config_.device_id << std::endl;
     std::cout << "Type: " << config_.device_type << std::endl;
     std::cout << "Gateway: " << config_.gateway_host << ":" << config_.gateway_port << std::endl;
+    if (config_.sensor_batch.enabled) {
+        std::cout << "Sensor batching: " << config_.sensor_batch.sample_interval_ms << " ms samples, "
+                  << config_.sensor_batch.window_ms << " ms window" << std::endl;
+    }
     std::cout << "===============================" << std::endl << std::endl;
 
     // Connect to gateway
@@ -100,6 +129,11 @@ void DeviceSimulator::stop() {
         sensor_thread_.join();
     }
 
+    // Do not lose the partial window
+    if (config_.sensor_batch.enabled && client_->isConnected()) {
+        sendSensorBatch(true);
+    }
+
     client_->disconnect();
     std::cout << "[Simulator] Stopped" << std::endl;
 }
@@ -119,22 +153,95 @@ void DeviceSimulator::workerLoop() {
             last_heartbeat = now;
         }
 
-        // Send sensor data
+        // Send sensor data (batched: whenever the window is due)
         auto sensor_elapsed = std::chrono::duration_cast<std::chrono::seconds>(
             now - last_sensor_data).count();
-        if (sensor_elapsed >= config_.sensor_update_interval_sec) {
+        if (config_.sensor_batch.enabled) {
+            sendSensorBatch(false);
+        } else if (sensor_elapsed >= config_.sensor_update_interval_sec) {
             sendSensorData();
             last_sensor_data = now;
         }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // Wait for requests, but wake for the next 0x2A deadline
+        uint64_t wait_ms = 100;
+        uint64_t next_due_ms = uds_.nextPeriodicDueMs();
+        if (next_due_ms != vmg::PERIODIC_NONE_DUE) {
+            uint64_t now_ms = steadyNowMs();
+            wait_ms = std::min<uint64_t>(wait_ms, next_due_ms > now_ms ? next_due_ms - now_ms : 0);
+        }
+        if (client_->waitReadable(static_cast<int>(wait_ms))) {
+            receiveRequests();
+        }
+        sendPeriodicFrames();
+    }
+}
+
+void DeviceSimulator::receiveRequests() {
+    std::string data = client_->receive();
+    if (data.empty()) {
+        return;
+    }
+    rx_buffer_ += data;
+
+    // Newline-delimited JSON, same framing as outgoing messages
+    size_t newline;
+    while ((newline = rx_buffer_.find('\n')) != std::string::npos) {
+        std::string line = rx_buffer_.substr(0, newline);
+        rx_buffer_.erase(0, newline + 1);
+
+        ProtocolMessage msg;
+        try {
+            msg = ProtocolMessage::fromJSON(line);
+        } catch (const std::exception& e) {
+            std::cerr << "[Simulator] Bad message: " << e.what() << std::endl;
+            continue;
+        }
+
+        std::vector<uint8_t> raw;
+        if (!parseUdsRequest(msg, raw)) {
+            continue;
+        }
+        // Handlers take everything after the SID in `data`
+        UdsMessage request;
+        request.service = static_cast<UdsService>(raw[0]);
+        request.sub_function = 0;
+        request.data.assign(raw.begin() + 1, raw.end());
+
+        UdsResponse response = uds_.handleRequest(request);
+        client_->send(createUdsResponse(config_.device_id, response.serialize(), false).toJSON() + "\n");
+    }
+}
+
+void DeviceSimulator::sendPeriodicFrames() {
+    std::vector<uint8_t> frame = uds_.collectPeriodicFrame(steadyNowMs());
+    if (frame.empty()) {
+        return;
     }
+    client_->send(createUdsResponse(config_.device_id, frame, true).toJSON() + "\n");
 }
 
 void DeviceSimulator::sensorLoop() {
+    if (!config_.sensor_batch.enabled) {
+        while (running_) {
+            updateSensors();
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+        return;
+    }
+
+    // Fixed-rate sampling: a steady schedule keeps timestamp delta-of-deltas near zero
+    auto interval = std::chrono::milliseconds(config_.sensor_batch.sample_interval_ms);
+    auto next = std::chrono::steady_clock::now();
     while (running_) {
-        updateSensors();
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        updateSensors(config_.sensor_batch.sample_interval_ms / 1000.0f);
+        float values[] = {temperature_, pressure_, voltage_};
+        {
+            std::lock_guard<std::mutex> lock(batch_mutex_);
+            batch_.add(currentTimeMs(), values);
+        }
+        next += interval;
+        std::this_thread::sleep_until(next);
     }
 }
 
@@ -164,13 +271,37 @@ void DeviceSimulator::sendSensorData() {
     client_->send(json_str + "\n");
 }
 
-void DeviceSimulator::updateSensors() {
-    // Simulate sensor readings with random variations
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::normal_distribution<float> temp_dist(0.0f, 0.5f);
-    std::normal_distribution<float> press_dist(0.0f, 0.2f);
-    std::normal_distribution<float> volt_dist(0.0f, 0.1f);
+void DeviceSimulator::sendSensorBatch(bool force) {
+    SensorBatch batch(config_.sensor_batch.channels.size());
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+        if (batch_.empty()) {
+            return;
+        }
+        bool due = batch_.size() >= static_cast<size_t>(config_.sensor_batch.max_samples) ||
+                   currentTimeMs() - batch_.firstTimestamp() >= config_.sensor_batch.window_ms;
+        if (!due && !force) {
+            return;
+        }
+        std::swap(batch, batch_);
+    }
+
+    auto msg = createSensorBatch(config_.device_id, config_.sensor_batch.channels, batch);
+    std::string json_str = msg.toJSON();
+
+    std::cout << "[Simulator] Sending sensor batch: " << batch.size() << " samples, "
+              << json_str.size() + 1 << " bytes" << std::endl;
+
+    client_->send(json_str + "\n");
+}
+
+void DeviceSimulator::updateSensors(float seconds) {
+    // Simulate sensor readings with random variations (random walk, 1 step/s scale)
+    static thread_local std::mt19937 gen(std::random_device{}());
+    float scale = std::sqrt(seconds);
+    std::normal_distribution<float> temp_dist(0.0f, 0.5f * scale);
+    std::normal_distribution<float> press_dist(0.0f, 0.2f * scale);
+    std::normal_distribution<float> volt_dist(0.0f, 0.1f * scale);
 
     temperature_ += temp_dist(gen);
     pressure_ += press_dist(gen);
@@ -0,0 +1,797 @@
+#include "fleet_simulator.hpp"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <random>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <openssl/err.h>
+
+namespace tc375 {
+
+namespace {
+
+constexpr size_t MAX_PENDING_BYTES = 64 * 1024;
+constexpr uint32_t CONNECT_TIMEOUT_MS = 10000;
+constexpr int MAX_EPOLL_EVENTS = 256;
+constexpr int MAX_WAIT_MS = 100;    // Upper bound so stop() is noticed
+
+uint64_t nowUs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t nowMs() {
+    return nowUs() / 1000;
+}
+
+} // namespace
+
+// ============================================================================
+// Scenario
+// ============================================================================
+
+FleetScenario FleetScenario::loadFromFile(const std::string& filepath) {
+    std::ifstream file(filepath);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open scenario file: " + filepath);
+    }
+
+    json j;
+    file >> j;
+
+    FleetScenario scenario;
+    scenario.device = SimulatorConfig::fromJSON(j);
+
+    if (j.contains("fleet")) {
+        const json& fleet = j["fleet"];
+        scenario.ecu_count = fleet.value("ecu_count", scenario.ecu_count);
+        scenario.threads = fleet.value("threads", scenario.threads);
+        scenario.ramp_up_per_sec = fleet.value("ramp_up_per_sec", scenario.ramp_up_per_sec);
+        scenario.duration_sec = fleet.value("duration_sec", scenario.duration_sec);
+        scenario.report_interval_sec = fleet.value("report_interval_sec", scenario.report_interval_sec);
+        scenario.heartbeat_interval_ms = fleet.value("heartbeat_interval_ms", scenario.heartbeat_interval_ms);
+        scenario.sensor_interval_ms = fleet.value("sensor_interval_ms", scenario.sensor_interval_ms);
+        scenario.max_backoff_sec = fleet.value("max_backoff_sec", scenario.max_backoff_sec);
+        scenario.tls_session_resumption = fleet.value("tls_session_resumption", scenario.tls_session_resumption);
+    }
+
+    if (scenario.ecu_count <= 0 || scenario.threads <= 0) {
+        throw std::runtime_error("fleet.ecu_count and fleet.threads must be positive");
+    }
+    return scenario;
+}
+
+// ============================================================================
+// Latency histogram
+// ============================================================================
+
+size_t LatencyHistogram::bucketOf(uint64_t us) {
+    if (us < (1u << SUB_BITS)) {
+        return static_cast<size_t>(us);
+    }
+    int msb = 63 - __builtin_clzll(us);
+    int shift = msb - SUB_BITS;
+    size_t sub = static_cast<size_t>((us >> shift) & ((1u << SUB_BITS) - 1));
+    return (static_cast<size_t>(shift + 1) << SUB_BITS) + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpper(size_t bucket) {
+    if (bucket < (1u << SUB_BITS)) {
+        return bucket;
+    }
+    int shift = static_cast<int>(bucket >> SUB_BITS) - 1;
+    uint64_t sub = bucket & ((1u << SUB_BITS) - 1);
+    uint64_t lower = ((1ull << SUB_BITS) + sub) << shift;
+    return lower + (1ull << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t us) {
+    buckets_[bucketOf(us)]++;
+    count_++;
+    max_ = std::max(max_, us);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; i++) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(count_)));
+    target = std::max<uint64_t>(target, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += buckets_[i];
+        if (seen >= target) {
+            return std::min(bucketUpper(i), max_);
+        }
+    }
+    return max_;
+}
+
+void FleetStats::merge(const FleetStats& other) {
+    connected += other.connected;
+    messages_sent += other.messages_sent;
+    bytes_sent += other.bytes_sent;
+    replies += other.replies;
+    connect_failures += other.connect_failures;
+    disconnects += other.disconnects;
+    dropped_messages += other.dropped_messages;
+    tls_resumed += other.tls_resumed;
+    connect_us.merge(other.connect_us);
+    send_lag_us.merge(other.send_lag_us);
+    reply_us.merge(other.reply_us);
+}
+
+// ============================================================================
+// Fleet simulator
+// ============================================================================
+
+// One event loop: its ECUs, timer heap and stats are touched only by its thread
+// (stats also by getStats() under stats_mutex)
+struct FleetSimulator::Shard {
+    std::vector<Ecu> ecus;
+    std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry>> timers;
+    int epoll_fd = -1;
+    std::thread thread;
+    std::mt19937 rng;
+    mutable std::mutex stats_mutex;
+    FleetStats stats;
+    char read_buffer[4096];
+};
+
+FleetSimulator::FleetSimulator(const FleetScenario& scenario)
+    : scenario_(scenario)
+    , heartbeat_ms_(0)
+    , sensor_ms_(0)
+    , epoch_offset_ms_(0)
+    , ssl_ctx_(nullptr)
+    , gateway_addr_()
+    , gateway_addr_len_(0)
+    , running_(false)
+    , session_(nullptr)
+{
+    heartbeat_ms_ = static_cast<uint32_t>(scenario_.heartbeat_interval_ms > 0 ?
+        scenario_.heartbeat_interval_ms : scenario_.device.heartbeat_interval_sec * 1000);
+    sensor_ms_ = static_cast<uint32_t>(scenario_.sensor_interval_ms > 0 ?
+        scenario_.sensor_interval_ms : scenario_.device.sensor_update_interval_sec * 1000);
+    if (scenario_.device.sensor_batch.enabled) {
+        sensor_ms_ = static_cast<uint32_t>(scenario_.device.sensor_batch.sample_interval_ms);
+    }
+    heartbeat_ms_ = std::max<uint32_t>(heartbeat_ms_, 1);
+    sensor_ms_ = std::max<uint32_t>(sensor_ms_, 1);
+    epoch_offset_ms_ = currentTimeMs() - static_cast<int64_t>(nowMs());
+}
+
+FleetSimulator::~FleetSimulator() {
+    stop();
+    if (session_) {
+        SSL_SESSION_free(session_);
+    }
+    if (ssl_ctx_) {
+        SSL_CTX_free(ssl_ctx_);
+    }
+}
+
+bool FleetSimulator::initSSL() {
+    ssl_ctx_ = SSL_CTX_new(TLS_client_method());
+    if (!ssl_ctx_) {
+        std::cerr << "[Fleet] Failed to create SSL context" << std::endl;
+        return false;
+    }
+
+    // Same policy as TlsClient
+    SSL_CTX_set_min_proto_version(ssl_ctx_, TLS1_3_VERSION);
+    if (scenario_.device.verify_peer) {
+        if (!scenario_.device.ca_cert_path.empty() &&
+            SSL_CTX_load_verify_locations(ssl_ctx_, scenario_.device.ca_cert_path.c_str(), nullptr) != 1) {
+            std::cerr << "[Fleet] Failed to load CA certificate" << std::endl;
+            return false;
+        }
+        SSL_CTX_set_verify(ssl_ctx_, SSL_VERIFY_PEER, nullptr);
+    } else {
+        SSL_CTX_set_verify(ssl_ctx_, SSL_VERIFY_NONE, nullptr);
+    }
+
+    // Thousands of mostly idle connections: drop per-connection buffers between records
+    SSL_CTX_set_mode(ssl_ctx_, SSL_MODE_RELEASE_BUFFERS | SSL_MODE_ENABLE_PARTIAL_WRITE |
+                               SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+    if (scenario_.tls_session_resumption) {
+        SSL_CTX_set_app_data(ssl_ctx_, this);
+        SSL_CTX_set_session_cache_mode(ssl_ctx_, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ssl_ctx_, &FleetSimulator::onNewSession);
+    }
+    return true;
+}
+
+int FleetSimulator::onNewSession(SSL* ssl, SSL_SESSION* session) {
+    auto* self = static_cast<FleetSimulator*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    std::lock_guard<std::mutex> lock(self->session_mutex_);
+    if (self->session_) {
+        SSL_SESSION_free(self->session_);
+    }
+    self->session_ = session;
+    return 1;  // Reference kept
+}
+
+bool FleetSimulator::start() {
+    if (running_) {
+        return true;
+    }
+
+    // Resolve once for all ECUs
+    struct addrinfo hints, *result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    std::string port_str = std::to_string(scenario_.device.gateway_port);
+    if (getaddrinfo(scenario_.device.gateway_host.c_str(), port_str.c_str(), &hints, &result) != 0) {
+        std::cerr << "[Fleet] Failed to resolve " << scenario_.device.gateway_host << std::endl;
+        return false;
+    }
+    memcpy(&gateway_addr_, result->ai_addr, result->ai_addrlen);
+    gateway_addr_len_ = result->ai_addrlen;
+    freeaddrinfo(result);
+
+    if (scenario_.device.use_tls && !ssl_ctx_ && !initSSL()) {
+        return false;
+    }
+
+    std::cout << "=== TC375 Fleet Simulator ===" << std::endl;
+    std::cout << "ECUs: " << scenario_.ecu_count << " on " << scenario_.threads << " threads" << std::endl;
+    std::cout << "Gateway: " << scenario_.device.gateway_host << ":" << scenario_.device.gateway_port
+              << (scenario_.device.use_tls ? " (TLS)" : " (TCP)") << std::endl;
+    std::cout << "Heartbeat: " << heartbeat_ms_ << " ms, sensor data: " << sensor_ms_ << " ms";
+    if (scenario_.device.sensor_batch.enabled) {
+        std::cout << " (batched, " << scenario_.device.sensor_batch.window_ms << " ms window)";
+    }
+    std::cout << std::endl;
+    std::cout << "=============================" << std::endl << std::endl;
+
+    // ECU i goes to shard i % threads, so the ramp-up is spread over all loops
+    uint64_t start_ms = nowMs();
+    int ramp = std::max(scenario_.ramp_up_per_sec, 1);
+    shards_.clear();
+    for (int t = 0; t < scenario_.threads; t++) {
+        auto shard = std::make_unique<Shard>();
+        shard->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (shard->epoll_fd < 0) {
+            std::cerr << "[Fleet] epoll_create1 failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+        shard->rng.seed(static_cast<uint32_t>(start_ms) + static_cast<uint32_t>(t));
+        shards_.push_back(std::move(shard));
+    }
+
+    for (int i = 0; i < scenario_.ecu_count; i++) {
+        Shard& shard = *shards_[static_cast<size_t>(i % scenario_.threads)];
+        std::ostringstream id;
+        id << scenario_.device.device_id << "-" << std::setw(5) << std::setfill('0') << i;
+
+        shard.ecus.emplace_back();
+        shard.ecus.back().device_id = id.str();
+        shard.ecus.back().batch = SensorBatch(scenario_.device.sensor_batch.channels.size());
+        schedule(shard, static_cast<uint32_t>(shard.ecus.size() - 1),
+                 start_ms + static_cast<uint64_t>(i) * 1000 / static_cast<uint64_t>(ramp));
+    }
+
+    running_ = true;
+    for (auto& shard : shards_) {
+        Shard* raw = shard.get();
+        shard->thread = std::thread([this, raw] { shardLoop(*raw); });
+    }
+
+    std::cout << "[Fleet] Started" << std::endl;
+    return true;
+}
+
+void FleetSimulator::stop() {
+    if (!running_) {
+        return;
+    }
+
+    std::cout << "[Fleet] Stopping..." << std::endl;
+    running_ = false;
+
+    for (auto& shard : shards_) {
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+
+    // Loops have exited: close connections from this thread
+    for (auto& shard : shards_) {
+        for (auto& ecu : shard->ecus) {
+            closeEcu(*shard, ecu);
+        }
+        close(shard->epoll_fd);
+        shard->epoll_fd = -1;
+        std::lock_guard<std::mutex> lock(shard->stats_mutex);
+        shard->stats.connected = 0;
+    }
+    std::cout << "[Fleet] Stopped" << std::endl;
+}
+
+void FleetSimulator::shardLoop(Shard& shard) {
+    epoll_event events[MAX_EPOLL_EVENTS];
+
+    while (running_) {
+        uint64_t now_ms = nowMs();
+        int wait_ms = MAX_WAIT_MS;
+        if (!shard.timers.empty()) {
+            uint64_t deadline = shard.timers.top().deadline_ms;
+            wait_ms = deadline <= now_ms ? 0 : static_cast<int>(std::min<uint64_t>(deadline - now_ms, MAX_WAIT_MS));
+        }
+
+        int count = epoll_wait(shard.epoll_fd, events, MAX_EPOLL_EVENTS, wait_ms);
+        for (int i = 0; i < count; i++) {
+            onIo(shard, events[i].data.u32, events[i].events);
+        }
+
+        now_ms = nowMs();
+        while (!shard.timers.empty() && shard.timers.top().deadline_ms <= now_ms) {
+            TimerEntry entry = shard.timers.top();
+            shard.timers.pop();
+            if (shard.ecus[entry.ecu].wake_ms == entry.deadline_ms) {
+                onTimer(shard, entry.ecu, now_ms);
+            }
+        }
+    }
+}
+
+void FleetSimulator::schedule(Shard& shard, uint32_t index, uint64_t deadline_ms) {
+    shard.ecus[index].wake_ms = deadline_ms;
+    shard.timers.push({deadline_ms, index});
+}
+
+// ============================================================================
+// ECU state machine
+// ============================================================================
+
+void FleetSimulator::onTimer(Shard& shard, uint32_t index, uint64_t now_ms) {
+    Ecu& ecu = shard.ecus[index];
+
+    switch (ecu.state) {
+        case EcuState::IDLE:
+            beginConnect(shard, index);
+            return;
+
+        case EcuState::CONNECTING:
+        case EcuState::HANDSHAKING:
+            fail(shard, index, false);  // Connect timeout
+            return;
+
+        case EcuState::RUNNING:
+            break;
+    }
+
+    if (now_ms >= ecu.next_heartbeat_ms) {
+        queueMessage(shard, index, createHeartbeat(ecu.device_id).toJSON() + "\n", ecu.next_heartbeat_ms);
+        ecu.next_heartbeat_ms += heartbeat_ms_;
+        if (ecu.next_heartbeat_ms <= now_ms) {
+            ecu.next_heartbeat_ms = now_ms + heartbeat_ms_;  // Fell behind: skip, do not burst
+        }
+    }
+    if (ecu.state == EcuState::RUNNING && now_ms >= ecu.next_sensor_ms) {
+        stepSensors(shard, ecu, static_cast<float>(sensor_ms_) / 1000.0f);
+        const SensorBatchConfig& batching = scenario_.device.sensor_batch;
+        if (batching.enabled) {
+            // Scheduled (not actual) time: regular intervals encode as 1 bit per sample
+            int64_t sample_ms = epoch_offset_ms_ + static_cast<int64_t>(ecu.next_sensor_ms);
+            float values[] = {ecu.temperature, ecu.pressure, ecu.voltage};
+            ecu.batch.add(sample_ms, values);
+            if (ecu.batch.size() >= static_cast<size_t>(batching.max_samples) ||
+                sample_ms - ecu.batch.firstTimestamp() >= batching.window_ms) {
+                queueMessage(shard, index,
+                             createSensorBatch(ecu.device_id, batching.channels, ecu.batch).toJSON() + "\n",
+                             ecu.next_sensor_ms);
+                ecu.batch.clear();
+            }
+        } else {
+            json sensor_data = {
+                {"temperature", ecu.temperature},
+                {"pressure", ecu.pressure},
+                {"voltage", ecu.voltage}
+            };
+            queueMessage(shard, index, createSensorData(ecu.device_id, sensor_data).toJSON() + "\n", ecu.next_sensor_ms);
+        }
+        ecu.next_sensor_ms += sensor_ms_;
+        if (ecu.next_sensor_ms <= now_ms) {
+            ecu.next_sensor_ms = now_ms + sensor_ms_;
+        }
+    }
+
+    if (ecu.state == EcuState::RUNNING) {
+        schedule(shard, index, std::min(ecu.next_heartbeat_ms, ecu.next_sensor_ms));
+    }
+}
+
+void FleetSimulator::onIo(Shard& shard, uint32_t index, uint32_t events) {
+    Ecu& ecu = shard.ecus[index];
+
+    switch (ecu.state) {
+        case EcuState::CONNECTING: {
+            int error = 0;
+            socklen_t len = sizeof(error);
+            if (getsockopt(ecu.fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+                fail(shard, index, false);
+                return;
+            }
+            if (!ssl_ctx_) {
+                onConnected(shard, index);
+                return;
+            }
+
+            ecu.ssl = SSL_new(ssl_ctx_);
+            if (!ecu.ssl) {
+                fail(shard, index, false);
+                return;
+            }
+            SSL_set_fd(ecu.ssl, ecu.fd);
+            SSL_set_connect_state(ecu.ssl);
+            if (scenario_.tls_session_resumption) {
+                std::lock_guard<std::mutex> lock(session_mutex_);
+                if (session_) {
+                    SSL_set_session(ecu.ssl, session_);
+                }
+            }
+            ecu.state = EcuState::HANDSHAKING;
+            continueHandshake(shard, index);
+            return;
+        }
+
+        case EcuState::HANDSHAKING:
+            continueHandshake(shard, index);
+            return;
+
+        case EcuState::RUNNING:
+            if (events & EPOLLIN) {
+                readReplies(shard, index);
+            } else if (events & (EPOLLERR | EPOLLHUP)) {
+                fail(shard, index, true);
+                return;
+            }
+            if (ecu.state == EcuState::RUNNING && (events & EPOLLOUT)) {
+                flush(shard, index);
+            }
+            return;
+
+        case EcuState::IDLE:
+            return;
+    }
+}
+
+void FleetSimulator::beginConnect(Shard& shard, uint32_t index) {
+    Ecu& ecu = shard.ecus[index];
+
+    ecu.fd = socket(gateway_addr_.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (ecu.fd < 0) {
+        fail(shard, index, false);
+        return;
+    }
+    int one = 1;
+    setsockopt(ecu.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    ecu.connect_start_us = nowUs();
+    if (connect(ecu.fd, reinterpret_cast<const sockaddr*>(&gateway_addr_), gateway_addr_len_) < 0 &&
+        errno != EINPROGRESS) {
+        fail(shard, index, false);
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLOUT;
+    ev.data.u32 = index;
+    if (epoll_ctl(shard.epoll_fd, EPOLL_CTL_ADD, ecu.fd, &ev) < 0) {
+        fail(shard, index, false);
+        return;
+    }
+
+    ecu.state = EcuState::CONNECTING;
+    ecu.want_write = true;
+    schedule(shard, index, nowMs() + CONNECT_TIMEOUT_MS);
+}
+
+void FleetSimulator::continueHandshake(Shard& shard, uint32_t index) {
+    Ecu& ecu = shard.ecus[index];
+
+    int ret = SSL_connect(ecu.ssl);
+    if (ret == 1) {
+        if (SSL_session_reused(ecu.ssl)) {
+            std::lock_guard<std::mutex> lock(shard.stats_mutex);
+            shard.stats.tls_resumed++;
+        }
+        onConnected(shard, index);
+        return;
+    }
+
+    int err = SSL_get_error(ecu.ssl, ret);
+    if (err == SSL_ERROR_WANT_READ) {
+        updateInterest(shard, index, false);
+    } else if (err == SSL_ERROR_WANT_WRITE) {
+        updateInterest(shard, index, true);
+    } else {
+        ERR_clear_error();
+        fail(shard, index, false);
+    }
+}
+
+void FleetSimulator::onConnected(Shard& shard, uint32_t index) {
+    Ecu& ecu = shard.ecus[index];
+    uint64_t now_us = nowUs();
+    uint64_t now_ms = now_us / 1000;
+
+    ecu.state = EcuState::RUNNING;
+    ecu.backoff_ms = 0;
+    {
+        std::lock_guard<std::mutex> lock(shard.stats_mutex);
+        shard.stats.connected++;
+        shard.stats.connect_us.record(now_us - ecu.connect_start_us);
+    }
+
+    // Random phase so the fleet does not send in lockstep
+    ecu.next_heartbeat_ms = now_ms + shard.rng() % heartbeat_ms_;
+    ecu.next_sensor_ms = now_ms + shard.rng() % sensor_ms_;
+    schedule(shard, index, std::min(ecu.next_heartbeat_ms, ecu.next_sensor_ms));
+    updateInterest(shard, index, false);
+}
+
+void FleetSimulator::fail(Shard& shard, uint32_t index, bool was_connected) {
+    Ecu& ecu = shard.ecus[index];
+    closeEcu(shard, ecu);
+    {
+        std::lock_guard<std::mutex> lock(shard.stats_mutex);
+        if (was_connected) {
+            shard.stats.disconnects++;
+            shard.stats.connected--;
+        } else {
+            shard.stats.connect_failures++;
+        }
+    }
+
+    // Exponential backoff with jitter
+    uint32_t max_backoff_ms = static_cast<uint32_t>(std::max(scenario_.max_backoff_sec, 1)) * 1000;
+    ecu.backoff_ms = ecu.backoff_ms == 0 ? 1000 : std::min(ecu.backoff_ms * 2, max_backoff_ms);
+    ecu.state = EcuState::IDLE;
+    schedule(shard, index, nowMs() + ecu.backoff_ms / 2 + shard.rng() % (ecu.backoff_ms / 2 + 1));
+}
+
+void FleetSimulator::closeEcu(Shard& shard, Ecu& ecu) {
+    if (ecu.ssl) {
+        if (ecu.state == EcuState::RUNNING) {
+            SSL_shutdown(ecu.ssl);  // close_notify, no wait for the peer
+        }
+        SSL_free(ecu.ssl);
+        ecu.ssl = nullptr;
+    }
+    if (ecu.fd >= 0) {
+        epoll_ctl(shard.epoll_fd, EPOLL_CTL_DEL, ecu.fd, nullptr);
+        close(ecu.fd);
+        ecu.fd = -1;
+    }
+    ecu.out.clear();
+    ecu.out_offset = 0;
+    ecu.out_messages = 0;
+    ecu.sent_count = 0;
+    ecu.want_write = false;
+}
+
+// ============================================================================
+// I/O
+// ============================================================================
+
+void FleetSimulator::queueMessage(Shard& shard, uint32_t index, const std::string& message, uint64_t due_ms) {
+    Ecu& ecu = shard.ecus[index];
+
+    if (ecu.out.size() - ecu.out_offset + message.size() > MAX_PENDING_BYTES) {
+        std::lock_guard<std::mutex> lock(shard.stats_mutex);
+        shard.stats.dropped_messages++;
+        return;
+    }
+
+    if (ecu.out_messages == 0) {
+        ecu.out_due_us = due_ms * 1000;
+    }
+    ecu.out += message;
+    ecu.out_messages++;
+    {
+        std::lock_guard<std::mutex> lock(shard.stats_mutex);
+        shard.stats.messages_sent++;
+    }
+
+    if (!ecu.want_write) {
+        flush(shard, index);
+    }
+}
+
+void FleetSimulator::flush(Shard& shard, uint32_t index) {
+    Ecu& ecu = shard.ecus[index];
+    uint64_t written = 0;
+
+    while (ecu.out_offset < ecu.out.size()) {
+        const char* data = ecu.out.data() + ecu.out_offset;
+        size_t len = ecu.out.size() - ecu.out_offset;
+        ssize_t n;
+
+        if (ecu.ssl) {
+            int ret = SSL_write(ecu.ssl, data, static_cast<int>(len));
+            if (ret <= 0) {
+                int err = SSL_get_error(ecu.ssl, ret);
+                if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ) {
+                    break;
+                }
+                ERR_clear_error();
+                fail(shard, index, true);
+                return;
+            }
+            n = ret;
+        } else {
+            n = send(ecu.fd, data, len, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                fail(shard, index, true);
+                return;
+            }
+        }
+        ecu.out_offset += static_cast<size_t>(n);
+        written += static_cast<uint64_t>(n);
+    }
+
+    bool drained = ecu.out_offset == ecu.out.size();
+    uint64_t now_us = nowUs();
+    {
+        std::lock_guard<std::mutex> lock(shard.stats_mutex);
+        shard.stats.bytes_sent += written;
+        if (drained && ecu.out_messages > 0) {
+            shard.stats.send_lag_us.record(now_us > ecu.out_due_us ? now_us - ecu.out_due_us : 0);
+        }
+    }
+
+    if (drained) {
+        // Remember write times for reply latency (oldest dropped when the ring is full)
+        for (uint32_t i = 0; i < ecu.out_messages; i++) {
+            size_t slot = (ecu.sent_head + ecu.sent_count) % ecu.sent_us.size();
+            if (ecu.sent_count == ecu.sent_us.size()) {
+                ecu.sent_head = static_cast<uint8_t>((ecu.sent_head + 1) % ecu.sent_us.size());
+            } else {
+                ecu.sent_count++;
+            }
+            ecu.sent_us[slot] = now_us;
+        }
+        ecu.out.clear();
+        ecu.out_offset = 0;
+        ecu.out_messages = 0;
+    }
+
+    if (drained == ecu.want_write) {
+        updateInterest(shard, index, !drained);
+    }
+}
+
+void FleetSimulator::readReplies(Shard& shard, uint32_t index) {
+    Ecu& ecu = shard.ecus[index];
+
+    while (true) {
+        ssize_t n;
+        if (ecu.ssl) {
+            int ret = SSL_read(ecu.ssl, shard.read_buffer, sizeof(shard.read_buffer));
+            if (ret <= 0) {
+                int err = SSL_get_error(ecu.ssl, ret);
+                if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+                    return;
+                }
+                ERR_clear_error();
+                fail(shard, index, true);
+                return;
+            }
+            n = ret;
+        } else {
+            n = recv(ecu.fd, shard.read_buffer, sizeof(shard.read_buffer), 0);
+            if (n <= 0) {
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    return;
+                }
+                fail(shard, index, true);
+                return;
+            }
+        }
+
+        // Gateway replies are newline-delimited JSON; match them to sends in order
+        uint64_t now_us = nowUs();
+        std::lock_guard<std::mutex> lock(shard.stats_mutex);
+        for (ssize_t i = 0; i < n; i++) {
+            if (shard.read_buffer[i] != '\n') {
+                continue;
+            }
+            shard.stats.replies++;
+            if (ecu.sent_count > 0) {
+                shard.stats.reply_us.record(now_us - ecu.sent_us[ecu.sent_head]);
+                ecu.sent_head = static_cast<uint8_t>((ecu.sent_head + 1) % ecu.sent_us.size());
+                ecu.sent_count--;
+            }
+        }
+    }
+}
+
+void FleetSimulator::updateInterest(Shard& shard, uint32_t index, bool want_write) {
+    Ecu& ecu = shard.ecus[index];
+    epoll_event ev{};
+    ev.events = want_write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    ev.data.u32 = index;
+    epoll_ctl(shard.epoll_fd, EPOLL_CTL_MOD, ecu.fd, &ev);
+    ecu.want_write = want_write;
+}
+
+void FleetSimulator::stepSensors(Shard& shard, Ecu& ecu, float seconds) {
+    // Same random walk as DeviceSimulator::updateSensors (1 step/s scale)
+    float scale = std::sqrt(seconds);
+    std::normal_distribution<float> temp_dist(0.0f, 0.5f * scale);
+    std::normal_distribution<float> press_dist(0.0f, 0.2f * scale);
+    std::normal_distribution<float> volt_dist(0.0f, 0.1f * scale);
+
+    ecu.temperature = std::max(15.0f, std::min(35.0f, ecu.temperature + temp_dist(shard.rng)));
+    ecu.pressure = std::max(95.0f, std::min(105.0f, ecu.pressure + press_dist(shard.rng)));
+    ecu.voltage = std::max(11.0f, std::min(13.0f, ecu.voltage + volt_dist(shard.rng)));
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+
+FleetStats FleetSimulator::getStats() const {
+    FleetStats total;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->stats_mutex);
+        total.merge(shard->stats);
+    }
+    return total;
+}
+
+std::string FleetSimulator::getStatusReport() const {
+    FleetStats stats = getStats();
+
+    auto distribution = [](const LatencyHistogram& h) {
+        std::stringstream ss;
+        ss << "n=" << h.count() << " p50=" << h.percentile(50) << " p90=" << h.percentile(90)
+           << " p99=" << h.percentile(99) << " max=" << h.max() << " us";
+        return ss.str();
+    };
+
+    std::stringstream ss;
+    ss << "=== Fleet Status ===" << std::endl;
+    ss << "ECUs connected: " << stats.connected << "/" << scenario_.ecu_count << std::endl;
+    ss << "Messages sent: " << stats.messages_sent << " (" << stats.bytes_sent << " bytes, "
+       << stats.dropped_messages << " dropped)" << std::endl;
+    ss << "Replies: " << stats.replies << std::endl;
+    ss << "Connect failures: " << stats.connect_failures << ", disconnects: " << stats.disconnects
+       << ", TLS resumed: " << stats.tls_resumed << std::endl;
+    ss << "Connect latency: " << distribution(stats.connect_us) << std::endl;
+    ss << "Send lag: " << distribution(stats.send_lag_us) << std::endl;
+    ss << "Reply latency: " << distribution(stats.reply_us) << std::endl;
+    return ss.str();
+}
+
+} // namespace tc375
@@ -4,6 +4,8 @@
 #include <sstream>
 #include <iomanip>
 #include <cstring>
+#include <cstdio>
+#include <algorithm>
 
 namespace tc375 {
 
@@ -31,6 +33,10 @@ OtaManager::OtaManager()
     , current_bank_(BootBank::BANK_A)
     , target_size_(0)
     , bytes_written_(0)
+    , resumed_(false)
+    , chunks_since_save_(0)
+    , run_start_(0)
+    , run_end_(0)
 {
     // Load current bank from bootloader
     current_bank_ = Bootloader::getActiveBank();
@@ -59,6 +65,10 @@ bool OtaManager::startDownload(uint32_t firmware_size, const FirmwareMetadata& m
     target_size_ = firmware_size;
     target_metadata_ = metadata;
     bytes_written_ = 0;
+    chunks_since_save_ = 0;
+    run_start_ = 0;
+    run_end_ = 0;
+    resumed_ = false;
     
     // Determine target bank (opposite of current)
     BootBank target = getTargetBank();
@@ -67,6 +77,32 @@ bool OtaManager::startDownload(uint32_t firmware_size, const FirmwareMetadata& m
               << (target == BootBank::BANK_A ? "A" : "B") << std::endl;
     std::cout << "[OTA] Firmware: " << metadata.toString() << std::endl;
     
+    // Create temporary file for Mac simulation
+    temp_file_path_ = "/tmp/ota_firmware_" + 
+                      std::string(target == BootBank::BANK_A ? "a" : "b") + ".bin";
+    
+    // Resume an interrupted download of the same image into the same bank
+    const BankMetadata& saved = bankMeta(target);
+    std::ifstream partial(temp_file_path_, std::ios::binary);
+    if (saved.download_in_progress &&
+        saved.chunk_size == OTA_CHUNK_SIZE &&
+        saved.firmware.version == metadata.version &&
+        saved.firmware.size == metadata.size &&
+        saved.firmware.crc32 == metadata.crc32 &&
+        saved.coverage.size() == (chunkCount() + 7) / 8 &&
+        partial.is_open()) {
+        
+        coverage_ = saved.coverage;
+        bytes_written_ = coveredBytes();
+        resumed_ = true;
+        
+        std::cout << "[OTA] Resuming download: " << bytes_written_ << " / " 
+                  << target_size_ << " bytes already in Bank "
+                  << (target == BootBank::BANK_A ? "A" : "B") << std::endl;
+        updateProgress();
+        return true;
+    }
+    
     // Erase target bank
     if (!eraseBank(target)) {
         setState(OtaState::FAILED);
@@ -74,9 +110,12 @@ bool OtaManager::startDownload(uint32_t firmware_size, const FirmwareMetadata& m
         return false;
     }
     
-    // Create temporary file for Mac simulation
-    temp_file_path_ = "/tmp/ota_firmware_" + 
-                      std::string(target == BootBank::BANK_A ? "a" : "b") + ".bin";
+    coverage_.assign((chunkCount() + 7) / 8, 0);
+    
+    // Record download start so a power cycle can resume
+    if (!saveDownloadProgress()) {
+        std::cerr << "[OTA] Warning: failed to persist download state" << std::endl;
+    }
     
     return true;
 }
@@ -101,7 +140,25 @@ bool OtaManager::writeBlock(uint32_t offset, const uint8_t* data, size_t length)
         return false;
     }
 
-    bytes_written_ += length;
+    // Sequential blocks need not be chunk aligned: coverage extends from
+    // the start of the current contiguous run (chunks before the one
+    // holding `offset` were already evaluated by earlier writes)
+    if (offset != run_end_) {
+        run_start_ = offset;
+    }
+    run_end_ = offset + static_cast<uint32_t>(length);
+    uint32_t scan_from = std::max(run_start_, offset - offset % OTA_CHUNK_SIZE);
+    
+    // Re-sent blocks (after resume) are not counted twice
+    uint32_t new_chunks = markCovered(scan_from, run_end_ - scan_from);
+    if (new_chunks > 0) {
+        chunks_since_save_ += new_chunks;
+        
+        if (chunks_since_save_ >= OTA_COVERAGE_SAVE_INTERVAL ||
+            bytes_written_ == target_size_) {
+            saveDownloadProgress();
+        }
+    }
     updateProgress();
     
     return true;
@@ -113,6 +170,12 @@ bool OtaManager::verify() {
         return false;
     }
 
+    if (bytes_written_ != target_size_) {
+        handleError("Download incomplete: " + std::to_string(getMissingRanges().size()) +
+                    " missing range(s)");
+        return false;
+    }
+
     setState(OtaState::VERIFYING);
     std::cout << "[OTA] Verifying firmware..." << std::endl;
 
@@ -120,6 +183,7 @@ bool OtaManager::verify() {
 
     // 1. Verify CRC
     if (!verifyCRC(target, target_metadata_.crc32)) {
+        clearDownloadProgress();
         setState(OtaState::FAILED);
         handleError("CRC verification failed");
         return false;
@@ -128,6 +192,7 @@ bool OtaManager::verify() {
 
     // 2. Verify signature (PQC)
     if (!verifySignature(target, target_metadata_.signature)) {
+        clearDownloadProgress();
         setState(OtaState::FAILED);
         handleError("Signature verification failed");
         return false;
@@ -140,6 +205,7 @@ bool OtaManager::verify() {
     new_meta.firmware = target_metadata_;
     new_meta.boot_count = 0;
     new_meta.last_boot_timestamp = 0;
+    new_meta.download_in_progress = false;
     
     if (!saveBankMetadata(target, new_meta)) {
         setState(OtaState::FAILED);
@@ -253,19 +319,67 @@ std::string OtaManager::getStatusReport() const {
     return ss.str();
 }
 
+// Bank metadata file layout (little-endian, host order):
+//   "OTAM" | u32 format | firmware fields | bank fields | u32 len + coverage bitmap
+static constexpr char BANK_META_MAGIC[4] = {'O', 'T', 'A', 'M'};
+static constexpr uint32_t BANK_META_FORMAT = 2;
+static constexpr uint32_t BANK_META_MAX_COVERAGE = (UINT32_MAX / OTA_CHUNK_SIZE) / 8 + 1;
+
+template <typename T>
+static void writePod(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+static bool readPod(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
 bool OtaManager::saveBankMetadata(BootBank bank, const BankMetadata& meta) {
     // In real TC375: write to dedicated Flash sector
     // For Mac: save to file
     std::string filename = "/tmp/bank_" + 
                           std::string(bank == BootBank::BANK_A ? "a" : "b") + "_meta.bin";
     
-    std::ofstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
+    // Write-then-rename, so power loss leaves either the old or new metadata
+    std::string tmp_filename = filename + ".tmp";
+    {
+        std::ofstream file(tmp_filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        
+        file.write(BANK_META_MAGIC, sizeof(BANK_META_MAGIC));
+        writePod(file, BANK_META_FORMAT);
+        
+        writePod(file, meta.firmware.version);
+        writePod(file, meta.firmware.size);
+        writePod(file, meta.firmware.crc32);
+        file.write(reinterpret_cast<const char*>(meta.firmware.signature),
+                   sizeof(meta.firmware.signature));
+        writePod(file, static_cast<uint32_t>(meta.firmware.build_date.size()));
+        file.write(meta.firmware.build_date.data(), meta.firmware.build_date.size());
+        
+        writePod(file, static_cast<uint8_t>(meta.valid));
+        writePod(file, meta.boot_count);
+        writePod(file, meta.last_boot_timestamp);
+        
+        writePod(file, static_cast<uint8_t>(meta.download_in_progress));
+        writePod(file, meta.chunk_size);
+        writePod(file, static_cast<uint32_t>(meta.coverage.size()));
+        file.write(reinterpret_cast<const char*>(meta.coverage.data()), meta.coverage.size());
+        
+        if (!file) {
+            return false;
+        }
+    }
+    
+    if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+        std::remove(tmp_filename.c_str());
         return false;
     }
     
-    // Serialize metadata (simplified)
-    file.write(reinterpret_cast<const char*>(&meta), sizeof(meta));
+    bankMeta(bank) = meta;
     return true;
 }
 
@@ -273,14 +387,59 @@ bool OtaManager::loadBankMetadata(BootBank bank, BankMetadata& meta) {
     std::string filename = "/tmp/bank_" + 
                           std::string(bank == BootBank::BANK_A ? "a" : "b") + "_meta.bin";
     
+    // Default metadata if file doesn't exist or is unreadable
+    meta = BankMetadata{};
+    meta.valid = false;
+    meta.boot_count = 0;
+    meta.last_boot_timestamp = 0;
+    
     std::ifstream file(filename, std::ios::binary);
     if (!file.is_open()) {
-        // Default metadata if file doesn't exist
-        meta.valid = false;
         return false;
     }
     
-    file.read(reinterpret_cast<char*>(&meta), sizeof(meta));
+    char magic[sizeof(BANK_META_MAGIC)];
+    uint32_t format = 0;
+    if (!file.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, BANK_META_MAGIC, sizeof(magic)) != 0 ||
+        !readPod(file, format) || format != BANK_META_FORMAT) {
+        return false;
+    }
+    
+    BankMetadata loaded;
+    uint32_t date_len = 0;
+    uint8_t valid = 0;
+    uint8_t in_progress = 0;
+    uint32_t coverage_len = 0;
+    
+    bool ok = readPod(file, loaded.firmware.version) &&
+              readPod(file, loaded.firmware.size) &&
+              readPod(file, loaded.firmware.crc32) &&
+              file.read(reinterpret_cast<char*>(loaded.firmware.signature),
+                        sizeof(loaded.firmware.signature)) &&
+              readPod(file, date_len) && date_len <= 64;
+    if (ok) {
+        loaded.firmware.build_date.resize(date_len);
+        ok = static_cast<bool>(file.read(&loaded.firmware.build_date[0], date_len));
+    }
+    ok = ok && readPod(file, valid) &&
+         readPod(file, loaded.boot_count) &&
+         readPod(file, loaded.last_boot_timestamp) &&
+         readPod(file, in_progress) &&
+         readPod(file, loaded.chunk_size) &&
+         readPod(file, coverage_len) && coverage_len <= BANK_META_MAX_COVERAGE;
+    if (ok) {
+        loaded.coverage.resize(coverage_len);
+        ok = static_cast<bool>(file.read(reinterpret_cast<char*>(loaded.coverage.data()),
+                                         coverage_len));
+    }
+    if (!ok) {
+        return false;
+    }
+    
+    loaded.valid = valid != 0;
+    loaded.download_in_progress = in_progress != 0;
+    meta = loaded;
     return true;
 }
 
@@ -345,6 +504,121 @@ bool OtaManager::verifySignature(BootBank bank, const uint8_t* signature) {
     return true;
 }
 
+// ============================================================================
+// Download Coverage Bitmap
+// ============================================================================
+
+std::vector<std::pair<uint32_t, uint32_t>> OtaManager::getMissingRanges() const {
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    
+    uint32_t chunks = chunkCount();
+    uint32_t chunk = 0;
+    while (chunk < chunks) {
+        if (isChunkCovered(chunk)) {
+            chunk++;
+            continue;
+        }
+        
+        uint32_t first = chunk;
+        while (chunk < chunks && !isChunkCovered(chunk)) {
+            chunk++;
+        }
+        
+        uint32_t offset = first * OTA_CHUNK_SIZE;
+        uint32_t end = std::min<uint64_t>(static_cast<uint64_t>(chunk) * OTA_CHUNK_SIZE,
+                                          target_size_);
+        ranges.emplace_back(offset, end - offset);
+    }
+    
+    return ranges;
+}
+
+uint32_t OtaManager::chunkCount() const {
+    return static_cast<uint32_t>(
+        (static_cast<uint64_t>(target_size_) + OTA_CHUNK_SIZE - 1) / OTA_CHUNK_SIZE);
+}
+
+bool OtaManager::isChunkCovered(uint32_t chunk) const {
+    return (coverage_[chunk / 8] >> (chunk % 8)) & 1;
+}
+
+uint32_t OtaManager::markCovered(uint32_t offset, size_t length) {
+    // Only chunks completely inside [offset, offset + length) count as
+    // written; the last chunk may be short (ends at target_size_).
+    uint64_t end = static_cast<uint64_t>(offset) + length;
+    uint32_t first = (offset + OTA_CHUNK_SIZE - 1) / OTA_CHUNK_SIZE;
+    uint32_t newly_covered = 0;
+    
+    for (uint32_t chunk = first; chunk < chunkCount(); chunk++) {
+        uint64_t chunk_end = std::min<uint64_t>(
+            static_cast<uint64_t>(chunk + 1) * OTA_CHUNK_SIZE, target_size_);
+        if (chunk_end > end) {
+            break;
+        }
+        if (!isChunkCovered(chunk)) {
+            coverage_[chunk / 8] |= static_cast<uint8_t>(1u << (chunk % 8));
+            bytes_written_ += static_cast<uint32_t>(chunk_end - chunk * OTA_CHUNK_SIZE);
+            newly_covered++;
+        }
+    }
+    
+    return newly_covered;
+}
+
+uint32_t OtaManager::coveredBytes() const {
+    uint32_t chunks = chunkCount();
+    uint32_t bytes = 0;
+    
+    for (uint32_t chunk = 0; chunk < chunks; chunk++) {
+        if (isChunkCovered(chunk)) {
+            bytes += (chunk == chunks - 1) ? target_size_ - chunk * OTA_CHUNK_SIZE
+                                           : OTA_CHUNK_SIZE;
+        }
+    }
+    
+    return bytes;
+}
+
+bool OtaManager::saveDownloadProgress() {
+    BankMetadata meta{};
+    meta.valid = false;
+    meta.firmware = target_metadata_;
+    meta.boot_count = 0;
+    meta.last_boot_timestamp = 0;
+    meta.download_in_progress = true;
+    meta.chunk_size = OTA_CHUNK_SIZE;
+    meta.coverage = coverage_;
+    
+    chunks_since_save_ = 0;
+    return saveBankMetadata(getTargetBank(), meta);
+}
+
+// A complete image that fails verification must not be resumed: the next
+// startDownload would restore full coverage and fail the same way again
+void OtaManager::clearDownloadProgress() {
+    coverage_.assign(coverage_.size(), 0);
+    bytes_written_ = 0;
+    run_start_ = 0;
+    run_end_ = 0;
+    chunks_since_save_ = 0;
+    resumed_ = false;
+    
+    BankMetadata meta{};
+    meta.valid = false;
+    meta.firmware = target_metadata_;
+    meta.boot_count = 0;
+    meta.last_boot_timestamp = 0;
+    meta.download_in_progress = false;
+    
+    if (!saveBankMetadata(getTargetBank(), meta)) {
+        std::cerr << "[OTA] Warning: failed to clear download state" << std::endl;
+    }
+}
+
+OtaManager::BankMetadata& OtaManager::bankMeta(BootBank bank) {
+    return (bank == BootBank::BANK_A) ? bank_a_meta_ : bank_b_meta_;
+}
+
 void OtaManager::updateProgress() {
     int progress = getProgress();
     if (progress_callback_) {
@@ -11,6 +11,9 @@ std::string messageTypeToString(MessageType type) {
         case MessageType::STATUS_REPORT: return "STATUS_REPORT";
         case MessageType::COMMAND_ACK: return "COMMAND_ACK";
         case MessageType::SENSOR_DATA: return "SENSOR_DATA";
+        case MessageType::SENSOR_BATCH: return "SENSOR_BATCH";
+        case MessageType::UDS_REQUEST: return "UDS_REQUEST";
+        case MessageType::UDS_RESPONSE: return "UDS_RESPONSE";
         case MessageType::ERROR: return "ERROR";
         default: return "UNKNOWN";
     }
@@ -21,6 +24,9 @@ MessageType stringToMessageType(const std::string& str) {
     if (str == "STATUS_REPORT") return MessageType::STATUS_REPORT;
     if (str == "COMMAND_ACK") return MessageType::COMMAND_ACK;
     if (str == "SENSOR_DATA") return MessageType::SENSOR_DATA;
+    if (str == "SENSOR_BATCH") return MessageType::SENSOR_BATCH;
+    if (str == "UDS_REQUEST") return MessageType::UDS_REQUEST;
+    if (str == "UDS_RESPONSE") return MessageType::UDS_RESPONSE;
     if (str == "ERROR") return MessageType::ERROR;
     return MessageType::ERROR;
 }
@@ -28,8 +34,10 @@ MessageType stringToMessageType(const std::string& str) {
 static std::string getCurrentTimestamp() {
     auto now = std::chrono::system_clock::now();
     auto time_t = std::chrono::system_clock::to_time_t(now);
+    std::tm local_tm{};
+    localtime_r(&time_t, &local_tm);  // Message builders run on several fleet threads
     std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
+    ss << std::put_time(&local_tm, "%Y-%m-%d %H:%M:%S");
     return ss.str();
 }
 
@@ -107,5 +115,53 @@ ProtocolMessage createError(const std::string& device_id, const std::string& err
     return msg;
 }
 
+ProtocolMessage createUdsResponse(const std::string& device_id, const std::vector<uint8_t>& response, bool periodic) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(response.size() * 2);
+    for (uint8_t byte : response) {
+        hex.push_back(digits[byte >> 4]);
+        hex.push_back(digits[byte & 0x0F]);
+    }
+
+    ProtocolMessage msg;
+    msg.type = MessageType::UDS_RESPONSE;
+    msg.device_id = device_id;
+    msg.payload = {
+        {"data", hex},
+        {"periodic", periodic}
+    };
+    msg.timestamp = getCurrentTimestamp();
+    return msg;
+}
+
+bool parseUdsRequest(const ProtocolMessage& msg, std::vector<uint8_t>& request) {
+    if (msg.type != MessageType::UDS_REQUEST || !msg.payload.contains("data") ||
+        !msg.payload["data"].is_string()) {
+        return false;
+    }
+    const std::string hex = msg.payload["data"].get<std::string>();
+    if (hex.empty() || hex.size() % 2 != 0) {
+        return false;
+    }
+
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    request.clear();
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        int hi = nibble(hex[i]);
+        int lo = nibble(hex[i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        request.push_back(static_cast<uint8_t>((hi << 4) | lo));
+    }
+    return true;
+}
+
 } // namespace tc375
 
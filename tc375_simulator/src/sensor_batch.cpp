@@ -0,0 +1,522 @@
+#include "sensor_batch.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace tc375 {
+
+namespace {
+
+constexpr uint8_t BLOCK_VERSION = 1;
+constexpr const char* BATCH_ENCODING = "columnar-v1";
+
+// MSB-first bit packing; columns are padded to whole bytes
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void write(uint64_t value, int bits) {
+        for (int i = bits - 1; i >= 0; i--) {
+            acc_ = static_cast<uint8_t>((acc_ << 1) | ((value >> i) & 1U));
+            if (++used_ == 8) {
+                out_.push_back(acc_);
+                acc_ = 0;
+                used_ = 0;
+            }
+        }
+    }
+
+    void align() {
+        if (used_ > 0) {
+            out_.push_back(static_cast<uint8_t>(acc_ << (8 - used_)));
+            acc_ = 0;
+            used_ = 0;
+        }
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint8_t acc_ = 0;
+    int used_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t len) : data_(data), len_(len) {}
+
+    // Returns false once the input is exhausted (value is then 0)
+    bool read(int bits, uint64_t& value) {
+        value = 0;
+        for (int i = 0; i < bits; i++) {
+            if (pos_ >= len_ * 8) {
+                return false;
+            }
+            value = (value << 1) | ((data_[pos_ / 8] >> (7 - pos_ % 8)) & 1U);
+            pos_++;
+        }
+        return true;
+    }
+
+    void align() { pos_ = (pos_ + 7) & ~static_cast<size_t>(7); }
+    size_t bytePos() const { return pos_ / 8; }
+    void seekByte(size_t byte) { pos_ = byte * 8; }
+
+private:
+    const uint8_t* data_;
+    size_t len_;
+    size_t pos_ = 0;
+};
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool getVarint(const uint8_t* data, size_t len, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < len; shift += 7) {
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+int64_t signExtend(uint64_t value, int bits) {
+    uint64_t sign = 1ULL << (bits - 1);
+    return static_cast<int64_t>((value ^ sign) - sign);
+}
+
+uint32_t floatBits(float f) {
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+float bitsFloat(uint32_t bits) {
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// Delta-of-delta buckets: prefix bits, prefix length, value width
+struct DodBucket {
+    uint8_t prefix;
+    int prefix_bits;
+    int value_bits;
+};
+
+constexpr DodBucket DOD_BUCKETS[] = {
+    {0x2, 2, 7},
+    {0x6, 3, 9},
+    {0xE, 4, 12},
+    {0xF, 4, 64},
+};
+
+void encodeTimestamps(BitWriter& w, const std::vector<int64_t>& ts) {
+    int64_t prev_delta = 0;
+    for (size_t i = 1; i < ts.size(); i++) {
+        int64_t delta = ts[i] - ts[i - 1];
+        int64_t dod = delta - prev_delta;
+        prev_delta = delta;
+
+        if (dod == 0) {
+            w.write(0, 1);
+            continue;
+        }
+        for (const auto& bucket : DOD_BUCKETS) {
+            int64_t limit = (bucket.value_bits == 64) ? 0 : (1LL << (bucket.value_bits - 1));
+            if (bucket.value_bits == 64 || (dod >= -limit && dod < limit)) {
+                w.write(bucket.prefix, bucket.prefix_bits);
+                uint64_t mask = (bucket.value_bits == 64) ? ~0ULL : ((1ULL << bucket.value_bits) - 1);
+                w.write(static_cast<uint64_t>(dod) & mask, bucket.value_bits);
+                break;
+            }
+        }
+    }
+}
+
+bool decodeTimestamps(BitReader& r, int64_t first, size_t count, std::vector<int64_t>& ts) {
+    ts.assign(1, first);
+    int64_t prev_delta = 0;
+    for (size_t i = 1; i < count; i++) {
+        int ones = 0;
+        uint64_t bit = 0;
+        while (ones < 4) {
+            if (!r.read(1, bit)) {
+                return false;
+            }
+            if (bit == 0) {
+                break;
+            }
+            ones++;
+        }
+
+        int64_t dod = 0;
+        if (ones > 0) {
+            int bits = DOD_BUCKETS[ones - 1].value_bits;
+            uint64_t raw = 0;
+            if (!r.read(bits, raw)) {
+                return false;
+            }
+            dod = (bits == 64) ? static_cast<int64_t>(raw) : signExtend(raw, bits);
+        }
+        prev_delta += dod;
+        ts.push_back(ts.back() + prev_delta);
+    }
+    return true;
+}
+
+void encodeXorColumn(BitWriter& w, const std::vector<float>& column) {
+    uint32_t prev = floatBits(column[0]);
+    w.write(prev, 32);
+
+    int prev_leading = -1;      // No window yet
+    int prev_trailing = 0;
+    for (size_t i = 1; i < column.size(); i++) {
+        uint32_t cur = floatBits(column[i]);
+        uint32_t x = cur ^ prev;
+        prev = cur;
+
+        if (x == 0) {
+            w.write(0, 1);
+            continue;
+        }
+        int leading = std::min(__builtin_clz(x), 31);
+        int trailing = __builtin_ctz(x);
+        if (prev_leading >= 0 && leading >= prev_leading && trailing >= prev_trailing) {
+            w.write(0x2, 2);
+            w.write(x >> prev_trailing, 32 - prev_leading - prev_trailing);
+        } else {
+            int length = 32 - leading - trailing;
+            w.write(0x3, 2);
+            w.write(static_cast<uint64_t>(leading), 5);
+            w.write(static_cast<uint64_t>(length - 1), 5);
+            w.write(x >> trailing, length);
+            prev_leading = leading;
+            prev_trailing = trailing;
+        }
+    }
+}
+
+bool decodeXorColumn(BitReader& r, size_t count, std::vector<float>& column) {
+    uint64_t raw = 0;
+    if (!r.read(32, raw)) {
+        return false;
+    }
+    uint32_t prev = static_cast<uint32_t>(raw);
+    column.assign(1, bitsFloat(prev));
+
+    int leading = -1;
+    int trailing = 0;
+    for (size_t i = 1; i < count; i++) {
+        uint64_t control = 0;
+        if (!r.read(1, control)) {
+            return false;
+        }
+        if (control != 0) {
+            if (!r.read(1, control)) {
+                return false;
+            }
+            if (control == 1) {
+                uint64_t lead = 0;
+                uint64_t length = 0;
+                if (!r.read(5, lead) || !r.read(5, length)) {
+                    return false;
+                }
+                leading = static_cast<int>(lead);
+                trailing = 32 - leading - static_cast<int>(length + 1);
+                if (trailing < 0) {
+                    return false;
+                }
+            } else if (leading < 0) {
+                return false;   // '10' before any window was set
+            }
+            uint64_t bits = 0;
+            if (!r.read(32 - leading - trailing, bits)) {
+                return false;
+            }
+            prev ^= static_cast<uint32_t>(bits << trailing);
+        }
+        column.push_back(bitsFloat(prev));
+    }
+    return true;
+}
+
+void encodeScaledColumn(std::vector<uint8_t>& out, const std::vector<float>& column, double resolution) {
+    int64_t prev = 0;
+    for (float value : column) {
+        int64_t q = std::llround(static_cast<double>(value) / resolution);
+        putVarint(out, zigzag(q - prev));
+        prev = q;
+    }
+}
+
+bool decodeScaledColumn(const uint8_t* data, size_t len, size_t& pos, size_t count, double resolution,
+                        std::vector<float>& column) {
+    column.clear();
+    int64_t q = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t raw = 0;
+        if (!getVarint(data, len, pos, raw)) {
+            return false;
+        }
+        q += unzigzag(raw);
+        column.push_back(static_cast<float>(static_cast<double>(q) * resolution));
+    }
+    return true;
+}
+
+const char BASE64_CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string base64Encode(const std::vector<uint8_t>& data) {
+    std::string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+    for (size_t i = 0; i < data.size(); i += 3) {
+        uint32_t n = static_cast<uint32_t>(data[i]) << 16;
+        if (i + 1 < data.size()) n |= static_cast<uint32_t>(data[i + 1]) << 8;
+        if (i + 2 < data.size()) n |= data[i + 2];
+        out.push_back(BASE64_CHARS[(n >> 18) & 0x3F]);
+        out.push_back(BASE64_CHARS[(n >> 12) & 0x3F]);
+        out.push_back(i + 1 < data.size() ? BASE64_CHARS[(n >> 6) & 0x3F] : '=');
+        out.push_back(i + 2 < data.size() ? BASE64_CHARS[n & 0x3F] : '=');
+    }
+    return out;
+}
+
+bool base64Decode(const std::string& text, std::vector<uint8_t>& out) {
+    out.clear();
+    uint32_t acc = 0;
+    int bits = 0;
+    for (char c : text) {
+        if (c == '=') {
+            break;
+        }
+        const char* p = std::strchr(BASE64_CHARS, c);
+        if (c == '\0' || p == nullptr) {
+            return false;
+        }
+        acc = (acc << 6) | static_cast<uint32_t>(p - BASE64_CHARS);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<uint8_t>(acc >> bits));
+        }
+    }
+    return true;
+}
+
+std::string encodingToString(ColumnEncoding encoding) {
+    return encoding == ColumnEncoding::XOR ? "xor" : "scaled";
+}
+
+} // namespace
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+SensorBatchConfig SensorBatchConfig::fromJSON(const json& j) {
+    SensorBatchConfig config;
+    config.channels = {
+        {"temperature", ColumnEncoding::SCALED, 0.01},
+        {"pressure", ColumnEncoding::SCALED, 0.01},
+        {"voltage", ColumnEncoding::SCALED, 0.001},
+    };
+    if (!j.contains("sensor_batch")) {
+        return config;
+    }
+
+    const json& batch = j["sensor_batch"];
+    config.enabled = batch.value("enabled", config.enabled);
+    config.sample_interval_ms = std::max(batch.value("sample_interval_ms", config.sample_interval_ms), 1);
+    config.window_ms = std::max(batch.value("window_ms", config.window_ms), 1);
+    config.max_samples = std::max(batch.value("max_samples", config.max_samples), 1);
+
+    // "scaled" keeps fixed-point resolution, "xor" sends exact floats
+    if (batch.value("value_encoding", std::string("scaled")) == "xor") {
+        for (auto& channel : config.channels) {
+            channel.encoding = ColumnEncoding::XOR;
+        }
+    }
+    return config;
+}
+
+// ============================================================================
+// Batch
+// ============================================================================
+
+SensorBatch::SensorBatch(size_t channel_count)
+    : columns_(channel_count) {
+}
+
+void SensorBatch::add(int64_t timestamp_ms, const float* values) {
+    timestamps_.push_back(timestamp_ms);
+    for (size_t c = 0; c < columns_.size(); c++) {
+        columns_[c].push_back(values[c]);
+    }
+}
+
+void SensorBatch::clear() {
+    timestamps_.clear();
+    for (auto& column : columns_) {
+        column.clear();
+    }
+}
+
+std::vector<uint8_t> SensorBatch::encode(const std::vector<SensorChannel>& channels) const {
+    if (channels.size() != columns_.size()) {
+        throw std::invalid_argument("SensorBatch: channel list does not match columns");
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(16 + timestamps_.size() * (1 + columns_.size() * 2));
+    out.push_back(BLOCK_VERSION);
+    putVarint(out, timestamps_.size());
+    putVarint(out, columns_.size());
+    if (timestamps_.empty()) {
+        return out;
+    }
+    putVarint(out, static_cast<uint64_t>(timestamps_.front()));
+
+    BitWriter ts_writer(out);
+    encodeTimestamps(ts_writer, timestamps_);
+    ts_writer.align();
+
+    for (size_t c = 0; c < columns_.size(); c++) {
+        if (channels[c].encoding == ColumnEncoding::XOR) {
+            BitWriter w(out);
+            encodeXorColumn(w, columns_[c]);
+            w.align();
+        } else {
+            encodeScaledColumn(out, columns_[c], channels[c].resolution);
+        }
+    }
+    return out;
+}
+
+// ============================================================================
+// Decoding
+// ============================================================================
+
+bool decodeSensorBlock(const uint8_t* data, size_t len, const std::vector<SensorChannel>& channels,
+                       DecodedSensorBatch& out) {
+    size_t pos = 0;
+    uint64_t count = 0;
+    uint64_t channel_count = 0;
+    if (len < 1 || data[pos++] != BLOCK_VERSION ||
+        !getVarint(data, len, pos, count) || !getVarint(data, len, pos, channel_count) ||
+        channel_count != channels.size() || count > len * 8) {
+        return false;
+    }
+
+    out.channels.clear();
+    for (const auto& channel : channels) {
+        out.channels.push_back(channel.name);
+    }
+    out.timestamps_ms.clear();
+    out.values.assign(channels.size(), {});
+    if (count == 0) {
+        return true;
+    }
+
+    uint64_t first = 0;
+    if (!getVarint(data, len, pos, first)) {
+        return false;
+    }
+
+    BitReader reader(data, len);
+    reader.seekByte(pos);
+    if (!decodeTimestamps(reader, static_cast<int64_t>(first), count, out.timestamps_ms)) {
+        return false;
+    }
+    reader.align();
+    pos = reader.bytePos();
+
+    for (size_t c = 0; c < channels.size(); c++) {
+        if (channels[c].encoding == ColumnEncoding::XOR) {
+            reader.seekByte(pos);
+            if (!decodeXorColumn(reader, count, out.values[c])) {
+                return false;
+            }
+            reader.align();
+            pos = reader.bytePos();
+        } else if (!decodeScaledColumn(data, len, pos, count, channels[c].resolution, out.values[c])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool decodeSensorBatch(const json& payload, DecodedSensorBatch& out) {
+    if (payload.value("encoding", std::string()) != BATCH_ENCODING ||
+        !payload.contains("channels") || !payload["channels"].is_array() ||
+        !payload.contains("data") || !payload["data"].is_string()) {
+        return false;
+    }
+
+    std::vector<SensorChannel> channels;
+    for (const auto& entry : payload["channels"]) {
+        SensorChannel channel;
+        channel.name = entry.value("name", std::string());
+        channel.encoding = (entry.value("encoding", std::string()) == "xor") ?
+            ColumnEncoding::XOR : ColumnEncoding::SCALED;
+        channel.resolution = entry.value("resolution", 1.0);
+        if (channel.encoding == ColumnEncoding::SCALED && !(channel.resolution > 0.0)) {
+            return false;
+        }
+        channels.push_back(channel);
+    }
+
+    std::vector<uint8_t> block;
+    if (!base64Decode(payload["data"].get<std::string>(), block)) {
+        return false;
+    }
+    return decodeSensorBlock(block.data(), block.size(), channels, out);
+}
+
+ProtocolMessage createSensorBatch(const std::string& device_id, const std::vector<SensorChannel>& channels,
+                                  const SensorBatch& batch) {
+    json channel_list = json::array();
+    for (const auto& channel : channels) {
+        json entry = {
+            {"name", channel.name},
+            {"encoding", encodingToString(channel.encoding)}
+        };
+        if (channel.encoding == ColumnEncoding::SCALED) {
+            entry["resolution"] = channel.resolution;
+        }
+        channel_list.push_back(entry);
+    }
+
+    ProtocolMessage msg = createSensorData(device_id, {
+        {"encoding", BATCH_ENCODING},
+        {"count", batch.size()},
+        {"channels", channel_list},
+        {"data", base64Encode(batch.encode(channels))}
+    });
+    msg.type = MessageType::SENSOR_BATCH;
+    return msg;
+}
+
+int64_t currentTimeMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace tc375
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <cstring>
 #include <unistd.h>
+#include <poll.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 
@@ -210,6 +211,17 @@ std::string TlsClient::receive(size_t max_len) {
     return std::string(buffer, ret);
 }
 
+bool TlsClient::waitReadable(int timeout_ms) {
+    if (!connected_ || !ssl_) {
+        return false;
+    }
+    if (SSL_pending(ssl_) > 0) {
+        return true;
+    }
+    struct pollfd pfd = { socket_fd_, POLLIN, 0 };
+    return poll(&pfd, 1, timeout_ms) > 0;
+}
+
 void TlsClient::setClientCertPath(const std::string& cert, const std::string& key) {
     client_cert_path_ = cert;
     client_key_path_ = key;
@@ -85,6 +85,11 @@ UdsHandler::UdsHandler()
 {
     download_state_.active = false;
     download_state_.block_counter = 0;
+
+    // PDID 0x86: active diagnostic session (as DID 0xF186)
+    registerPeriodicDid(0x86, [this]() {
+        return std::vector<uint8_t>{static_cast<uint8_t>(current_session_)};
+    });
     
     // Register default handlers
     registerServiceHandler(UdsService::DIAGNOSTIC_SESSION_CONTROL, 
@@ -97,6 +102,8 @@ UdsHandler::UdsHandler()
         [this](const UdsMessage& msg) { return handleTesterPresent(msg); });
     registerServiceHandler(UdsService::READ_DATA_BY_ID, 
         [this](const UdsMessage& msg) { return handleReadDataById(msg); });
+    registerServiceHandler(UdsService::READ_DATA_BY_PERIODIC_ID, 
+        [this](const UdsMessage& msg) { return handleReadDataByPeriodicId(msg); });
     registerServiceHandler(UdsService::REQUEST_DOWNLOAD, 
         [this](const UdsMessage& msg) { return handleRequestDownload(msg); });
     registerServiceHandler(UdsService::TRANSFER_DATA, 
@@ -109,16 +116,16 @@ UdsResponse UdsHandler::handleRequest(const UdsMessage& request) {
     std::cout << "[UDS] Handling service: 0x" << std::hex 
               << static_cast<int>(request.service) << std::dec << std::endl;
 
-    auto it = service_handlers_.find(request.service);
-    if (it == service_handlers_.end()) {
+    const ServiceHandler& handler = service_handlers_[static_cast<uint8_t>(request.service)];
+    if (!handler) {
         return createNegativeResponse(request.service, NRC::SERVICE_NOT_SUPPORTED);
     }
 
-    return it->second(request);
+    return handler(request);
 }
 
 void UdsHandler::registerServiceHandler(UdsService service, ServiceHandler handler) {
-    service_handlers_[service] = handler;
+    service_handlers_[static_cast<uint8_t>(service)] = handler;
 }
 
 UdsResponse UdsHandler::handleDiagnosticSession(const UdsMessage& request) {
@@ -131,6 +138,7 @@ UdsResponse UdsHandler::handleDiagnosticSession(const UdsMessage& request) {
     switch (session_type) {
         case 0x01: // Default session
             current_session_ = DiagnosticSession::DEFAULT;
+            periodic_.stopAll();  // Periodic transmission ends in default session
             break;
         case 0x02: // Programming session
             if (security_level_ != SecurityLevel::UNLOCKED) {
@@ -251,6 +259,80 @@ UdsResponse UdsHandler::handleReadDataById(const UdsMessage& request) {
     }
 }
 
+UdsResponse UdsHandler::handleReadDataByPeriodicId(const UdsMessage& request) {
+    // data: transmissionMode, then the PDIDs
+    if (request.data.empty()) {
+        return createNegativeResponse(request.service, NRC::INCORRECT_MESSAGE_LENGTH);
+    }
+    auto mode = static_cast<vmg::PeriodicRate>(request.data[0]);
+
+    if (mode == vmg::PeriodicRate::Stop) {
+        // Stop listed PDIDs, or all when none listed
+        if (request.data.size() == 1) {
+            periodic_.stopAll();
+        }
+        for (size_t i = 1; i < request.data.size(); i++) {
+            periodic_.stop(request.data[i]);
+        }
+        return createPositiveResponse(request.service);
+    }
+
+    if (mode < vmg::PeriodicRate::Slow || mode > vmg::PeriodicRate::Fast) {
+        return createNegativeResponse(request.service, NRC::REQUEST_OUT_OF_RANGE);
+    }
+    if (current_session_ == DiagnosticSession::DEFAULT) {
+        return createNegativeResponse(request.service, NRC::SERVICE_NOT_SUPPORTED_IN_ACTIVE_SESSION);
+    }
+    if (request.data.size() == 1) {
+        return createNegativeResponse(request.service, NRC::INCORRECT_MESSAGE_LENGTH);
+    }
+
+    // Unsupported PDIDs are skipped; NRC only if none could be scheduled
+    size_t scheduled = 0;
+    for (size_t i = 1; i < request.data.size(); i++) {
+        uint8_t pdid = request.data[i];
+        if (periodic_readers_[pdid] && periodic_.schedule(pdid, mode)) {
+            scheduled++;
+        }
+    }
+
+    if (scheduled == 0) {
+        return createNegativeResponse(request.service, NRC::REQUEST_OUT_OF_RANGE);
+    }
+
+    std::cout << "[UDS] Periodic read: mode=" << static_cast<int>(request.data[0])
+              << ", " << periodic_.size() << " PDIDs scheduled" << std::endl;
+    return createPositiveResponse(request.service);
+}
+
+void UdsHandler::registerPeriodicDid(uint8_t pdid, PeriodicReader reader) {
+    periodic_readers_[pdid] = reader;
+}
+
+std::vector<uint8_t> UdsHandler::collectPeriodicFrame(uint64_t now_ms) {
+    std::vector<uint8_t> frame;
+
+    // Every due group shares one frame; the scheduler skips missed slots
+    uint8_t due[256];
+    size_t count = periodic_.collectDue(now_ms, due, sizeof(due));
+    for (size_t i = 0; i < count; i++) {
+        std::vector<uint8_t> data = periodic_readers_[due[i]]();
+        if (frame.empty()) {
+            frame.push_back(0x40 + static_cast<uint8_t>(UdsService::READ_DATA_BY_PERIODIC_ID));
+        }
+        frame.push_back(due[i]);
+        frame.insert(frame.end(), data.begin(), data.end());
+    }
+    if (count > 0) {
+        periodic_.recordFrame(count);
+    }
+    return frame;
+}
+
+uint64_t UdsHandler::nextPeriodicDueMs() const {
+    return periodic_.nextDueMs();
+}
+
 UdsResponse UdsHandler::handleWriteDataById(const UdsMessage& request) {
     if (current_session_ != DiagnosticSession::PROGRAMMING && 
         current_session_ != DiagnosticSession::EXTENDED) {
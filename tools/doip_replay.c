@@ -0,0 +1,838 @@
+/**
+ * @file doip_replay.c
+ * @brief DoIP trace replay tool (performance regression)
+ *
+ * Re-drives a DoIP trace captured by the VMG DoIP server or the Linux Zonal
+ * Gateway (common/protocol/doip_trace.h) against a live server and compares
+ * request -> response latency with the recording.
+ *
+ * Every traced TCP connection is replayed on its own connection and thread,
+ * so the recorded concurrency is kept. Requests are sent at their recorded
+ * offsets divided by the speed factor (or back-to-back at max speed); within
+ * one connection a request is never sent before the previous response, like
+ * a real tester. The final response of a request is matched by payload type
+ * and, for diagnostic messages, by addresses and UDS SID (NRC 0x78 pending
+ * responses are skipped), so DoIP ACKs and 0x2A periodic frames are ignored.
+ *
+ * Trace latencies are server-side (request received -> response written);
+ * live replay latencies are seen by the tester and include the network RTT.
+ * For a like-for-like comparison, capture on the server under test while
+ * replaying and compare the two traces with -c.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../common/protocol/doip_trace.h"
+#include "../common/protocol/doip_protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define REPLAY_CATEGORIES   (256 + 8)   /* UDS SIDs + DoIP payload types */
+#define REPLAY_CAT_UDS      0
+#define REPLAY_CAT_DOIP     256
+
+// Replay options
+typedef struct {
+    const char* trace_path;
+    const char* host;
+    const char* port;
+    double speed;               /* 1 = recorded pace, 0 = max */
+    int timeout_ms;
+    double max_regression_pct;  /* < 0: no pass/fail check */
+    bool info_only;
+} ReplayOptions;
+
+// One request from the trace (plus OPEN / CLOSE markers)
+typedef struct {
+    uint64_t time_us;
+    uint8_t kind;
+    uint32_t length;
+    uint8_t* frame;
+    uint16_t category;
+
+    /* Recording */
+    int64_t recorded_us;        /* -1: no final response in the trace */
+    const uint8_t* recorded_response;
+    uint32_t recorded_length;
+
+    /* Replay */
+    int64_t replay_us;          /* -1: not replayed / no response expected */
+    bool timeout;
+    bool differs;               /* Response bytes differ from the recording */
+    uint64_t late_us;           /* Send time behind schedule */
+} ReplayEvent;
+
+typedef struct {
+    uint32_t id;
+    ReplayEvent* events;
+    size_t count;
+    size_t capacity;
+
+    /* Trace analysis: all records of this connection */
+    size_t* record_index;
+    size_t record_count;
+    size_t record_capacity;
+
+    /* Replay thread */
+    pthread_t thread;
+    int sock;
+    uint8_t* rx;
+    size_t rx_used;
+    size_t rx_capacity;
+    bool connect_failed;
+} ReplayConnection;
+
+typedef struct {
+    uint64_t time_us;
+    uint32_t connection;
+    uint8_t kind;
+    uint32_t length;
+    uint8_t* frame;
+} TraceRecord;
+
+// Shared, read-only while threads run
+static ReplayOptions g_options;
+static struct sockaddr_storage g_addr;
+static socklen_t g_addr_len;
+static uint64_t g_start_mono_us;
+static uint64_t g_trace_start_us;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static void sleep_until_us(uint64_t deadline) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline / 1000000ULL);
+    ts.tv_nsec = (long)((deadline % 1000000ULL) * 1000ULL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+static uint16_t be16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void* grow(void* ptr, size_t* capacity, size_t needed, size_t elem) {
+    if (needed <= *capacity) {
+        return ptr;
+    }
+    size_t cap = (*capacity == 0) ? 16 : *capacity;
+    while (cap < needed) {
+        cap *= 2;
+    }
+    void* p = realloc(ptr, cap * elem);
+    if (p == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    *capacity = cap;
+    return p;
+}
+
+static uint16_t frame_category(const uint8_t* frame, uint32_t length) {
+    uint16_t type = be16(frame + 2);
+    if (type == DOIP_DIAGNOSTIC_MESSAGE && length > DOIP_HEADER_SIZE + 4) {
+        return (uint16_t)(REPLAY_CAT_UDS + frame[DOIP_HEADER_SIZE + 4]);
+    }
+    switch (type) {
+        case DOIP_VEHICLE_IDENTIFICATION_REQ: return REPLAY_CAT_DOIP + 0;
+        case DOIP_ROUTING_ACTIVATION_REQ:     return REPLAY_CAT_DOIP + 1;
+        case DOIP_ALIVE_CHECK_REQ:            return REPLAY_CAT_DOIP + 2;
+        default:                              return REPLAY_CAT_DOIP + 3;
+    }
+}
+
+static void category_name(uint16_t category, char* out, size_t len) {
+    static const char* const DOIP_NAMES[] = {
+        "VehicleIdentification", "RoutingActivation", "AliveCheck", "Other DoIP"
+    };
+    if (category < REPLAY_CAT_DOIP) {
+        snprintf(out, len, "UDS 0x%02X", category - REPLAY_CAT_UDS);
+    } else {
+        snprintf(out, len, "%s", DOIP_NAMES[category - REPLAY_CAT_DOIP]);
+    }
+}
+
+/* Final response to a request: ACKs, NRC 0x78 and periodic frames do not count */
+static bool is_final_response(const uint8_t* req, uint32_t req_len, const uint8_t* resp, uint32_t resp_len) {
+    if (req_len < DOIP_HEADER_SIZE || resp_len < DOIP_HEADER_SIZE) {
+        return false;
+    }
+    uint16_t req_type = be16(req + 2);
+    uint16_t resp_type = be16(resp + 2);
+
+    switch (req_type) {
+        case DOIP_VEHICLE_IDENTIFICATION_REQ:
+            return resp_type == DOIP_VEHICLE_IDENTIFICATION_RES;
+        case DOIP_ROUTING_ACTIVATION_REQ:
+            return resp_type == DOIP_ROUTING_ACTIVATION_RES;
+        case DOIP_ALIVE_CHECK_REQ:
+            return resp_type == DOIP_ALIVE_CHECK_RES;
+        case DOIP_DIAGNOSTIC_MESSAGE:
+            break;
+        default:
+            return false;
+    }
+
+    if (resp_type == DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK) {
+        return true;  // Request rejected at DoIP level
+    }
+    const uint8_t* rq = req + DOIP_HEADER_SIZE;
+    const uint8_t* rs = resp + DOIP_HEADER_SIZE;
+    if (resp_type != DOIP_DIAGNOSTIC_MESSAGE || req_len < DOIP_HEADER_SIZE + 5 ||
+        resp_len < DOIP_HEADER_SIZE + 5) {
+        return false;
+    }
+    /* Response goes ECU (request TA) -> tester (request SA) */
+    if (be16(rs) != be16(rq + 2) || be16(rs + 2) != be16(rq)) {
+        return false;
+    }
+    uint8_t sid = rq[4];
+    if (rs[4] == (uint8_t)(sid + 0x40)) {
+        return true;
+    }
+    return rs[4] == 0x7F && resp_len >= DOIP_HEADER_SIZE + 7 && rs[5] == sid && rs[6] != 0x78;
+}
+
+static int compare_i64(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/* values must be sorted */
+static int64_t percentile(const int64_t* values, size_t count, double p) {
+    if (count == 0) {
+        return -1;
+    }
+    size_t index = (size_t)(p * (double)(count - 1) + 0.5);
+    return values[index];
+}
+
+// ============================================================================
+// Trace Loading
+// ============================================================================
+
+static ReplayConnection* find_connection(ReplayConnection** conns, size_t* count, size_t* capacity, uint32_t id) {
+    for (size_t i = 0; i < *count; i++) {
+        if ((*conns)[i].id == id) {
+            return &(*conns)[i];
+        }
+    }
+    *conns = (ReplayConnection*)grow(*conns, capacity, *count + 1, sizeof(ReplayConnection));
+    ReplayConnection* conn = &(*conns)[(*count)++];
+    memset(conn, 0, sizeof(*conn));
+    conn->id = id;
+    conn->sock = -1;
+    return conn;
+}
+
+static int load_trace(const char* path, TraceRecord** out_records, size_t* out_count,
+                      ReplayConnection** out_conns, size_t* out_conn_count, uint64_t* start_unix_us) {
+    DoIPTraceReader reader;
+    if (doip_trace_reader_open(&reader, path) != 0) {
+        fprintf(stderr, "Cannot open trace %s\n", path);
+        return -1;
+    }
+    *start_unix_us = reader.start_unix_us;
+
+    TraceRecord* records = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    ReplayConnection* conns = NULL;
+    size_t conn_count = 0;
+    size_t conn_capacity = 0;
+
+    DoIPTraceRecord rec;
+    int result;
+    while ((result = doip_trace_read(&reader, &rec)) == 1) {
+        if ((rec.kind == DOIP_TRACE_RX || rec.kind == DOIP_TRACE_TX) && rec.length < DOIP_HEADER_SIZE) {
+            continue;
+        }
+        records = (TraceRecord*)grow(records, &capacity, count + 1, sizeof(TraceRecord));
+        TraceRecord* r = &records[count];
+        r->time_us = rec.time_us;
+        r->connection = rec.connection;
+        r->kind = rec.kind;
+        r->length = rec.length;
+        r->frame = NULL;
+        if (rec.length > 0) {
+            r->frame = (uint8_t*)malloc(rec.length);
+            if (r->frame == NULL) {
+                fprintf(stderr, "Out of memory\n");
+                exit(1);
+            }
+            memcpy(r->frame, rec.frame, rec.length);
+        }
+
+        ReplayConnection* conn = find_connection(&conns, &conn_count, &conn_capacity, rec.connection);
+        conn->record_index = (size_t*)grow(conn->record_index, &conn->record_capacity,
+                                           conn->record_count + 1, sizeof(size_t));
+        conn->record_index[conn->record_count++] = count;
+        count++;
+    }
+    doip_trace_reader_close(&reader);
+
+    if (result < 0) {
+        fprintf(stderr, "Warning: trace truncated after %zu records\n", count);
+    }
+
+    /* Replay events and recorded latency: first final response before the next request */
+    for (size_t c = 0; c < conn_count; c++) {
+        ReplayConnection* conn = &conns[c];
+        for (size_t i = 0; i < conn->record_count; i++) {
+            TraceRecord* r = &records[conn->record_index[i]];
+            if (r->kind == DOIP_TRACE_TX) {
+                continue;
+            }
+            conn->events = (ReplayEvent*)grow(conn->events, &conn->capacity, conn->count + 1, sizeof(ReplayEvent));
+            ReplayEvent* ev = &conn->events[conn->count++];
+            memset(ev, 0, sizeof(*ev));
+            ev->time_us = r->time_us;
+            ev->kind = r->kind;
+            ev->length = r->length;
+            ev->frame = r->frame;
+            ev->recorded_us = -1;
+            ev->replay_us = -1;
+            if (r->kind != DOIP_TRACE_RX) {
+                continue;
+            }
+            ev->category = frame_category(r->frame, r->length);
+
+            for (size_t j = i + 1; j < conn->record_count; j++) {
+                TraceRecord* t = &records[conn->record_index[j]];
+                if (t->kind == DOIP_TRACE_RX || t->kind == DOIP_TRACE_CLOSE) {
+                    break;
+                }
+                if (t->kind == DOIP_TRACE_TX && is_final_response(r->frame, r->length, t->frame, t->length)) {
+                    ev->recorded_us = (int64_t)(t->time_us - r->time_us);
+                    ev->recorded_response = t->frame;
+                    ev->recorded_length = t->length;
+                    break;
+                }
+            }
+        }
+    }
+
+    *out_records = records;
+    *out_count = count;
+    *out_conns = conns;
+    *out_conn_count = conn_count;
+    return 0;
+}
+
+// ============================================================================
+// Replay
+// ============================================================================
+
+static bool open_socket(ReplayConnection* conn) {
+    bool udp = (conn->id == DOIP_TRACE_UDP_CONNECTION);
+    conn->sock = socket(g_addr.ss_family, udp ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (conn->sock < 0) {
+        return false;
+    }
+    if (connect(conn->sock, (struct sockaddr*)&g_addr, g_addr_len) != 0) {
+        close(conn->sock);
+        conn->sock = -1;
+        return false;
+    }
+    if (!udp) {
+        int one = 1;
+        setsockopt(conn->sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    conn->rx_used = 0;
+    return true;
+}
+
+static void close_socket(ReplayConnection* conn) {
+    if (conn->sock >= 0) {
+        close(conn->sock);
+        conn->sock = -1;
+    }
+}
+
+static bool send_all(int sock, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(sock, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* Next complete frame into conn->rx[0..*len); 1 = frame, 0 = timeout, -1 = closed / error */
+static int receive_frame(ReplayConnection* conn, uint64_t deadline, uint32_t* len) {
+    bool udp = (conn->id == DOIP_TRACE_UDP_CONNECTION);
+
+    for (;;) {
+        if (!udp && conn->rx_used >= DOIP_HEADER_SIZE) {
+            uint32_t frame_len = DOIP_HEADER_SIZE + be32(conn->rx + 4);
+            if (frame_len > DOIP_TRACE_MAX_FRAME) {
+                return -1;
+            }
+            if (conn->rx_used >= frame_len) {
+                *len = frame_len;
+                return 1;
+            }
+        }
+
+        uint64_t now = now_us();
+        if (now >= deadline) {
+            return 0;
+        }
+        struct pollfd pfd = {conn->sock, POLLIN, 0};
+        int ready = poll(&pfd, 1, (int)((deadline - now + 999) / 1000));
+        if (ready < 0 && errno != EINTR) {
+            return -1;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+
+        conn->rx = (uint8_t*)grow(conn->rx, &conn->rx_capacity, conn->rx_used + 4096, 1);
+        ssize_t n = recv(conn->sock, conn->rx + conn->rx_used, conn->rx_capacity - conn->rx_used, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (udp) {
+            *len = (uint32_t)n;
+            return 1;
+        }
+        conn->rx_used += (size_t)n;
+    }
+}
+
+static void consume_frame(ReplayConnection* conn, uint32_t len) {
+    if (conn->id == DOIP_TRACE_UDP_CONNECTION) {
+        return;
+    }
+    memmove(conn->rx, conn->rx + len, conn->rx_used - len);
+    conn->rx_used -= len;
+}
+
+static void* replay_thread(void* arg) {
+    ReplayConnection* conn = (ReplayConnection*)arg;
+    uint64_t ready_us = g_start_mono_us;  /* Previous response received */
+
+    sleep_until_us(g_start_mono_us);
+
+    for (size_t i = 0; i < conn->count; i++) {
+        ReplayEvent* ev = &conn->events[i];
+
+        uint64_t scheduled = ready_us;
+        if (g_options.speed > 0.0) {
+            uint64_t offset = (uint64_t)((double)(ev->time_us - g_trace_start_us) / g_options.speed);
+            scheduled = g_start_mono_us + offset;
+            sleep_until_us((scheduled > ready_us) ? scheduled : ready_us);
+        }
+
+        if (ev->kind == DOIP_TRACE_OPEN) {
+            if (conn->sock < 0 && !open_socket(conn)) {
+                conn->connect_failed = true;
+            }
+            continue;
+        }
+        if (ev->kind == DOIP_TRACE_CLOSE) {
+            close_socket(conn);
+            continue;
+        }
+        if (ev->kind != DOIP_TRACE_RX) {
+            continue;
+        }
+
+        /* Capture may have started mid-connection: connect on first request */
+        if (conn->sock < 0 && !open_socket(conn)) {
+            conn->connect_failed = true;
+            ev->timeout = (ev->recorded_us >= 0);
+            continue;
+        }
+
+        uint64_t sent = now_us();
+        if (g_options.speed > 0.0 && sent > scheduled) {
+            ev->late_us = sent - scheduled;  // Previous response slower than recorded, or overload
+        }
+        if (!send_all(conn->sock, ev->frame, ev->length)) {
+            close_socket(conn);
+            ev->timeout = (ev->recorded_us >= 0);
+            continue;
+        }
+        ready_us = sent;
+        if (ev->recorded_us < 0) {
+            continue;  // Nothing to wait for (suppressed response / notification)
+        }
+
+        uint64_t deadline = sent + (uint64_t)g_options.timeout_ms * 1000ULL;
+        for (;;) {
+            uint32_t len = 0;
+            int result = receive_frame(conn, deadline, &len);
+            if (result <= 0) {
+                ev->timeout = true;
+                if (result < 0) {
+                    close_socket(conn);
+                }
+                break;
+            }
+            if (is_final_response(ev->frame, ev->length, conn->rx, len)) {
+                ready_us = now_us();
+                ev->replay_us = (int64_t)(ready_us - sent);
+                ev->differs = (len != ev->recorded_length ||
+                               memcmp(conn->rx, ev->recorded_response, len) != 0);
+                consume_frame(conn, len);
+                break;
+            }
+            consume_frame(conn, len);
+        }
+    }
+
+    close_socket(conn);
+    return NULL;
+}
+
+// ============================================================================
+// Report
+// ============================================================================
+
+typedef enum {
+    REPORT_INFO,        /* Recording only */
+    REPORT_REPLAY,      /* New = latency observed by the replaying tester */
+    REPORT_COMPARE      /* New = server-side latency in a candidate trace */
+} ReportMode;
+
+typedef struct {
+    int64_t* recorded;
+    size_t recorded_count;
+    size_t recorded_capacity;
+    int64_t* replayed;
+    size_t replayed_count;
+    size_t replayed_capacity;
+    size_t requests;
+    size_t timeouts;
+    size_t differs;
+} CategoryStats;
+
+static void add_sample(int64_t** values, size_t* count, size_t* capacity, int64_t value) {
+    *values = (int64_t*)grow(*values, capacity, *count + 1, sizeof(int64_t));
+    (*values)[(*count)++] = value;
+}
+
+/* Recorded latencies of a trace, as baseline or (compare mode) as the new side */
+static void collect_recorded(const ReplayConnection* conns, size_t conn_count, bool as_new,
+                             CategoryStats* stats, CategoryStats* total) {
+    for (size_t c = 0; c < conn_count; c++) {
+        for (size_t i = 0; i < conns[c].count; i++) {
+            const ReplayEvent* ev = &conns[c].events[i];
+            if (ev->kind != DOIP_TRACE_RX) {
+                continue;
+            }
+            CategoryStats* s = &stats[ev->category];
+            if (as_new) {
+                if (ev->recorded_us >= 0) {
+                    add_sample(&s->replayed, &s->replayed_count, &s->replayed_capacity, ev->recorded_us);
+                    add_sample(&total->replayed, &total->replayed_count, &total->replayed_capacity, ev->recorded_us);
+                }
+                continue;
+            }
+            s->requests++;
+            total->requests++;
+            if (ev->recorded_us >= 0) {
+                add_sample(&s->recorded, &s->recorded_count, &s->recorded_capacity, ev->recorded_us);
+                add_sample(&total->recorded, &total->recorded_count, &total->recorded_capacity, ev->recorded_us);
+            }
+        }
+    }
+}
+
+static void collect_replay(const ReplayConnection* conns, size_t conn_count, CategoryStats* stats,
+                           CategoryStats* total, size_t* late, uint64_t* max_late_us) {
+    for (size_t c = 0; c < conn_count; c++) {
+        for (size_t i = 0; i < conns[c].count; i++) {
+            const ReplayEvent* ev = &conns[c].events[i];
+            if (ev->kind != DOIP_TRACE_RX) {
+                continue;
+            }
+            CategoryStats* s = &stats[ev->category];
+            if (ev->replay_us >= 0) {
+                add_sample(&s->replayed, &s->replayed_count, &s->replayed_capacity, ev->replay_us);
+                add_sample(&total->replayed, &total->replayed_count, &total->replayed_capacity, ev->replay_us);
+            }
+            s->timeouts += ev->timeout;
+            total->timeouts += ev->timeout;
+            s->differs += ev->differs;
+            total->differs += ev->differs;
+            if (ev->late_us > 1000) {
+                (*late)++;
+            }
+            if (ev->late_us > *max_late_us) {
+                *max_late_us = ev->late_us;
+            }
+        }
+    }
+}
+
+static void print_us(int64_t us) {
+    if (us < 0) {
+        printf("%10s", "-");
+    } else {
+        printf("%10lld", (long long)us);
+    }
+}
+
+static void print_delta(int64_t recorded, int64_t replayed) {
+    if (recorded <= 0 || replayed < 0) {
+        printf("%10s", "-");
+    } else {
+        printf(" %+8.1f%%", 100.0 * (double)(replayed - recorded) / (double)recorded);
+    }
+}
+
+static void print_row(const char* name, CategoryStats* s, ReportMode mode) {
+    qsort(s->recorded, s->recorded_count, sizeof(int64_t), compare_i64);
+    qsort(s->replayed, s->replayed_count, sizeof(int64_t), compare_i64);
+
+    int64_t rec50 = percentile(s->recorded, s->recorded_count, 0.50);
+    int64_t rec99 = percentile(s->recorded, s->recorded_count, 0.99);
+    int64_t new50 = percentile(s->replayed, s->replayed_count, 0.50);
+    int64_t new99 = percentile(s->replayed, s->replayed_count, 0.99);
+
+    printf("%-22s %7zu", name, s->requests);
+    print_us(rec50);
+    print_us(rec99);
+    if (mode != REPORT_INFO) {
+        print_us(new50);
+        print_us(new99);
+        print_delta(rec50, new50);
+        print_delta(rec99, new99);
+    }
+    if (mode == REPORT_REPLAY) {
+        printf(" %8zu %6zu", s->timeouts, s->differs);
+    }
+    printf("\n");
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [options] <trace>\n"
+            "  -H <host>   server address (default 127.0.0.1)\n"
+            "  -p <port>   DoIP port (default 13400)\n"
+            "  -s <speed>  1 = recorded pace, N = N x faster, 0 = max (default 1)\n"
+            "  -t <ms>     response timeout (default 2000)\n"
+            "  -r <pct>    exit 2 if new p99 is more than <pct> %% above the recording\n"
+            "  -c <trace>  compare with a candidate trace instead of replaying\n"
+            "              (capture on the server under test while replaying)\n"
+            "  -i          trace summary only (no replay)\n",
+            prog);
+}
+
+static void print_trace_summary(const char* path, size_t record_count, const ReplayConnection* conns,
+                                size_t conn_count, uint64_t start_unix_us, uint64_t* first_us, uint64_t* last_us) {
+    size_t requests = 0;
+    *first_us = UINT64_MAX;
+    *last_us = 0;
+    for (size_t c = 0; c < conn_count; c++) {
+        for (size_t i = 0; i < conns[c].count; i++) {
+            const ReplayEvent* ev = &conns[c].events[i];
+            requests += (ev->kind == DOIP_TRACE_RX);
+            if (ev->time_us < *first_us) {
+                *first_us = ev->time_us;
+            }
+            if (ev->time_us > *last_us) {
+                *last_us = ev->time_us;
+            }
+        }
+    }
+    if (*first_us == UINT64_MAX) {
+        *first_us = 0;
+    }
+
+    time_t recorded_at = (time_t)(start_unix_us / 1000000ULL);
+    struct tm tm_info;
+    char date[32];
+    localtime_r(&recorded_at, &tm_info);
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm_info);
+    printf("Trace: %s (recorded %s)\n", path, date);
+    printf("  %zu records, %zu connections, %zu requests over %.3f s\n",
+           record_count, conn_count, requests, (double)(*last_us - *first_us) / 1e6);
+}
+
+int main(int argc, char** argv) {
+    const char* candidate_path = NULL;
+    g_options.host = "127.0.0.1";
+    g_options.port = "13400";
+    g_options.speed = 1.0;
+    g_options.timeout_ms = 2000;
+    g_options.max_regression_pct = -1.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:s:t:r:c:i")) != -1) {
+        switch (opt) {
+            case 'H': g_options.host = optarg; break;
+            case 'p': g_options.port = optarg; break;
+            case 's': g_options.speed = atof(optarg); break;
+            case 't': g_options.timeout_ms = atoi(optarg); break;
+            case 'r': g_options.max_regression_pct = atof(optarg); break;
+            case 'c': candidate_path = optarg; break;
+            case 'i': g_options.info_only = true; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind != argc - 1 || g_options.speed < 0.0 || g_options.timeout_ms <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    g_options.trace_path = argv[optind];
+
+    ReportMode mode = g_options.info_only ? REPORT_INFO : (candidate_path ? REPORT_COMPARE : REPORT_REPLAY);
+
+    TraceRecord* records = NULL;
+    size_t record_count = 0;
+    ReplayConnection* conns = NULL;
+    size_t conn_count = 0;
+    uint64_t start_unix_us = 0;
+    if (load_trace(g_options.trace_path, &records, &record_count, &conns, &conn_count, &start_unix_us) != 0) {
+        return 1;
+    }
+    uint64_t trace_end_us = 0;
+    print_trace_summary(g_options.trace_path, record_count, conns, conn_count, start_unix_us,
+                        &g_trace_start_us, &trace_end_us);
+
+    CategoryStats* stats = (CategoryStats*)calloc(REPLAY_CATEGORIES, sizeof(CategoryStats));
+    CategoryStats total;
+    memset(&total, 0, sizeof(total));
+    collect_recorded(conns, conn_count, false, stats, &total);
+    if (total.requests == 0) {
+        fprintf(stderr, "No requests in trace %s\n", g_options.trace_path);
+        return 1;
+    }
+
+    size_t late = 0;
+    uint64_t max_late_us = 0;
+    size_t connect_failures = 0;
+    double wall_s = 0.0;
+
+    if (mode == REPORT_COMPARE) {
+        TraceRecord* cand_records = NULL;
+        size_t cand_record_count = 0;
+        ReplayConnection* cand_conns = NULL;
+        size_t cand_conn_count = 0;
+        uint64_t cand_start_unix_us = 0;
+        uint64_t cand_first_us = 0;
+        uint64_t cand_last_us = 0;
+        if (load_trace(candidate_path, &cand_records, &cand_record_count, &cand_conns, &cand_conn_count,
+                       &cand_start_unix_us) != 0) {
+            return 1;
+        }
+        print_trace_summary(candidate_path, cand_record_count, cand_conns, cand_conn_count,
+                            cand_start_unix_us, &cand_first_us, &cand_last_us);
+        collect_recorded(cand_conns, cand_conn_count, true, stats, &total);
+    } else if (mode == REPORT_REPLAY) {
+        struct addrinfo hints;
+        struct addrinfo* res = NULL;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        if (getaddrinfo(g_options.host, g_options.port, &hints, &res) != 0 || res == NULL) {
+            fprintf(stderr, "Cannot resolve %s:%s\n", g_options.host, g_options.port);
+            return 1;
+        }
+        memcpy(&g_addr, res->ai_addr, res->ai_addrlen);
+        g_addr_len = res->ai_addrlen;
+        freeaddrinfo(res);
+
+        if (g_options.speed > 0.0) {
+            printf("Replay: %s:%s at %.1fx\n", g_options.host, g_options.port, g_options.speed);
+        } else {
+            printf("Replay: %s:%s at max speed\n", g_options.host, g_options.port);
+        }
+
+        g_start_mono_us = now_us() + 10000;  /* Common start for all threads */
+        for (size_t c = 0; c < conn_count; c++) {
+            if (pthread_create(&conns[c].thread, NULL, replay_thread, &conns[c]) != 0) {
+                fprintf(stderr, "Failed to start replay thread\n");
+                return 1;
+            }
+        }
+        for (size_t c = 0; c < conn_count; c++) {
+            pthread_join(conns[c].thread, NULL);
+            connect_failures += conns[c].connect_failed;
+        }
+        wall_s = (double)(now_us() - g_start_mono_us) / 1e6;
+        collect_replay(conns, conn_count, stats, &total, &late, &max_late_us);
+    }
+
+    printf("\nLatency (us); rec = server-side in the trace, new = %s\n",
+           (mode == REPORT_REPLAY) ? "observed by the replaying tester (includes network RTT)" :
+           (mode == REPORT_COMPARE) ? "server-side in the candidate trace" : "-");
+    printf("%-22s %7s%10s%10s", "request", "n", "rec p50", "rec p99");
+    if (mode != REPORT_INFO) {
+        printf("%10s%10s%10s%10s", "new p50", "new p99", "d p50", "d p99");
+    }
+    if (mode == REPORT_REPLAY) {
+        printf(" %8s %6s", "timeout", "diff");
+    }
+    printf("\n");
+    for (uint16_t cat = 0; cat < REPLAY_CATEGORIES; cat++) {
+        if (stats[cat].requests == 0) {
+            continue;
+        }
+        char name[32];
+        category_name(cat, name, sizeof(name));
+        print_row(name, &stats[cat], mode);
+    }
+    print_row("TOTAL", &total, mode);
+
+    if (mode == REPORT_REPLAY) {
+        printf("\nReplay wall time %.3f s (recording %.3f s), %zu sends >1 ms late (max %.1f ms)",
+               wall_s, (double)(trace_end_us - g_trace_start_us) / 1e6, late, (double)max_late_us / 1000.0);
+        if (connect_failures > 0) {
+            printf(", %zu connections failed", connect_failures);
+        }
+        printf("\n");
+    }
+
+    int exit_code = 0;
+    if (mode != REPORT_INFO && g_options.max_regression_pct >= 0.0) {
+        int64_t rec99 = percentile(total.recorded, total.recorded_count, 0.99);
+        int64_t new99 = percentile(total.replayed, total.replayed_count, 0.99);
+        double limit = (double)rec99 * (1.0 + g_options.max_regression_pct / 100.0);
+        if (total.timeouts > 0 || new99 < 0 || (double)new99 > limit) {
+            printf("REGRESSION: p99 %lld us vs recorded %lld us (limit +%.1f%%), %zu timeouts\n",
+                   (long long)new99, (long long)rec99, g_options.max_regression_pct, total.timeouts);
+            exit_code = 2;
+        } else {
+            printf("OK: p99 within +%.1f%% of the recording\n", g_options.max_regression_pct);
+        }
+    }
+    return exit_code;
+}
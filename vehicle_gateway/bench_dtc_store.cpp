@@ -0,0 +1,176 @@
+/**
+ * @file bench_dtc_store.cpp
+ * @brief DTCStore status-mask query benchmark (host build)
+ *
+ * Stores 4096 DTCs of which 1% / 10% / 100% are currently failing and
+ * reports UDS 0x19 0x02 (reportDTCByStatusMask, mask 0x01) requests/sec through
+ * the status-bit index against a linear scan over every stored record.
+ * Then reopens the log and checks that replay restores the same DTCs,
+ * and that 0x14 ClearDTC empties the store across a reopen.
+ *
+ * Usage: ./dtc_store_bench [queries] [log_path]
+ */
+
+#include "include/dtc_store.hpp"
+#include "include/uds_service_handler.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace vmg;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t STORED_DTCS = 4096;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Status mask query without the index (same response writer), kept as baseline
+size_t linearScan(const std::vector<DTCRecord>& records, uint8_t mask, uint8_t* out, size_t cap) {
+    UDSResponseWriter writer(out, cap);
+    writer.put(0x59);
+    writer.put(0x02);
+    writer.put(DTCStore::STATUS_AVAILABILITY_MASK);
+    for (const auto& record : records) {
+        if (record.status & mask) {
+            writer.put(static_cast<uint8_t>(record.dtc >> 16));
+            writer.putU16(static_cast<uint16_t>(record.dtc & 0xFFFF));
+            writer.put(record.status);
+        }
+    }
+    return writer.size();
+}
+
+bool populate(DTCStore& store, std::vector<DTCRecord>& shadow, uint32_t failing_every) {
+    store.clear(DTC_GROUP_ALL);
+    shadow.clear();
+
+    const uint8_t snapshot[] = {0xF4, 0x0D, 0x00, 0x57};  // Vehicle speed DID + data
+    for (uint32_t i = 0; i < STORED_DTCS; i++) {
+        uint32_t dtc = 0x400000 + i * 7;
+        if (!store.reportTestResult(dtc, true, snapshot, sizeof(snapshot))) {
+            return false;
+        }
+        // Most DTCs pass a later test (testFailed cleared, still confirmed)
+        if (i % failing_every != 0) {
+            store.reportTestResult(dtc, false);
+        }
+    }
+
+    for (uint32_t i = 0; i < STORED_DTCS; i++) {
+        DTCRecord record;
+        store.find(0x400000 + i * 7, record);
+        shadow.push_back(record);
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t queries = (argc > 1) ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 20000u;
+    std::string log_path = (argc > 2) ? argv[2] : "/tmp/vmg_dtc_bench.log";
+    if (queries == 0) {
+        std::cerr << "Usage: " << argv[0] << " [queries] [log_path]" << std::endl;
+        return 1;
+    }
+    std::remove(log_path.c_str());
+
+    DTCStoreConfig config;
+    config.log_path = log_path;
+    DTCStore store(config);
+    if (!store.open()) {
+        return 1;
+    }
+
+    UDSServiceHandler handler;
+    handler.attachDTCStore(&store);
+
+    static uint8_t response[64 * 1024];
+    const uint8_t request[] = {0x19, 0x02, DTC_STATUS_TEST_FAILED};
+    static const uint32_t failing_every[] = {100, 10, 1};
+    size_t len = 0;
+
+    std::cout << "DTCStore 0x19 0x02 benchmark (" << STORED_DTCS << " DTCs, "
+              << queries << " queries)" << std::endl;
+    std::cout << "  " << std::setw(10) << "matching" << std::setw(14) << "index/s"
+              << std::setw(14) << "linear/s" << std::setw(12) << "bytes" << std::endl;
+
+    for (uint32_t every : failing_every) {
+        std::vector<DTCRecord> shadow;
+        if (!populate(store, shadow, every)) {
+            std::cerr << "Populate failed" << std::endl;
+            return 1;
+        }
+
+        len = handler.processRequest(ConstByteSpan(request), response, sizeof(response));
+        size_t matching = store.countByStatusMask(DTC_STATUS_TEST_FAILED);
+        if (len != 3 + 4 * matching || matching != (STORED_DTCS + every - 1) / every) {
+            std::cerr << "Unexpected response length " << len << " for " << matching << " DTCs" << std::endl;
+            return 1;
+        }
+
+        uint64_t sink = 0;
+        auto t0 = Clock::now();
+        for (uint32_t q = 0; q < queries; q++) {
+            sink += handler.processRequest(ConstByteSpan(request), response, sizeof(response));
+        }
+        double index_secs = secondsSince(t0);
+
+        t0 = Clock::now();
+        for (uint32_t q = 0; q < queries; q++) {
+            sink += linearScan(shadow, DTC_STATUS_TEST_FAILED, response, sizeof(response));
+        }
+        double linear_secs = secondsSince(t0);
+
+        if (sink == 0) {
+            std::cerr << "unexpected empty response" << std::endl;
+        }
+        std::cout << "  " << std::setw(10) << matching << std::fixed << std::setprecision(0)
+                  << std::setw(14) << queries / index_secs
+                  << std::setw(14) << queries / linear_secs
+                  << std::setw(12) << len << std::endl;
+    }
+
+    // Replay: a reopened store answers the same
+    size_t failing = store.countByStatusMask(DTC_STATUS_TEST_FAILED);
+    size_t confirmed = store.countByStatusMask(DTC_STATUS_CONFIRMED);
+    DTCStoreStats before = store.getStats();
+
+    DTCStore reopened(config);
+    auto t0 = Clock::now();
+    if (!reopened.open()) {
+        return 1;
+    }
+    double replay_ms = secondsSince(t0) * 1000.0;
+    if (reopened.countByStatusMask(DTC_STATUS_TEST_FAILED) != failing ||
+        reopened.countByStatusMask(DTC_STATUS_CONFIRMED) != confirmed) {
+        std::cerr << "Replay mismatch" << std::endl;
+        return 1;
+    }
+    std::cout << "Replay: " << reopened.getStats().records << " DTCs from "
+              << before.log_entries << " log entries in " << std::setprecision(2) << replay_ms
+              << " ms (" << before.compactions << " compactions)" << std::endl;
+
+    // 0x14 ClearDTC survives a reopen
+    UDSServiceHandler clear_handler;
+    clear_handler.attachDTCStore(&reopened);
+    const uint8_t clear_request[] = {0x14, 0xFF, 0xFF, 0xFF};
+    len = clear_handler.processRequest(ConstByteSpan(clear_request), response, sizeof(response));
+    DTCStore cleared(config);
+    if (len != 1 || response[0] != 0x54 || !cleared.open() ||
+        cleared.countByStatusMask(0xFF) != 0) {
+        std::cerr << "ClearDTC failed" << std::endl;
+        return 1;
+    }
+    std::cout << "ClearDTC: store empty after reopen" << std::endl;
+
+    std::remove(log_path.c_str());
+    return 0;
+}
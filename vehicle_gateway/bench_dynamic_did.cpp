@@ -0,0 +1,126 @@
+/**
+ * @file bench_dynamic_did.cpp
+ * @brief 0x2C dynamic DID read benchmark (host build)
+ *
+ * A logger samples 32 two-byte signals from a live signal buffer:
+ *   - per-signal DIDs: 32 custom DID handlers read with one multi-DID 0x22
+ *   - dynamic DID, scattered: one DDDID over 32 memory ranges (stride 8)
+ *   - dynamic DID, packed: one DDDID over 32 adjacent ranges (plan merges
+ *     them into a single copy step)
+ * Reports reads/s, signals/s and request/response bytes per sample.
+ *
+ * Usage: ./dynamic_did_bench [reads]
+ */
+
+#include "include/uds_service_handler.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+using namespace vmg;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t SIGNALS = 32;
+constexpr uint32_t SIGNAL_BASE = 0x70000000;
+constexpr uint16_t SIGNAL_DID_BASE = 0xF400;
+
+uint8_t g_signals[SIGNALS * 8];
+
+std::vector<uint8_t> defineByMemory(uint16_t dddid, size_t stride) {
+    std::vector<uint8_t> request = {0x2C, 0x02, static_cast<uint8_t>(dddid >> 8),
+                                    static_cast<uint8_t>(dddid & 0xFF), 0x14};
+    for (size_t i = 0; i < SIGNALS; i++) {
+        uint32_t address = static_cast<uint32_t>(SIGNAL_BASE + i * stride);
+        request.push_back(static_cast<uint8_t>(address >> 24));
+        request.push_back(static_cast<uint8_t>(address >> 16));
+        request.push_back(static_cast<uint8_t>(address >> 8));
+        request.push_back(static_cast<uint8_t>(address));
+        request.push_back(0x02);
+    }
+    return request;
+}
+
+void report(const char* name, uint32_t reads, double secs, size_t request_len, size_t response_len) {
+    std::cout << "  " << std::left << std::setw(22) << name << std::right << std::fixed
+              << std::setprecision(0) << std::setw(12) << reads / secs
+              << std::setw(14) << reads * SIGNALS / secs
+              << std::setw(10) << request_len << std::setw(10) << response_len << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t reads = (argc > 1) ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 1000000u;
+    if (reads == 0) {
+        std::cerr << "Usage: " << argv[0] << " [reads]" << std::endl;
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(g_signals); i++) {
+        g_signals[i] = static_cast<uint8_t>(i);
+    }
+
+    UDSServiceHandler handler;
+    handler.registerMemoryRegion(SIGNAL_BASE, g_signals, sizeof(g_signals));
+
+    // Before 0x2C: one DID per signal, each served by a handler
+    std::vector<uint8_t> per_signal = {0x22};
+    for (size_t i = 0; i < SIGNALS; i++) {
+        uint16_t did = static_cast<uint16_t>(SIGNAL_DID_BASE + i);
+        const uint8_t* signal = g_signals + i * 8;
+        handler.registerDIDReadHandler(did, [signal](uint16_t) {
+            return std::vector<uint8_t>{signal[0], signal[1]};
+        });
+        per_signal.push_back(static_cast<uint8_t>(did >> 8));
+        per_signal.push_back(static_cast<uint8_t>(did & 0xFF));
+    }
+
+    uint8_t response[UDSServiceHandler::MAX_RESPONSE_SIZE];
+    if (handler.processRequest(ConstByteSpan(defineByMemory(0xF300, 8)), response, sizeof(response)) != 4 ||
+        handler.processRequest(ConstByteSpan(defineByMemory(0xF301, 2)), response, sizeof(response)) != 4) {
+        std::cerr << "DynamicallyDefineDataIdentifier rejected" << std::endl;
+        return 1;
+    }
+
+    const uint8_t scattered[] = {0x22, 0xF3, 0x00};
+    const uint8_t packed[] = {0x22, 0xF3, 0x01};
+
+    struct Case {
+        const char* name;
+        ConstByteSpan request;
+    };
+    const Case cases[] = {
+        {"0x22 x32 signal DIDs", ConstByteSpan(per_signal)},
+        {"DDDID scattered", ConstByteSpan(scattered)},
+        {"DDDID packed", ConstByteSpan(packed)},
+    };
+
+    std::cout << "Dynamic DID benchmark (" << SIGNALS << " x 2-byte signals, " << reads << " reads)" << std::endl;
+    std::cout << "  " << std::left << std::setw(22) << "case" << std::right << std::setw(12) << "reads/s"
+              << std::setw(14) << "signals/s" << std::setw(10) << "req B" << std::setw(10) << "resp B" << std::endl;
+
+    for (const auto& c : cases) {
+        size_t len = handler.processRequest(c.request, response, sizeof(response));
+        if (len < 1 || response[0] != 0x62) {
+            std::cerr << c.name << ": unexpected response" << std::endl;
+            return 1;
+        }
+
+        uint64_t sink = 0;
+        auto t0 = Clock::now();
+        for (uint32_t r = 0; r < reads; r++) {
+            g_signals[r % sizeof(g_signals)]++;  // Live data changes between reads
+            sink += handler.processRequest(c.request, response, sizeof(response));
+        }
+        double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+        if (sink == 0) {
+            std::cerr << "unexpected empty response" << std::endl;
+        }
+        report(c.name, reads, secs, c.request.size(), len);
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file bench_periodic_did.cpp
+ * @brief 0x22 polling vs 0x2A periodic streaming (host build)
+ *
+ * A dashboard watches N live values: 1/4 at the fast rate (50 ms), 1/4 at
+ * medium (200 ms), the rest at slow (1000 ms). Polling sends one 0x22
+ * request per value per period (request, DoIP ACK and response on the
+ * wire); 0x2A sends one request and then one batched frame per due slot.
+ * Reports DoIP frames, bytes and handler time for 60 s of simulated time.
+ *
+ * Usage: ./periodic_did_bench [values]
+ */
+
+#include "include/uds_service_handler.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+using namespace vmg;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t SIMULATED_MS = 60000;
+constexpr size_t DOIP_HEADER = 8;
+constexpr size_t DOIP_ADDRESSES = 4;
+constexpr size_t DOIP_ACK = DOIP_HEADER + 5;
+constexpr uint16_t TESTER_ADDRESS = 0x0E00;
+
+struct WireStats {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    double handler_secs = 0;
+};
+
+uint32_t periodOf(size_t index, size_t values) {
+    if (index < values / 4) {
+        return 50;
+    }
+    return (index < values / 2) ? 200 : 1000;
+}
+
+void registerValues(UDSServiceHandler& handler, size_t values) {
+    for (size_t i = 0; i < values; i++) {
+        uint8_t value = static_cast<uint8_t>(i);
+        handler.registerDIDReadHandler(static_cast<uint16_t>(PERIODIC_DID_BASE | i),
+            [value](uint16_t) { return std::vector<uint8_t>{value, 0x00, 0x10, 0x20}; });
+    }
+}
+
+WireStats runPolling(size_t values) {
+    UDSServiceHandler handler;
+    registerValues(handler, values);
+
+    WireStats stats;
+    uint8_t request[3] = {0x22, 0xF2, 0x00};
+    uint8_t response[64];
+
+    auto t0 = Clock::now();
+    for (uint64_t now = 0; now < SIMULATED_MS; now += 50) {
+        for (size_t i = 0; i < values; i++) {
+            if (now % periodOf(i, values) != 0) {
+                continue;
+            }
+            request[2] = static_cast<uint8_t>(i);
+            size_t len = handler.processRequest(ConstByteSpan(request), response, sizeof(response));
+            stats.frames += 3;  // Request, ACK, response
+            stats.bytes += (DOIP_HEADER + DOIP_ADDRESSES + sizeof(request)) + DOIP_ACK +
+                           (DOIP_HEADER + DOIP_ADDRESSES + len);
+        }
+    }
+    stats.handler_secs = std::chrono::duration<double>(Clock::now() - t0).count();
+    return stats;
+}
+
+WireStats runPeriodic(size_t values) {
+    UDSServiceHandler handler;
+    registerValues(handler, values);
+
+    WireStats stats;
+    uint8_t response[UDSServiceHandler::MAX_RESPONSE_SIZE];
+
+    auto t0 = Clock::now();
+    // 0x2A needs a non-default session, then one request per rate group
+    handler.setTesterAddress(TESTER_ADDRESS);
+    static const uint8_t extended_session[] = {0x10, 0x03};
+    handler.processRequest(ConstByteSpan(extended_session), response, sizeof(response));
+    static const uint8_t modes[] = {0x03, 0x02, 0x01};
+    for (uint8_t mode : modes) {
+        std::vector<uint8_t> request = {0x2A, mode};
+        for (size_t i = 0; i < values; i++) {
+            uint32_t period = periodOf(i, values);
+            if ((mode == 0x03 && period == 50) || (mode == 0x02 && period == 200) ||
+                (mode == 0x01 && period == 1000)) {
+                request.push_back(static_cast<uint8_t>(i));
+            }
+        }
+        if (request.size() == 2) {
+            continue;
+        }
+        size_t len = handler.processRequest(ConstByteSpan(request), response, sizeof(response));
+        stats.frames += 3;
+        stats.bytes += (DOIP_HEADER + DOIP_ADDRESSES + request.size()) + DOIP_ACK +
+                       (DOIP_HEADER + DOIP_ADDRESSES + len);
+    }
+
+    // Streamed frames: the server thread wakes at each deadline
+    uint64_t now = 0;
+    while (now < SIMULATED_MS) {
+        uint64_t next_due = PERIODIC_NONE_DUE;
+        size_t len = handler.collectPeriodicFrame(TESTER_ADDRESS, now, response, sizeof(response), next_due);
+        if (len > 0) {
+            stats.frames++;
+            stats.bytes += DOIP_HEADER + DOIP_ADDRESSES + len;
+        }
+        if (next_due == PERIODIC_NONE_DUE) {
+            break;
+        }
+        now = next_due;
+    }
+    stats.handler_secs = std::chrono::duration<double>(Clock::now() - t0).count();
+    return stats;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t values = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 32;
+    if (values == 0 || values > UDSServiceHandler::MAX_READ_DIDS) {
+        std::cerr << "Usage: " << argv[0] << " [values 1-" << UDSServiceHandler::MAX_READ_DIDS << "]" << std::endl;
+        return 1;
+    }
+
+    WireStats polling = runPolling(values);
+    WireStats periodic = runPeriodic(values);
+
+    std::cout << "Live values: " << values << " (50/200/1000 ms), " << SIMULATED_MS / 1000
+              << " s simulated" << std::endl;
+    std::cout << "  " << std::left << std::setw(10) << "mode" << std::right
+              << std::setw(12) << "frames" << std::setw(12) << "bytes"
+              << std::setw(12) << "frames/s" << std::setw(14) << "handler us" << std::endl;
+
+    auto row = [](const char* name, const WireStats& stats) {
+        std::cout << "  " << std::left << std::setw(10) << name << std::right
+                  << std::setw(12) << stats.frames << std::setw(12) << stats.bytes
+                  << std::setw(12) << std::fixed << std::setprecision(1)
+                  << stats.frames * 1000.0 / SIMULATED_MS
+                  << std::setw(14) << std::setprecision(0) << stats.handler_secs * 1e6 << std::endl;
+    };
+    row("0x22 poll", polling);
+    row("0x2A", periodic);
+
+    std::cout << "  frame reduction: " << std::setprecision(1)
+              << static_cast<double>(polling.frames) / periodic.frames << "x, bytes: "
+              << static_cast<double>(polling.bytes) / periodic.bytes << "x" << std::endl;
+    return 0;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file bench_security_access.cpp
+ * @brief 0x27 seed/key latency benchmark (host build)
+ *
+ * Seed generation:
+ *   - legacy: std::random_device + mt19937 constructed per request
+ *   - inline: getrandom() per request (pool miss path)
+ *   - pool: SecurityAccessEngine seed pool with background refill
+ * Then full requestSeed/sendKey exchanges through UDSServiceHandler with
+ * the HMAC-SHA256 key, printing the engine's per-level stats.
+ *
+ * Usage: ./security_access_bench [unlocks]
+ */
+
+#include "include/uds_service_handler.hpp"
+#include "include/security_access.hpp"
+#include <sys/random.h>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <cstdlib>
+
+using namespace vmg;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const std::vector<uint8_t> LEVEL1_SECRET = {0x10, 0x32, 0x54, 0x76, 0x98, 0xBA, 0xDC, 0xFE,
+                                            0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF};
+
+void report(const char* name, uint32_t ops, double secs) {
+    std::cout << "  " << std::left << std::setw(26) << name << std::right << std::fixed
+              << std::setprecision(0) << std::setw(12) << ops / secs
+              << std::setw(12) << std::setprecision(1) << secs * 1e9 / ops << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t unlocks = (argc > 1) ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 20000u;
+    if (unlocks == 0) {
+        std::cerr << "Usage: " << argv[0] << " [unlocks]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "SecurityAccess benchmark (" << unlocks << " operations)" << std::endl;
+    std::cout << "  " << std::left << std::setw(26) << "case" << std::right
+              << std::setw(12) << "ops/s" << std::setw(12) << "ns/op" << std::endl;
+
+    uint64_t sink = 0;
+
+    // Legacy seed: random_device + mt19937 per request
+    auto t0 = Clock::now();
+    for (uint32_t i = 0; i < unlocks; i++) {
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        sink += gen();
+    }
+    report("seed: random_device/call", unlocks, std::chrono::duration<double>(Clock::now() - t0).count());
+
+    // Pool miss path: one getrandom() per seed
+    uint8_t seed[SECURITY_SEED_SIZE];
+    t0 = Clock::now();
+    for (uint32_t i = 0; i < unlocks; i++) {
+        if (getrandom(seed, sizeof(seed), 0) != static_cast<ssize_t>(sizeof(seed))) {
+            std::cerr << "getrandom failed" << std::endl;
+            return 1;
+        }
+        sink += seed[0];
+    }
+    report("seed: getrandom/call", unlocks, std::chrono::duration<double>(Clock::now() - t0).count());
+
+    // Pooled seeds; pool sized so the refill thread keeps up with a tester burst
+    SecurityAccessConfig config;
+    config.seed_pool_size = 256;
+    config.seed_pool_low_water = 128;
+    SecurityAccessEngine engine(config);
+    engine.setLevelSecret(0x01, LEVEL1_SECRET);
+    while (engine.seedPoolLevel() < config.seed_pool_size) {
+        std::this_thread::yield();
+    }
+
+    t0 = Clock::now();
+    for (uint32_t i = 0; i < unlocks; i++) {
+        engine.requestSeed(static_cast<uint16_t>(0x0E00 + (i & 0xFF)), 0x01, 0, seed);
+        sink += seed[0];
+    }
+    report("seed: pool", unlocks, std::chrono::duration<double>(Clock::now() - t0).count());
+
+    // HMAC key computation + constant-time compare (sendKey cost)
+    uint8_t key[SECURITY_KEY_SIZE];
+    uint8_t expected[SECURITY_KEY_SIZE];
+    t0 = Clock::now();
+    for (uint32_t i = 0; i < unlocks; i++) {
+        seed[0] = static_cast<uint8_t>(i);
+        SecurityAccessEngine::computeHmacKey(LEVEL1_SECRET, seed, key);
+        SecurityAccessEngine::computeHmacKey(LEVEL1_SECRET, seed, expected);
+        sink += SecurityAccessEngine::constantTimeEqual(key, expected, sizeof(key));
+    }
+    report("key: HMAC x2 + compare", unlocks, std::chrono::duration<double>(Clock::now() - t0).count());
+
+    // Full exchanges through the UDS handler (fresh engine for clean stats)
+    SecurityAccessEngine uds_engine(config);
+    uds_engine.setLevelSecret(0x01, LEVEL1_SECRET);
+    UDSServiceHandler handler;
+    handler.attachSecurityEngine(&uds_engine);
+    handler.setTesterAddress(0x0E00);
+    while (uds_engine.seedPoolLevel() < config.seed_pool_size) {
+        std::this_thread::yield();
+    }
+
+    const uint8_t seed_request[] = {0x27, 0x01};
+    uint8_t key_request[2 + SECURITY_KEY_SIZE] = {0x27, 0x02};
+    uint8_t response[64];
+
+    t0 = Clock::now();
+    for (uint32_t i = 0; i < unlocks; i++) {
+        size_t len = handler.processRequest(ConstByteSpan(seed_request), response, sizeof(response));
+        if (len != 2 + SECURITY_SEED_SIZE || response[0] != 0x67) {
+            std::cerr << "unexpected seed response" << std::endl;
+            return 1;
+        }
+        SecurityAccessEngine::computeHmacKey(LEVEL1_SECRET, response + 2, key_request + 2);
+        len = handler.processRequest(ConstByteSpan(key_request), response, sizeof(response));
+        if (len != 2 || response[0] != 0x67) {
+            std::cerr << "unexpected key response" << std::endl;
+            return 1;
+        }
+        uds_engine.lock(0x0E00);  // Relock, as a return to the default session does
+    }
+    report("0x27 unlock (seed+key)", unlocks, std::chrono::duration<double>(Clock::now() - t0).count());
+
+    SecurityLevelStats stats = uds_engine.getStats(0x01);
+    std::cout << "  level 0x01: seeds=" << stats.seeds << " pool_misses=" << stats.pool_misses
+              << " unlocks=" << stats.unlocks << " avg seed " << stats.seed_ns / stats.seeds
+              << " ns, avg key " << stats.key_ns / stats.seeds << " ns" << std::endl;
+
+    if (sink == 0) {
+        std::cerr << "unexpected zero sink" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,318 @@
+/**
+ * @file bench_telemetry_bus.cpp
+ * @brief Telemetry bus throughput / latency benchmark (host build)
+ *
+ * Fan-out of 128-byte events from P producer threads to S subscribers:
+ *   - callbacks: per-subscriber mutex + condvar queue of std::vector copies
+ *     (what ad-hoc component wiring looks like today)
+ *   - bus: TelemetryBus in process memory
+ *   - bus (shm): TelemetryBus in shared memory, subscribers in a child process
+ * Producers retry on a full ring, so every case delivers every event.
+ *
+ * Usage: ./telemetry_bus_bench [events per producer] [producers] [subscribers]
+ */
+
+#include "include/telemetry_bus.hpp"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+using namespace vmg;
+
+namespace {
+
+constexpr size_t EVENT_SIZE = 128;
+
+uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+struct Result {
+    uint64_t delivered = 0;
+    double secs = 0;
+    std::vector<uint32_t> latency_ns;   // Sampled publish -> handler latency
+};
+
+void report(const char* name, Result& r) {
+    std::sort(r.latency_ns.begin(), r.latency_ns.end());
+    auto pct = [&r](double p) -> uint32_t {
+        return r.latency_ns.empty() ? 0 : r.latency_ns[static_cast<size_t>(p * (r.latency_ns.size() - 1))];
+    };
+    std::cout << "  " << std::left << std::setw(16) << name << std::right << std::fixed
+              << std::setprecision(0) << std::setw(14) << r.delivered / r.secs
+              << std::setw(10) << pct(0.50) << std::setw(10) << pct(0.99) << std::endl;
+}
+
+// ============================================================================
+// Baseline: locked queues with copied events
+// ============================================================================
+
+struct LockedQueue {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::pair<uint64_t, std::vector<uint8_t>>> events;
+};
+
+Result runCallbacks(uint32_t events, uint32_t producers, uint32_t subscribers) {
+    std::vector<LockedQueue> queues(subscribers);
+    std::vector<std::function<void(uint64_t, const uint8_t*, size_t)>> callbacks;
+    for (auto& q : queues) {
+        callbacks.push_back([&q](uint64_t ts, const uint8_t* data, size_t len) {
+            {
+                std::lock_guard<std::mutex> lock(q.mutex);
+                q.events.emplace_back(ts, std::vector<uint8_t>(data, data + len));
+            }
+            q.cv.notify_one();
+        });
+    }
+
+    Result result;
+    std::mutex result_mutex;
+    uint64_t expected = static_cast<uint64_t>(events) * producers;
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (auto& q : queues) {
+        threads.emplace_back([&q, &result, &result_mutex, expected] {
+            std::vector<uint32_t> samples;
+            uint64_t got = 0;
+            while (got < expected) {
+                std::unique_lock<std::mutex> lock(q.mutex);
+                q.cv.wait(lock, [&q] { return !q.events.empty(); });
+                while (!q.events.empty()) {
+                    if ((got & 63) == 0) {
+                        samples.push_back(static_cast<uint32_t>(nowNs() - q.events.front().first));
+                    }
+                    q.events.pop_front();
+                    got++;
+                }
+            }
+            std::lock_guard<std::mutex> lock(result_mutex);
+            result.delivered += got;
+            result.latency_ns.insert(result.latency_ns.end(), samples.begin(), samples.end());
+        });
+    }
+    for (uint32_t p = 0; p < producers; p++) {
+        threads.emplace_back([&callbacks, events] {
+            uint8_t event[EVENT_SIZE] = {0};
+            for (uint32_t i = 0; i < events; i++) {
+                std::memcpy(event, &i, sizeof(i));
+                uint64_t ts = nowNs();
+                for (auto& cb : callbacks) {
+                    cb(ts, event, sizeof(event));
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    result.secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return result;
+}
+
+// ============================================================================
+// TelemetryBus
+// ============================================================================
+
+void publishAll(TelemetryBus& bus, uint32_t events) {
+    uint8_t event[EVENT_SIZE] = {0};
+    for (uint32_t i = 0; i < events; i++) {
+        std::memcpy(event, &i, sizeof(i));
+        while (!bus.publish(TOPIC_DIAGNOSTIC_RESPONSE, event, sizeof(event))) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Drains `expected` events; latency is sampled against the slot timestamp
+void drain(TelemetrySubscription& sub, uint64_t expected, Result& out) {
+    uint64_t got = 0;
+    uint64_t checksum = 0;
+    while (got < expected) {
+        if (!sub.waitFor(std::chrono::milliseconds(100))) {
+            continue;
+        }
+        got += sub.poll([&](const BusMessageView& view) {
+            checksum += view.data[0];
+            if ((view.sequence & 63) == 0) {
+                out.latency_ns.push_back(static_cast<uint32_t>(nowNs() - view.publish_ns));
+            }
+        }, 256);
+    }
+    out.delivered = got + (checksum & 0);
+}
+
+Result runBus(uint32_t events, uint32_t producers, uint32_t subscribers) {
+    TelemetryBus bus;
+    bus.open();
+    std::vector<TelemetrySubscription> subs;
+    for (uint32_t s = 0; s < subscribers; s++) {
+        subs.push_back(bus.subscribe());
+    }
+
+    uint64_t expected = static_cast<uint64_t>(events) * producers;
+    std::vector<Result> partial(subscribers);
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (uint32_t s = 0; s < subscribers; s++) {
+        threads.emplace_back([&subs, &partial, s, expected] { drain(subs[s], expected, partial[s]); });
+    }
+    for (uint32_t p = 0; p < producers; p++) {
+        threads.emplace_back([&bus, events] { publishAll(bus, events); });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    Result result;
+    result.secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    for (auto& r : partial) {
+        result.delivered += r.delivered;
+        result.latency_ns.insert(result.latency_ns.end(), r.latency_ns.begin(), r.latency_ns.end());
+    }
+    TelemetryBusStats stats = bus.getStats();
+    if (stats.published != expected) {
+        std::cerr << "bus: published " << stats.published << " of " << expected << std::endl;
+    }
+    return result;
+}
+
+// Subscribers live in a forked child and report back through a pipe
+Result runSharedBus(uint32_t events, uint32_t producers, uint32_t subscribers) {
+    Result result;
+    const std::string name = "/vmg_bus_bench_" + std::to_string(getpid());
+    TelemetryBusConfig config;
+    config.shm_name = name;
+    TelemetryBus bus(config);
+    if (!bus.open()) {
+        return result;
+    }
+
+    int ready_pipe[2];
+    int result_pipe[2];
+    if (pipe(ready_pipe) != 0 || pipe(result_pipe) != 0) {
+        return result;
+    }
+    uint64_t expected = static_cast<uint64_t>(events) * producers;
+
+    pid_t child = fork();
+    if (child == 0) {
+        TelemetryBus child_bus(config);
+        child_bus.open();
+        std::vector<TelemetrySubscription> subs;
+        for (uint32_t s = 0; s < subscribers; s++) {
+            subs.push_back(child_bus.subscribe());
+        }
+        char ok = 1;
+        if (write(ready_pipe[1], &ok, 1) != 1) {
+            _exit(1);
+        }
+
+        std::vector<Result> partial(subscribers);
+        std::vector<std::thread> threads;
+        for (uint32_t s = 0; s < subscribers; s++) {
+            threads.emplace_back([&subs, &partial, s, expected] { drain(subs[s], expected, partial[s]); });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        std::vector<uint32_t> samples;
+        uint64_t delivered = 0;
+        for (auto& r : partial) {
+            delivered += r.delivered;
+            samples.insert(samples.end(), r.latency_ns.begin(), r.latency_ns.end());
+        }
+        uint64_t count = samples.size();
+        bool sent = write(result_pipe[1], &delivered, sizeof(delivered)) == sizeof(delivered) &&
+                    write(result_pipe[1], &count, sizeof(count)) == sizeof(count) &&
+                    write(result_pipe[1], samples.data(), count * sizeof(uint32_t)) ==
+                        static_cast<ssize_t>(count * sizeof(uint32_t));
+        _exit(sent ? 0 : 1);
+    }
+
+    char ok = 0;
+    if (read(ready_pipe[0], &ok, 1) != 1) {
+        return result;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (uint32_t p = 0; p < producers; p++) {
+        threads.emplace_back([&bus, events] { publishAll(bus, events); });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    uint64_t count = 0;
+    if (read(result_pipe[0], &result.delivered, sizeof(result.delivered)) == sizeof(result.delivered) &&
+        read(result_pipe[0], &count, sizeof(count)) == sizeof(count)) {
+        result.secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        result.latency_ns.resize(count);
+        size_t off = 0;
+        while (off < count * sizeof(uint32_t)) {
+            ssize_t n = read(result_pipe[0], reinterpret_cast<uint8_t*>(result.latency_ns.data()) + off,
+                             count * sizeof(uint32_t) - off);
+            if (n <= 0) {
+                break;
+            }
+            off += static_cast<size_t>(n);
+        }
+    }
+    waitpid(child, nullptr, 0);
+    bus.close();
+    TelemetryBus::unlink(name);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t events = (argc > 1) ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 500000u;
+    uint32_t producers = (argc > 2) ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 2u;
+    uint32_t subscribers = (argc > 3) ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 3u;
+    if (events == 0 || producers == 0 || subscribers == 0 || subscribers > TelemetryBus::MAX_SUBSCRIBERS) {
+        std::cerr << "Usage: " << argv[0] << " [events per producer] [producers] [subscribers <= "
+                  << TelemetryBus::MAX_SUBSCRIBERS << "]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Telemetry bus benchmark (" << producers << " producers x " << events
+              << " events of " << EVENT_SIZE << " B, " << subscribers << " subscribers)" << std::endl;
+    std::cout << "  " << std::left << std::setw(16) << "case" << std::right
+              << std::setw(14) << "deliveries/s" << std::setw(10) << "p50 ns" << std::setw(10)
+              << "p99 ns" << std::endl;
+
+    Result callbacks = runCallbacks(events, producers, subscribers);
+    report("callbacks", callbacks);
+    Result bus = runBus(events, producers, subscribers);
+    report("bus", bus);
+    Result shared = runSharedBus(events, producers, subscribers);
+    if (shared.secs > 0) {
+        report("bus (shm)", shared);
+    } else {
+        std::cout << "  bus (shm)       skipped (shm_open/fork failed)" << std::endl;
+    }
+
+    uint64_t expected = static_cast<uint64_t>(events) * producers * subscribers;
+    if (callbacks.delivered != expected || bus.delivered != expected ||
+        (shared.secs > 0 && shared.delivered != expected)) {
+        std::cerr << "delivery mismatch (expected " << expected << ")" << std::endl;
+        return 1;
+    }
+    return 0;
+}
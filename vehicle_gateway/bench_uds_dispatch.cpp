@@ -0,0 +1,274 @@
+/**
+ * @file bench_uds_dispatch.cpp
+ * @brief UDSServiceHandler dispatch benchmark (0x22 / 0x3E mix, multi-DID read)
+ *
+ * Replays a gateway-local request mix (ReadDataByIdentifier VIN/serial/
+ * SW version and TesterPresent) and reports requests/sec and heap
+ * allocations per request for:
+ *   - buffer:  table dispatch into a caller buffer
+ *   - vector:  table dispatch through the std::vector overload
+ *   - legacy:  previous switch + vector-building path, kept as baseline
+ *
+ * Then reads 20 DIDs as one multi-DID 0x22 request against 20 single-DID
+ * requests (DIDs/sec, response bytes).
+ *
+ * Usage: ./uds_dispatch_bench [requests]
+ */
+
+#include "include/uds_service_handler.hpp"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+using namespace vmg;
+
+// Count every heap allocation made by the process. The scalar and array
+// forms are all replaced so each delete matches its new; noinline keeps
+// GCC from pairing an inlined free() with the allocation site
+// (-Wmismatched-new-delete).
+static std::atomic<uint64_t> g_allocations{0};
+
+__attribute__((noinline)) void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p) noexcept {
+    ::operator delete(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p, size_t) noexcept {
+    ::operator delete(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Previous processRequest for 0x22 / 0x3E, kept as baseline
+class LegacyHandler {
+public:
+    std::vector<uint8_t> processRequest(const std::vector<uint8_t>& request) {
+        if (request.empty()) {
+            return {0x7F, 0x00, 0x13};
+        }
+        switch (request[0]) {
+            case 0x22: return handleReadDataByIdentifier(request);
+            case 0x3E: return handleTesterPresent(request);
+            default:   return {0x7F, request[0], 0x11};
+        }
+    }
+
+private:
+    std::vector<uint8_t> handleTesterPresent(const std::vector<uint8_t>& request) {
+        if (request.size() < 2) {
+            return {0x7F, request[0], 0x13};
+        }
+        return buildPositiveResponse(request[0], {request[1]});
+    }
+
+    std::vector<uint8_t> handleReadDataByIdentifier(const std::vector<uint8_t>& request) {
+        if (request.size() < 3) {
+            return {0x7F, request[0], 0x13};
+        }
+        uint16_t did = (static_cast<uint16_t>(request[1]) << 8) | request[2];
+
+        std::string data_str;
+        switch (did) {
+            case 0xF190: data_str = vin_; data_str.resize(17, ' '); break;
+            case 0xF18C: data_str = ecu_serial_; break;
+            case 0xF195: data_str = software_version_; break;
+            default:     return {0x7F, request[0], 0x31};
+        }
+
+        std::vector<uint8_t> response_data = {
+            static_cast<uint8_t>(did >> 8),
+            static_cast<uint8_t>(did & 0xFF)
+        };
+        response_data.insert(response_data.end(), data_str.begin(), data_str.end());
+        return buildPositiveResponse(request[0], response_data);
+    }
+
+    std::vector<uint8_t> buildPositiveResponse(uint8_t sid, const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> response(1 + data.size());
+        response[0] = static_cast<uint8_t>(sid + 0x40);
+        std::copy(data.begin(), data.end(), response.begin() + 1);
+        return response;
+    }
+
+    std::string vin_ = "WBADT43452G296403";
+    std::string ecu_serial_ = "ECU123456789";
+    std::string software_version_ = "v1.0.0";
+};
+
+struct Result {
+    double per_sec = 0;
+    double allocs_per_request = 0;
+    uint64_t checksum = 0;
+};
+
+// 0x22 VIN, 0x3E, 0x22 serial, 0x3E, 0x22 SW version, 0x3E 0x80
+const std::vector<std::vector<uint8_t>>& requestMix() {
+    static const std::vector<std::vector<uint8_t>> mix = {
+        {0x22, 0xF1, 0x90},
+        {0x3E, 0x00},
+        {0x22, 0xF1, 0x8C},
+        {0x3E, 0x00},
+        {0x22, 0xF1, 0x95},
+        {0x3E, 0x80},
+    };
+    return mix;
+}
+
+template <typename Fn>
+Result run(uint32_t requests, Fn&& process) {
+    const auto& mix = requestMix();
+    Result r;
+
+    uint64_t allocs_before = g_allocations.load();
+    auto t0 = Clock::now();
+    for (uint32_t i = 0; i < requests; i++) {
+        r.checksum += process(mix[i % mix.size()]);
+    }
+    auto t1 = Clock::now();
+    uint64_t allocs = g_allocations.load() - allocs_before;
+
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+    r.per_sec = secs > 0 ? requests / secs : 0;
+    r.allocs_per_request = static_cast<double>(allocs) / requests;
+    return r;
+}
+
+uint64_t sum(const uint8_t* data, size_t len) {
+    uint64_t s = len;
+    for (size_t i = 0; i < len; i++) {
+        s += data[i];
+    }
+    return s;
+}
+
+void print(const char* name, const Result& r) {
+    std::cout << "  " << std::left << std::setw(8) << name << std::right
+              << std::setw(14) << std::fixed << std::setprecision(0) << r.per_sec
+              << std::setw(14) << std::setprecision(2) << r.allocs_per_request << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t requests = (argc > 1) ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 10000000u;
+    if (requests == 0) {
+        std::cerr << "Usage: " << argv[0] << " [requests]" << std::endl;
+        return 1;
+    }
+
+    UDSServiceHandler handler;
+    LegacyHandler legacy;
+    uint8_t response[UDSServiceHandler::MAX_RESPONSE_SIZE];
+
+    // All three paths must produce identical responses
+    for (const auto& request : requestMix()) {
+        size_t len = handler.processRequest(ConstByteSpan(request), response, sizeof(response));
+        std::vector<uint8_t> expected = legacy.processRequest(request);
+        if (std::vector<uint8_t>(response, response + len) != expected ||
+            handler.processRequest(request) != expected) {
+            std::cerr << "Response mismatch for SID 0x" << std::hex
+                      << static_cast<int>(request[0]) << std::endl;
+            return 1;
+        }
+    }
+
+    Result buffer = run(requests, [&](const std::vector<uint8_t>& request) {
+        size_t len = handler.processRequest(ConstByteSpan(request), response, sizeof(response));
+        return sum(response, len);
+    });
+    Result vector = run(requests, [&](const std::vector<uint8_t>& request) {
+        std::vector<uint8_t> r = handler.processRequest(request);
+        return sum(r.data(), r.size());
+    });
+    Result baseline = run(requests, [&](const std::vector<uint8_t>& request) {
+        std::vector<uint8_t> r = legacy.processRequest(request);
+        return sum(r.data(), r.size());
+    });
+
+    if (buffer.checksum != vector.checksum || buffer.checksum != baseline.checksum) {
+        std::cerr << "Checksum mismatch" << std::endl;
+        return 1;
+    }
+
+    std::cout << "UDS dispatch benchmark (" << requests << " requests, 0x22/0x3E mix)" << std::endl;
+    std::cout << "  " << std::left << std::setw(8) << "" << std::right
+              << std::setw(14) << "req/s" << std::setw(14) << "allocs/req" << std::endl;
+    print("buffer", buffer);
+    print("vector", vector);
+    print("legacy", baseline);
+
+    // 20 DIDs: the four built-ins repeated
+    static const uint8_t dids[][2] = {{0xF1, 0x90}, {0xF1, 0x8C}, {0xF1, 0x95}, {0xF1, 0x91}};
+    const size_t did_count = 20;
+    std::vector<uint8_t> multi = {0x22};
+    for (size_t i = 0; i < did_count; i++) {
+        multi.push_back(dids[i % 4][0]);
+        multi.push_back(dids[i % 4][1]);
+    }
+
+    size_t multi_len = handler.processRequest(ConstByteSpan(multi), response, sizeof(response));
+    size_t single_len = 0;
+    for (size_t i = 0; i < did_count; i++) {
+        const uint8_t single[] = {0x22, dids[i % 4][0], dids[i % 4][1]};
+        single_len += handler.processRequest(ConstByteSpan(single), response, sizeof(response));
+    }
+    if (multi_len != single_len - (did_count - 1)) {
+        std::cerr << "Multi-DID response length mismatch" << std::endl;
+        return 1;
+    }
+
+    uint32_t rounds = requests / did_count;
+    uint64_t sink = 0;
+    auto t0 = Clock::now();
+    for (uint32_t r = 0; r < rounds; r++) {
+        sink += handler.processRequest(ConstByteSpan(multi), response, sizeof(response));
+    }
+    auto t1 = Clock::now();
+    for (uint32_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < did_count; i++) {
+            const uint8_t single[] = {0x22, dids[i % 4][0], dids[i % 4][1]};
+            sink += handler.processRequest(ConstByteSpan(single), response, sizeof(response));
+        }
+    }
+    auto t2 = Clock::now();
+    if (sink == 0) {
+        std::cerr << "unexpected empty response" << std::endl;
+    }
+
+    double dids_total = static_cast<double>(rounds) * did_count;
+    std::cout << std::endl << "Read " << did_count << " DIDs" << std::endl;
+    std::cout << "  " << std::left << std::setw(8) << "" << std::right
+              << std::setw(14) << "DIDs/s" << std::setw(14) << "requests" << std::setw(14) << "bytes" << std::endl;
+    std::cout << "  " << std::left << std::setw(8) << "multi" << std::right << std::setprecision(0)
+              << std::setw(14) << dids_total / std::chrono::duration<double>(t1 - t0).count()
+              << std::setw(14) << 1 << std::setw(14) << multi_len << std::endl;
+    std::cout << "  " << std::left << std::setw(8) << "single" << std::right
+              << std::setw(14) << dids_total / std::chrono::duration<double>(t2 - t1).count()
+              << std::setw(14) << did_count << std::setw(14) << single_len << std::endl;
+    return 0;
+}
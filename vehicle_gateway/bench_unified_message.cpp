@@ -0,0 +1,230 @@
+/**
+ * @file bench_unified_message.cpp
+ * @brief UnifiedMessage wire format benchmark (JSON vs binary codec)
+ *
+ * Round-trips SENSOR_DATA and HEARTBEAT messages and reports encoded
+ * size and encode/decode throughput for each format, then measures
+ * message construction rate (ID + timestamp generation) across threads
+ * and envelope decode cost (type/entity lookup) on pre-parsed JSON.
+ *
+ * Usage: ./unified_message_bench [iterations] [max_threads]
+ */
+
+#include "include/unified_message_codec.hpp"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace vmg;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+UnifiedMessage makeSensorData() {
+    UnifiedMessage msg(MessageType::SENSOR_DATA);
+    msg.setSource({EntityType::ECU, "TC375-SIM-001-20251030"});
+    msg.setTarget({EntityType::VMG, "VMG-001"});
+    msg.setPayload({
+        {"sensor_id", "wheel_speed_fl"},
+        {"value", 87.25},
+        {"unit", "km/h"},
+        {"sequence", 123456}
+    });
+    return msg;
+}
+
+UnifiedMessage makeHeartbeat() {
+    return MessageBuilder::createHeartbeat("TC375-SIM-001-20251030");
+}
+
+struct Result {
+    size_t bytes = 0;
+    double encode_per_sec = 0;
+    double decode_per_sec = 0;
+};
+
+double perSecond(int iterations, Clock::time_point start, Clock::time_point end) {
+    double secs = std::chrono::duration<double>(end - start).count();
+    return secs > 0 ? iterations / secs : 0;
+}
+
+Result benchJson(const UnifiedMessage& msg, int iterations, int indent) {
+    Result r;
+    std::string encoded;
+
+    auto t0 = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        encoded = msg.toJson().dump(indent);
+    }
+    auto t1 = Clock::now();
+    size_t sink = 0;
+    for (int i = 0; i < iterations; i++) {
+        sink += UnifiedMessage::fromJson(json::parse(encoded)).getMessageId().size();
+    }
+    auto t2 = Clock::now();
+
+    if (sink == 0) std::cerr << "unexpected empty decode" << std::endl;
+    r.bytes = encoded.size();
+    r.encode_per_sec = perSecond(iterations, t0, t1);
+    r.decode_per_sec = perSecond(iterations, t1, t2);
+    return r;
+}
+
+Result benchBinary(const UnifiedMessage& msg, int iterations) {
+    Result r;
+    std::vector<uint8_t> encoded;
+
+    auto t0 = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        encoded = UnifiedMessageCodec::encodeBinary(msg);
+    }
+    auto t1 = Clock::now();
+    size_t sink = 0;
+    for (int i = 0; i < iterations; i++) {
+        sink += UnifiedMessageCodec::decodeBinary(encoded).getMessageId().size();
+    }
+    auto t2 = Clock::now();
+
+    if (sink == 0) std::cerr << "unexpected empty decode" << std::endl;
+    r.bytes = encoded.size();
+    r.encode_per_sec = perSecond(iterations, t0, t1);
+    r.decode_per_sec = perSecond(iterations, t1, t2);
+    return r;
+}
+
+void printRow(const std::string& format, const Result& r) {
+    std::cout << "  " << std::left << std::setw(14) << format
+              << std::right << std::setw(8) << r.bytes << " B"
+              << std::setw(14) << static_cast<uint64_t>(r.encode_per_sec) << " enc/s"
+              << std::setw(14) << static_cast<uint64_t>(r.decode_per_sec) << " dec/s"
+              << std::endl;
+}
+
+void runCase(const std::string& title, UnifiedMessage msg, int iterations) {
+    MessageMetadata meta;
+    meta.protocol_version = UnifiedMessageCodec::PROTOCOL_VERSION_BINARY;
+    msg.setMetadata(meta);
+
+    // Sanity check: binary round-trip must be lossless
+    if (UnifiedMessageCodec::decodeBinary(UnifiedMessageCodec::encodeBinary(msg)).toJson()
+            != msg.toJson()) {
+        std::cerr << "Round-trip mismatch for " << title << std::endl;
+        std::exit(1);
+    }
+
+    std::cout << "\n" << title << " (" << iterations << " iterations)" << std::endl;
+    printRow("JSON dump(2)", benchJson(msg, iterations, 2));
+    printRow("JSON compact", benchJson(msg, iterations, -1));
+    printRow("Binary", benchBinary(msg, iterations));
+}
+
+// Previous stringToMessageType (linear if-chain), kept as decode baseline
+MessageType legacyStringToMessageType(const std::string& str) {
+    if (str == "DEVICE_REGISTRATION") return MessageType::DEVICE_REGISTRATION;
+    if (str == "DEVICE_REGISTRATION_ACK") return MessageType::DEVICE_REGISTRATION_ACK;
+    if (str == "HEARTBEAT") return MessageType::HEARTBEAT;
+    if (str == "SENSOR_DATA") return MessageType::SENSOR_DATA;
+    if (str == "STATUS_REPORT") return MessageType::STATUS_REPORT;
+    if (str == "WAKEUP") return MessageType::WAKEUP;
+    if (str == "WAKEUP_ACK") return MessageType::WAKEUP_ACK;
+    if (str == "REQUEST_VCI") return MessageType::REQUEST_VCI;
+    if (str == "VCI_REPORT") return MessageType::VCI_REPORT;
+    if (str == "REQUEST_READINESS") return MessageType::REQUEST_READINESS;
+    if (str == "READINESS_RESPONSE") return MessageType::READINESS_RESPONSE;
+    if (str == "OTA_DOWNLOAD_PROGRESS") return MessageType::OTA_DOWNLOAD_PROGRESS;
+    if (str == "OTA_UPDATE_RESULT") return MessageType::OTA_UPDATE_RESULT;
+    if (str == "COMMAND_ACK") return MessageType::COMMAND_ACK;
+    if (str == "ERROR") return MessageType::ERROR;
+    return MessageType::ERROR;
+}
+
+void runDecode(int iterations) {
+    std::cout << "\nDecode (" << iterations << " iterations)" << std::endl;
+
+    // All type names, so the if-chain baseline is measured over its average depth
+    std::vector<std::string> names;
+    for (size_t i = 0; i <= static_cast<size_t>(MessageType::ERROR); i++) {
+        names.emplace_back(UnifiedMessage::messageTypeToString(static_cast<MessageType>(i)));
+    }
+
+    size_t sink = 0;
+    auto t0 = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sink += static_cast<size_t>(legacyStringToMessageType(names[i % names.size()]));
+    }
+    auto t1 = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sink += static_cast<size_t>(UnifiedMessage::stringToMessageType(names[i % names.size()]));
+    }
+    auto t2 = Clock::now();
+
+    json tree = makeSensorData().toJson();
+    auto t3 = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sink += static_cast<size_t>(UnifiedMessage::fromJson(tree).getSource().entity);
+    }
+    auto t4 = Clock::now();
+
+    if (sink == 0) std::cerr << "unexpected empty decode" << std::endl;
+    std::cout << "  type lookup (if-chain)  " << std::setw(14)
+              << static_cast<uint64_t>(perSecond(iterations, t0, t1)) << " /s" << std::endl;
+    std::cout << "  type lookup (perfect)   " << std::setw(14)
+              << static_cast<uint64_t>(perSecond(iterations, t1, t2)) << " /s" << std::endl;
+    std::cout << "  fromJson (parsed tree)  " << std::setw(14)
+              << static_cast<uint64_t>(perSecond(iterations, t3, t4)) << " /s" << std::endl;
+}
+
+void runConstruction(int iterations, unsigned max_threads) {
+    std::cout << "\nConstruction (" << iterations << " messages per thread)" << std::endl;
+
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        std::vector<std::thread> workers;
+        std::vector<size_t> sinks(threads, 0);
+
+        auto start = Clock::now();
+        for (unsigned t = 0; t < threads; t++) {
+            workers.emplace_back([&sinks, t, iterations]() {
+                size_t sink = 0;
+                for (int i = 0; i < iterations; i++) {
+                    UnifiedMessage msg(MessageType::HEARTBEAT);
+                    sink += msg.getMessageId().size();
+                }
+                sinks[t] = sink;
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        auto end = Clock::now();
+
+        std::cout << "  " << std::setw(3) << threads << " thread(s)"
+                  << std::setw(14) << static_cast<uint64_t>(
+                         perSecond(iterations * static_cast<int>(threads), start, end))
+                  << " msg/s" << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int iterations = (argc > 1) ? std::atoi(argv[1]) : 100000;
+    unsigned max_threads = (argc > 2) ? static_cast<unsigned>(std::atoi(argv[2]))
+                                      : std::max(1u, std::thread::hardware_concurrency());
+    if (iterations <= 0 || max_threads == 0) {
+        std::cerr << "Usage: " << argv[0] << " [iterations] [max_threads]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "UnifiedMessage wire format benchmark" << std::endl;
+    runCase("SENSOR_DATA", makeSensorData(), iterations);
+    runCase("HEARTBEAT", makeHeartbeat(), iterations);
+    runDecode(iterations);
+    runConstruction(iterations, max_threads);
+
+    return 0;
+}
@@ -4,16 +4,52 @@
  * 
  * Demonstrates how to use the DoIP server for VMG (Vehicle Gateway).
  * This example mirrors the Python DoIPServer usage.
+ *
+ * Usage: ./vmg_doip_server_plain [--capture <trace file>] [--bus <shm name>]
+ *   --capture  record all DoIP traffic for tools/doip_replay
+ *   --bus      publish UDS responses on the VMG telemetry bus (e.g. /vmg_telemetry)
  */
 
 #include "include/doip_server.hpp"
 #include "include/uds_service_handler.hpp"
+#include "include/dtc_store.hpp"
+#include "include/security_access.hpp"
+#include "include/telemetry_bus.hpp"
+#include "include/unified_message.hpp"
+#include "zone_vci_codec.hpp"
+#include "uds_standard.h"
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <map>
 #include <signal.h>
 #include <unistd.h>
 
 using namespace vmg;
 
+// VCI_REPORT payload for the uplink: zone status plus its ECU list
+static json zoneVCIToJson(const ZoneVCIData& vci) {
+    json ecus = json::array();
+    for (const auto& ecu : vci.ecus) {
+        ecus.push_back({
+            {"ecu_id", ecu.ecu_id},
+            {"logical_address", ecu.logical_address},
+            {"firmware_version", ecu.firmware_version},
+            {"hardware_version", ecu.hardware_version},
+            {"online", ecu.is_online},
+            {"ota_capable", ecu.ota_capable}
+        });
+    }
+    return {
+        {"zone_id", vci.zone_id},
+        {"generation", vci.generation},
+        {"total_storage_mb", vci.total_storage_mb},
+        {"available_storage_mb", vci.available_storage_mb},
+        {"battery_level", vci.average_battery_level},
+        {"ecus", ecus}
+    };
+}
+
 // Global server instance for signal handler
 DoIPServer* g_server = nullptr;
 
@@ -26,7 +62,21 @@ void signalHandler(int signal) {
     }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    std::string capture_path;
+    std::string bus_name;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--capture" && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else if (arg == "--bus" && i + 1 < argc) {
+            bus_name = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--capture <trace file>] [--bus <shm name>]" << std::endl;
+            return 1;
+        }
+    }
+
     std::cout << "=== VMG DoIP Server Example ===" << std::endl;
     std::cout << std::endl;
 
@@ -54,15 +104,90 @@ int main() {
     uds_handler.setSoftwareVersion("v1.2.3");
     uds_handler.setHardwareVersion("HW_REV_B");
 
+    // DTC memory for 0x19 / 0x14 (log kept next to the binary for this example)
+    DTCStoreConfig dtc_config;
+    dtc_config.log_path = "vmg_dtc.log";
+    DTCStore dtc_store(dtc_config);
+    if (dtc_store.open()) {
+        uds_handler.attachDTCStore(&dtc_store);
+    }
+
+    // SecurityAccess 0x27 level 0x01: HMAC-SHA256 key over a 16-byte seed
+    // (EXAMPLE secret; provision per vehicle from secure storage in production)
+    SecurityAccessEngine security_engine;
+    security_engine.setLevelSecret(0x01, {0x56, 0x4D, 0x47, 0x2D, 0x4C, 0x31, 0x2D, 0x53,
+                                          0x45, 0x43, 0x52, 0x45, 0x54, 0x2D, 0x30, 0x31});
+    uds_handler.attachSecurityEngine(&security_engine);
+
     // Register custom DID handlers (optional)
-    uds_handler.registerDIDReadHandler(0xF1A0, [](uint16_t did) -> std::vector<uint8_t> {
+    uds_handler.registerDIDReadHandler(0xF1A0, [](uint16_t) -> std::vector<uint8_t> {
         std::string custom_data = "Custom Data";
         return std::vector<uint8_t>(custom_data.begin(), custom_data.end());
     });
 
+    // Periodic DIDs for 0x2A (PDID n = DID 0xF200 | n): live values for dashboards
+    auto start_time = std::chrono::steady_clock::now();
+    uds_handler.registerDIDReadHandler(0xF201, [start_time](uint16_t) -> std::vector<uint8_t> {
+        auto uptime = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+        return {static_cast<uint8_t>(uptime >> 24), static_cast<uint8_t>(uptime >> 16),
+                static_cast<uint8_t>(uptime >> 8), static_cast<uint8_t>(uptime)};
+    });
+    uds_handler.registerDIDReadHandler(0xF202, [&server](uint16_t) -> std::vector<uint8_t> {
+        return {static_cast<uint8_t>(std::min<size_t>(server.getActiveConnections(), 0xFF))};
+    });
+
+    // Telemetry bus shared with vmg_gateway: diagnostic responses and zone
+    // VCI reports go to the uplink
+    TelemetryBusConfig bus_config;
+    bus_config.shm_name = bus_name;
+    TelemetryBus bus(bus_config);
+    if (!bus_name.empty() && !bus.open()) {
+        std::cerr << "Telemetry bus unavailable, continuing without it" << std::endl;
+    }
+
+    // Zone VCI reports (0x2E F1A1) from the zonal gateways: one copy per zone.
+    // 0x6E tells the ZG the generation landed; NRC 0x22 (delta against a
+    // copy we do not hold) makes it resend a full snapshot. ZGs authenticate
+    // at the DoIP/TLS layer, so no SecurityAccess is required.
+    // (UDS calls are serialized by the server; no extra lock)
+    std::map<uint8_t, ZoneVCIData> zones;
+    uds_handler.registerDIDWriteHandler(UDS_DID_ZONE_VCI_REPORT, [&zones, &bus](uint16_t, ConstByteSpan data) {
+        uint8_t zone_id = 0;
+        if (!ZoneVCICodec::reportZoneID(data.data(), data.size(), zone_id)) {
+            return false;
+        }
+        ZoneVCIData& vci = zones[zone_id];
+        if (!ZoneVCICodec::applyReport(data.data(), data.size(), vci)) {
+            std::cerr << "Zone " << static_cast<int>(zone_id) << " VCI report rejected (have generation "
+                      << vci.generation << ")" << std::endl;
+            return false;
+        }
+        std::cout << "Zone " << static_cast<int>(zone_id) << " VCI: " << vci.ecus.size()
+                  << " ECUs, generation " << vci.generation << std::endl;
+        if (bus.isOpen()) {
+            bus.publish(MessageBuilder::createVCIReport("zone-" + std::to_string(zone_id), zoneVCIToJson(vci)));
+        }
+        return true;
+    }, false);
+
     // Register UDS handler with DoIP server
-    server.registerUDSHandler([&uds_handler](const std::vector<uint8_t>& request) {
-        return uds_handler.processRequest(request);
+    // Event = tester address + response, built in a buffer reused across
+    // calls; ones larger than a slot are rejected by publish() and counted
+    // as oversize
+    std::vector<uint8_t> event;
+    server.registerTesterUDSHandler([&uds_handler, &bus, &event](uint16_t tester, const std::vector<uint8_t>& request) {
+        uds_handler.setTesterAddress(tester);
+        std::vector<uint8_t> response = uds_handler.processRequest(request);
+        if (bus.isOpen() && !response.empty()) {
+            event.assign({static_cast<uint8_t>(tester >> 8), static_cast<uint8_t>(tester)});
+            event.insert(event.end(), response.begin(), response.end());
+            bus.publish(TOPIC_DIAGNOSTIC_RESPONSE, event.data(), event.size());
+        }
+        return response;
+    });
+    server.registerPeriodicSource([&uds_handler](uint16_t tester, uint64_t now_ms, uint64_t& next_due_ms) {
+        return uds_handler.collectPeriodicFrame(tester, now_ms, next_due_ms);
     });
 
     // Setup signal handlers
@@ -75,6 +200,10 @@ int main() {
         std::cerr << "Failed to start server" << std::endl;
         return 1;
     }
+    if (!capture_path.empty() && !server.startCapture(capture_path)) {
+        server.stop();
+        return 1;
+    }
 
     std::cout << std::endl;
     std::cout << "Server is running. Press Ctrl+C to stop." << std::endl;
@@ -94,7 +223,17 @@ int main() {
         uint64_t total_msgs = server.getTotalMessages();
         
         std::cout << "[Stats] Active connections: " << active_conns 
-                  << ", Total messages: " << total_msgs << std::endl;
+                  << ", Total messages: " << total_msgs
+                  << ", Periodic frames: " << server.getPeriodicFrames() << std::endl;
+
+        SecurityLevelStats level1 = security_engine.getStats(0x01);
+        if (level1.seeds > 0) {
+            std::cout << "[Stats] Security L1: seeds=" << level1.seeds
+                      << " (pool misses " << level1.pool_misses << ", avg "
+                      << level1.seed_ns / level1.seeds << " ns), unlocks=" << level1.unlocks
+                      << ", invalid keys=" << level1.invalid_keys
+                      << ", lockouts=" << level1.lockouts << std::endl;
+        }
     }
 
     std::cout << "Server stopped." << std::endl;
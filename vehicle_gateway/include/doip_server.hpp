@@ -17,7 +17,9 @@
 #include <atomic>
 #include <map>
 #include <mutex>
+#include <condition_variable>
 #include <cstdint>
+#include "doip_trace.h"
 
 namespace vmg {
 
@@ -92,12 +94,19 @@ public:
     void setRoutingActive(bool active) { routing_active_ = active; }
     uint16_t getSourceAddress() const { return source_address_; }
     void setSourceAddress(uint16_t addr) { source_address_ = addr; }
+    uint32_t getTraceId() const { return trace_id_; }
+    void setTraceId(uint32_t id) { trace_id_ = id; }
+
+    // Serializes sends from the client thread and the periodic thread
+    std::mutex& getSendMutex() { return send_mutex_; }
 
 private:
     int socket_;
     std::string address_;
     bool routing_active_;
     uint16_t source_address_;
+    uint32_t trace_id_;  // Connection id in capture traces
+    std::mutex send_mutex_;
 };
 
 /**
@@ -105,6 +114,23 @@ private:
  */
 using UDSHandler = std::function<std::vector<uint8_t>(const std::vector<uint8_t>&)>;
 
+/**
+ * @brief UDS handler that also receives the tester logical address (SA)
+ *
+ * Needed for per-tester state such as SecurityAccess.
+ */
+using TesterUDSHandler = std::function<std::vector<uint8_t>(uint16_t tester_address, const std::vector<uint8_t>&)>;
+
+/**
+ * @brief Periodic (0x2A) frame source
+ *
+ * Called per streaming tester with the current steady-clock time in ms;
+ * returns that tester's UDS frame due now (empty if none) and sets
+ * next_due_ms to its next deadline (UINT64_MAX when nothing is scheduled).
+ */
+using PeriodicSource =
+    std::function<std::vector<uint8_t>(uint16_t tester_address, uint64_t now_ms, uint64_t& next_due_ms)>;
+
 /**
  * @brief DoIP Server Configuration
  */
@@ -137,6 +163,10 @@ public:
 
     // Register UDS handler
     void registerUDSHandler(UDSHandler handler);
+    void registerTesterUDSHandler(TesterUDSHandler handler);
+
+    // Register 0x2A frame source; each tester's frames go to the session of its last accepted 0x2A request
+    void registerPeriodicSource(PeriodicSource source);
     
     // Set custom VIN/EID/GID
     void setVIN(const std::string& vin);
@@ -144,15 +174,23 @@ public:
     void setEID(const std::vector<uint8_t>& eid);
     void setGID(const std::vector<uint8_t>& gid);
 
+    // Traffic capture to a DoIP trace (common/protocol/doip_trace.h) for tools/doip_replay.
+    // May be started/stopped while running; frames are recorded as sent/received.
+    bool startCapture(const std::string& path);
+    void stopCapture();
+    bool isCapturing() const { return std::atomic_load(&capture_) != nullptr; }
+
     // Statistics
     size_t getActiveConnections() const;
     uint64_t getTotalMessages() const { return total_messages_; }
+    uint64_t getPeriodicFrames() const { return periodic_frames_; }
 
 private:
     // Server threads
     void udpListenerThread();
     void tcpAcceptThread();
     void clientHandlerThread(std::shared_ptr<DoIPClientSession> session);
+    void periodicThread();
 
     // Message handlers
     void handleUDPMessage(const DoIPMessage& msg, const std::string& client_addr);
@@ -167,8 +205,9 @@ private:
     // Socket helpers
     int createUDPSocket();
     int createTCPSocket();
-    bool sendMessage(int socket, const DoIPMessage& msg);
+    bool sendToSession(const std::shared_ptr<DoIPClientSession>& session, const DoIPMessage& msg);
     DoIPMessage receiveMessage(int socket);
+    void captureFrame(uint32_t connection, uint8_t kind, const uint8_t* data, size_t len);
 
     // Configuration
     DoIPServerConfig config_;
@@ -180,10 +219,13 @@ private:
     // State
     std::atomic<bool> running_;
     std::atomic<uint64_t> total_messages_;
+    std::atomic<uint64_t> periodic_frames_;
+    std::atomic<uint32_t> next_trace_id_;
 
     // Threads
     std::unique_ptr<std::thread> udp_thread_;
     std::unique_ptr<std::thread> tcp_thread_;
+    std::unique_ptr<std::thread> periodic_thread_;
     std::vector<std::unique_ptr<std::thread>> client_threads_;
 
     // Client sessions
@@ -191,8 +233,21 @@ private:
     mutable std::mutex sessions_mutex_;
 
     // UDS handler
-    UDSHandler uds_handler_;
+    TesterUDSHandler uds_handler_;
     std::mutex uds_mutex_;
+
+    // Periodic (0x2A) transmission: source is called under uds_mutex_
+    struct PeriodicTarget {
+        std::weak_ptr<DoIPClientSession> session;
+        uint16_t ecu_address;
+    };
+    PeriodicSource periodic_source_;
+    std::map<uint16_t, PeriodicTarget> periodic_targets_;  // By tester address
+    std::mutex periodic_mutex_;
+    std::condition_variable periodic_cv_;
+
+    // Active capture; swapped with atomic_load/atomic_store, closed by the last user
+    std::shared_ptr<DoIPTraceWriter> capture_;
 };
 
 } // namespace vmg
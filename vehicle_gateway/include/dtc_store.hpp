@@ -0,0 +1,234 @@
+/**
+ * @file dtc_store.hpp
+ * @brief Persistent DTC memory for VMG (log-structured file)
+ *
+ * Fixed-size DTC records (status byte, occurrence counter, snapshot and
+ * extended data) kept in memory and appended to a log file on every
+ * change. Each append is fdatasync'ed before the call returns, so a DTC
+ * reported (or a 0x14 answered) survives power loss. The log is replayed
+ * on open and compacted once it holds much more entries than live records;
+ * compaction syncs the new log and its directory before replacing the old.
+ *
+ * Records are indexed by DTC number and by each status bit, so status
+ * mask queries (UDS 0x19 0x01/0x02) cost O(matches), not O(stored DTCs).
+ *
+ * Log entry (big-endian, DTC_LOG_ENTRY_SIZE bytes):
+ *   op(1) | dtc(3) | status(1) | occurrence(2) |
+ *   snapshot_len(1) snapshot(DTC_SNAPSHOT_SIZE) |
+ *   extended_len(1) extended(DTC_EXTENDED_SIZE) | checksum(4, FNV-1a)
+ *   op: 'U' upsert, 'D' delete, 'C' clear all
+ */
+
+#ifndef DTC_STORE_HPP
+#define DTC_STORE_HPP
+
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+namespace vmg {
+
+constexpr size_t DTC_SNAPSHOT_SIZE = 24;
+constexpr size_t DTC_EXTENDED_SIZE = 8;
+constexpr size_t DTC_LOG_ENTRY_SIZE = 1 + 3 + 1 + 2 + 1 + DTC_SNAPSHOT_SIZE + 1 + DTC_EXTENDED_SIZE + 4;
+constexpr uint32_t DTC_GROUP_ALL = 0xFFFFFF;
+
+/**
+ * @brief DTC status bits (ISO 14229-1 D.2)
+ */
+enum DTCStatusBit : uint8_t {
+    DTC_STATUS_TEST_FAILED = 0x01,
+    DTC_STATUS_TEST_FAILED_THIS_CYCLE = 0x02,
+    DTC_STATUS_PENDING = 0x04,
+    DTC_STATUS_CONFIRMED = 0x08,
+    DTC_STATUS_NOT_COMPLETED_SINCE_CLEAR = 0x10,
+    DTC_STATUS_FAILED_SINCE_CLEAR = 0x20,
+    DTC_STATUS_NOT_COMPLETED_THIS_CYCLE = 0x40,
+    DTC_STATUS_WARNING_INDICATOR = 0x80
+};
+
+/**
+ * @brief Stored DTC record
+ *
+ * snapshot holds the body of snapshot record 0x01 (DID(2) + data),
+ * extended the body of extended data record 0x02.
+ */
+struct DTCRecord {
+    uint32_t dtc = 0;                   // 24-bit DTC number
+    uint8_t status = 0;
+    uint16_t occurrence_count = 0;
+    uint8_t snapshot_len = 0;
+    std::array<uint8_t, DTC_SNAPSHOT_SIZE> snapshot{};
+    uint8_t extended_len = 0;
+    std::array<uint8_t, DTC_EXTENDED_SIZE> extended{};
+};
+
+/**
+ * @brief DTC store configuration
+ */
+struct DTCStoreConfig {
+    std::string log_path = "/var/lib/vmg/dtc.log";
+    size_t max_records = 4096;
+    size_t compact_min_entries = 1024;  // Compact when log > 2x live records and above this
+};
+
+/**
+ * @brief DTC store statistics
+ */
+struct DTCStoreStats {
+    uint64_t records = 0;
+    uint64_t log_entries = 0;
+    uint64_t compactions = 0;
+    uint64_t replay_errors = 0;
+};
+
+/**
+ * @brief Persistent DTC memory
+ */
+class DTCStore {
+public:
+    // Status bits this store maintains (reported as DTCStatusAvailabilityMask)
+    static constexpr uint8_t STATUS_AVAILABILITY_MASK =
+        DTC_STATUS_TEST_FAILED | DTC_STATUS_TEST_FAILED_THIS_CYCLE | DTC_STATUS_PENDING |
+        DTC_STATUS_CONFIRMED | DTC_STATUS_FAILED_SINCE_CLEAR;
+
+    explicit DTCStore(const DTCStoreConfig& config = DTCStoreConfig());
+    ~DTCStore();
+
+    /**
+     * @brief Open log file and replay stored DTCs
+     *
+     * A torn or corrupt tail (power loss during append) is dropped and
+     * the log is rewritten from the records replayed so far.
+     *
+     * @return true on success
+     */
+    bool open();
+
+    /**
+     * @brief Record a test result for a DTC
+     *
+     * A failure creates the record if needed, sets testFailed/pending/
+     * confirmed, counts the occurrence and replaces snapshot/extended
+     * data when given. A pass clears testFailed of an existing record.
+     *
+     * @return false if the store is full or the log write failed
+     */
+    bool reportTestResult(uint32_t dtc, bool failed,
+                          const uint8_t* snapshot = nullptr, size_t snapshot_len = 0,
+                          const uint8_t* extended = nullptr, size_t extended_len = 0);
+
+    /**
+     * @brief Clear DTCs (UDS 0x14)
+     *
+     * @param group DTC_GROUP_ALL or a single DTC number
+     * @param cleared Optional: number of records cleared
+     * @return false if the log write failed (memory is cleared, but the
+     *         records come back on the next open())
+     */
+    bool clear(uint32_t group, size_t* cleared = nullptr);
+
+    /**
+     * @brief Copy record of a DTC
+     *
+     * @return false if not stored
+     */
+    bool find(uint32_t dtc, DTCRecord& out) const;
+
+    /**
+     * @brief Visit records with (status & mask) != 0, O(matches)
+     *
+     * @param fn Called as fn(const DTCRecord&) with the store locked
+     * @return Number of records visited
+     */
+    template <typename Fn>
+    size_t forEachByStatusMask(uint8_t mask, Fn&& fn) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return forEachLocked(mask, fn);
+    }
+
+    size_t countByStatusMask(uint8_t mask) const;
+
+    /**
+     * @brief Write DTCAndStatusRecords (DTC(3) + status) of matching records
+     *
+     * Count and copy happen under one lock, straight into `out`.
+     *
+     * @param written Bytes written (4 per record)
+     * @return false if capacity is too small (nothing written)
+     */
+    bool writeStatusRecords(uint8_t mask, uint8_t* out, size_t capacity, size_t& written) const;
+
+    DTCStoreStats getStats() const;
+
+private:
+    static uint8_t lowestBit(uint8_t value) {
+        uint8_t bit = 0;
+        while (bit < 8 && !(value & (1u << bit))) {
+            bit++;
+        }
+        return bit;
+    }
+
+    template <typename Fn>
+    size_t forEachLocked(uint8_t mask, Fn& fn) const {
+        if (mask != 0 && (mask & (mask - 1)) == 0) {
+            // Single bit: its list is exactly the result
+            const auto& list = by_status_bit_[lowestBit(mask)];
+            for (uint32_t slot : list) {
+                fn(records_[slot]);
+            }
+            return list.size();
+        }
+        size_t count = 0;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            if (!(mask & (1u << bit))) {
+                continue;
+            }
+            for (uint32_t slot : by_status_bit_[bit]) {
+                const DTCRecord& record = records_[slot];
+                // Visit each record once, from the list of its lowest matching bit
+                if (lowestBit(record.status & mask) == bit) {
+                    fn(record);
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+
+    size_t countLocked(uint8_t mask) const;
+
+    // Callers hold mutex_
+    void upsertLocked(const DTCRecord& record);
+    void eraseLocked(uint32_t dtc);
+    void clearAllLocked();
+    void setStatusLocked(uint32_t slot, uint8_t status);
+    bool appendLocked(char op, const DTCRecord& record);
+    bool openLogLocked();
+    void closeLogLocked();
+    bool compactLocked();
+    void maybeCompactLocked();
+
+    static void encodeEntry(char op, const DTCRecord& record, uint8_t* out);
+    static bool decodeEntry(const uint8_t* in, char& op, DTCRecord& record);
+
+    DTCStoreConfig config_;
+
+    std::vector<DTCRecord> records_;
+    std::unordered_map<uint32_t, uint32_t> by_dtc_;             // DTC -> slot
+    std::array<std::vector<uint32_t>, 8> by_status_bit_;        // Slots with bit set
+    std::vector<std::array<uint32_t, 8>> bit_position_;        // Slot -> index in by_status_bit_
+
+    int log_fd_;                    // O_APPEND, -1 when closed
+    DTCStoreStats stats_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace vmg
+
+#endif // DTC_STORE_HPP
@@ -0,0 +1,245 @@
+/**
+ * @file ota_chunk_cache.hpp
+ * @brief Content-addressed OTA chunk cache for VMG
+ *
+ * OTA packages are split into fixed-size chunks identified by SHA-256.
+ * The VMG downloads each chunk from the backend once and serves it to
+ * every Zonal Gateway that needs the same firmware. Hot chunks stay in
+ * memory (size-bounded LRU), cold chunks are spilled to disk (also an
+ * LRU, bounded by max_disk_bytes).
+ */
+
+#ifndef OTA_CHUNK_CACHE_HPP
+#define OTA_CHUNK_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <array>
+#include <list>
+#include <unordered_map>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+namespace vmg {
+
+/**
+ * @brief SHA-256 digest of a chunk (content address)
+ */
+using ChunkDigest = std::array<uint8_t, 32>;
+
+struct ChunkDigestHash {
+    size_t operator()(const ChunkDigest& d) const {
+        // Digest is already uniformly distributed, first 8 bytes are enough
+        size_t h = 0;
+        for (size_t i = 0; i < sizeof(size_t); i++) {
+            h = (h << 8) | d[i];
+        }
+        return h;
+    }
+};
+
+/**
+ * @brief OTA package manifest (from OTA server)
+ */
+struct OTAPackageManifest {
+    std::string package_id;
+    uint64_t total_size = 0;
+    uint32_t chunk_size = 64 * 1024;
+    std::vector<ChunkDigest> chunks;    // In package order
+};
+
+/**
+ * @brief Chunk cache configuration
+ */
+struct OTAChunkCacheConfig {
+    size_t max_memory_bytes = 8 * 1024 * 1024;          // In-memory LRU budget
+    std::string spill_dir = "/var/lib/vmg/ota_chunks";  // Disk spill location
+    uint64_t max_disk_bytes = 512ULL * 1024 * 1024;     // 0 = unlimited
+};
+
+/**
+ * @brief Chunk cache statistics
+ */
+struct OTAChunkCacheStats {
+    uint64_t memory_hits = 0;
+    uint64_t disk_hits = 0;
+    uint64_t misses = 0;
+    uint64_t backend_fetches = 0;
+    uint64_t coalesced_fetches = 0;     // Waited on another caller's fetch of the same chunk
+    uint64_t verify_failures = 0;
+    uint64_t spills = 0;
+    uint64_t disk_evictions = 0;        // Spilled chunks dropped for disk budget
+    uint64_t memory_bytes = 0;
+    uint64_t disk_bytes = 0;
+};
+
+/**
+ * @brief Backend chunk fetcher
+ *
+ * Downloads chunk `index` of `manifest` into `out`. Returns false on failure.
+ */
+using ChunkFetcher = std::function<bool(const OTAPackageManifest& manifest,
+                                        size_t index,
+                                        std::vector<uint8_t>& out)>;
+
+/**
+ * @brief Download progress callback
+ *
+ * Called with the bytes of the package cached so far: once at the resume
+ * point, then after every chunk.
+ */
+using FetchProgress = std::function<void(const OTAPackageManifest& manifest,
+                                         uint64_t bytes_cached)>;
+
+/**
+ * @brief Content-addressed OTA Chunk Cache
+ *
+ * - Chunks are verified against their SHA-256 before being stored
+ * - Identical chunks shared by several packages are stored once
+ * - Spilled chunks survive a VMG restart, so an interrupted backend
+ *   download resumes from the first missing chunk
+ * - A missing chunk is fetched by one caller at a time; concurrent
+ *   fetchPackage() calls needing the same chunk wait for that result
+ */
+class OTAChunkCache {
+public:
+    explicit OTAChunkCache(const OTAChunkCacheConfig& config = OTAChunkCacheConfig());
+    ~OTAChunkCache() = default;
+
+    /**
+     * @brief Create spill directory and index chunks already on disk
+     *
+     * @return true on success
+     */
+    bool initialize();
+
+    /**
+     * @brief Register package manifest
+     *
+     * @param manifest Package manifest
+     * @return true if manifest is consistent (chunk count vs size)
+     */
+    bool registerManifest(const OTAPackageManifest& manifest);
+
+    /**
+     * @brief Store chunk after verifying its digest
+     *
+     * @param digest Expected SHA-256
+     * @param data Chunk data
+     * @param len Chunk length
+     * @return true if verified and stored
+     */
+    bool put(const ChunkDigest& digest, const uint8_t* data, size_t len);
+
+    /**
+     * @brief Get chunk by digest (memory first, then disk)
+     *
+     * @param digest Chunk SHA-256
+     * @param out Output chunk data
+     * @return true if found
+     */
+    bool get(const ChunkDigest& digest, std::vector<uint8_t>& out);
+
+    /**
+     * @brief Check whether chunk is cached (memory or disk)
+     */
+    bool contains(const ChunkDigest& digest) const;
+
+    /**
+     * @brief Get chunk `index` of a registered package
+     *
+     * Used by the DoIP side to serve TransferData blocks to Zonal Gateways.
+     */
+    bool readPackageChunk(const std::string& package_id, size_t index,
+                          std::vector<uint8_t>& out);
+
+    /**
+     * @brief Index of first chunk not yet cached (resume point)
+     *
+     * @return Chunk count if package is complete
+     */
+    size_t firstMissingChunk(const std::string& package_id) const;
+
+    /**
+     * @brief Check whether every chunk of a package is cached
+     */
+    bool isPackageComplete(const std::string& package_id) const;
+
+    /**
+     * @brief Download missing chunks of a package from the backend
+     *
+     * Chunks already cached (from an earlier, interrupted download or
+     * from another package sharing the same content) are skipped.
+     *
+     * @param package_id Registered package
+     * @param fetcher Backend download function
+     * @param progress Optional progress callback (OTA_DOWNLOAD_PROGRESS)
+     * @return true if package is complete afterwards
+     */
+    bool fetchPackage(const std::string& package_id, const ChunkFetcher& fetcher,
+                      const FetchProgress& progress = FetchProgress());
+
+    OTAChunkCacheStats getStats() const;
+
+    static ChunkDigest computeDigest(const uint8_t* data, size_t len);
+    static std::string digestToHex(const ChunkDigest& digest);
+    static bool hexToDigest(const std::string& hex, ChunkDigest& digest);
+
+private:
+    struct MemoryEntry {
+        std::vector<uint8_t> data;
+        std::list<ChunkDigest>::iterator lru_it;
+    };
+
+    struct DiskEntry {
+        uint64_t size;
+        std::list<ChunkDigest>::iterator lru_it;
+    };
+
+    // Backend fetch of one chunk, shared by every caller that needs it
+    struct InFlightFetch {
+        bool done = false;
+        bool ok = false;
+    };
+
+    bool fetchChunk(const OTAPackageManifest& manifest, size_t index,
+                    const ChunkFetcher& fetcher);
+
+    // Callers hold mutex_
+    bool getLocked(const ChunkDigest& digest, std::vector<uint8_t>& out);
+    void insertMemoryLocked(const ChunkDigest& digest, std::vector<uint8_t> data);
+    void evictLocked();
+    bool spillLocked(const ChunkDigest& digest, const std::vector<uint8_t>& data);
+    bool loadFromDiskLocked(const ChunkDigest& digest, std::vector<uint8_t>& out);
+    void dropDiskLocked(const ChunkDigest& digest);
+    bool containsLocked(const ChunkDigest& digest) const;
+    std::string chunkPath(const ChunkDigest& digest) const;
+
+    OTAChunkCacheConfig config_;
+
+    // Memory tier: most recently used at front
+    std::list<ChunkDigest> lru_;
+    std::unordered_map<ChunkDigest, MemoryEntry, ChunkDigestHash> memory_;
+
+    // Disk tier: most recently used at front, evicted from the back
+    // once max_disk_bytes is reached
+    std::list<ChunkDigest> disk_lru_;
+    std::unordered_map<ChunkDigest, DiskEntry, ChunkDigestHash> disk_;
+
+    std::map<std::string, OTAPackageManifest> manifests_;
+
+    // Chunks being fetched from the backend; fetch_cv_ signals completion
+    std::unordered_map<ChunkDigest, std::shared_ptr<InFlightFetch>, ChunkDigestHash> in_flight_;
+    std::condition_variable fetch_cv_;
+
+    OTAChunkCacheStats stats_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace vmg
+
+#endif // OTA_CHUNK_CACHE_HPP
@@ -0,0 +1,165 @@
+/**
+ * @file security_access.hpp
+ * @brief SecurityAccess (UDS 0x27) seed/key engine for VMG
+ *
+ * Seeds come from a pre-generated pool that a background thread refills
+ * in batches (getrandom by default, or an HSM TRNG hook), so requestSeed
+ * never waits on the RNG. Keys are HMAC-SHA256(level secret, seed)
+ * truncated to SECURITY_KEY_SIZE and compared in constant time. Failed
+ * attempts and lockout delays are tracked per tester address, counters
+ * and latencies per security level.
+ */
+
+#ifndef SECURITY_ACCESS_HPP
+#define SECURITY_ACCESS_HPP
+
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+namespace vmg {
+
+constexpr size_t SECURITY_SEED_SIZE = 16;
+constexpr size_t SECURITY_KEY_SIZE = 16;
+constexpr uint8_t SECURITY_MAX_LEVEL = 0x41;  // Highest requestSeed sub-function (ISO 14229-1)
+
+/**
+ * @brief Result of a seed or key request (mapped to NRCs by the UDS handler)
+ */
+enum class SecurityResult {
+    Ok,
+    AlreadyUnlocked,       // Seed is all zeros
+    LevelNotSupported,     // No secret / key algorithm for this level
+    SequenceError,         // sendKey without a matching seed
+    InvalidKey,
+    ExceededAttempts,      // This failure started the lockout
+    DelayNotExpired,       // Tester is locked out
+    RandomFailure
+};
+
+/**
+ * @brief Seed/key engine configuration
+ */
+struct SecurityAccessConfig {
+    size_t seed_pool_size = 64;
+    size_t seed_pool_low_water = 16;   // Refill thread wakes below this
+    uint8_t max_attempts = 3;
+    uint32_t lockout_ms = 10000;
+};
+
+/**
+ * @brief Per-level counters and latencies
+ */
+struct SecurityLevelStats {
+    uint64_t seeds = 0;
+    uint64_t pool_misses = 0;          // Seeds generated inline (pool empty)
+    uint64_t unlocks = 0;
+    uint64_t invalid_keys = 0;
+    uint64_t lockouts = 0;
+    uint64_t seed_ns = 0;              // Total requestSeed time
+    uint64_t key_ns = 0;               // Total sendKey time
+};
+
+/**
+ * @brief SecurityAccess seed/key engine
+ *
+ * Thread-safe; one instance can serve several UDS handlers.
+ */
+class SecurityAccessEngine {
+public:
+    // Fill `len` random bytes; false on failure (e.g. HSM TRNG hook)
+    using RandomSource = std::function<bool(uint8_t* out, size_t len)>;
+    // Expected key for (level, seed) into key[SECURITY_KEY_SIZE]; false if level unsupported
+    using KeyAlgorithm = std::function<bool(uint8_t level, const uint8_t* seed, uint8_t* key)>;
+
+    /**
+     * @param random Seed entropy, nullptr = getrandom()
+     */
+    explicit SecurityAccessEngine(const SecurityAccessConfig& config = SecurityAccessConfig(),
+                                  RandomSource random = nullptr);
+    ~SecurityAccessEngine();
+
+    SecurityAccessEngine(const SecurityAccessEngine&) = delete;
+    SecurityAccessEngine& operator=(const SecurityAccessEngine&) = delete;
+
+    /**
+     * @brief Enable a level with the default HMAC-SHA256 key algorithm
+     *
+     * @param level Odd requestSeed sub-function (0x01, 0x03, ...)
+     */
+    void setLevelSecret(uint8_t level, const std::vector<uint8_t>& secret);
+
+    // Replace the HMAC algorithm (e.g. HSM CMAC); applies to every level
+    void setKeyAlgorithm(KeyAlgorithm algorithm);
+
+    /**
+     * @brief requestSeed for `level` from `tester`
+     *
+     * @param seed Output, SECURITY_SEED_SIZE bytes (zeros if already unlocked)
+     */
+    SecurityResult requestSeed(uint16_t tester, uint8_t level, uint64_t now_ms, uint8_t* seed);
+
+    /**
+     * @brief sendKey for `level` (the requestSeed sub-function) from `tester`
+     */
+    SecurityResult sendKey(uint16_t tester, uint8_t level, const uint8_t* key, size_t key_len, uint64_t now_ms);
+
+    // Unlocked level of tester, 0 if locked
+    uint8_t unlockedLevel(uint16_t tester) const;
+
+    // Relock tester (session change); pending seeds are dropped, lockout kept
+    void lock(uint16_t tester);
+
+    SecurityLevelStats getStats(uint8_t level) const;
+    size_t seedPoolLevel() const;
+
+    // Expected key with the default algorithm (testers, benchmarks)
+    static bool computeHmacKey(const std::vector<uint8_t>& secret, const uint8_t* seed, uint8_t* key);
+
+    // Constant-time equality of a and b (len bytes)
+    static bool constantTimeEqual(const uint8_t* a, const uint8_t* b, size_t len);
+
+private:
+    struct TesterState {
+        uint8_t unlocked_level = 0;
+        uint8_t pending_level = 0;     // Level whose seed awaits a key, 0 = none
+        std::array<uint8_t, SECURITY_SEED_SIZE> seed{};
+        uint8_t failed_attempts = 0;
+        uint64_t locked_until_ms = 0;
+    };
+
+    using Seed = std::array<uint8_t, SECURITY_SEED_SIZE>;
+
+    void refillThread();
+    bool takeSeed(uint8_t* seed, bool& pool_hit);
+    bool expectedKey(uint8_t level, const uint8_t* seed, uint8_t* key) const;
+
+    SecurityAccessConfig config_;
+    RandomSource random_;
+
+    // Seed ring buffer (pool_mutex_)
+    std::vector<Seed> pool_;
+    size_t pool_head_;
+    size_t pool_count_;
+    bool stopping_;
+    mutable std::mutex pool_mutex_;
+    std::condition_variable refill_cv_;
+    std::thread refill_thread_;
+
+    // Testers, secrets, stats (mutex_)
+    std::unordered_map<uint16_t, TesterState> testers_;
+    std::unordered_map<uint8_t, std::vector<uint8_t>> level_secrets_;
+    KeyAlgorithm key_algorithm_;
+    std::array<SecurityLevelStats, SECURITY_MAX_LEVEL + 1> stats_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace vmg
+
+#endif // SECURITY_ACCESS_HPP
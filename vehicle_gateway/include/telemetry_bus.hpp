@@ -0,0 +1,209 @@
+/**
+ * @file telemetry_bus.hpp
+ * @brief Lock-free telemetry bus between VMG components
+ *
+ * Broadcast ring of fixed-size slots carrying UnifiedMessage-typed events
+ * (diagnostic responses, VCI updates, OTA progress, ...) from any number of
+ * publishers to up to MAX_SUBSCRIBERS subscribers. The ring lives either in
+ * process memory or in a POSIX shared memory segment, so the DoIP server,
+ * OTA manager and MQTT uplink can run as separate processes.
+ *
+ *   - Publishers claim a sequence number with one CAS and write the event
+ *     straight into its slot; no mutex, no per-event allocation.
+ *   - Each subscriber owns a cursor and reads events in place; a slot is
+ *     only reused once every active subscriber has moved past it, so a
+ *     view stays valid for the whole handler call.
+ *   - A full ring (slowest subscriber N events behind) makes publish()
+ *     return false instead of blocking the producer; drops are counted.
+ *   - Subscribers block in waitFor() on a futex that publishers only touch
+ *     while somebody is actually waiting.
+ *
+ * Slot payload is opaque bytes. UnifiedMessage topics carry the binary codec
+ * frame (unified_message_codec.hpp); raw topics carry their own format:
+ *   TOPIC_DIAGNOSTIC_RESPONSE: u16 tester address (BE) + UDS response
+ */
+
+#ifndef TELEMETRY_BUS_HPP
+#define TELEMETRY_BUS_HPP
+
+#include <string>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+namespace vmg {
+
+enum class MessageType;
+class UnifiedMessage;
+struct BusControl;
+
+/**
+ * @brief Bus topic: MessageType value, or a raw in-vehicle channel >= 32
+ */
+using BusTopic = uint8_t;
+
+constexpr BusTopic BUS_TOPIC_COUNT = 64;
+constexpr BusTopic TOPIC_DIAGNOSTIC_RESPONSE = 32;
+constexpr uint64_t ALL_TOPICS = ~0ULL;
+
+constexpr BusTopic topicOf(MessageType type) {
+    return static_cast<BusTopic>(type);
+}
+
+constexpr uint64_t topicBit(BusTopic topic) {
+    return 1ULL << topic;
+}
+
+/**
+ * @brief Bus geometry and backing store
+ *
+ * When attaching to an existing shared memory segment the geometry stored
+ * in the segment wins over slot_count / slot_size.
+ */
+struct TelemetryBusConfig {
+    size_t slot_count = 1024;   // Power of two
+    size_t slot_size = 256;     // Bytes per slot incl. 24-byte header, multiple of 64
+    std::string shm_name;       // Empty = in-process, else POSIX shm name ("/vmg_telemetry")
+};
+
+struct TelemetryBusStats {
+    uint64_t published = 0;
+    uint64_t dropped_full = 0;      // Slowest subscriber was a full ring behind
+    uint64_t dropped_oversize = 0;  // Event larger than a slot payload
+    size_t subscribers = 0;
+    size_t slot_count = 0;
+    size_t slot_size = 0;
+};
+
+/**
+ * @brief One event, pointing into the ring (valid during the handler call)
+ */
+struct BusMessageView {
+    BusTopic topic;
+    uint64_t sequence;
+    uint64_t publish_ns;        // CLOCK_MONOTONIC, comparable across processes
+    const uint8_t* data;
+    size_t size;
+
+    /**
+     * @brief Decode a UnifiedMessage topic (throws on a malformed frame)
+     */
+    UnifiedMessage toMessage() const;
+};
+
+using BusHandler = std::function<void(const BusMessageView&)>;
+
+class TelemetryBus;
+
+/**
+ * @brief Subscriber cursor (movable, released on destruction)
+ *
+ * A subscription gates the ring: it must be polled regularly or destroyed,
+ * otherwise publishers start dropping once it falls slot_count events behind.
+ */
+class TelemetrySubscription {
+public:
+    TelemetrySubscription() = default;
+    ~TelemetrySubscription();
+
+    TelemetrySubscription(TelemetrySubscription&& other) noexcept;
+    TelemetrySubscription& operator=(TelemetrySubscription&& other) noexcept;
+    TelemetrySubscription(const TelemetrySubscription&) = delete;
+    TelemetrySubscription& operator=(const TelemetrySubscription&) = delete;
+
+    bool valid() const { return bus_ != nullptr; }
+
+    /**
+     * @brief Deliver up to max_events pending events matching the topic mask
+     * @return Number of events consumed (filtered ones included)
+     */
+    size_t poll(const BusHandler& handler, size_t max_events = 64);
+
+    /**
+     * @brief Block until an event is pending or the timeout expires
+     */
+    bool waitFor(std::chrono::milliseconds timeout);
+
+    bool pending() const;
+    uint64_t lag() const;   // Events published but not yet consumed
+    void release();
+
+private:
+    friend class TelemetryBus;
+    TelemetrySubscription(TelemetryBus* bus, int index, uint64_t topic_mask, uint64_t cursor)
+        : bus_(bus), index_(index), topic_mask_(topic_mask), cursor_(cursor) {}
+
+    TelemetryBus* bus_ = nullptr;
+    int index_ = -1;
+    uint64_t topic_mask_ = 0;
+    uint64_t cursor_ = 0;
+};
+
+/**
+ * @brief Multi-producer / multi-subscriber broadcast ring
+ */
+class TelemetryBus {
+public:
+    static constexpr size_t MAX_SUBSCRIBERS = 16;
+    static constexpr size_t SLOT_HEADER_SIZE = 24;
+
+    explicit TelemetryBus(const TelemetryBusConfig& config = TelemetryBusConfig());
+    ~TelemetryBus();
+
+    TelemetryBus(const TelemetryBus&) = delete;
+    TelemetryBus& operator=(const TelemetryBus&) = delete;
+
+    /**
+     * @brief Allocate the ring, or create / attach the shared memory segment
+     */
+    bool open();
+    void close();
+    bool isOpen() const { return control_ != nullptr; }
+
+    /**
+     * @brief Remove a shared memory segment (mappings stay valid until closed)
+     */
+    static bool unlink(const std::string& shm_name);
+
+    /**
+     * @brief Publish one event (thread-safe, never blocks)
+     * @return false if the ring is full or the event does not fit a slot
+     */
+    bool publish(BusTopic topic, const uint8_t* data, size_t len);
+
+    /**
+     * @brief Publish a UnifiedMessage as its binary codec frame
+     */
+    bool publish(const UnifiedMessage& msg);
+
+    /**
+     * @brief Attach a subscriber; it sees events published from now on
+     * @return Invalid subscription if all MAX_SUBSCRIBERS entries are taken
+     */
+    TelemetrySubscription subscribe(uint64_t topic_mask = ALL_TOPICS);
+
+    size_t payloadCapacity() const { return slot_size_ - SLOT_HEADER_SIZE; }
+    TelemetryBusStats getStats() const;
+
+private:
+    friend class TelemetrySubscription;
+
+    bool openShared();
+    uint8_t* slotAt(uint64_t sequence) const;
+    uint64_t minCursor(uint64_t claim);
+    void releaseSubscriber(int index);
+
+    TelemetryBusConfig config_;
+    BusControl* control_ = nullptr;
+    uint8_t* slots_ = nullptr;
+    size_t slot_count_ = 0;
+    size_t slot_size_ = 0;
+    uint64_t mask_ = 0;
+    size_t region_size_ = 0;
+    bool shared_ = false;
+};
+
+} // namespace vmg
+
+#endif // TELEMETRY_BUS_HPP
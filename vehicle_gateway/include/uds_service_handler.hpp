@@ -3,19 +3,33 @@
  * @brief UDS Service Handler for VMG Gateway
  * 
  * Implements common UDS services for diagnostic communication.
+ * Requests are dispatched through a 256-entry table indexed by SID;
+ * handlers parse from a ConstByteSpan and write into caller memory, so
+ * built-in services allocate nothing.
+ *
+ * Dynamically defined DIDs (0x2C) are compiled into a copy plan of
+ * (source pointer, length) steps over prebuilt DID records and registered
+ * memory regions; a read runs the plan with memcpy.
  */
 
 #ifndef UDS_SERVICE_HANDLER_HPP
 #define UDS_SERVICE_HANDLER_HPP
 
-#include <vector>
+#include <array>
 #include <map>
+#include <vector>
 #include <string>
 #include <functional>
 #include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "periodic_did_scheduler.hpp"
 
 namespace vmg {
 
+class DTCStore;
+class SecurityAccessEngine;
+
 /**
  * @brief UDS Service IDs
  */
@@ -27,6 +41,8 @@ enum class UDSServiceID : uint8_t {
     TesterPresent = 0x3E,
     ReadDataByIdentifier = 0x22,
     ReadMemoryByAddress = 0x23,
+    ReadDataByPeriodicIdentifier = 0x2A,
+    DynamicallyDefineDataIdentifier = 0x2C,
     ReadDTCInformation = 0x19,
     WriteDataByIdentifier = 0x2E,
     WriteMemoryByAddress = 0x3D,
@@ -46,13 +62,16 @@ enum class UDSNRC : uint8_t {
     ServiceNotSupported = 0x11,
     SubFunctionNotSupported = 0x12,
     IncorrectMessageLength = 0x13,
+    ResponseTooLong = 0x14,
     ConditionsNotCorrect = 0x22,
     RequestSequenceError = 0x24,
     RequestOutOfRange = 0x31,
     SecurityAccessDenied = 0x33,
     InvalidKey = 0x35,
     ExceedNumberOfAttempts = 0x36,
-    RequiredTimeDelayNotExpired = 0x37
+    RequiredTimeDelayNotExpired = 0x37,
+    GeneralProgrammingFailure = 0x72,
+    ServiceNotSupportedInActiveSession = 0x7F
 };
 
 /**
@@ -67,6 +86,78 @@ enum class UDSDID : uint16_t {
     ApplicationVersion = 0xF181
 };
 
+/**
+ * @brief Read-only byte view (std::span<const uint8_t> stand-in until C++20)
+ */
+class ConstByteSpan {
+public:
+    constexpr ConstByteSpan() noexcept : data_(nullptr), size_(0) {}
+    constexpr ConstByteSpan(const uint8_t* data, size_t size) noexcept : data_(data), size_(size) {}
+    ConstByteSpan(const std::vector<uint8_t>& bytes) noexcept : data_(bytes.data()), size_(bytes.size()) {}
+    template <size_t N>
+    constexpr ConstByteSpan(const uint8_t (&bytes)[N]) noexcept : data_(bytes), size_(N) {}
+
+    constexpr const uint8_t* data() const noexcept { return data_; }
+    constexpr size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+    constexpr uint8_t operator[](size_t i) const noexcept { return data_[i]; }
+    constexpr const uint8_t* begin() const noexcept { return data_; }
+    constexpr const uint8_t* end() const noexcept { return data_ + size_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+};
+
+/**
+ * @brief Appends a response into caller-owned memory
+ *
+ * Writes past capacity are dropped and flagged; the handler answers
+ * ResponseTooLong instead.
+ */
+class UDSResponseWriter {
+public:
+    UDSResponseWriter(uint8_t* buffer, size_t capacity) noexcept
+        : buffer_(buffer), capacity_(capacity), size_(0), overflow_(false) {}
+
+    void put(uint8_t byte) noexcept {
+        if (size_ < capacity_) {
+            buffer_[size_++] = byte;
+        } else {
+            overflow_ = true;
+        }
+    }
+    void put(const uint8_t* data, size_t len) noexcept {
+        size_t room = capacity_ - size_;
+        if (len > room) {
+            len = room;
+            overflow_ = true;
+        }
+        std::memcpy(buffer_ + size_, data, len);
+        size_ += len;
+    }
+    void putU16(uint16_t value) noexcept {
+        put(static_cast<uint8_t>(value >> 8));
+        put(static_cast<uint8_t>(value & 0xFF));
+    }
+    void reset() noexcept { size_ = 0; overflow_ = false; }
+
+    // Bulk writers fill tail() directly (up to room() bytes), then commit()
+    uint8_t* tail() noexcept { return buffer_ + size_; }
+    size_t room() const noexcept { return capacity_ - size_; }
+    void commit(size_t len) noexcept { size_ += len; }
+    void markOverflow() noexcept { overflow_ = true; }
+
+    size_t size() const noexcept { return size_; }
+    bool overflow() const noexcept { return overflow_; }
+
+private:
+    uint8_t* buffer_;
+    size_t capacity_;
+    size_t size_;
+    bool overflow_;
+};
+
 /**
  * @brief UDS Service Handler
  * 
@@ -77,7 +168,17 @@ public:
     UDSServiceHandler();
     ~UDSServiceHandler() = default;
 
-    // Process UDS request
+    /**
+     * @brief Process UDS request into a caller buffer (no allocation for built-in services)
+     *
+     * @param request Request bytes (SID first)
+     * @param response Output buffer (at least 3 bytes for a negative response)
+     * @param capacity Output buffer size
+     * @return Response length, 0 if capacity < 3
+     */
+    size_t processRequest(ConstByteSpan request, uint8_t* response, size_t capacity);
+
+    // Process UDS request (allocates the response)
     std::vector<uint8_t> processRequest(const std::vector<uint8_t>& request);
 
     // Set vehicle/ECU information
@@ -86,39 +187,166 @@ public:
     void setSoftwareVersion(const std::string& version);
     void setHardwareVersion(const std::string& version);
 
-    // Register custom DID handler
+    // Register custom DID handler (takes precedence over built-in DID data)
     using DIDHandler = std::function<std::vector<uint8_t>(uint16_t did)>;
     void registerDIDReadHandler(uint16_t did, DIDHandler handler);
 
+    /**
+     * @brief Accept 0x2E writes to `did`
+     *
+     * The handler gets the data record (after the DID); returning false
+     * answers NRC 0x22. Unregistered DIDs are echoed as before. Clear
+     * `requires_security` only for peers authenticated by the transport
+     * (the zonal gateways' F1A1 VCI report).
+     */
+    using DIDWriteHandler = std::function<bool(uint16_t did, ConstByteSpan data)>;
+    void registerDIDWriteHandler(uint16_t did, DIDWriteHandler handler, bool requires_security = true);
+
+    /**
+     * @brief Expose caller memory to 0x2C defineByMemoryAddress
+     *
+     * Dynamic DIDs copy straight from `data` on every read; it must stay
+     * valid for the handler's lifetime.
+     */
+    void registerMemoryRegion(uint32_t address, const uint8_t* data, size_t size);
+
+    // Serve 0x19 / 0x14 from a DTC store (not owned; nullptr = no stored DTCs)
+    void attachDTCStore(DTCStore* store);
+
+    // Serve 0x27 from a seed/key engine (not owned; nullptr = 0x27 not supported)
+    void attachSecurityEngine(SecurityAccessEngine* engine);
+
+    // Tester logical address of the request being processed (per-tester security state)
+    void setTesterAddress(uint16_t address) { tester_address_ = address; }
+
+    /**
+     * @brief Build a tester's next batched 0x2A frame into a caller buffer
+     *
+     * Frame: 0x6A followed by PDID(1) + data for every PDID the tester
+     * scheduled that is due at now_ms, all rate groups in one frame.
+     * Records that do not fit are skipped.
+     *
+     * @param next_due_ms Set to the tester's next deadline (PERIODIC_NONE_DUE when stopped)
+     * @return Frame length, 0 if nothing is due
+     */
+    size_t collectPeriodicFrame(uint16_t tester_address, uint64_t now_ms, uint8_t* frame, size_t capacity,
+                                uint64_t& next_due_ms);
+
+    // Build a tester's next batched 0x2A frame (allocates; empty if nothing is due)
+    std::vector<uint8_t> collectPeriodicFrame(uint16_t tester_address, uint64_t now_ms, uint64_t& next_due_ms);
+
+    // Totals across all testers
+    PeriodicSchedulerStats getPeriodicStats() const;
+
+    // Most DIDs accepted in one ReadDataByIdentifier request
+    static constexpr size_t MAX_READ_DIDS = 32;
+
+    // Response buffer used by the vector overload; longer answers get ResponseTooLong
+    static constexpr size_t MAX_RESPONSE_SIZE = 4096;
+
+    // Dynamically defined DID range (ISO 14229-1 F200-F3FF) and size limits
+    static constexpr uint16_t DYNAMIC_DID_FIRST = 0xF200;
+    static constexpr uint16_t DYNAMIC_DID_LAST = 0xF3FF;
+    static constexpr size_t MAX_DYNAMIC_SOURCES = 64;
+    static constexpr size_t MAX_DYNAMIC_DID_SIZE = 1024;
+
 private:
-    // Service handlers
-    std::vector<uint8_t> handleDiagnosticSessionControl(const std::vector<uint8_t>& request);
-    std::vector<uint8_t> handleECUReset(const std::vector<uint8_t>& request);
-    std::vector<uint8_t> handleSecurityAccess(const std::vector<uint8_t>& request);
-    std::vector<uint8_t> handleTesterPresent(const std::vector<uint8_t>& request);
-    std::vector<uint8_t> handleReadDataByIdentifier(const std::vector<uint8_t>& request);
-    std::vector<uint8_t> handleWriteDataByIdentifier(const std::vector<uint8_t>& request);
-    std::vector<uint8_t> handleReadDTCInformation(const std::vector<uint8_t>& request);
-    std::vector<uint8_t> handleRoutineControl(const std::vector<uint8_t>& request);
+    // Service handlers: request[0] is the SID, response goes into `out`
+    void handleDiagnosticSessionControl(ConstByteSpan request, UDSResponseWriter& out);
+    void handleECUReset(ConstByteSpan request, UDSResponseWriter& out);
+    void handleSecurityAccess(ConstByteSpan request, UDSResponseWriter& out);
+    void handleTesterPresent(ConstByteSpan request, UDSResponseWriter& out);
+    void handleReadDataByIdentifier(ConstByteSpan request, UDSResponseWriter& out);
+    void handleReadDataByPeriodicIdentifier(ConstByteSpan request, UDSResponseWriter& out);
+    void handleDynamicallyDefineDataIdentifier(ConstByteSpan request, UDSResponseWriter& out);
+    void handleWriteDataByIdentifier(ConstByteSpan request, UDSResponseWriter& out);
+    void handleReadDTCInformation(ConstByteSpan request, UDSResponseWriter& out);
+    void handleClearDiagnosticInformation(ConstByteSpan request, UDSResponseWriter& out);
+    void handleRoutineControl(ConstByteSpan request, UDSResponseWriter& out);
+    void handleNotSupported(ConstByteSpan request, UDSResponseWriter& out);
+
+    // SID -> handler, built at compile time
+    using ServiceFn = void (UDSServiceHandler::*)(ConstByteSpan, UDSResponseWriter&);
+    using DispatchTable = std::array<ServiceFn, 256>;
+    static constexpr DispatchTable buildDispatchTable();
+    static const DispatchTable DISPATCH;
 
     // Response builders
-    std::vector<uint8_t> buildPositiveResponse(uint8_t sid, const std::vector<uint8_t>& data = {});
-    std::vector<uint8_t> buildNegativeResponse(uint8_t sid, UDSNRC nrc);
+    static void writePositiveResponse(UDSResponseWriter& out, uint8_t sid);
+    static void writeNegativeResponse(UDSResponseWriter& out, uint8_t sid, UDSNRC nrc);
+
+    // 0x2C source element: bytes of another DID (position is 1-based) or a memory range
+    struct DynamicSource {
+        bool by_memory;
+        uint16_t source_did;
+        uint32_t address;
+        uint16_t position;
+        uint16_t size;
+    };
+
+    // Copy plan step: `src` points into a DID record or memory region;
+    // nullptr means slice [offset, offset + len) of custom handler source_did
+    struct CopyStep {
+        const uint8_t* src;
+        uint16_t source_did;
+        uint16_t offset;
+        uint16_t len;
+    };
+
+    // DID index entry: prebuilt response bytes (built-in), read handler (custom)
+    // or 0x2C definition with its compiled copy plan (dynamic)
+    struct DIDEntry {
+        uint16_t did;
+        std::vector<uint8_t> data;
+        DIDHandler handler;
+        std::vector<DynamicSource> sources;
+        std::vector<CopyStep> plan;
+        size_t dynamic_size = 0;
+        bool plan_valid = false;
+
+        bool isDynamic() const { return !sources.empty(); }
+    };
+
+    struct MemoryRegion {
+        uint32_t address;
+        const uint8_t* data;
+        size_t size;
+    };
+
+    struct DIDWriteEntry {
+        uint16_t did;
+        DIDWriteHandler handler;
+        bool requires_security;
+    };
+
+    const DIDEntry* findDID(uint16_t did) const;
+    DIDEntry& insertDID(uint16_t did);
+    void setStaticDID(UDSDID did, const std::string& value, size_t fixed_length = 0);
+    bool putPeriodicRecord(uint8_t pdid, UDSResponseWriter& out);
+
+    // 0x2C plan compilation/execution
+    bool resolveSource(const DynamicSource& source, CopyStep& step) const;
+    bool compilePlan(DIDEntry& entry) const;
+    void compileDynamicPlans();
+    bool runCopyPlan(const DIDEntry& entry, uint8_t* dst) const;
+
+    // Flat DID index, sorted by DID
+    std::vector<DIDEntry> did_index_;
+
+    // Copy plans point into did_index_ records; rebuilt before the next read after a change
+    std::vector<MemoryRegion> memory_regions_;
+    std::vector<DIDWriteEntry> write_handlers_;
+    bool plans_dirty_;
 
-    // Data storage
-    std::string vin_;
-    std::string ecu_serial_;
-    std::string software_version_;
-    std::string hardware_version_;
+    bool securityUnlocked() const;
 
-    // Custom DID handlers
-    std::map<uint16_t, DIDHandler> did_handlers_;
+    DTCStore* dtc_store_;
+    SecurityAccessEngine* security_engine_;
+    std::map<uint16_t, PeriodicDIDScheduler> periodic_;  // 0x2A schedule per tester address
 
     // State
     uint8_t current_session_;
-    bool security_unlocked_;
-    uint32_t security_seed_;
-    uint8_t security_attempts_;
+    uint16_t tester_address_;
 };
 
 } // namespace vmg
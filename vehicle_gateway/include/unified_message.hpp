@@ -10,9 +10,18 @@
 #define UNIFIED_MESSAGE_HPP
 
 #include <string>
+#include <string_view>
+#include <array>
+#include <cstdint>
 #include <nlohmann/json.hpp>
 #include <chrono>
 #include <random>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <functional>
+#include <cstring>
+#include <ctime>
 
 namespace vmg {
 
@@ -53,11 +62,85 @@ enum class MessageType {
     ERROR
 };
 
+/**
+ * @brief Compile-time perfect hash for enum name lookup
+ *
+ * slot(s) = (len(s) * L + s[0] + s[last] * K) mod Slots. The multipliers
+ * are chosen so every name gets its own slot; a lookup is one hash and
+ * one string compare. Retune L/K if a static_assert below fires after
+ * adding a name.
+ */
+template <size_t N, size_t Slots, uint32_t L, uint32_t K>
+class PerfectHashTable {
+public:
+    constexpr explicit PerfectHashTable(const std::array<std::string_view, N>& names)
+        : names_(names), slots_(), collision_(false) {
+        for (auto& slot : slots_) {
+            slot = EMPTY;
+        }
+        for (size_t i = 0; i < N; i++) {
+            size_t h = slot(names[i]);
+            if (slots_[h] != EMPTY) {
+                collision_ = true;
+            }
+            slots_[h] = static_cast<uint8_t>(i);
+        }
+    }
+    
+    constexpr bool collisionFree() const { return !collision_; }
+    
+    // Index of `name`, or -1 if unknown
+    constexpr int find(std::string_view name) const {
+        if (name.empty()) {
+            return -1;
+        }
+        uint8_t index = slots_[slot(name)];
+        return (index != EMPTY && names_[index] == name) ? index : -1;
+    }
+    
+    constexpr std::string_view name(size_t index) const {
+        return index < N ? names_[index] : std::string_view("UNKNOWN");
+    }
+
+private:
+    static constexpr uint8_t EMPTY = 0xFF;
+    
+    static constexpr size_t slot(std::string_view s) {
+        return (s.size() * L + static_cast<uint8_t>(s.front()) +
+                static_cast<uint8_t>(s.back()) * K) % Slots;
+    }
+    
+    std::array<std::string_view, N> names_;
+    std::array<uint8_t, Slots> slots_;
+    bool collision_;
+};
+
+// Names indexed by enum value (order must match the enum declarations)
+inline constexpr PerfectHashTable<15, 32, 2, 13> MESSAGE_TYPE_NAMES(std::array<std::string_view, 15>{
+    "DEVICE_REGISTRATION", "DEVICE_REGISTRATION_ACK", "HEARTBEAT", "SENSOR_DATA",
+    "STATUS_REPORT", "WAKEUP", "WAKEUP_ACK", "REQUEST_VCI", "VCI_REPORT",
+    "REQUEST_READINESS", "READINESS_RESPONSE", "OTA_DOWNLOAD_PROGRESS",
+    "OTA_UPDATE_RESULT", "COMMAND_ACK", "ERROR"
+});
+
+inline constexpr PerfectHashTable<3, 4, 1, 1> ENTITY_TYPE_NAMES(std::array<std::string_view, 3>{
+    "VMG", "SERVER", "ECU"
+});
+
+static_assert(MESSAGE_TYPE_NAMES.collisionFree(), "MessageType perfect hash has collisions");
+static_assert(ENTITY_TYPE_NAMES.collisionFree(), "EntityType perfect hash has collisions");
+static_assert(MESSAGE_TYPE_NAMES.find("HEARTBEAT") == static_cast<int>(MessageType::HEARTBEAT),
+              "MESSAGE_TYPE_NAMES out of sync with MessageType");
+static_assert(MESSAGE_TYPE_NAMES.find("ERROR") == static_cast<int>(MessageType::ERROR),
+              "MESSAGE_TYPE_NAMES out of sync with MessageType");
+static_assert(ENTITY_TYPE_NAMES.find("ECU") == static_cast<int>(EntityType::ECU),
+              "ENTITY_TYPE_NAMES out of sync with EntityType");
+
 /**
  * @brief Message Source/Target
  */
 struct MessageEntity {
-    EntityType entity;
+    EntityType entity = EntityType::VMG;  // Binary frames carry it even when unset
     std::string identifier;
     
     json toJson() const {
@@ -67,13 +150,18 @@ struct MessageEntity {
         };
     }
     
-    static std::string entityTypeToString(EntityType type) {
-        switch (type) {
-            case EntityType::VMG: return "VMG";
-            case EntityType::SERVER: return "SERVER";
-            case EntityType::ECU: return "ECU";
-            default: return "UNKNOWN";
+    static std::string_view entityTypeToString(EntityType type) {
+        return ENTITY_TYPE_NAMES.name(static_cast<size_t>(type));
+    }
+    
+    // Returns false (and leaves `type` untouched) for unknown names
+    static bool stringToEntityType(std::string_view str, EntityType& type) {
+        int index = ENTITY_TYPE_NAMES.find(str);
+        if (index < 0) {
+            return false;
         }
+        type = static_cast<EntityType>(index);
+        return true;
     }
 };
 
@@ -95,21 +183,32 @@ struct MessageMetadata {
             result["signature"] = signature;
         }
         if (!extra.empty()) {
-            result = json::object::merge(result, extra);
+            result.update(extra);
         }
         return result;
     }
 };
 
+class UnifiedMessageCodec;
+
 /**
  * @brief Unified Message
  */
 class UnifiedMessage {
 public:
     UnifiedMessage(MessageType type)
-        : message_type_(type),
-          message_id_(generateUUID()),
-          timestamp_(getCurrentTimestampISO8601()) {}
+        : message_type_(type) {
+        // One clock read feeds both the UUIDv7 time field and the timestamp
+        uint64_t now_ms = currentEpochMs();
+        
+        char id[UUID_LENGTH];
+        formatUUIDv7(now_ms, id);
+        message_id_.assign(id, UUID_LENGTH);
+        
+        char ts[TIMESTAMP_LENGTH];
+        formatTimestampISO8601(now_ms, ts);
+        timestamp_.assign(ts, TIMESTAMP_LENGTH);
+    }
     
     // Setters
     void setCorrelationId(const std::string& id) { correlation_id_ = id; }
@@ -126,6 +225,7 @@ public:
     const MessageEntity& getSource() const { return source_; }
     const MessageEntity& getTarget() const { return target_; }
     const json& getPayload() const { return payload_; }
+    const MessageMetadata& getMetadata() const { return metadata_; }
     
     // Serialization
     json toJson() const {
@@ -158,7 +258,8 @@ public:
     
     // Deserialization
     static UnifiedMessage fromJson(const json& j) {
-        MessageType type = stringToMessageType(j["message_type"]);
+        MessageType type = stringToMessageType(
+            j["message_type"].get_ref<const std::string&>());
         UnifiedMessage msg(type);
         
         msg.message_id_ = j["message_id"];
@@ -168,24 +269,38 @@ public:
             msg.correlation_id_ = j["correlation_id"];
         }
         
-        // Parse source
-        if (j.contains("source")) {
-            msg.source_.entity = EntityType::VMG; // TODO: parse from string
-            msg.source_.identifier = j["source"]["identifier"];
+        // Parse source (defaults to VMG if entity is missing/unknown)
+        auto source = j.find("source");
+        if (source != j.end()) {
+            msg.source_.entity = EntityType::VMG;
+            parseEntity(*source, msg.source_);
         }
         
-        // Parse target
-        if (j.contains("target")) {
+        // Parse target (defaults to SERVER if entity is missing/unknown)
+        auto target = j.find("target");
+        if (target != j.end()) {
             msg.target_.entity = EntityType::SERVER;
-            msg.target_.identifier = j["target"]["identifier"];
+            parseEntity(*target, msg.target_);
         }
         
         msg.payload_ = j["payload"];
         
         return msg;
     }
+    
+    static std::string_view messageTypeToString(MessageType type) {
+        return MESSAGE_TYPE_NAMES.name(static_cast<size_t>(type));
+    }
+    
+    // Unknown names map to MessageType::ERROR
+    static MessageType stringToMessageType(std::string_view str) {
+        int index = MESSAGE_TYPE_NAMES.find(str);
+        return index < 0 ? MessageType::ERROR : static_cast<MessageType>(index);
+    }
 
 private:
+    friend class UnifiedMessageCodec;  // Binary wire format (unified_message_codec.hpp)
+    
     MessageType message_type_;
     std::string message_id_;
     std::string correlation_id_;
@@ -195,77 +310,115 @@ private:
     json payload_;
     MessageMetadata metadata_;
     
-    static std::string generateUUID() {
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        static std::uniform_int_distribution<> dis(0, 15);
-        static std::uniform_int_distribution<> dis2(8, 11);
-        
-        std::stringstream ss;
-        ss << std::hex;
-        for (int i = 0; i < 8; i++) ss << dis(gen);
-        ss << "-";
-        for (int i = 0; i < 4; i++) ss << dis(gen);
-        ss << "-4"; // UUID version 4
-        for (int i = 0; i < 3; i++) ss << dis(gen);
-        ss << "-";
-        ss << dis2(gen);
-        for (int i = 0; i < 3; i++) ss << dis(gen);
-        ss << "-";
-        for (int i = 0; i < 12; i++) ss << dis(gen);
-        return ss.str();
+    static constexpr size_t UUID_LENGTH = 36;        // xxxxxxxx-xxxx-7xxx-yxxx-xxxxxxxxxxxx
+    static constexpr size_t TIMESTAMP_LENGTH = 24;   // YYYY-MM-DDTHH:MM:SS.mmmZ
+    
+    static uint64_t currentEpochMs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
     }
     
-    static std::string getCurrentTimestampISO8601() {
-        auto now = std::chrono::system_clock::now();
-        auto itt = std::chrono::system_clock::to_time_t(now);
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now.time_since_epoch()) % 1000;
+    /**
+     * @brief Per-thread ID generator state (no locks, no shared PRNG)
+     */
+    struct IdGeneratorState {
+        uint64_t prng;          // xorshift64* state
+        uint64_t last_ms = 0;
+        uint16_t counter = 0;   // 12-bit monotonic counter within one ms
+        
+        IdGeneratorState() {
+            std::random_device rd;
+            prng = (static_cast<uint64_t>(rd()) << 32) ^ rd() ^
+                   std::hash<std::thread::id>()(std::this_thread::get_id());
+            if (prng == 0) prng = 0x9E3779B97F4A7C15ULL;
+        }
         
-        std::ostringstream ss;
-        ss << std::put_time(std::gmtime(&itt), "%Y-%m-%dT%H:%M:%S");
-        ss << '.' << std::setfill('0') << std::setw(3) << ms.count() << 'Z';
-        return ss.str();
+        uint64_t next() {
+            prng ^= prng >> 12;
+            prng ^= prng << 25;
+            prng ^= prng >> 27;
+            return prng * 0x2545F4914F6CDD1DULL;
+        }
+    };
+    
+    /**
+     * @brief Write a UUIDv7 (RFC 9562) into `out` without allocating
+     *
+     * 48-bit Unix ms | ver 7 | 12-bit counter | variant | 62 random bits.
+     * The counter keeps IDs from one thread strictly ordered within a ms.
+     */
+    static void formatUUIDv7(uint64_t now_ms, char out[UUID_LENGTH]) {
+        thread_local IdGeneratorState state;
+        
+        if (now_ms > state.last_ms) {
+            state.last_ms = now_ms;
+            state.counter = static_cast<uint16_t>(state.next() & 0x7FF);  // Leave headroom
+        } else if (++state.counter > 0xFFF) {
+            state.last_ms++;    // Counter exhausted: borrow the next ms
+            state.counter = 0;
+        }
+        
+        uint8_t bytes[16];
+        uint64_t ms = state.last_ms;
+        for (int i = 5; i >= 0; i--) {
+            bytes[i] = static_cast<uint8_t>(ms);
+            ms >>= 8;
+        }
+        bytes[6] = static_cast<uint8_t>(0x70 | (state.counter >> 8));
+        bytes[7] = static_cast<uint8_t>(state.counter);
+        
+        uint64_t rand_b = state.next();
+        bytes[8] = static_cast<uint8_t>(0x80 | ((rand_b >> 56) & 0x3F));
+        for (int i = 9; i < 16; i++) {
+            bytes[i] = static_cast<uint8_t>(rand_b >> ((15 - i) * 8));
+        }
+        
+        static const char hex[] = "0123456789abcdef";
+        char* p = out;
+        for (int i = 0; i < 16; i++) {
+            if (i == 4 || i == 6 || i == 8 || i == 10) *p++ = '-';
+            *p++ = hex[bytes[i] >> 4];
+            *p++ = hex[bytes[i] & 0x0F];
+        }
     }
     
-    static std::string messageTypeToString(MessageType type) {
-        switch (type) {
-            case MessageType::DEVICE_REGISTRATION: return "DEVICE_REGISTRATION";
-            case MessageType::DEVICE_REGISTRATION_ACK: return "DEVICE_REGISTRATION_ACK";
-            case MessageType::HEARTBEAT: return "HEARTBEAT";
-            case MessageType::SENSOR_DATA: return "SENSOR_DATA";
-            case MessageType::STATUS_REPORT: return "STATUS_REPORT";
-            case MessageType::WAKEUP: return "WAKEUP";
-            case MessageType::WAKEUP_ACK: return "WAKEUP_ACK";
-            case MessageType::REQUEST_VCI: return "REQUEST_VCI";
-            case MessageType::VCI_REPORT: return "VCI_REPORT";
-            case MessageType::REQUEST_READINESS: return "REQUEST_READINESS";
-            case MessageType::READINESS_RESPONSE: return "READINESS_RESPONSE";
-            case MessageType::OTA_DOWNLOAD_PROGRESS: return "OTA_DOWNLOAD_PROGRESS";
-            case MessageType::OTA_UPDATE_RESULT: return "OTA_UPDATE_RESULT";
-            case MessageType::COMMAND_ACK: return "COMMAND_ACK";
-            case MessageType::ERROR: return "ERROR";
-            default: return "UNKNOWN";
+    /**
+     * @brief Write ISO-8601 UTC timestamp into `out` without allocating
+     *
+     * The "YYYY-MM-DDTHH:MM:SS" prefix is cached per thread and only
+     * re-formatted (gmtime_r) when the second changes.
+     */
+    static void formatTimestampISO8601(uint64_t now_ms, char out[TIMESTAMP_LENGTH]) {
+        struct SecondCache {
+            int64_t second = -1;
+            char prefix[20];
+        };
+        thread_local SecondCache cache;
+        
+        int64_t second = static_cast<int64_t>(now_ms / 1000);
+        if (second != cache.second) {
+            time_t t = static_cast<time_t>(second);
+            struct tm tm_utc;
+            gmtime_r(&t, &tm_utc);
+            strftime(cache.prefix, sizeof(cache.prefix), "%Y-%m-%dT%H:%M:%S", &tm_utc);
+            cache.second = second;
         }
+        
+        unsigned ms = static_cast<unsigned>(now_ms % 1000);
+        std::memcpy(out, cache.prefix, 19);
+        out[19] = '.';
+        out[20] = static_cast<char>('0' + ms / 100);
+        out[21] = static_cast<char>('0' + (ms / 10) % 10);
+        out[22] = static_cast<char>('0' + ms % 10);
+        out[23] = 'Z';
     }
     
-    static MessageType stringToMessageType(const std::string& str) {
-        if (str == "DEVICE_REGISTRATION") return MessageType::DEVICE_REGISTRATION;
-        if (str == "DEVICE_REGISTRATION_ACK") return MessageType::DEVICE_REGISTRATION_ACK;
-        if (str == "HEARTBEAT") return MessageType::HEARTBEAT;
-        if (str == "SENSOR_DATA") return MessageType::SENSOR_DATA;
-        if (str == "STATUS_REPORT") return MessageType::STATUS_REPORT;
-        if (str == "WAKEUP") return MessageType::WAKEUP;
-        if (str == "WAKEUP_ACK") return MessageType::WAKEUP_ACK;
-        if (str == "REQUEST_VCI") return MessageType::REQUEST_VCI;
-        if (str == "VCI_REPORT") return MessageType::VCI_REPORT;
-        if (str == "REQUEST_READINESS") return MessageType::REQUEST_READINESS;
-        if (str == "READINESS_RESPONSE") return MessageType::READINESS_RESPONSE;
-        if (str == "OTA_DOWNLOAD_PROGRESS") return MessageType::OTA_DOWNLOAD_PROGRESS;
-        if (str == "OTA_UPDATE_RESULT") return MessageType::OTA_UPDATE_RESULT;
-        if (str == "COMMAND_ACK") return MessageType::COMMAND_ACK;
-        if (str == "ERROR") return MessageType::ERROR;
-        return MessageType::ERROR;
+    static void parseEntity(const json& j, MessageEntity& entity) {
+        auto name = j.find("entity");
+        if (name != j.end() && name->is_string()) {
+            MessageEntity::stringToEntityType(name->get_ref<const std::string&>(), entity.entity);
+        }
+        entity.identifier = j["identifier"];
     }
 };
 
@@ -0,0 +1,440 @@
+/**
+ * @file unified_message_codec.hpp
+ * @brief Compact binary codec for UnifiedMessage
+ *
+ * Alternative wire format for high-rate traffic (SENSOR_DATA, HEARTBEAT).
+ * The envelope is a fixed binary header with 128-bit message IDs and
+ * epoch-nanosecond timestamps; the payload is MessagePack.
+ *
+ * Format is negotiated via MessageMetadata::protocol_version:
+ *   "1.x" -> JSON (UnifiedMessage::toJson)
+ *   "2.x" -> binary (this codec)
+ *
+ * Binary frame layout (big-endian):
+ *   [0..1]   Magic 'U' 'M'
+ *   [2]      Codec version (0x01)
+ *   [3]      MessageType
+ *   [4]      Flags (bit0: target, bit1: metadata, bit2: metadata extension)
+ *   [5]      Source EntityType
+ *   [6]      Target EntityType
+ *   [7]      Reserved
+ *   [8..15]  Timestamp (ns since Unix epoch)
+ *   ID       message_id, then correlation_id (see IdTag)
+ *   STR8     source.identifier, [target.identifier]
+ *   STR8     [protocol_version, encryption]
+ *   BLOB32   [metadata extension: MessagePack {signature, extra}]
+ *   BLOB32   payload (MessagePack)
+ */
+
+#ifndef UNIFIED_MESSAGE_CODEC_HPP
+#define UNIFIED_MESSAGE_CODEC_HPP
+
+#include "unified_message.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+
+namespace vmg {
+
+/**
+ * @brief Wire formats for UnifiedMessage
+ */
+enum class WireFormat {
+    JSON,
+    BINARY
+};
+
+/**
+ * @brief Binary codec for UnifiedMessage
+ */
+class UnifiedMessageCodec {
+public:
+    static constexpr const char* PROTOCOL_VERSION_JSON = "1.0";
+    static constexpr const char* PROTOCOL_VERSION_BINARY = "2.0";
+    static constexpr uint8_t CODEC_VERSION = 0x01;
+
+    /**
+     * @brief Select wire format from a peer's protocol_version
+     *
+     * Binary is used only if the peer advertises major version >= 2.
+     */
+    static WireFormat negotiate(const std::string& peer_protocol_version) {
+        int major = 0;
+        for (char c : peer_protocol_version) {
+            if (c < '0' || c > '9') break;
+            major = major * 10 + (c - '0');
+        }
+        return major >= 2 ? WireFormat::BINARY : WireFormat::JSON;
+    }
+
+    /**
+     * @brief Encode using the format selected by the message's protocol_version
+     */
+    static std::vector<uint8_t> encode(const UnifiedMessage& msg) {
+        if (negotiate(msg.metadata_.protocol_version) == WireFormat::BINARY) {
+            return encodeBinary(msg);
+        }
+        std::string text = msg.toJson().dump();
+        return std::vector<uint8_t>(text.begin(), text.end());
+    }
+
+    /**
+     * @brief Decode either format (detected by the binary magic)
+     */
+    static UnifiedMessage decode(const uint8_t* data, size_t len) {
+        if (isBinary(data, len)) {
+            return decodeBinary(data, len);
+        }
+        return UnifiedMessage::fromJson(json::parse(data, data + len));
+    }
+
+    static UnifiedMessage decode(const std::vector<uint8_t>& data) {
+        return decode(data.data(), data.size());
+    }
+
+    static bool isBinary(const uint8_t* data, size_t len) {
+        return len >= 2 && data[0] == 'U' && data[1] == 'M';
+    }
+
+    /**
+     * @brief Encode to binary frame
+     */
+    static std::vector<uint8_t> encodeBinary(const UnifiedMessage& msg) {
+        const MessageMetadata& meta = msg.metadata_;
+        bool has_target = !msg.target_.identifier.empty();
+        bool has_metadata = !meta.protocol_version.empty();
+        bool has_meta_ext = has_metadata && (!meta.signature.empty() || !meta.extra.empty());
+
+        std::vector<uint8_t> payload = json::to_msgpack(msg.payload_);
+
+        std::vector<uint8_t> out;
+        out.reserve(64 + msg.source_.identifier.size() + payload.size());
+
+        out.push_back('U');
+        out.push_back('M');
+        out.push_back(CODEC_VERSION);
+        out.push_back(static_cast<uint8_t>(msg.message_type_));
+        out.push_back((has_target ? FLAG_TARGET : 0) |
+                      (has_metadata ? FLAG_METADATA : 0) |
+                      (has_meta_ext ? FLAG_METADATA_EXT : 0));
+        out.push_back(static_cast<uint8_t>(msg.source_.entity));
+        out.push_back(static_cast<uint8_t>(msg.target_.entity));
+        out.push_back(0x00);
+
+        putU64(out, isoToEpochNs(msg.timestamp_));
+        putId(out, msg.message_id_);
+        putId(out, msg.correlation_id_);
+
+        putStr8(out, msg.source_.identifier);
+        if (has_target) {
+            putStr8(out, msg.target_.identifier);
+        }
+
+        if (has_metadata) {
+            putStr8(out, meta.protocol_version);
+            putStr8(out, meta.encryption);
+        }
+        if (has_meta_ext) {
+            json ext = {{"signature", meta.signature}, {"extra", meta.extra}};
+            putBlob32(out, json::to_msgpack(ext));
+        }
+
+        putBlob32(out, payload);
+        return out;
+    }
+
+    /**
+     * @brief Decode binary frame
+     *
+     * @throws std::runtime_error on malformed input
+     */
+    static UnifiedMessage decodeBinary(const uint8_t* data, size_t len) {
+        Reader r{data, len, 0};
+
+        if (!isBinary(data, len) || r.u8At(2) != CODEC_VERSION) {
+            throw std::runtime_error("Invalid binary UnifiedMessage header");
+        }
+        r.pos = 3;
+
+        uint8_t type = r.u8();
+        uint8_t flags = r.u8();
+        uint8_t source_entity = r.u8();
+        uint8_t target_entity = r.u8();
+        r.u8();  // Reserved
+
+        if (type > static_cast<uint8_t>(MessageType::ERROR) ||
+            source_entity > static_cast<uint8_t>(EntityType::ECU) ||
+            target_entity > static_cast<uint8_t>(EntityType::ECU)) {
+            throw std::runtime_error("Invalid binary UnifiedMessage enum value");
+        }
+
+        UnifiedMessage msg(static_cast<MessageType>(type));
+        msg.timestamp_ = epochNsToIso(r.u64());
+        msg.message_id_ = r.id();
+        msg.correlation_id_ = r.id();
+
+        msg.source_.entity = static_cast<EntityType>(source_entity);
+        msg.source_.identifier = r.str8();
+
+        msg.target_.entity = static_cast<EntityType>(target_entity);
+        if (flags & FLAG_TARGET) {
+            msg.target_.identifier = r.str8();
+        }
+
+        if (flags & FLAG_METADATA) {
+            msg.metadata_.protocol_version = r.str8();
+            msg.metadata_.encryption = r.str8();
+        } else {
+            msg.metadata_.protocol_version.clear();
+        }
+        if (flags & FLAG_METADATA_EXT) {
+            json ext = r.msgpack();
+            msg.metadata_.signature = ext.value("signature", json());
+            msg.metadata_.extra = ext.value("extra", json());
+        }
+
+        msg.payload_ = r.msgpack();
+        return msg;
+    }
+
+    static UnifiedMessage decodeBinary(const std::vector<uint8_t>& data) {
+        return decodeBinary(data.data(), data.size());
+    }
+
+    /**
+     * @brief Parse canonical UUID string into 16 bytes
+     *
+     * @return false if `str` is not a 36-char UUID
+     */
+    static bool parseUUID(const std::string& str, uint8_t out[16]) {
+        if (str.size() != 36) {
+            return false;
+        }
+        size_t byte = 0;
+        for (size_t i = 0; i < str.size();) {
+            if (i == 8 || i == 13 || i == 18 || i == 23) {
+                if (str[i] != '-') return false;
+                i++;
+                continue;
+            }
+            int hi = hexValue(str[i]);
+            int lo = hexValue(str[i + 1]);
+            if (hi < 0 || lo < 0) {
+                return false;
+            }
+            out[byte++] = static_cast<uint8_t>((hi << 4) | lo);
+            i += 2;
+        }
+        return byte == 16;
+    }
+
+    static std::string formatUUID(const uint8_t in[16]) {
+        static const char hex[] = "0123456789abcdef";
+        std::string out;
+        out.reserve(36);
+        for (size_t i = 0; i < 16; i++) {
+            if (i == 4 || i == 6 || i == 8 || i == 10) out.push_back('-');
+            out.push_back(hex[in[i] >> 4]);
+            out.push_back(hex[in[i] & 0x0F]);
+        }
+        return out;
+    }
+
+    /**
+     * @brief "YYYY-MM-DDTHH:MM:SS[.fff...]Z" -> ns since epoch (0 if invalid)
+     */
+    static uint64_t isoToEpochNs(const std::string& iso) {
+        int y, mo, d, h, mi, s;
+        if (iso.size() < 20 ||
+            !digits(iso, 0, 4, y) || !digits(iso, 5, 2, mo) || !digits(iso, 8, 2, d) ||
+            !digits(iso, 11, 2, h) || !digits(iso, 14, 2, mi) || !digits(iso, 17, 2, s)) {
+            return 0;
+        }
+
+        uint64_t frac_ns = 0;
+        uint64_t scale = 100000000;
+        for (size_t i = 20; i < iso.size() && iso[19] == '.' && scale > 0; i++) {
+            if (iso[i] < '0' || iso[i] > '9') break;
+            frac_ns += static_cast<uint64_t>(iso[i] - '0') * scale;
+            scale /= 10;
+        }
+
+        int64_t secs = daysFromCivil(y, mo, d) * 86400LL + h * 3600 + mi * 60 + s;
+        return static_cast<uint64_t>(secs) * 1000000000ULL + frac_ns;
+    }
+
+    /**
+     * @brief ns since epoch -> "YYYY-MM-DDTHH:MM:SS.mmmZ"
+     */
+    static std::string epochNsToIso(uint64_t ns) {
+        int64_t secs = static_cast<int64_t>(ns / 1000000000ULL);
+        unsigned ms = static_cast<unsigned>((ns / 1000000ULL) % 1000);
+        int64_t days = secs / 86400;
+        int64_t rem = secs % 86400;
+
+        int y;
+        unsigned mo, d;
+        civilFromDays(days, y, mo, d);
+
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%04d-%02u-%02uT%02u:%02u:%02u.%03uZ",
+                 y, mo, d,
+                 static_cast<unsigned>(rem / 3600),
+                 static_cast<unsigned>((rem % 3600) / 60),
+                 static_cast<unsigned>(rem % 60), ms);
+        return buf;
+    }
+
+private:
+    static constexpr uint8_t FLAG_TARGET = 0x01;
+    static constexpr uint8_t FLAG_METADATA = 0x02;
+    static constexpr uint8_t FLAG_METADATA_EXT = 0x04;
+
+    // ID field tag: non-UUID identifiers (e.g. "diag-12345") are kept as strings
+    enum IdTag : uint8_t {
+        ID_ABSENT = 0,
+        ID_UUID = 1,
+        ID_STRING = 2
+    };
+
+    static void putU64(std::vector<uint8_t>& out, uint64_t v) {
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out.push_back(static_cast<uint8_t>(v >> shift));
+        }
+    }
+
+    static void putStr8(std::vector<uint8_t>& out, const std::string& s) {
+        if (s.size() > 0xFF) {
+            throw std::runtime_error("Binary UnifiedMessage: string field too long");
+        }
+        out.push_back(static_cast<uint8_t>(s.size()));
+        out.insert(out.end(), s.begin(), s.end());
+    }
+
+    static void putBlob32(std::vector<uint8_t>& out, const std::vector<uint8_t>& blob) {
+        uint32_t n = static_cast<uint32_t>(blob.size());
+        out.push_back((n >> 24) & 0xFF);
+        out.push_back((n >> 16) & 0xFF);
+        out.push_back((n >> 8) & 0xFF);
+        out.push_back(n & 0xFF);
+        out.insert(out.end(), blob.begin(), blob.end());
+    }
+
+    static void putId(std::vector<uint8_t>& out, const std::string& id) {
+        uint8_t uuid[16];
+        if (id.empty()) {
+            out.push_back(ID_ABSENT);
+        } else if (parseUUID(id, uuid)) {
+            out.push_back(ID_UUID);
+            out.insert(out.end(), uuid, uuid + 16);
+        } else {
+            out.push_back(ID_STRING);
+            putStr8(out, id);
+        }
+    }
+
+    struct Reader {
+        const uint8_t* data;
+        size_t len;
+        size_t pos;
+
+        void need(size_t n) const {
+            if (pos + n > len) {
+                throw std::runtime_error("Binary UnifiedMessage truncated");
+            }
+        }
+        uint8_t u8At(size_t at) const {
+            if (at >= len) throw std::runtime_error("Binary UnifiedMessage truncated");
+            return data[at];
+        }
+        uint8_t u8() {
+            need(1);
+            return data[pos++];
+        }
+        uint32_t u32() {
+            need(4);
+            uint32_t v = (static_cast<uint32_t>(data[pos]) << 24) |
+                         (static_cast<uint32_t>(data[pos + 1]) << 16) |
+                         (static_cast<uint32_t>(data[pos + 2]) << 8) |
+                         data[pos + 3];
+            pos += 4;
+            return v;
+        }
+        uint64_t u64() {
+            uint64_t hi = u32();
+            return (hi << 32) | u32();
+        }
+        std::string str8() {
+            size_t n = u8();
+            need(n);
+            std::string s(reinterpret_cast<const char*>(data + pos), n);
+            pos += n;
+            return s;
+        }
+        std::string id() {
+            switch (u8()) {
+                case ID_ABSENT: return std::string();
+                case ID_UUID: {
+                    need(16);
+                    std::string s = formatUUID(data + pos);
+                    pos += 16;
+                    return s;
+                }
+                case ID_STRING: return str8();
+                default: throw std::runtime_error("Binary UnifiedMessage: invalid ID tag");
+            }
+        }
+        json msgpack() {
+            size_t n = u32();
+            need(n);
+            json j = json::from_msgpack(data + pos, data + pos + n);
+            pos += n;
+            return j;
+        }
+    };
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    static bool digits(const std::string& s, size_t at, size_t n, int& value) {
+        value = 0;
+        for (size_t i = at; i < at + n; i++) {
+            if (s[i] < '0' || s[i] > '9') return false;
+            value = value * 10 + (s[i] - '0');
+        }
+        return true;
+    }
+
+    // Proleptic Gregorian calendar <-> days since 1970-01-01
+    // (H. Hinnant, "chrono-Compatible Low-Level Date Algorithms")
+    static int64_t daysFromCivil(int y, unsigned m, unsigned d) {
+        y -= m <= 2;
+        const int64_t era = (y >= 0 ? y : y - 399) / 400;
+        const unsigned yoe = static_cast<unsigned>(y - era * 400);
+        const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + static_cast<int64_t>(doe) - 719468;
+    }
+
+    static void civilFromDays(int64_t z, int& y, unsigned& m, unsigned& d) {
+        z += 719468;
+        const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        const unsigned doe = static_cast<unsigned>(z - era * 146097);
+        const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned mp = (5 * doy + 2) / 153;
+        d = doy - (153 * mp + 2) / 5 + 1;
+        m = mp < 10 ? mp + 3 : mp - 9;
+        y = static_cast<int>(yoe + era * 400) + (m <= 2);
+    }
+};
+
+} // namespace vmg
+
+#endif // UNIFIED_MESSAGE_CODEC_HPP
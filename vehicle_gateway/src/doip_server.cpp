@@ -7,15 +7,26 @@
 #include <iostream>
 #include <cstring>
 #include <algorithm>
+#include <chrono>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
 
 namespace vmg {
 
+namespace {
+
+uint64_t steadyNowMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
 // ============================================================================
 // DoIPMessage Implementation
 // ============================================================================
@@ -39,17 +50,15 @@ std::vector<uint8_t> DoIPMessage::toBytes() const {
     result.push_back(header_.protocol_version);
     result.push_back(header_.inverse_protocol_version);
 
-    // Payload type (big-endian)
-    uint16_t pt_be = htons(header_.payload_type);
-    result.push_back((pt_be >> 8) & 0xFF);
-    result.push_back(pt_be & 0xFF);
+    // Payload type (big-endian; header fields are host order, shifts emit network order)
+    result.push_back((header_.payload_type >> 8) & 0xFF);
+    result.push_back(header_.payload_type & 0xFF);
 
     // Payload length (big-endian)
-    uint32_t len_be = htonl(header_.payload_length);
-    result.push_back((len_be >> 24) & 0xFF);
-    result.push_back((len_be >> 16) & 0xFF);
-    result.push_back((len_be >> 8) & 0xFF);
-    result.push_back(len_be & 0xFF);
+    result.push_back((header_.payload_length >> 24) & 0xFF);
+    result.push_back((header_.payload_length >> 16) & 0xFF);
+    result.push_back((header_.payload_length >> 8) & 0xFF);
+    result.push_back(header_.payload_length & 0xFF);
 
     // Payload
     result.insert(result.end(), payload_data_.begin(), payload_data_.end());
@@ -96,7 +105,7 @@ DoIPMessage DoIPMessage::fromBytes(const uint8_t* data, size_t len) {
 // ============================================================================
 
 DoIPClientSession::DoIPClientSession(int socket, const std::string& address)
-    : socket_(socket), address_(address), routing_active_(false), source_address_(0) {
+    : socket_(socket), address_(address), routing_active_(false), source_address_(0), trace_id_(0) {
 }
 
 DoIPClientSession::~DoIPClientSession() {
@@ -110,7 +119,8 @@ DoIPClientSession::~DoIPClientSession() {
 // ============================================================================
 
 DoIPServer::DoIPServer(const DoIPServerConfig& config)
-    : config_(config), udp_socket_(-1), tcp_socket_(-1), running_(false), total_messages_(0) {
+    : config_(config), udp_socket_(-1), tcp_socket_(-1), running_(false), total_messages_(0),
+      periodic_frames_(0), next_trace_id_(1) {
 }
 
 DoIPServer::~DoIPServer() {
@@ -137,6 +147,7 @@ bool DoIPServer::start() {
     // Start threads
     udp_thread_ = std::make_unique<std::thread>(&DoIPServer::udpListenerThread, this);
     tcp_thread_ = std::make_unique<std::thread>(&DoIPServer::tcpAcceptThread, this);
+    periodic_thread_ = std::make_unique<std::thread>(&DoIPServer::periodicThread, this);
 
     std::cout << "DoIP Server started on " << config_.host << ":" << config_.port << std::endl;
     std::cout << "  VIN: " << config_.vin << std::endl;
@@ -150,14 +161,20 @@ void DoIPServer::stop() {
         return;
     }
 
-    running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(periodic_mutex_);
+        running_ = false;
+    }
+    periodic_cv_.notify_all();
 
-    // Close sockets
+    // Close sockets (shutdown first: close() alone does not wake a blocked accept/recv)
     if (udp_socket_ >= 0) {
+        shutdown(udp_socket_, SHUT_RDWR);
         close(udp_socket_);
         udp_socket_ = -1;
     }
     if (tcp_socket_ >= 0) {
+        shutdown(tcp_socket_, SHUT_RDWR);
         close(tcp_socket_);
         tcp_socket_ = -1;
     }
@@ -169,6 +186,17 @@ void DoIPServer::stop() {
     if (tcp_thread_ && tcp_thread_->joinable()) {
         tcp_thread_->join();
     }
+    if (periodic_thread_ && periodic_thread_->joinable()) {
+        periodic_thread_->join();
+    }
+
+    // Wake client threads blocked in recv(); sockets are closed with their sessions
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        for (const auto& entry : sessions_) {
+            shutdown(entry.second->getSocket(), SHUT_RDWR);
+        }
+    }
 
     // Wait for client threads
     for (auto& thread : client_threads_) {
@@ -184,14 +212,34 @@ void DoIPServer::stop() {
         sessions_.clear();
     }
 
+    stopCapture();
+
     std::cout << "DoIP Server stopped" << std::endl;
 }
 
 void DoIPServer::registerUDSHandler(UDSHandler handler) {
+    if (!handler) {
+        registerTesterUDSHandler(nullptr);
+        return;
+    }
+    registerTesterUDSHandler([handler](uint16_t, const std::vector<uint8_t>& request) {
+        return handler(request);
+    });
+}
+
+void DoIPServer::registerTesterUDSHandler(TesterUDSHandler handler) {
     std::lock_guard<std::mutex> lock(uds_mutex_);
     uds_handler_ = handler;
 }
 
+void DoIPServer::registerPeriodicSource(PeriodicSource source) {
+    {
+        std::lock_guard<std::mutex> lock(uds_mutex_);
+        periodic_source_ = source;
+    }
+    periodic_cv_.notify_all();
+}
+
 void DoIPServer::setVIN(const std::string& vin) {
     config_.vin = vin;
 }
@@ -208,6 +256,51 @@ void DoIPServer::setGID(const std::vector<uint8_t>& gid) {
     config_.gid = gid;
 }
 
+bool DoIPServer::startCapture(const std::string& path) {
+    auto writer = std::shared_ptr<DoIPTraceWriter>(new DoIPTraceWriter(), [](DoIPTraceWriter* w) {
+        doip_trace_writer_close(w);
+        delete w;
+    });
+    if (doip_trace_writer_open(writer.get(), path.c_str()) != 0) {
+        std::cerr << "Failed to open capture file " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Sessions already open are announced so the replay tool sees every connection
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        for (const auto& entry : sessions_) {
+            doip_trace_record(writer.get(), entry.second->getTraceId(), DOIP_TRACE_OPEN, nullptr, 0);
+        }
+    }
+
+    std::atomic_store(&capture_, writer);
+    std::cout << "DoIP capture started: " << path << std::endl;
+    return true;
+}
+
+void DoIPServer::stopCapture() {
+    auto writer = std::atomic_exchange(&capture_, std::shared_ptr<DoIPTraceWriter>());
+    if (!writer) {
+        return;
+    }
+    pthread_mutex_lock(&writer->mutex);
+    uint64_t records = writer->records;
+    uint64_t bytes = writer->bytes;
+    uint64_t dropped = writer->dropped;
+    pthread_mutex_unlock(&writer->mutex);
+    std::cout << "DoIP capture stopped: " << records << " records, " << bytes
+              << " bytes, " << dropped << " dropped" << std::endl;
+    // File is closed when the last in-flight captureFrame() releases it
+}
+
+void DoIPServer::captureFrame(uint32_t connection, uint8_t kind, const uint8_t* data, size_t len) {
+    auto writer = std::atomic_load(&capture_);
+    if (writer) {
+        doip_trace_record(writer.get(), connection, kind, data, len);
+    }
+}
+
 size_t DoIPServer::getActiveConnections() const {
     std::lock_guard<std::mutex> lock(sessions_mutex_);
     return sessions_.size();
@@ -301,6 +394,8 @@ void DoIPServer::udpListenerThread() {
             continue;
         }
 
+        captureFrame(DOIP_TRACE_UDP_CONNECTION, DOIP_TRACE_RX, buffer.data(), static_cast<size_t>(recv_len));
+
         try {
             DoIPMessage msg = DoIPMessage::fromBytes(buffer.data(), recv_len);
             
@@ -319,6 +414,7 @@ void DoIPServer::udpListenerThread() {
                 
                 sendto(udp_socket_, response_data.data(), response_data.size(), 0,
                        (struct sockaddr*)&client_addr, addr_len);
+                captureFrame(DOIP_TRACE_UDP_CONNECTION, DOIP_TRACE_TX, response_data.data(), response_data.size());
             }
 
         } catch (const std::exception& e) {
@@ -341,6 +437,11 @@ void DoIPServer::tcpAcceptThread() {
             continue;
         }
 
+        // ACK + response are separate small writes: without this Nagle holds the
+        // response until the tester's delayed ACK (~40 ms)
+        int opt = 1;
+        setsockopt(client_sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
         char client_ip[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
         std::string client_address = std::string(client_ip) + ":" + 
@@ -350,6 +451,8 @@ void DoIPServer::tcpAcceptThread() {
 
         // Create session
         auto session = std::make_shared<DoIPClientSession>(client_sock, client_address);
+        session->setTraceId(next_trace_id_++);
+        captureFrame(session->getTraceId(), DOIP_TRACE_OPEN, nullptr, 0);
 
         {
             std::lock_guard<std::mutex> lock(sessions_mutex_);
@@ -398,6 +501,8 @@ void DoIPServer::clientHandlerThread(std::shared_ptr<DoIPClientSession> session)
             }
         }
 
+        captureFrame(session->getTraceId(), DOIP_TRACE_RX, buffer.data(), 8 + payload_length);
+
         try {
             DoIPMessage msg = DoIPMessage::fromBytes(buffer.data(), 8 + payload_length);
             handleTCPMessage(msg, session);
@@ -409,6 +514,29 @@ void DoIPServer::clientHandlerThread(std::shared_ptr<DoIPClientSession> session)
     }
 
     std::cout << "Client disconnected: " << session->getAddress() << std::endl;
+    captureFrame(session->getTraceId(), DOIP_TRACE_CLOSE, nullptr, 0);
+
+    // Periodic streams of departed testers stop with them (0x2A 0x04, all PDIDs)
+    std::vector<uint16_t> periodic_testers;
+    {
+        std::lock_guard<std::mutex> lock(periodic_mutex_);
+        for (auto it = periodic_targets_.begin(); it != periodic_targets_.end();) {
+            if (it->second.session.lock() == session) {
+                periodic_testers.push_back(it->first);
+                it = periodic_targets_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    if (!periodic_testers.empty()) {
+        std::lock_guard<std::mutex> lock(uds_mutex_);
+        for (uint16_t tester : periodic_testers) {
+            if (uds_handler_) {
+                uds_handler_(tester, {0x2A, 0x04});
+            }
+        }
+    }
 
     // Remove session
     {
@@ -421,6 +549,66 @@ void DoIPServer::clientHandlerThread(std::shared_ptr<DoIPClientSession> session)
 // Message Handlers
 // ============================================================================
 
+void DoIPServer::periodicThread() {
+    std::unique_lock<std::mutex> lock(periodic_mutex_);
+
+    while (running_) {
+        uint64_t next_due_ms = UINT64_MAX;
+        std::map<uint16_t, PeriodicTarget> targets = periodic_targets_;
+
+        if (!targets.empty()) {
+            lock.unlock();
+
+            // Each tester has its own schedule; sleep until the earliest deadline of any
+            for (const auto& entry : targets) {
+                auto session = entry.second.session.lock();
+                if (!session) {
+                    continue;
+                }
+                uint16_t tester = entry.first;
+                uint16_t ecu = entry.second.ecu_address;
+
+                std::vector<uint8_t> frame;
+                uint64_t tester_due_ms = UINT64_MAX;
+                {
+                    std::lock_guard<std::mutex> uds_lock(uds_mutex_);
+                    if (periodic_source_) {
+                        frame = periodic_source_(tester, steadyNowMs(), tester_due_ms);
+                    }
+                }
+                next_due_ms = std::min(next_due_ms, tester_due_ms);
+
+                if (!frame.empty()) {
+                    // Same addressing as the 0x2A response: ECU -> tester
+                    std::vector<uint8_t> payload;
+                    payload.reserve(4 + frame.size());
+                    payload.push_back((ecu >> 8) & 0xFF);
+                    payload.push_back(ecu & 0xFF);
+                    payload.push_back((tester >> 8) & 0xFF);
+                    payload.push_back(tester & 0xFF);
+                    payload.insert(payload.end(), frame.begin(), frame.end());
+                    if (sendToSession(session, DoIPMessage(DoIPPayloadType::DiagnosticMessage, payload))) {
+                        periodic_frames_++;
+                    }
+                }
+            }
+            lock.lock();
+        }
+
+        if (!running_) {
+            break;
+        }
+
+        // Sleep until the next deadline, or until a 0x2A request changes the schedule
+        if (next_due_ms == UINT64_MAX) {
+            periodic_cv_.wait_for(lock, std::chrono::seconds(1));
+        } else {
+            auto deadline = std::chrono::steady_clock::time_point(std::chrono::milliseconds(next_due_ms));
+            periodic_cv_.wait_until(lock, deadline);
+        }
+    }
+}
+
 void DoIPServer::handleUDPMessage(const DoIPMessage& msg, const std::string& client_addr) {
     std::cout << "UDP message from " << client_addr << ": type=0x" 
               << std::hex << static_cast<int>(msg.getPayloadType()) << std::dec << std::endl;
@@ -432,17 +620,33 @@ void DoIPServer::handleTCPMessage(const DoIPMessage& msg, std::shared_ptr<DoIPCl
     switch (msg.getPayloadType()) {
         case DoIPPayloadType::RoutingActivationReq:
             response = handleRoutingActivationReq(msg, session);
-            sendMessage(session->getSocket(), response);
+            sendToSession(session, response);
             break;
 
-        case DoIPPayloadType::DiagnosticMessage:
+        case DoIPPayloadType::DiagnosticMessage: {
             response = handleDiagnosticMessage(msg, session);
-            sendMessage(session->getSocket(), response);
+            sendToSession(session, response);
+
+            // Accepted 0x2A start: stream this tester's schedule to it, after its 0x6A response
+            const auto& request = msg.getPayload();
+            const auto& reply = response.getPayload();
+            if (request.size() >= 6 && request[4] == 0x2A && request[5] != 0x04 &&
+                reply.size() >= 5 && reply[4] == 0x6A) {
+                {
+                    std::lock_guard<std::mutex> lock(periodic_mutex_);
+                    uint16_t tester = (static_cast<uint16_t>(reply[2]) << 8) | reply[3];
+                    PeriodicTarget& target = periodic_targets_[tester];
+                    target.session = session;
+                    target.ecu_address = (static_cast<uint16_t>(reply[0]) << 8) | reply[1];
+                }
+                periodic_cv_.notify_all();
+            }
             break;
+        }
 
         case DoIPPayloadType::AliveCheckReq:
             response = handleAliveCheckReq(msg);
-            sendMessage(session->getSocket(), response);
+            sendToSession(session, response);
             break;
 
         default:
@@ -552,14 +756,14 @@ DoIPMessage DoIPServer::handleDiagnosticMessage(const DoIPMessage& msg,
     ack_payload.push_back(target_address & 0xFF);
     ack_payload.push_back(0x00);  // ACK code
     DoIPMessage ack(DoIPPayloadType::DiagnosticMessagePosAck, ack_payload);
-    sendMessage(session->getSocket(), ack);
+    sendToSession(session, ack);
 
     // Process UDS request
     std::vector<uint8_t> uds_response;
     {
         std::lock_guard<std::mutex> lock(uds_mutex_);
         if (uds_handler_) {
-            uds_response = uds_handler_(uds_request);
+            uds_response = uds_handler_(source_address, uds_request);
         } else {
             // Default: echo request with positive response offset
             if (!uds_request.empty()) {
@@ -591,10 +795,16 @@ DoIPMessage DoIPServer::handleAliveCheckReq(const DoIPMessage& msg) {
     return DoIPMessage(DoIPPayloadType::AliveCheckRes, payload);
 }
 
-bool DoIPServer::sendMessage(int socket, const DoIPMessage& msg) {
+bool DoIPServer::sendToSession(const std::shared_ptr<DoIPClientSession>& session, const DoIPMessage& msg) {
     std::vector<uint8_t> data = msg.toBytes();
-    ssize_t sent = send(socket, data.data(), data.size(), 0);
-    return sent == static_cast<ssize_t>(data.size());
+    std::lock_guard<std::mutex> lock(session->getSendMutex());
+    ssize_t sent = send(session->getSocket(), data.data(), data.size(), 0);
+    if (sent != static_cast<ssize_t>(data.size())) {
+        return false;
+    }
+    // Recorded under the send mutex so the trace keeps the wire order
+    captureFrame(session->getTraceId(), DOIP_TRACE_TX, data.data(), data.size());
+    return true;
 }
 
 } // namespace vmg
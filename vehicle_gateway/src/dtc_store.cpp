@@ -0,0 +1,505 @@
+/**
+ * @file dtc_store.cpp
+ * @brief Persistent DTC memory Implementation
+ */
+
+#include "dtc_store.hpp"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace vmg {
+
+static const char DTC_LOG_MAGIC[4] = {'D', 'T', 'C', 'L'};
+constexpr uint8_t DTC_LOG_VERSION = 1;
+constexpr size_t DTC_LOG_HEADER_SIZE = sizeof(DTC_LOG_MAGIC) + 1;
+
+constexpr char DTC_OP_UPSERT = 'U';
+constexpr char DTC_OP_DELETE = 'D';
+constexpr char DTC_OP_CLEAR = 'C';
+
+// write() all of `len`, retrying short writes and EINTR
+static bool writeAll(int fd, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Make a rename in `dir` durable
+static void syncDirectory(const fs::path& dir) {
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+static uint32_t fnv1a(const uint8_t* data, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+DTCStore::DTCStore(const DTCStoreConfig& config)
+    : config_(config),
+      log_fd_(-1) {
+}
+
+DTCStore::~DTCStore() {
+    closeLogLocked();
+}
+
+bool DTCStore::open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    fs::path path(config_.log_path);
+    std::error_code ec;
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path(), ec);
+        if (ec) {
+            std::cerr << "[DTCStore] Failed to create " << path.parent_path()
+                      << ": " << ec.message() << std::endl;
+            return false;
+        }
+    }
+
+    clearAllLocked();
+    stats_ = DTCStoreStats();
+
+    bool rewrite = true;
+    std::ifstream file(config_.log_path, std::ios::binary);
+    if (file) {
+        std::vector<uint8_t> log((std::istreambuf_iterator<char>(file)),
+                                 std::istreambuf_iterator<char>());
+
+        if (log.size() >= DTC_LOG_HEADER_SIZE &&
+            std::memcmp(log.data(), DTC_LOG_MAGIC, sizeof(DTC_LOG_MAGIC)) == 0 &&
+            log[sizeof(DTC_LOG_MAGIC)] == DTC_LOG_VERSION) {
+            rewrite = false;
+            size_t offset = DTC_LOG_HEADER_SIZE;
+            for (; offset + DTC_LOG_ENTRY_SIZE <= log.size(); offset += DTC_LOG_ENTRY_SIZE) {
+                char op;
+                DTCRecord record;
+                if (!decodeEntry(&log[offset], op, record)) {
+                    break;
+                }
+                if (op == DTC_OP_UPSERT) {
+                    upsertLocked(record);
+                } else if (op == DTC_OP_DELETE) {
+                    eraseLocked(record.dtc);
+                } else {
+                    clearAllLocked();
+                }
+                stats_.log_entries++;
+            }
+            if (offset != log.size()) {
+                // Torn or corrupt tail: keep what replayed cleanly
+                stats_.replay_errors++;
+                rewrite = true;
+                std::cerr << "[DTCStore] Dropped " << (log.size() - offset)
+                          << " bytes of damaged log tail" << std::endl;
+            }
+        } else if (!log.empty()) {
+            stats_.replay_errors++;
+            std::cerr << "[DTCStore] Unrecognized log " << config_.log_path
+                      << ", starting empty" << std::endl;
+        }
+    }
+    file.close();
+
+    if (rewrite) {
+        if (!compactLocked()) {
+            return false;
+        }
+    } else {
+        if (!openLogLocked()) {
+            return false;
+        }
+        maybeCompactLocked();
+    }
+
+    std::cout << "[DTCStore] Opened " << config_.log_path << ": " << records_.size()
+              << " DTCs (" << stats_.log_entries << " log entries)" << std::endl;
+    return true;
+}
+
+bool DTCStore::reportTestResult(uint32_t dtc, bool failed,
+                                const uint8_t* snapshot, size_t snapshot_len,
+                                const uint8_t* extended, size_t extended_len) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    dtc &= 0xFFFFFF;
+    auto it = by_dtc_.find(dtc);
+
+    DTCRecord record;
+    if (it != by_dtc_.end()) {
+        record = records_[it->second];
+    } else if (!failed) {
+        return true;  // Passing test of a DTC never stored
+    } else if (records_.size() >= config_.max_records) {
+        std::cerr << "[DTCStore] Store full, DTC 0x" << std::hex << dtc << std::dec
+                  << " not recorded" << std::endl;
+        return false;
+    } else {
+        record.dtc = dtc;
+    }
+
+    uint8_t status = record.status &
+        ~(DTC_STATUS_NOT_COMPLETED_SINCE_CLEAR | DTC_STATUS_NOT_COMPLETED_THIS_CYCLE);
+
+    if (failed) {
+        // Confirmation threshold of one failure
+        status |= DTC_STATUS_TEST_FAILED | DTC_STATUS_TEST_FAILED_THIS_CYCLE |
+                  DTC_STATUS_PENDING | DTC_STATUS_CONFIRMED | DTC_STATUS_FAILED_SINCE_CLEAR;
+        if (record.occurrence_count < 0xFFFF) {
+            record.occurrence_count++;
+        }
+        if (snapshot) {
+            record.snapshot_len = static_cast<uint8_t>(std::min(snapshot_len, DTC_SNAPSHOT_SIZE));
+            std::memcpy(record.snapshot.data(), snapshot, record.snapshot_len);
+        }
+        if (extended) {
+            record.extended_len = static_cast<uint8_t>(std::min(extended_len, DTC_EXTENDED_SIZE));
+            std::memcpy(record.extended.data(), extended, record.extended_len);
+        }
+    } else {
+        status &= ~DTC_STATUS_TEST_FAILED;
+        if (status == record.status) {
+            return true;  // Nothing to persist
+        }
+    }
+
+    record.status = status;
+    upsertLocked(record);
+    bool ok = appendLocked(DTC_OP_UPSERT, record);
+    maybeCompactLocked();
+    return ok;
+}
+
+bool DTCStore::clear(uint32_t group, size_t* cleared_out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    group &= 0xFFFFFF;
+    size_t cleared = 0;
+    bool ok = true;
+    DTCRecord marker;
+    marker.dtc = group;
+
+    if (group == DTC_GROUP_ALL) {
+        cleared = records_.size();
+        clearAllLocked();
+        ok = appendLocked(DTC_OP_CLEAR, marker);
+    } else if (by_dtc_.count(group)) {
+        eraseLocked(group);
+        ok = appendLocked(DTC_OP_DELETE, marker);
+        cleared = 1;
+    }
+
+    if (cleared) {
+        std::cout << "[DTCStore] Cleared " << cleared << " DTC(s), group 0x"
+                  << std::hex << group << std::dec << std::endl;
+    }
+    maybeCompactLocked();
+    if (cleared_out) {
+        *cleared_out = cleared;
+    }
+    return ok;
+}
+
+bool DTCStore::find(uint32_t dtc, DTCRecord& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = by_dtc_.find(dtc & 0xFFFFFF);
+    if (it == by_dtc_.end()) {
+        return false;
+    }
+    out = records_[it->second];
+    return true;
+}
+
+size_t DTCStore::countByStatusMask(uint8_t mask) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return countLocked(mask);
+}
+
+bool DTCStore::writeStatusRecords(uint8_t mask, uint8_t* out, size_t capacity, size_t& written) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    written = 0;
+    if (countLocked(mask) * 4 > capacity) {
+        return false;
+    }
+
+    uint8_t* p = out;
+    auto put = [&p](const DTCRecord& record) {
+        p[0] = static_cast<uint8_t>(record.dtc >> 16);
+        p[1] = static_cast<uint8_t>(record.dtc >> 8);
+        p[2] = static_cast<uint8_t>(record.dtc & 0xFF);
+        p[3] = record.status;
+        p += 4;
+    };
+    forEachLocked(mask, put);
+    written = static_cast<size_t>(p - out);
+    return true;
+}
+
+DTCStoreStats DTCStore::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DTCStoreStats stats = stats_;
+    stats.records = records_.size();
+    return stats;
+}
+
+// ============================================================================
+// Index maintenance
+// ============================================================================
+
+size_t DTCStore::countLocked(uint8_t mask) const {
+    if (mask != 0 && (mask & (mask - 1)) == 0) {
+        return by_status_bit_[lowestBit(mask)].size();
+    }
+    auto none = [](const DTCRecord&) {};
+    return forEachLocked(mask, none);
+}
+
+void DTCStore::upsertLocked(const DTCRecord& record) {
+    auto it = by_dtc_.find(record.dtc);
+    uint32_t slot;
+    if (it != by_dtc_.end()) {
+        slot = it->second;
+    } else {
+        slot = static_cast<uint32_t>(records_.size());
+        records_.emplace_back();
+        records_.back().dtc = record.dtc;
+        bit_position_.emplace_back();
+        by_dtc_[record.dtc] = slot;
+    }
+
+    uint8_t old_status = records_[slot].status;
+    records_[slot] = record;
+    records_[slot].status = old_status;
+    setStatusLocked(slot, record.status);
+}
+
+void DTCStore::eraseLocked(uint32_t dtc) {
+    auto it = by_dtc_.find(dtc);
+    if (it == by_dtc_.end()) {
+        return;
+    }
+
+    uint32_t slot = it->second;
+    by_dtc_.erase(it);
+    setStatusLocked(slot, 0);
+
+    // Move last record into the hole
+    uint32_t last = static_cast<uint32_t>(records_.size() - 1);
+    if (slot != last) {
+        records_[slot] = records_[last];
+        bit_position_[slot] = bit_position_[last];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            if (records_[slot].status & (1u << bit)) {
+                by_status_bit_[bit][bit_position_[slot][bit]] = slot;
+            }
+        }
+        by_dtc_[records_[slot].dtc] = slot;
+    }
+    records_.pop_back();
+    bit_position_.pop_back();
+}
+
+void DTCStore::clearAllLocked() {
+    records_.clear();
+    by_dtc_.clear();
+    bit_position_.clear();
+    for (auto& list : by_status_bit_) {
+        list.clear();
+    }
+}
+
+void DTCStore::setStatusLocked(uint32_t slot, uint8_t status) {
+    uint8_t changed = records_[slot].status ^ status;
+
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        if (!(changed & (1u << bit))) {
+            continue;
+        }
+        auto& list = by_status_bit_[bit];
+        if (status & (1u << bit)) {
+            bit_position_[slot][bit] = static_cast<uint32_t>(list.size());
+            list.push_back(slot);
+        } else {
+            // Swap-remove
+            uint32_t pos = bit_position_[slot][bit];
+            uint32_t moved = list.back();
+            list[pos] = moved;
+            bit_position_[moved][bit] = pos;
+            list.pop_back();
+        }
+    }
+    records_[slot].status = status;
+}
+
+// ============================================================================
+// Log file
+// ============================================================================
+
+bool DTCStore::openLogLocked() {
+    closeLogLocked();
+    log_fd_ = ::open(config_.log_path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (log_fd_ < 0) {
+        std::cerr << "[DTCStore] Failed to open " << config_.log_path << ": "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void DTCStore::closeLogLocked() {
+    if (log_fd_ >= 0) {
+        ::close(log_fd_);
+        log_fd_ = -1;
+    }
+}
+
+bool DTCStore::appendLocked(char op, const DTCRecord& record) {
+    if (log_fd_ < 0) {
+        return false;
+    }
+
+    uint8_t entry[DTC_LOG_ENTRY_SIZE];
+    encodeEntry(op, record, entry);
+    // A torn entry is dropped on replay; the sync makes the change durable
+    // before the caller (e.g. a 0x14 positive response) reports it
+    if (!writeAll(log_fd_, entry, sizeof(entry)) || ::fdatasync(log_fd_) != 0) {
+        std::cerr << "[DTCStore] Failed to append to " << config_.log_path << ": "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+    stats_.log_entries++;
+    return true;
+}
+
+bool DTCStore::compactLocked() {
+    // Rewrite live records to a temp file and rename over the log
+    std::string tmp_path = config_.log_path + ".tmp";
+    {
+        int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            std::cerr << "[DTCStore] Failed to open " << tmp_path << std::endl;
+            return false;
+        }
+
+        std::vector<uint8_t> image;
+        image.reserve(DTC_LOG_HEADER_SIZE + records_.size() * DTC_LOG_ENTRY_SIZE);
+        image.insert(image.end(), DTC_LOG_MAGIC, DTC_LOG_MAGIC + sizeof(DTC_LOG_MAGIC));
+        image.push_back(DTC_LOG_VERSION);
+        uint8_t entry[DTC_LOG_ENTRY_SIZE];
+        for (const auto& record : records_) {
+            encodeEntry(DTC_OP_UPSERT, record, entry);
+            image.insert(image.end(), entry, entry + sizeof(entry));
+        }
+
+        // Data must be on disk before the rename makes it the log
+        bool ok = writeAll(fd, image.data(), image.size()) && ::fsync(fd) == 0;
+        ::close(fd);
+        if (!ok) {
+            std::cerr << "[DTCStore] Failed to write " << tmp_path << std::endl;
+            return false;
+        }
+    }
+
+    closeLogLocked();
+
+    std::error_code ec;
+    fs::rename(tmp_path, config_.log_path, ec);
+    if (ec) {
+        std::cerr << "[DTCStore] Failed to commit " << config_.log_path << ": " << ec.message() << std::endl;
+        fs::remove(tmp_path, ec);
+    } else {
+        syncDirectory(fs::path(config_.log_path).parent_path());
+    }
+
+    if (!openLogLocked()) {
+        return false;
+    }
+
+    stats_.log_entries = records_.size();
+    stats_.compactions++;
+    return !ec;
+}
+
+void DTCStore::maybeCompactLocked() {
+    if (stats_.log_entries > config_.compact_min_entries &&
+        stats_.log_entries > 2 * records_.size()) {
+        compactLocked();
+    }
+}
+
+void DTCStore::encodeEntry(char op, const DTCRecord& record, uint8_t* out) {
+    uint8_t* p = out;
+    *p++ = static_cast<uint8_t>(op);
+    *p++ = static_cast<uint8_t>(record.dtc >> 16);
+    *p++ = static_cast<uint8_t>(record.dtc >> 8);
+    *p++ = static_cast<uint8_t>(record.dtc & 0xFF);
+    *p++ = record.status;
+    *p++ = static_cast<uint8_t>(record.occurrence_count >> 8);
+    *p++ = static_cast<uint8_t>(record.occurrence_count & 0xFF);
+    *p++ = record.snapshot_len;
+    std::memcpy(p, record.snapshot.data(), DTC_SNAPSHOT_SIZE);
+    p += DTC_SNAPSHOT_SIZE;
+    *p++ = record.extended_len;
+    std::memcpy(p, record.extended.data(), DTC_EXTENDED_SIZE);
+    p += DTC_EXTENDED_SIZE;
+
+    uint32_t checksum = fnv1a(out, DTC_LOG_ENTRY_SIZE - 4);
+    *p++ = static_cast<uint8_t>(checksum >> 24);
+    *p++ = static_cast<uint8_t>(checksum >> 16);
+    *p++ = static_cast<uint8_t>(checksum >> 8);
+    *p++ = static_cast<uint8_t>(checksum & 0xFF);
+}
+
+bool DTCStore::decodeEntry(const uint8_t* in, char& op, DTCRecord& record) {
+    const uint8_t* c = in + DTC_LOG_ENTRY_SIZE - 4;
+    uint32_t checksum = (static_cast<uint32_t>(c[0]) << 24) | (static_cast<uint32_t>(c[1]) << 16) |
+                        (static_cast<uint32_t>(c[2]) << 8) | static_cast<uint32_t>(c[3]);
+    if (checksum != fnv1a(in, DTC_LOG_ENTRY_SIZE - 4)) {
+        return false;
+    }
+
+    const uint8_t* p = in;
+    op = static_cast<char>(*p++);
+    if (op != DTC_OP_UPSERT && op != DTC_OP_DELETE && op != DTC_OP_CLEAR) {
+        return false;
+    }
+    record.dtc = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+    p += 3;
+    record.status = *p++;
+    record.occurrence_count = static_cast<uint16_t>((p[0] << 8) | p[1]);
+    p += 2;
+    record.snapshot_len = std::min<uint8_t>(*p++, DTC_SNAPSHOT_SIZE);
+    std::memcpy(record.snapshot.data(), p, DTC_SNAPSHOT_SIZE);
+    p += DTC_SNAPSHOT_SIZE;
+    record.extended_len = std::min<uint8_t>(*p++, DTC_EXTENDED_SIZE);
+    std::memcpy(record.extended.data(), p, DTC_EXTENDED_SIZE);
+    return true;
+}
+
+} // namespace vmg
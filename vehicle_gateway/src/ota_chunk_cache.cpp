@@ -0,0 +1,454 @@
+/**
+ * @file ota_chunk_cache.cpp
+ * @brief Content-addressed OTA Chunk Cache Implementation
+ */
+
+#include "ota_chunk_cache.hpp"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <openssl/evp.h>
+
+namespace fs = std::filesystem;
+
+namespace vmg {
+
+OTAChunkCache::OTAChunkCache(const OTAChunkCacheConfig& config)
+    : config_(config) {
+}
+
+bool OTAChunkCache::initialize() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::error_code ec;
+    fs::create_directories(config_.spill_dir, ec);
+    if (ec) {
+        std::cerr << "[OTACache] Failed to create " << config_.spill_dir
+                  << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    // Re-index chunks spilled before a restart. Content is re-verified
+    // lazily on first read, so a torn file is simply discarded then.
+    disk_.clear();
+    disk_lru_.clear();
+    stats_.disk_bytes = 0;
+
+    std::vector<std::pair<fs::file_time_type, ChunkDigest>> found;
+    for (const auto& entry : fs::directory_iterator(config_.spill_dir, ec)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        if (entry.path().extension() == ".tmp") {
+            // Spill interrupted before its rename
+            std::error_code rm_ec;
+            fs::remove(entry.path(), rm_ec);
+            continue;
+        }
+        ChunkDigest digest;
+        if (!hexToDigest(entry.path().filename().string(), digest)) {
+            continue;  // Foreign file
+        }
+        uint64_t size = entry.file_size(ec);
+        found.emplace_back(entry.last_write_time(ec), digest);
+        disk_[digest] = DiskEntry{size, disk_lru_.end()};
+        stats_.disk_bytes += size;
+    }
+
+    // Oldest file is the first disk eviction candidate
+    std::sort(found.begin(), found.end());
+    for (const auto& file : found) {
+        disk_lru_.push_front(file.second);
+        disk_[file.second].lru_it = disk_lru_.begin();
+    }
+
+    std::cout << "[OTACache] Initialized: " << disk_.size() << " chunks on disk ("
+              << stats_.disk_bytes << " bytes), memory budget "
+              << config_.max_memory_bytes << " bytes" << std::endl;
+    return true;
+}
+
+bool OTAChunkCache::registerManifest(const OTAPackageManifest& manifest) {
+    if (manifest.chunk_size == 0) {
+        std::cerr << "[OTACache] Invalid chunk size for " << manifest.package_id << std::endl;
+        return false;
+    }
+
+    uint64_t expected = (manifest.total_size + manifest.chunk_size - 1) / manifest.chunk_size;
+    if (manifest.chunks.size() != expected) {
+        std::cerr << "[OTACache] Manifest " << manifest.package_id << ": "
+                  << manifest.chunks.size() << " chunks, expected " << expected << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    manifests_[manifest.package_id] = manifest;
+    return true;
+}
+
+bool OTAChunkCache::put(const ChunkDigest& digest, const uint8_t* data, size_t len) {
+    if (computeDigest(data, len) != digest) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.verify_failures++;
+        std::cerr << "[OTACache] Digest mismatch for chunk " << digestToHex(digest) << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (containsLocked(digest)) {
+        return true;  // Deduplicated
+    }
+
+    std::vector<uint8_t> chunk(data, data + len);
+
+    // Persist immediately so an interrupted download can resume from here
+    spillLocked(digest, chunk);
+    insertMemoryLocked(digest, std::move(chunk));
+    return true;
+}
+
+bool OTAChunkCache::get(const ChunkDigest& digest, std::vector<uint8_t>& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return getLocked(digest, out);
+}
+
+bool OTAChunkCache::contains(const ChunkDigest& digest) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return containsLocked(digest);
+}
+
+bool OTAChunkCache::readPackageChunk(const std::string& package_id, size_t index,
+                                     std::vector<uint8_t>& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = manifests_.find(package_id);
+    if (it == manifests_.end() || index >= it->second.chunks.size()) {
+        return false;
+    }
+    return getLocked(it->second.chunks[index], out);
+}
+
+size_t OTAChunkCache::firstMissingChunk(const std::string& package_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = manifests_.find(package_id);
+    if (it == manifests_.end()) {
+        return 0;
+    }
+
+    const auto& chunks = it->second.chunks;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (!containsLocked(chunks[i])) {
+            return i;
+        }
+    }
+    return chunks.size();
+}
+
+bool OTAChunkCache::isPackageComplete(const std::string& package_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = manifests_.find(package_id);
+    if (it == manifests_.end()) {
+        return false;
+    }
+    for (const auto& digest : it->second.chunks) {
+        if (!containsLocked(digest)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OTAChunkCache::fetchPackage(const std::string& package_id, const ChunkFetcher& fetcher,
+                                 const FetchProgress& progress) {
+    OTAPackageManifest manifest;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = manifests_.find(package_id);
+        if (it == manifests_.end()) {
+            std::cerr << "[OTACache] Unknown package: " << package_id << std::endl;
+            return false;
+        }
+        manifest = it->second;
+    }
+
+    size_t resume_from = firstMissingChunk(package_id);
+    if (resume_from > 0) {
+        std::cout << "[OTACache] Resuming " << package_id << " at chunk "
+                  << resume_from << "/" << manifest.chunks.size() << std::endl;
+    }
+
+    // Chunks are chunk_size bytes except the last one
+    auto bytes_through = [&manifest](size_t chunks) {
+        return std::min<uint64_t>(static_cast<uint64_t>(chunks) * manifest.chunk_size,
+                                  manifest.total_size);
+    };
+    if (progress) {
+        progress(manifest, bytes_through(resume_from));
+    }
+
+    for (size_t i = resume_from; i < manifest.chunks.size(); i++) {
+        if (!fetchChunk(manifest, i, fetcher)) {
+            return false;  // Next call retries this chunk
+        }
+        if (progress) {
+            progress(manifest, bytes_through(i + 1));
+        }
+    }
+
+    return isPackageComplete(package_id);
+}
+
+bool OTAChunkCache::fetchChunk(const OTAPackageManifest& manifest, size_t index,
+                               const ChunkFetcher& fetcher) {
+    const ChunkDigest& digest = manifest.chunks[index];
+    std::shared_ptr<InFlightFetch> flight;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        // Shared with another package or already fetched by a concurrent caller
+        if (containsLocked(digest)) {
+            return true;
+        }
+
+        // Single flight: wait for the caller already fetching this chunk
+        auto it = in_flight_.find(digest);
+        if (it != in_flight_.end()) {
+            std::shared_ptr<InFlightFetch> waiting = it->second;
+            stats_.coalesced_fetches++;
+            fetch_cv_.wait(lock, [&waiting] { return waiting->done; });
+            return waiting->ok;
+        }
+
+        flight = std::make_shared<InFlightFetch>();
+        in_flight_.emplace(digest, flight);
+        stats_.backend_fetches++;
+    }
+
+    // Waiters must be released even if the fetcher throws
+    auto finish = [this, &digest, &flight](bool ok) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flight->done = true;
+            flight->ok = ok;
+            in_flight_.erase(digest);
+        }
+        fetch_cv_.notify_all();
+    };
+
+    std::vector<uint8_t> buffer;
+    bool ok = false;
+    try {
+        ok = fetcher(manifest, index, buffer);
+    } catch (...) {
+        finish(false);
+        throw;
+    }
+    if (!ok) {
+        std::cerr << "[OTACache] Backend fetch failed: " << manifest.package_id
+                  << " chunk " << index << std::endl;
+    } else {
+        ok = put(digest, buffer.data(), buffer.size());  // False: corrupted download
+    }
+
+    finish(ok);
+    return ok;
+}
+
+OTAChunkCacheStats OTAChunkCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// ============================================================================
+// Digest Helpers
+// ============================================================================
+
+ChunkDigest OTAChunkCache::computeDigest(const uint8_t* data, size_t len) {
+    ChunkDigest digest{};
+    unsigned int digest_len = 0;
+    EVP_Digest(data, len, digest.data(), &digest_len, EVP_sha256(), nullptr);
+    return digest;
+}
+
+std::string OTAChunkCache::digestToHex(const ChunkDigest& digest) {
+    static const char hex[] = "0123456789abcdef";
+    std::string result(64, '0');
+    for (size_t i = 0; i < digest.size(); i++) {
+        result[2 * i] = hex[digest[i] >> 4];
+        result[2 * i + 1] = hex[digest[i] & 0x0F];
+    }
+    return result;
+}
+
+bool OTAChunkCache::hexToDigest(const std::string& hex, ChunkDigest& digest) {
+    if (hex.size() != 64) {
+        return false;
+    }
+
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
+    for (size_t i = 0; i < digest.size(); i++) {
+        int hi = nibble(hex[2 * i]);
+        int lo = nibble(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        digest[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return true;
+}
+
+// ============================================================================
+// Private Methods
+// ============================================================================
+
+bool OTAChunkCache::getLocked(const ChunkDigest& digest, std::vector<uint8_t>& out) {
+    auto it = memory_.find(digest);
+    if (it != memory_.end()) {
+        // Move to front (most recently used)
+        lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+        out = it->second.data;
+        stats_.memory_hits++;
+        return true;
+    }
+
+    if (loadFromDiskLocked(digest, out)) {
+        stats_.disk_hits++;
+        insertMemoryLocked(digest, out);
+        return true;
+    }
+
+    stats_.misses++;
+    return false;
+}
+
+void OTAChunkCache::insertMemoryLocked(const ChunkDigest& digest, std::vector<uint8_t> data) {
+    if (data.size() > config_.max_memory_bytes) {
+        return;  // Served from disk only
+    }
+
+    stats_.memory_bytes += data.size();
+    lru_.push_front(digest);
+    memory_[digest] = MemoryEntry{std::move(data), lru_.begin()};
+    evictLocked();
+}
+
+void OTAChunkCache::evictLocked() {
+    auto lru_it = lru_.end();
+    while (stats_.memory_bytes > config_.max_memory_bytes && lru_it != lru_.begin()) {
+        --lru_it;
+        auto it = memory_.find(*lru_it);
+
+        // Chunks are written through on put(); only spill if disk copy was lost.
+        // If that fails too, this is the only copy: keep it, over budget.
+        if (disk_.find(*lru_it) == disk_.end() && !spillLocked(*lru_it, it->second.data)) {
+            std::cerr << "[OTACache] Chunk " << digestToHex(*lru_it)
+                      << " could not be spilled, kept in memory" << std::endl;
+            continue;
+        }
+
+        stats_.memory_bytes -= it->second.data.size();
+        memory_.erase(it);
+        lru_it = lru_.erase(lru_it);
+    }
+}
+
+bool OTAChunkCache::spillLocked(const ChunkDigest& digest, const std::vector<uint8_t>& data) {
+    if (config_.max_disk_bytes != 0) {
+        if (data.size() > config_.max_disk_bytes) {
+            std::cerr << "[OTACache] Chunk " << digestToHex(digest)
+                      << " is larger than the disk budget" << std::endl;
+            return false;
+        }
+
+        // Make room by dropping the least recently used spilled chunks
+        while (stats_.disk_bytes + data.size() > config_.max_disk_bytes && !disk_lru_.empty()) {
+            dropDiskLocked(disk_lru_.back());
+            stats_.disk_evictions++;
+        }
+    }
+
+    // Write to temp file and rename, so a power loss never leaves a torn chunk
+    std::string path = chunkPath(digest);
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "[OTACache] Failed to open " << tmp_path << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file) {
+            std::cerr << "[OTACache] Failed to write " << tmp_path << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tmp_path, path, ec);
+    if (ec) {
+        std::cerr << "[OTACache] Failed to commit " << path << ": " << ec.message() << std::endl;
+        fs::remove(tmp_path, ec);
+        return false;
+    }
+
+    disk_lru_.push_front(digest);
+    disk_[digest] = DiskEntry{data.size(), disk_lru_.begin()};
+    stats_.disk_bytes += data.size();
+    stats_.spills++;
+    return true;
+}
+
+bool OTAChunkCache::loadFromDiskLocked(const ChunkDigest& digest, std::vector<uint8_t>& out) {
+    auto it = disk_.find(digest);
+    if (it == disk_.end()) {
+        return false;
+    }
+
+    std::ifstream file(chunkPath(digest), std::ios::binary);
+    if (file) {
+        out.resize(it->second.size);
+        file.read(reinterpret_cast<char*>(out.data()), out.size());
+        if (file && computeDigest(out.data(), out.size()) == digest) {
+            disk_lru_.splice(disk_lru_.begin(), disk_lru_, it->second.lru_it);
+            return true;
+        }
+    }
+
+    // Missing or corrupted on disk: forget it so it gets re-fetched
+    std::cerr << "[OTACache] Dropping corrupted chunk " << digestToHex(digest) << std::endl;
+    stats_.verify_failures++;
+    dropDiskLocked(digest);
+    return false;
+}
+
+void OTAChunkCache::dropDiskLocked(const ChunkDigest& digest) {
+    auto it = disk_.find(digest);
+    if (it == disk_.end()) {
+        return;
+    }
+
+    stats_.disk_bytes -= it->second.size;
+    disk_lru_.erase(it->second.lru_it);
+    disk_.erase(it);
+    std::error_code ec;
+    fs::remove(chunkPath(digest), ec);
+}
+
+bool OTAChunkCache::containsLocked(const ChunkDigest& digest) const {
+    return memory_.count(digest) != 0 || disk_.count(digest) != 0;
+}
+
+std::string OTAChunkCache::chunkPath(const ChunkDigest& digest) const {
+    return config_.spill_dir + "/" + digestToHex(digest);
+}
+
+} // namespace vmg
@@ -0,0 +1,288 @@
+/**
+ * @file security_access.cpp
+ * @brief SecurityAccess seed/key engine Implementation
+ */
+
+#include "security_access.hpp"
+#include <openssl/hmac.h>
+#include <openssl/evp.h>
+#include <openssl/crypto.h>
+#include <sys/random.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+
+namespace vmg {
+
+namespace {
+
+bool getrandomFill(uint8_t* out, size_t len) {
+    while (len > 0) {
+        ssize_t n = getrandom(out, len, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        out += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+uint64_t elapsedNs(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+bool isSeedLevel(uint8_t level) {
+    return level != 0 && level <= SECURITY_MAX_LEVEL && (level & 0x01) != 0;
+}
+
+} // namespace
+
+SecurityAccessEngine::SecurityAccessEngine(const SecurityAccessConfig& config, RandomSource random)
+    : config_(config),
+      random_(random ? std::move(random) : RandomSource(getrandomFill)),
+      pool_head_(0),
+      pool_count_(0),
+      stopping_(false) {
+    config_.seed_pool_size = std::max<size_t>(config_.seed_pool_size, 1);
+    config_.seed_pool_low_water = std::min(std::max<size_t>(config_.seed_pool_low_water, 1),
+                                           config_.seed_pool_size);
+    config_.max_attempts = std::max<uint8_t>(config_.max_attempts, 1);
+    pool_.resize(config_.seed_pool_size);
+
+    refill_thread_ = std::thread(&SecurityAccessEngine::refillThread, this);
+}
+
+SecurityAccessEngine::~SecurityAccessEngine() {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        stopping_ = true;
+    }
+    refill_cv_.notify_all();
+    if (refill_thread_.joinable()) {
+        refill_thread_.join();
+    }
+    OPENSSL_cleanse(pool_.data(), pool_.size() * sizeof(Seed));
+}
+
+void SecurityAccessEngine::setLevelSecret(uint8_t level, const std::vector<uint8_t>& secret) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    level_secrets_[level] = secret;
+}
+
+void SecurityAccessEngine::setKeyAlgorithm(KeyAlgorithm algorithm) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    key_algorithm_ = std::move(algorithm);
+}
+
+// ============================================================================
+// Seed Pool
+// ============================================================================
+
+void SecurityAccessEngine::refillThread() {
+    std::vector<uint8_t> batch;
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+
+    while (true) {
+        refill_cv_.wait(lock, [this] { return stopping_ || pool_count_ < config_.seed_pool_low_water; });
+        if (stopping_) {
+            break;
+        }
+
+        // One RNG call for every missing seed, outside the lock
+        size_t missing = pool_.size() - pool_count_;
+        lock.unlock();
+        batch.resize(missing * SECURITY_SEED_SIZE);
+        bool ok = random_(batch.data(), batch.size());
+        lock.lock();
+
+        if (!ok) {
+            std::cerr << "[SecurityAccess] Random source failed, retrying" << std::endl;
+            refill_cv_.wait_for(lock, std::chrono::milliseconds(100));
+            continue;
+        }
+
+        for (size_t i = 0; i < missing && pool_count_ < pool_.size(); i++) {
+            Seed& slot = pool_[(pool_head_ + pool_count_) % pool_.size()];
+            std::memcpy(slot.data(), batch.data() + i * SECURITY_SEED_SIZE, SECURITY_SEED_SIZE);
+            pool_count_++;
+        }
+        OPENSSL_cleanse(batch.data(), batch.size());
+    }
+}
+
+bool SecurityAccessEngine::takeSeed(uint8_t* seed, bool& pool_hit) {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        if (pool_count_ > 0) {
+            Seed& slot = pool_[pool_head_];
+            std::memcpy(seed, slot.data(), SECURITY_SEED_SIZE);
+            OPENSSL_cleanse(slot.data(), slot.size());
+            pool_head_ = (pool_head_ + 1) % pool_.size();
+            pool_count_--;
+            pool_hit = true;
+            if (pool_count_ < config_.seed_pool_low_water) {
+                refill_cv_.notify_one();
+            }
+            return true;
+        }
+    }
+
+    // Pool drained faster than the refill: generate inline
+    pool_hit = false;
+    return random_(seed, SECURITY_SEED_SIZE);
+}
+
+size_t SecurityAccessEngine::seedPoolLevel() const {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    return pool_count_;
+}
+
+// ============================================================================
+// Seed / Key
+// ============================================================================
+
+SecurityResult SecurityAccessEngine::requestSeed(uint16_t tester, uint8_t level, uint64_t now_ms, uint8_t* seed) {
+    auto start = std::chrono::steady_clock::now();
+    if (!isSeedLevel(level)) {
+        return SecurityResult::LevelNotSupported;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!key_algorithm_ && level_secrets_.find(level) == level_secrets_.end()) {
+        return SecurityResult::LevelNotSupported;
+    }
+
+    TesterState& state = testers_[tester];
+    if (state.locked_until_ms != 0) {
+        if (now_ms < state.locked_until_ms) {
+            return SecurityResult::DelayNotExpired;
+        }
+        state.locked_until_ms = 0;
+        state.failed_attempts = 0;
+    }
+
+    if (state.unlocked_level == level) {
+        std::memset(seed, 0, SECURITY_SEED_SIZE);
+        return SecurityResult::AlreadyUnlocked;
+    }
+
+    bool pool_hit = false;
+    if (!takeSeed(state.seed.data(), pool_hit)) {
+        return SecurityResult::RandomFailure;
+    }
+    std::memcpy(seed, state.seed.data(), SECURITY_SEED_SIZE);
+    state.pending_level = level;
+
+    SecurityLevelStats& stats = stats_[level];
+    stats.seeds++;
+    if (!pool_hit) {
+        stats.pool_misses++;
+    }
+    stats.seed_ns += elapsedNs(start);
+    return SecurityResult::Ok;
+}
+
+SecurityResult SecurityAccessEngine::sendKey(uint16_t tester, uint8_t level, const uint8_t* key,
+                                             size_t key_len, uint64_t now_ms) {
+    auto start = std::chrono::steady_clock::now();
+    if (!isSeedLevel(level)) {
+        return SecurityResult::LevelNotSupported;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    TesterState& state = testers_[tester];
+    if (state.locked_until_ms != 0) {
+        if (now_ms < state.locked_until_ms) {
+            return SecurityResult::DelayNotExpired;
+        }
+        state.locked_until_ms = 0;
+        state.failed_attempts = 0;
+    }
+
+    if (state.pending_level != level) {
+        return SecurityResult::SequenceError;
+    }
+    state.pending_level = 0;  // One key attempt per seed
+
+    uint8_t expected[SECURITY_KEY_SIZE];
+    bool supported = expectedKey(level, state.seed.data(), expected);
+    // Length is public; the key bytes are compared without early exit
+    bool match = supported && key_len == SECURITY_KEY_SIZE && constantTimeEqual(key, expected, SECURITY_KEY_SIZE);
+    OPENSSL_cleanse(expected, sizeof(expected));
+    OPENSSL_cleanse(state.seed.data(), state.seed.size());
+
+    SecurityLevelStats& stats = stats_[level];
+    stats.key_ns += elapsedNs(start);
+
+    if (!supported) {
+        return SecurityResult::LevelNotSupported;
+    }
+    if (match) {
+        state.unlocked_level = level;
+        state.failed_attempts = 0;
+        stats.unlocks++;
+        return SecurityResult::Ok;
+    }
+
+    stats.invalid_keys++;
+    state.failed_attempts++;
+    if (state.failed_attempts >= config_.max_attempts) {
+        state.locked_until_ms = now_ms + config_.lockout_ms;
+        stats.lockouts++;
+        return SecurityResult::ExceededAttempts;
+    }
+    return SecurityResult::InvalidKey;
+}
+
+uint8_t SecurityAccessEngine::unlockedLevel(uint16_t tester) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = testers_.find(tester);
+    return (it != testers_.end()) ? it->second.unlocked_level : 0;
+}
+
+void SecurityAccessEngine::lock(uint16_t tester) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = testers_.find(tester);
+    if (it != testers_.end()) {
+        it->second.unlocked_level = 0;
+        it->second.pending_level = 0;
+    }
+}
+
+SecurityLevelStats SecurityAccessEngine::getStats(uint8_t level) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return (level <= SECURITY_MAX_LEVEL) ? stats_[level] : SecurityLevelStats();
+}
+
+bool SecurityAccessEngine::expectedKey(uint8_t level, const uint8_t* seed, uint8_t* key) const {
+    if (key_algorithm_) {
+        return key_algorithm_(level, seed, key);
+    }
+    auto it = level_secrets_.find(level);
+    return it != level_secrets_.end() && computeHmacKey(it->second, seed, key);
+}
+
+bool SecurityAccessEngine::computeHmacKey(const std::vector<uint8_t>& secret, const uint8_t* seed, uint8_t* key) {
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+    if (!HMAC(EVP_sha256(), secret.data(), static_cast<int>(secret.size()),
+              seed, SECURITY_SEED_SIZE, digest, &digest_len) || digest_len < SECURITY_KEY_SIZE) {
+        return false;
+    }
+    std::memcpy(key, digest, SECURITY_KEY_SIZE);
+    OPENSSL_cleanse(digest, sizeof(digest));
+    return true;
+}
+
+bool SecurityAccessEngine::constantTimeEqual(const uint8_t* a, const uint8_t* b, size_t len) {
+    return CRYPTO_memcmp(a, b, len) == 0;
+}
+
+} // namespace vmg
@@ -0,0 +1,506 @@
+/**
+ * @file telemetry_bus.cpp
+ * @brief Lock-free telemetry bus Implementation
+ */
+
+#include "telemetry_bus.hpp"
+#include <atomic>
+#include <new>
+#include <thread>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace vmg {
+
+// ============================================================================
+// Shared layout
+// ============================================================================
+
+static constexpr uint32_t BUS_MAGIC = 0x564D4254;   // "VMBT"
+static constexpr uint32_t BUS_VERSION = 1;
+
+static constexpr uint32_t SUBSCRIBER_FREE = 0;
+static constexpr uint32_t SUBSCRIBER_ACTIVE = 1;
+static constexpr uint32_t SUBSCRIBER_JOINING = 2;  // Entry taken, cursor not yet valid
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "bus needs lock-free 64-bit atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "bus needs lock-free 32-bit atomics");
+
+struct alignas(64) SubscriberEntry {
+    std::atomic<uint64_t> cursor;       // Next sequence this subscriber will read
+    std::atomic<uint32_t> state;
+    std::atomic<int32_t> pid;           // Owner process, for reaping crashed subscribers
+};
+
+/**
+ * @brief Control block at the start of the region (all-zero is a valid
+ *        empty bus, so a freshly truncated shm segment needs no setup
+ *        beyond the geometry)
+ */
+struct BusControl {
+    std::atomic<uint32_t> magic;        // Stored last by the creator
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+
+    alignas(64) std::atomic<uint64_t> claim;        // Next sequence to hand out
+    alignas(64) std::atomic<uint64_t> gating;       // Cached min subscriber cursor
+    alignas(64) std::atomic<uint32_t> notify;       // Futex word
+    std::atomic<uint32_t> waiters;
+    alignas(64) std::atomic<uint64_t> dropped_full;
+    std::atomic<uint64_t> dropped_oversize;
+
+    SubscriberEntry subscribers[TelemetryBus::MAX_SUBSCRIBERS];
+};
+
+/**
+ * @brief Slot header; sequence is published last with release ordering
+ */
+struct SlotHeader {
+    std::atomic<uint64_t> sequence;     // sequence + 1 once written (0 = never)
+    uint64_t publish_ns;
+    uint32_t length;
+    uint8_t topic;
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(SlotHeader) == TelemetryBus::SLOT_HEADER_SIZE, "slot header layout");
+
+static size_t controlSize() {
+    return (sizeof(BusControl) + 63) & ~static_cast<size_t>(63);
+}
+
+static uint64_t monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Shared (non-private) futex ops so waiters in other processes are woken too
+static void futexWait(std::atomic<uint32_t>* word, uint32_t expected, std::chrono::milliseconds timeout) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    ts.tv_nsec = static_cast<long>((timeout.count() % 1000) * 1000000);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+static void futexWakeAll(std::atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+static constexpr int WAIT_SPIN_ITERATIONS = 2000;
+
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+static bool processAlive(int32_t pid) {
+    return pid <= 0 || kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+// ============================================================================
+// TelemetryBus
+// ============================================================================
+
+TelemetryBus::TelemetryBus(const TelemetryBusConfig& config)
+    : config_(config) {
+}
+
+TelemetryBus::~TelemetryBus() {
+    close();
+}
+
+bool TelemetryBus::open() {
+    if (control_) {
+        return true;
+    }
+
+    if (config_.slot_count < 2 || (config_.slot_count & (config_.slot_count - 1)) != 0 ||
+        config_.slot_count > UINT32_MAX) {
+        std::cerr << "[Bus] slot_count must be a power of two" << std::endl;
+        return false;
+    }
+    if (config_.slot_size <= SLOT_HEADER_SIZE || config_.slot_size % 64 != 0 ||
+        config_.slot_size > UINT32_MAX) {
+        std::cerr << "[Bus] slot_size must be a multiple of 64 above "
+                  << SLOT_HEADER_SIZE << std::endl;
+        return false;
+    }
+
+    if (!config_.shm_name.empty()) {
+        return openShared();
+    }
+
+    slot_count_ = config_.slot_count;
+    slot_size_ = config_.slot_size;
+    region_size_ = controlSize() + slot_count_ * slot_size_;
+
+    void* region = std::aligned_alloc(64, region_size_);
+    if (!region) {
+        return false;
+    }
+    std::memset(region, 0, region_size_);
+    control_ = new (region) BusControl();
+    control_->version = BUS_VERSION;
+    control_->slot_count = static_cast<uint32_t>(slot_count_);
+    control_->slot_size = static_cast<uint32_t>(slot_size_);
+    control_->magic.store(BUS_MAGIC, std::memory_order_release);
+
+    slots_ = static_cast<uint8_t*>(region) + controlSize();
+    mask_ = slot_count_ - 1;
+    shared_ = false;
+    return true;
+}
+
+bool TelemetryBus::openShared() {
+    const char* name = config_.shm_name.c_str();
+    bool creator = true;
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0660);
+    if (fd < 0 && errno == EEXIST) {
+        creator = false;
+        fd = shm_open(name, O_RDWR, 0);
+    }
+    if (fd < 0) {
+        std::cerr << "[Bus] shm_open " << config_.shm_name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    size_t size = 0;
+    if (creator) {
+        size = controlSize() + config_.slot_count * config_.slot_size;
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            std::cerr << "[Bus] ftruncate: " << strerror(errno) << std::endl;
+            ::close(fd);
+            shm_unlink(name);
+            return false;
+        }
+    } else {
+        // The creator may still be between shm_open and ftruncate
+        for (int i = 0; i < 100 && size == 0; i++) {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                size = static_cast<size_t>(st.st_size);
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        if (size < controlSize()) {
+            std::cerr << "[Bus] " << config_.shm_name << " is not initialized" << std::endl;
+            ::close(fd);
+            return false;
+        }
+    }
+
+    void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (region == MAP_FAILED) {
+        std::cerr << "[Bus] mmap: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    BusControl* control = static_cast<BusControl*>(region);
+    if (creator) {
+        // ftruncate zero-filled the segment: counters, cursors and slot
+        // sequences already hold their initial values
+        control->version = BUS_VERSION;
+        control->slot_count = static_cast<uint32_t>(config_.slot_count);
+        control->slot_size = static_cast<uint32_t>(config_.slot_size);
+        control->magic.store(BUS_MAGIC, std::memory_order_release);
+    } else {
+        bool ready = false;
+        for (int i = 0; i < 100 && !ready; i++) {
+            ready = control->magic.load(std::memory_order_acquire) == BUS_MAGIC;
+            if (!ready) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        size_t expected = ready ? controlSize() +
+            static_cast<size_t>(control->slot_count) * control->slot_size : 0;
+        if (!ready || control->version != BUS_VERSION || expected != size) {
+            std::cerr << "[Bus] " << config_.shm_name << " has an incompatible layout" << std::endl;
+            munmap(region, size);
+            return false;
+        }
+        if (control->slot_count != config_.slot_count || control->slot_size != config_.slot_size) {
+            std::cout << "[Bus] Attached with existing geometry " << control->slot_count
+                      << " x " << control->slot_size << " bytes" << std::endl;
+        }
+    }
+
+    control_ = control;
+    slot_count_ = control->slot_count;
+    slot_size_ = control->slot_size;
+    slots_ = static_cast<uint8_t*>(region) + controlSize();
+    mask_ = slot_count_ - 1;
+    region_size_ = size;
+    shared_ = true;
+
+    std::cout << "[Bus] " << (creator ? "Created " : "Attached ") << config_.shm_name
+              << " (" << slot_count_ << " slots x " << slot_size_ << " bytes)" << std::endl;
+    return true;
+}
+
+void TelemetryBus::close() {
+    if (!control_) {
+        return;
+    }
+    if (shared_) {
+        munmap(control_, region_size_);
+    } else {
+        control_->~BusControl();
+        std::free(control_);
+    }
+    control_ = nullptr;
+    slots_ = nullptr;
+}
+
+bool TelemetryBus::unlink(const std::string& shm_name) {
+    return shm_unlink(shm_name.c_str()) == 0;
+}
+
+uint8_t* TelemetryBus::slotAt(uint64_t sequence) const {
+    return slots_ + (sequence & mask_) * slot_size_;
+}
+
+/**
+ * Slowest active cursor, or `claim` when nobody is subscribed. Subscribers
+ * of crashed processes that are holding the ring back are released here,
+ * so the kill() probe only runs on the (rare) ring-full path.
+ */
+uint64_t TelemetryBus::minCursor(uint64_t claim) {
+    uint64_t min = claim;
+    for (size_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        SubscriberEntry& entry = control_->subscribers[i];
+        if (entry.state.load(std::memory_order_seq_cst) != SUBSCRIBER_ACTIVE) {
+            continue;
+        }
+        uint64_t cursor = entry.cursor.load(std::memory_order_acquire);
+        if (cursor + slot_count_ <= claim && !processAlive(entry.pid.load(std::memory_order_relaxed))) {
+            uint32_t active = SUBSCRIBER_ACTIVE;
+            if (entry.state.compare_exchange_strong(active, SUBSCRIBER_FREE)) {
+                std::cerr << "[Bus] Released subscriber " << i << " of dead process "
+                          << entry.pid.load(std::memory_order_relaxed) << std::endl;
+            }
+            continue;
+        }
+        if (cursor < min) {
+            min = cursor;
+        }
+    }
+    return min;
+}
+
+bool TelemetryBus::publish(BusTopic topic, const uint8_t* data, size_t len) {
+    if (!control_) {
+        return false;
+    }
+    if (len > payloadCapacity() || topic >= BUS_TOPIC_COUNT) {
+        control_->dropped_oversize.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Claim a sequence whose slot every subscriber has already consumed
+    uint64_t seq = control_->claim.load(std::memory_order_relaxed);
+    do {
+        if (seq >= control_->gating.load(std::memory_order_acquire) + slot_count_) {
+            uint64_t gate = minCursor(seq);
+            control_->gating.store(gate, std::memory_order_release);
+            if (seq >= gate + slot_count_) {
+                control_->dropped_full.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+    } while (!control_->claim.compare_exchange_weak(seq, seq + 1,
+                                                    std::memory_order_acq_rel,
+                                                    std::memory_order_relaxed));
+
+    uint8_t* slot = slotAt(seq);
+    SlotHeader* header = reinterpret_cast<SlotHeader*>(slot);
+    header->publish_ns = monotonicNs();
+    header->length = static_cast<uint32_t>(len);
+    header->topic = topic;
+    if (len > 0) {
+        std::memcpy(slot + SLOT_HEADER_SIZE, data, len);
+    }
+    header->sequence.store(seq + 1, std::memory_order_release);
+
+    // Pairs with the fence in waitFor(): either we see the waiter, or the
+    // waiter's re-check sees this event
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (control_->waiters.load(std::memory_order_relaxed) > 0) {
+        control_->notify.fetch_add(1, std::memory_order_release);
+        futexWakeAll(&control_->notify);
+    }
+    return true;
+}
+
+TelemetrySubscription TelemetryBus::subscribe(uint64_t topic_mask) {
+    if (!control_) {
+        return TelemetrySubscription();
+    }
+
+    for (size_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        SubscriberEntry& entry = control_->subscribers[i];
+        uint32_t free_state = SUBSCRIBER_FREE;
+        if (entry.state.load(std::memory_order_relaxed) != SUBSCRIBER_FREE ||
+            !entry.state.compare_exchange_strong(free_state, SUBSCRIBER_JOINING)) {
+            continue;
+        }
+        entry.pid.store(static_cast<int32_t>(getpid()), std::memory_order_relaxed);
+        entry.cursor.store(control_->claim.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        entry.state.store(SUBSCRIBER_ACTIVE, std::memory_order_seq_cst);
+
+        // Re-read the claim after going ACTIVE: a producer that computed its
+        // gate without seeing this entry did so at a claim <= this one
+        uint64_t cursor = control_->claim.load(std::memory_order_seq_cst);
+        entry.cursor.store(cursor, std::memory_order_release);
+        return TelemetrySubscription(this, static_cast<int>(i), topic_mask, cursor);
+    }
+
+    std::cerr << "[Bus] No free subscriber entry (max " << MAX_SUBSCRIBERS << ")" << std::endl;
+    return TelemetrySubscription();
+}
+
+void TelemetryBus::releaseSubscriber(int index) {
+    if (control_ && index >= 0 && static_cast<size_t>(index) < MAX_SUBSCRIBERS) {
+        control_->subscribers[index].state.store(SUBSCRIBER_FREE, std::memory_order_release);
+    }
+}
+
+TelemetryBusStats TelemetryBus::getStats() const {
+    TelemetryBusStats stats;
+    if (!control_) {
+        return stats;
+    }
+    stats.published = control_->claim.load(std::memory_order_relaxed);
+    stats.dropped_full = control_->dropped_full.load(std::memory_order_relaxed);
+    stats.dropped_oversize = control_->dropped_oversize.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (control_->subscribers[i].state.load(std::memory_order_relaxed) == SUBSCRIBER_ACTIVE) {
+            stats.subscribers++;
+        }
+    }
+    stats.slot_count = slot_count_;
+    stats.slot_size = slot_size_;
+    return stats;
+}
+
+// ============================================================================
+// TelemetrySubscription
+// ============================================================================
+
+TelemetrySubscription::~TelemetrySubscription() {
+    release();
+}
+
+TelemetrySubscription::TelemetrySubscription(TelemetrySubscription&& other) noexcept
+    : bus_(other.bus_), index_(other.index_), topic_mask_(other.topic_mask_), cursor_(other.cursor_) {
+    other.bus_ = nullptr;
+    other.index_ = -1;
+}
+
+TelemetrySubscription& TelemetrySubscription::operator=(TelemetrySubscription&& other) noexcept {
+    if (this != &other) {
+        release();
+        bus_ = other.bus_;
+        index_ = other.index_;
+        topic_mask_ = other.topic_mask_;
+        cursor_ = other.cursor_;
+        other.bus_ = nullptr;
+        other.index_ = -1;
+    }
+    return *this;
+}
+
+void TelemetrySubscription::release() {
+    if (bus_) {
+        bus_->releaseSubscriber(index_);
+        bus_ = nullptr;
+        index_ = -1;
+    }
+}
+
+size_t TelemetrySubscription::poll(const BusHandler& handler, size_t max_events) {
+    if (!bus_ || !bus_->control_) {
+        return 0;
+    }
+
+    SubscriberEntry& entry = bus_->control_->subscribers[index_];
+    size_t consumed = 0;
+    while (consumed < max_events) {
+        const uint8_t* slot = bus_->slotAt(cursor_);
+        const SlotHeader* header = reinterpret_cast<const SlotHeader*>(slot);
+        // Events are consumed in sequence order, even if a later one landed first
+        if (header->sequence.load(std::memory_order_acquire) != cursor_ + 1) {
+            break;
+        }
+        if (topic_mask_ & topicBit(header->topic)) {
+            BusMessageView view{header->topic, cursor_, header->publish_ns,
+                                slot + TelemetryBus::SLOT_HEADER_SIZE, header->length};
+            handler(view);
+        }
+        cursor_++;
+        consumed++;
+        // Hand the slot back only after the handler is done with the view
+        entry.cursor.store(cursor_, std::memory_order_release);
+    }
+    return consumed;
+}
+
+bool TelemetrySubscription::pending() const {
+    if (!bus_ || !bus_->control_) {
+        return false;
+    }
+    const SlotHeader* header = reinterpret_cast<const SlotHeader*>(bus_->slotAt(cursor_));
+    return header->sequence.load(std::memory_order_acquire) == cursor_ + 1;
+}
+
+bool TelemetrySubscription::waitFor(std::chrono::milliseconds timeout) {
+    if (!bus_ || !bus_->control_) {
+        return false;
+    }
+    // Events usually arrive in bursts: a short spin keeps busy subscribers
+    // off the futex, and publishers skip the wake syscall when nobody sleeps
+    for (int i = 0; i < WAIT_SPIN_ITERATIONS; i++) {
+        if (pending()) {
+            return true;
+        }
+        cpuRelax();
+    }
+
+    BusControl* control = bus_->control_;
+    control->waiters.fetch_add(1, std::memory_order_seq_cst);
+    uint32_t word = control->notify.load(std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!pending()) {
+        futexWait(&control->notify, word, timeout);
+    }
+    control->waiters.fetch_sub(1, std::memory_order_relaxed);
+    return pending();
+}
+
+uint64_t TelemetrySubscription::lag() const {
+    if (!bus_ || !bus_->control_) {
+        return 0;
+    }
+    uint64_t claim = bus_->control_->claim.load(std::memory_order_relaxed);
+    return claim > cursor_ ? claim - cursor_ : 0;
+}
+
+} // namespace vmg
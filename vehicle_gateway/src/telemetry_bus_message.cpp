@@ -0,0 +1,23 @@
+/**
+ * @file telemetry_bus_message.cpp
+ * @brief UnifiedMessage <-> TelemetryBus glue
+ *
+ * Kept out of telemetry_bus.cpp so that raw-topic publishers (DoIP server)
+ * link the bus without pulling in nlohmann/json.
+ */
+
+#include "telemetry_bus.hpp"
+#include "unified_message_codec.hpp"
+
+namespace vmg {
+
+bool TelemetryBus::publish(const UnifiedMessage& msg) {
+    std::vector<uint8_t> frame = UnifiedMessageCodec::encodeBinary(msg);
+    return publish(topicOf(msg.getMessageType()), frame.data(), frame.size());
+}
+
+UnifiedMessage BusMessageView::toMessage() const {
+    return UnifiedMessageCodec::decodeBinary(data, size);
+}
+
+} // namespace vmg
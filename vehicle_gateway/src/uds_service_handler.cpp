@@ -4,321 +4,917 @@
  */
 
 #include "uds_service_handler.hpp"
+#include "dtc_store.hpp"
+#include "security_access.hpp"
+#include <algorithm>
 #include <iostream>
-#include <random>
+#include <chrono>
 #include <cstring>
 
 namespace vmg {
 
 constexpr uint8_t UDS_POSITIVE_RESPONSE_OFFSET = 0x40;
 constexpr uint8_t UDS_NEGATIVE_RESPONSE = 0x7F;
+constexpr size_t UDS_NEGATIVE_RESPONSE_SIZE = 3;
+
+constexpr UDSServiceHandler::DispatchTable UDSServiceHandler::buildDispatchTable() {
+    DispatchTable table{};
+    for (auto& entry : table) {
+        entry = &UDSServiceHandler::handleNotSupported;
+    }
+    table[static_cast<uint8_t>(UDSServiceID::DiagnosticSessionControl)] = &UDSServiceHandler::handleDiagnosticSessionControl;
+    table[static_cast<uint8_t>(UDSServiceID::ECUReset)] = &UDSServiceHandler::handleECUReset;
+    table[static_cast<uint8_t>(UDSServiceID::SecurityAccess)] = &UDSServiceHandler::handleSecurityAccess;
+    table[static_cast<uint8_t>(UDSServiceID::TesterPresent)] = &UDSServiceHandler::handleTesterPresent;
+    table[static_cast<uint8_t>(UDSServiceID::ReadDataByIdentifier)] = &UDSServiceHandler::handleReadDataByIdentifier;
+    table[static_cast<uint8_t>(UDSServiceID::ReadDataByPeriodicIdentifier)] = &UDSServiceHandler::handleReadDataByPeriodicIdentifier;
+    table[static_cast<uint8_t>(UDSServiceID::DynamicallyDefineDataIdentifier)] = &UDSServiceHandler::handleDynamicallyDefineDataIdentifier;
+    table[static_cast<uint8_t>(UDSServiceID::WriteDataByIdentifier)] = &UDSServiceHandler::handleWriteDataByIdentifier;
+    table[static_cast<uint8_t>(UDSServiceID::ReadDTCInformation)] = &UDSServiceHandler::handleReadDTCInformation;
+    table[static_cast<uint8_t>(UDSServiceID::ClearDTCInformation)] = &UDSServiceHandler::handleClearDiagnosticInformation;
+    table[static_cast<uint8_t>(UDSServiceID::RoutineControl)] = &UDSServiceHandler::handleRoutineControl;
+    return table;
+}
+
+constexpr UDSServiceHandler::DispatchTable UDSServiceHandler::DISPATCH = UDSServiceHandler::buildDispatchTable();
 
 UDSServiceHandler::UDSServiceHandler()
-    : vin_("WBADT43452G296403"),
-      ecu_serial_("ECU123456789"),
-      software_version_("v1.0.0"),
-      hardware_version_("HW_REV_A"),
+    : plans_dirty_(false),
+      dtc_store_(nullptr),
+      security_engine_(nullptr),
       current_session_(0x01),
-      security_unlocked_(false),
-      security_seed_(0),
-      security_attempts_(0) {
+      tester_address_(0) {
+    setVIN("WBADT43452G296403");
+    setECUSerialNumber("ECU123456789");
+    setSoftwareVersion("v1.0.0");
+    setHardwareVersion("HW_REV_A");
 }
 
-std::vector<uint8_t> UDSServiceHandler::processRequest(const std::vector<uint8_t>& request) {
+size_t UDSServiceHandler::processRequest(ConstByteSpan request, uint8_t* response, size_t capacity) {
+    if (capacity < UDS_NEGATIVE_RESPONSE_SIZE) {
+        return 0;
+    }
+
+    UDSResponseWriter out(response, capacity);
+
     if (request.empty()) {
-        return buildNegativeResponse(0x00, UDSNRC::IncorrectMessageLength);
+        writeNegativeResponse(out, 0x00, UDSNRC::IncorrectMessageLength);
+        return out.size();
     }
 
     uint8_t sid = request[0];
 
     try {
-        switch (static_cast<UDSServiceID>(sid)) {
-            case UDSServiceID::DiagnosticSessionControl:
-                return handleDiagnosticSessionControl(request);
-
-            case UDSServiceID::ECUReset:
-                return handleECUReset(request);
+        (this->*DISPATCH[sid])(request, out);
+    } catch (const std::exception& e) {
+        std::cerr << "UDS service error: " << e.what() << std::endl;
+        out.reset();
+        writeNegativeResponse(out, sid, UDSNRC::GeneralReject);
+    }
 
-            case UDSServiceID::SecurityAccess:
-                return handleSecurityAccess(request);
+    if (out.overflow()) {
+        out.reset();
+        writeNegativeResponse(out, sid, UDSNRC::ResponseTooLong);
+    }
+    return out.size();
+}
 
-            case UDSServiceID::TesterPresent:
-                return handleTesterPresent(request);
+std::vector<uint8_t> UDSServiceHandler::processRequest(const std::vector<uint8_t>& request) {
+    std::vector<uint8_t> response(MAX_RESPONSE_SIZE);
+    response.resize(processRequest(ConstByteSpan(request), response.data(), response.size()));
+    return response;
+}
 
-            case UDSServiceID::ReadDataByIdentifier:
-                return handleReadDataByIdentifier(request);
+size_t UDSServiceHandler::collectPeriodicFrame(uint16_t tester_address, uint64_t now_ms, uint8_t* frame,
+                                               size_t capacity, uint64_t& next_due_ms) {
+    next_due_ms = PERIODIC_NONE_DUE;
+    auto it = periodic_.find(tester_address);
+    if (it == periodic_.end()) {
+        return 0;
+    }
+    PeriodicDIDScheduler& schedule = it->second;
 
-            case UDSServiceID::WriteDataByIdentifier:
-                return handleWriteDataByIdentifier(request);
+    if (plans_dirty_) {
+        compileDynamicPlans();
+    }
 
-            case UDSServiceID::ReadDTCInformation:
-                return handleReadDTCInformation(request);
+    uint8_t due[MAX_READ_DIDS];
+    size_t count = schedule.collectDue(now_ms, due, sizeof(due));
+    next_due_ms = schedule.nextDueMs();
+    if (count == 0 || capacity < 1) {
+        return 0;
+    }
 
-            case UDSServiceID::RoutineControl:
-                return handleRoutineControl(request);
+    UDSResponseWriter out(frame, capacity);
+    writePositiveResponse(out, static_cast<uint8_t>(UDSServiceID::ReadDataByPeriodicIdentifier));
 
-            default:
-                return buildNegativeResponse(sid, UDSNRC::ServiceNotSupported);
+    size_t records = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (putPeriodicRecord(due[i], out)) {
+            records++;
         }
-    } catch (const std::exception& e) {
-        std::cerr << "UDS service error: " << e.what() << std::endl;
-        return buildNegativeResponse(sid, UDSNRC::GeneralReject);
     }
+    if (records == 0) {
+        return 0;
+    }
+    schedule.recordFrame(records);
+    return out.size();
+}
+
+std::vector<uint8_t> UDSServiceHandler::collectPeriodicFrame(uint16_t tester_address, uint64_t now_ms,
+                                                             uint64_t& next_due_ms) {
+    std::vector<uint8_t> frame(MAX_RESPONSE_SIZE);
+    frame.resize(collectPeriodicFrame(tester_address, now_ms, frame.data(), frame.size(), next_due_ms));
+    return frame;
+}
+
+PeriodicSchedulerStats UDSServiceHandler::getPeriodicStats() const {
+    PeriodicSchedulerStats total;
+    for (const auto& entry : periodic_) {
+        const PeriodicSchedulerStats& stats = entry.second.getStats();
+        total.frames += stats.frames;
+        total.records += stats.records;
+        total.skipped_slots += stats.skipped_slots;
+    }
+    return total;
 }
 
 void UDSServiceHandler::setVIN(const std::string& vin) {
-    vin_ = vin;
+    setStaticDID(UDSDID::VIN, vin, 17);  // Fixed 17 bytes, space padded
 }
 
 void UDSServiceHandler::setECUSerialNumber(const std::string& serial) {
-    ecu_serial_ = serial;
+    setStaticDID(UDSDID::ECUSerialNumber, serial);
 }
 
 void UDSServiceHandler::setSoftwareVersion(const std::string& version) {
-    software_version_ = version;
+    setStaticDID(UDSDID::ECUSoftwareVersion, version);
 }
 
 void UDSServiceHandler::setHardwareVersion(const std::string& version) {
-    hardware_version_ = version;
+    setStaticDID(UDSDID::ECUHardwareVersion, version);
 }
 
 void UDSServiceHandler::registerDIDReadHandler(uint16_t did, DIDHandler handler) {
-    did_handlers_[did] = handler;
+    insertDID(did).handler = std::move(handler);
+    plans_dirty_ = true;  // Plans reading this DID switch to the handler
+}
+
+void UDSServiceHandler::registerDIDWriteHandler(uint16_t did, DIDWriteHandler handler, bool requires_security) {
+    for (auto& entry : write_handlers_) {
+        if (entry.did == did) {
+            entry.handler = std::move(handler);
+            entry.requires_security = requires_security;
+            return;
+        }
+    }
+    write_handlers_.push_back(DIDWriteEntry{did, std::move(handler), requires_security});
+}
+
+void UDSServiceHandler::registerMemoryRegion(uint32_t address, const uint8_t* data, size_t size) {
+    memory_regions_.push_back(MemoryRegion{address, data, size});
+}
+
+void UDSServiceHandler::attachDTCStore(DTCStore* store) {
+    dtc_store_ = store;
+}
+
+void UDSServiceHandler::attachSecurityEngine(SecurityAccessEngine* engine) {
+    security_engine_ = engine;
+}
+
+bool UDSServiceHandler::securityUnlocked() const {
+    return security_engine_ && security_engine_->unlockedLevel(tester_address_) != 0;
+}
+
+// ============================================================================
+// DID Index
+// ============================================================================
+
+const UDSServiceHandler::DIDEntry* UDSServiceHandler::findDID(uint16_t did) const {
+    auto it = std::lower_bound(did_index_.begin(), did_index_.end(), did,
+                               [](const DIDEntry& entry, uint16_t key) { return entry.did < key; });
+    return (it != did_index_.end() && it->did == did) ? &*it : nullptr;
+}
+
+UDSServiceHandler::DIDEntry& UDSServiceHandler::insertDID(uint16_t did) {
+    auto it = std::lower_bound(did_index_.begin(), did_index_.end(), did,
+                               [](const DIDEntry& entry, uint16_t key) { return entry.did < key; });
+    if (it == did_index_.end() || it->did != did) {
+        DIDEntry entry;
+        entry.did = did;
+        it = did_index_.insert(it, std::move(entry));
+        plans_dirty_ = true;
+    }
+    return *it;
+}
+
+void UDSServiceHandler::setStaticDID(UDSDID did, const std::string& value, size_t fixed_length) {
+    // Prebuilt record: DID(2) + data, copied as-is into responses
+    std::vector<uint8_t>& data = insertDID(static_cast<uint16_t>(did)).data;
+    data.clear();
+    data.push_back(static_cast<uint8_t>(static_cast<uint16_t>(did) >> 8));
+    data.push_back(static_cast<uint8_t>(static_cast<uint16_t>(did) & 0xFF));
+    data.insert(data.end(), value.begin(), value.end());
+    if (fixed_length != 0) {
+        data.resize(2 + fixed_length, ' ');
+    }
+    plans_dirty_ = true;  // Record may have moved or shrunk
+}
+
+bool UDSServiceHandler::putPeriodicRecord(uint8_t pdid, UDSResponseWriter& out) {
+    // Periodic record: PDID(1) + data, i.e. the DID record without the 0xF2 high byte
+    uint16_t did = PERIODIC_DID_BASE | pdid;
+    const DIDEntry* entry = findDID(did);
+    if (!entry) {
+        return false;
+    }
+
+    if (entry->isDynamic()) {
+        if (!entry->plan_valid || out.room() < 1 + entry->dynamic_size ||
+            !runCopyPlan(*entry, out.tail() + 1)) {
+            return false;
+        }
+        out.put(pdid);
+        out.commit(entry->dynamic_size);
+    } else if (entry->handler) {
+        std::vector<uint8_t> data;
+        try {
+            data = entry->handler(did);
+        } catch (const std::exception& e) {
+            std::cerr << "DID handler error: " << e.what() << std::endl;
+            return false;
+        }
+        if (out.room() < 1 + data.size()) {
+            return false;  // Does not fit this frame; goes out next period
+        }
+        out.put(pdid);
+        out.put(data.data(), data.size());
+    } else {
+        if (entry->data.size() < 2 || out.room() < entry->data.size() - 1) {
+            return false;
+        }
+        out.put(pdid);
+        out.put(entry->data.data() + 2, entry->data.size() - 2);
+    }
+    return true;
+}
+
+// ============================================================================
+// Dynamic DID Copy Plans
+// ============================================================================
+
+bool UDSServiceHandler::resolveSource(const DynamicSource& source, CopyStep& step) const {
+    step.len = source.size;
+
+    if (source.by_memory) {
+        for (const auto& region : memory_regions_) {
+            if (source.address >= region.address &&
+                static_cast<uint64_t>(source.address - region.address) + source.size <= region.size) {
+                step.src = region.data + (source.address - region.address);
+                step.source_did = 0;
+                step.offset = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const DIDEntry* entry = findDID(source.source_did);
+    if (!entry || entry->isDynamic()) {
+        return false;  // No nesting of dynamic DIDs
+    }
+
+    size_t offset = source.position - 1;
+    if (entry->handler) {
+        // Handler data is produced per read; its length is checked then
+        step.src = nullptr;
+        step.source_did = source.source_did;
+        step.offset = static_cast<uint16_t>(offset);
+        return true;
+    }
+    if (entry->data.size() < 2 + offset + source.size) {
+        return false;
+    }
+    step.src = entry->data.data() + 2 + offset;  // Skip the DID prefix of the record
+    step.source_did = source.source_did;
+    step.offset = 0;
+    return true;
+}
+
+bool UDSServiceHandler::compilePlan(DIDEntry& entry) const {
+    entry.plan.clear();
+    entry.dynamic_size = 0;
+
+    for (const auto& source : entry.sources) {
+        CopyStep step;
+        if (!resolveSource(source, step)) {
+            return false;
+        }
+        entry.dynamic_size += step.len;
+        if (entry.dynamic_size > MAX_DYNAMIC_DID_SIZE) {
+            return false;
+        }
+
+        // Merge with the previous step when the bytes are adjacent in the source
+        if (!entry.plan.empty()) {
+            CopyStep& last = entry.plan.back();
+            bool adjacent = step.src ? (last.src && last.src + last.len == step.src)
+                                     : (!last.src && last.source_did == step.source_did &&
+                                        last.offset + last.len == step.offset);
+            if (adjacent) {
+                last.len = static_cast<uint16_t>(last.len + step.len);
+                continue;
+            }
+        }
+        entry.plan.push_back(step);
+    }
+    return true;
+}
+
+void UDSServiceHandler::compileDynamicPlans() {
+    for (auto& entry : did_index_) {
+        if (entry.isDynamic()) {
+            entry.plan_valid = compilePlan(entry);
+        }
+    }
+    plans_dirty_ = false;
+}
+
+bool UDSServiceHandler::runCopyPlan(const DIDEntry& entry, uint8_t* dst) const {
+    // Handler sources are read once per plan run
+    uint16_t cached_did = 0;
+    bool cached = false;
+    std::vector<uint8_t> cached_data;
+
+    for (const auto& step : entry.plan) {
+        if (step.src) {
+            std::memcpy(dst, step.src, step.len);
+        } else {
+            if (!cached || cached_did != step.source_did) {
+                const DIDEntry* source = findDID(step.source_did);
+                if (!source || !source->handler) {
+                    return false;
+                }
+                try {
+                    cached_data = source->handler(step.source_did);
+                } catch (const std::exception& e) {
+                    std::cerr << "DID handler error: " << e.what() << std::endl;
+                    return false;
+                }
+                cached_did = step.source_did;
+                cached = true;
+            }
+            if (cached_data.size() < static_cast<size_t>(step.offset) + step.len) {
+                return false;
+            }
+            std::memcpy(dst, cached_data.data() + step.offset, step.len);
+        }
+        dst += step.len;
+    }
+    return true;
 }
 
 // ============================================================================
 // Service Handlers
 // ============================================================================
 
-std::vector<uint8_t> UDSServiceHandler::handleDiagnosticSessionControl(
-    const std::vector<uint8_t>& request) {
-    
+void UDSServiceHandler::handleDiagnosticSessionControl(ConstByteSpan request, UDSResponseWriter& out) {
     if (request.size() < 2) {
-        return buildNegativeResponse(request[0], UDSNRC::IncorrectMessageLength);
+        writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+        return;
     }
 
     uint8_t session_type = request[1];
 
     // Validate session type
     if (session_type < 0x01 || session_type > 0x03) {
-        return buildNegativeResponse(request[0], UDSNRC::SubFunctionNotSupported);
+        writeNegativeResponse(out, request[0], UDSNRC::SubFunctionNotSupported);
+        return;
     }
 
     current_session_ = session_type;
     
     // Reset security on session change
     if (session_type == 0x01) {  // Default session
-        security_unlocked_ = false;
+        if (security_engine_) {
+            security_engine_->lock(tester_address_);
+        }
+        // Periodic transmission ends with the non-default session
+        for (auto& entry : periodic_) {
+            entry.second.stopAll();
+        }
     }
 
     std::cout << "Session control: type=0x" << std::hex 
               << static_cast<int>(session_type) << std::dec << std::endl;
 
     // Response: echo session type
-    return buildPositiveResponse(request[0], {session_type});
+    writePositiveResponse(out, request[0]);
+    out.put(session_type);
 }
 
-std::vector<uint8_t> UDSServiceHandler::handleECUReset(const std::vector<uint8_t>& request) {
+void UDSServiceHandler::handleECUReset(ConstByteSpan request, UDSResponseWriter& out) {
     if (request.size() < 2) {
-        return buildNegativeResponse(request[0], UDSNRC::IncorrectMessageLength);
+        writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+        return;
     }
 
     uint8_t reset_type = request[1];
 
     // Validate reset type (0x01 = hard, 0x02 = key off/on, 0x03 = soft)
     if (reset_type < 0x01 || reset_type > 0x03) {
-        return buildNegativeResponse(request[0], UDSNRC::SubFunctionNotSupported);
+        writeNegativeResponse(out, request[0], UDSNRC::SubFunctionNotSupported);
+        return;
     }
 
     std::cout << "ECU reset requested: type=0x" << std::hex 
               << static_cast<int>(reset_type) << std::dec << std::endl;
 
     // In gateway, we don't actually reset - just acknowledge
-    return buildPositiveResponse(request[0], {reset_type});
+    writePositiveResponse(out, request[0]);
+    out.put(reset_type);
 }
 
-std::vector<uint8_t> UDSServiceHandler::handleSecurityAccess(const std::vector<uint8_t>& request) {
+void UDSServiceHandler::handleSecurityAccess(ConstByteSpan request, UDSResponseWriter& out) {
+    if (!security_engine_) {
+        writeNegativeResponse(out, request[0], UDSNRC::ServiceNotSupported);
+        return;
+    }
     if (request.size() < 2) {
-        return buildNegativeResponse(request[0], UDSNRC::IncorrectMessageLength);
+        writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+        return;
     }
 
     uint8_t sub_function = request[1];
-
-    if (sub_function == 0x01) {
-        // Request seed
-        if (security_unlocked_) {
-            // Already unlocked, return seed = 0
-            return buildPositiveResponse(request[0], {0x01, 0x00, 0x00, 0x00, 0x00});
+    uint64_t now_ms = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    SecurityResult result;
+
+    if (sub_function & 0x01) {
+        // Request seed (odd sub-function); all zeros if already unlocked
+        uint8_t seed[SECURITY_SEED_SIZE];
+        result = security_engine_->requestSeed(tester_address_, sub_function, now_ms, seed);
+        if (result == SecurityResult::Ok || result == SecurityResult::AlreadyUnlocked) {
+            writePositiveResponse(out, request[0]);
+            out.put(sub_function);
+            out.put(seed, sizeof(seed));
+            return;
         }
-
-        // Check attempt limit
-        if (security_attempts_ >= 3) {
-            return buildNegativeResponse(request[0], UDSNRC::ExceedNumberOfAttempts);
+    } else {
+        // Send key (even sub-function) for the preceding seed level
+        if (request.size() < 3) {
+            writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+            return;
         }
+        result = security_engine_->sendKey(tester_address_, static_cast<uint8_t>(sub_function - 1),
+                                           request.data() + 2, request.size() - 2, now_ms);
+        if (result == SecurityResult::Ok) {
+            writePositiveResponse(out, request[0]);
+            out.put(sub_function);
+            return;
+        }
+    }
+
+    if (result == SecurityResult::ExceededAttempts) {
+        std::cout << "Security access: tester 0x" << std::hex << tester_address_
+                  << " locked out" << std::dec << std::endl;
+    }
 
-        // Generate random seed
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<uint32_t> dis(0x10000000, 0xFFFFFFFF);
-        security_seed_ = dis(gen);
+    UDSNRC nrc;
+    switch (result) {
+        case SecurityResult::LevelNotSupported: nrc = UDSNRC::SubFunctionNotSupported; break;
+        case SecurityResult::SequenceError:     nrc = UDSNRC::RequestSequenceError; break;
+        case SecurityResult::InvalidKey:        nrc = UDSNRC::InvalidKey; break;
+        case SecurityResult::ExceededAttempts:  nrc = UDSNRC::ExceedNumberOfAttempts; break;
+        case SecurityResult::DelayNotExpired:   nrc = UDSNRC::RequiredTimeDelayNotExpired; break;
+        case SecurityResult::RandomFailure:     nrc = UDSNRC::ConditionsNotCorrect; break;
+        default:                                nrc = UDSNRC::GeneralReject; break;
+    }
+    writeNegativeResponse(out, request[0], nrc);
+}
 
-        std::vector<uint8_t> response_data = {0x01};
-        response_data.push_back((security_seed_ >> 24) & 0xFF);
-        response_data.push_back((security_seed_ >> 16) & 0xFF);
-        response_data.push_back((security_seed_ >> 8) & 0xFF);
-        response_data.push_back(security_seed_ & 0xFF);
+void UDSServiceHandler::handleTesterPresent(ConstByteSpan request, UDSResponseWriter& out) {
+    if (request.size() < 2) {
+        writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+        return;
+    }
 
-        std::cout << "Security access: seed=0x" << std::hex << security_seed_ << std::dec << std::endl;
+    writePositiveResponse(out, request[0]);
+    out.put(request[1]);
+}
 
-        return buildPositiveResponse(request[0], response_data);
+void UDSServiceHandler::handleReadDataByIdentifier(ConstByteSpan request, UDSResponseWriter& out) {
+    // 0x22 DID_1 [DID_2 ... DID_n]
+    size_t did_count = (request.size() - 1) / 2;
+    if (request.size() < 3 || (request.size() - 1) % 2 != 0 || did_count > MAX_READ_DIDS) {
+        writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+        return;
+    }
 
-    } else if (sub_function == 0x02) {
-        // Send key
-        if (request.size() < 6) {
-            return buildNegativeResponse(request[0], UDSNRC::IncorrectMessageLength);
-        }
+    if (plans_dirty_) {
+        compileDynamicPlans();
+    }
 
-        uint32_t received_key = (static_cast<uint32_t>(request[2]) << 24) |
-                                 (static_cast<uint32_t>(request[3]) << 16) |
-                                 (static_cast<uint32_t>(request[4]) << 8) |
-                                 static_cast<uint32_t>(request[5]);
+    writePositiveResponse(out, request[0]);
+    size_t records = 0;
 
-        // Simple key algorithm: key = seed XOR 0xABCD1234 (EXAMPLE ONLY)
-        uint32_t expected_key = security_seed_ ^ 0xABCD1234;
+    for (size_t i = 0; i < did_count; i++) {
+        uint16_t did = (static_cast<uint16_t>(request[1 + 2 * i]) << 8) | request[2 + 2 * i];
+        const DIDEntry* entry = findDID(did);
+        if (!entry) {
+            continue;  // Unsupported DIDs are skipped; NRC only if none is supported
+        }
 
-        if (received_key == expected_key) {
-            security_unlocked_ = true;
-            security_attempts_ = 0;
-            std::cout << "Security access: UNLOCKED" << std::endl;
-            return buildPositiveResponse(request[0], {0x02});
-        } else {
-            security_attempts_++;
-            std::cout << "Security access: INVALID KEY (attempt " 
-                      << static_cast<int>(security_attempts_) << ")" << std::endl;
-            
-            if (security_attempts_ >= 3) {
-                return buildNegativeResponse(request[0], UDSNRC::ExceedNumberOfAttempts);
+        if (entry->isDynamic()) {
+            // Copy plan runs straight into the response
+            if (!entry->plan_valid) {
+                continue;
+            }
+            if (out.room() < 2 + entry->dynamic_size) {
+                out.markOverflow();
+                break;
+            }
+            if (!runCopyPlan(*entry, out.tail() + 2)) {
+                continue;
+            }
+            out.putU16(did);
+            out.commit(entry->dynamic_size);
+        } else if (entry->handler) {
+            // Custom handlers return a vector and do allocate
+            std::vector<uint8_t> data;
+            try {
+                data = entry->handler(did);
+            } catch (const std::exception& e) {
+                std::cerr << "DID handler error: " << e.what() << std::endl;
+                continue;
             }
-            return buildNegativeResponse(request[0], UDSNRC::InvalidKey);
+            out.putU16(did);
+            out.put(data.data(), data.size());
+        } else {
+            out.put(entry->data.data(), entry->data.size());
         }
+        records++;
     }
 
-    return buildNegativeResponse(request[0], UDSNRC::SubFunctionNotSupported);
+    if (records == 0) {
+        out.reset();
+        writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+    }
 }
 
-std::vector<uint8_t> UDSServiceHandler::handleTesterPresent(const std::vector<uint8_t>& request) {
-    if (request.size() < 2) {
-        return buildNegativeResponse(request[0], UDSNRC::IncorrectMessageLength);
+void UDSServiceHandler::handleReadDataByPeriodicIdentifier(ConstByteSpan request, UDSResponseWriter& out) {
+    // 0x2A transmissionMode [PDID_1 ... PDID_n]
+    if (request.size() < 2 || request.size() - 2 > MAX_READ_DIDS) {
+        writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+        return;
     }
 
-    uint8_t sub_function = request[1];
-    return buildPositiveResponse(request[0], {sub_function});
-}
+    auto mode = static_cast<PeriodicRate>(request[1]);
 
-std::vector<uint8_t> UDSServiceHandler::handleReadDataByIdentifier(
-    const std::vector<uint8_t>& request) {
-    
-    if (request.size() < 3) {
-        return buildNegativeResponse(request[0], UDSNRC::IncorrectMessageLength);
+    // Stop is always accepted; a tester with no schedule has nothing to stop
+    if (mode == PeriodicRate::Stop) {
+        auto it = periodic_.find(tester_address_);
+        if (it != periodic_.end()) {
+            // No PDIDs listed: stop everything of this tester
+            if (request.size() == 2) {
+                it->second.stopAll();
+            }
+            for (size_t i = 2; i < request.size(); i++) {
+                it->second.stop(request[i]);
+            }
+        }
+        writePositiveResponse(out, request[0]);
+        return;
     }
 
-    uint16_t did = (static_cast<uint16_t>(request[1]) << 8) | request[2];
+    if (mode < PeriodicRate::Slow || mode > PeriodicRate::Fast) {
+        writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+        return;
+    }
+    if (current_session_ == 0x01) {
+        writeNegativeResponse(out, request[0], UDSNRC::ServiceNotSupportedInActiveSession);
+        return;
+    }
+    if (request.size() == 2) {
+        writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+        return;
+    }
 
-    std::cout << "Read DID: 0x" << std::hex << did << std::dec << std::endl;
+    // Unsupported PDIDs are skipped; NRC only if none could be scheduled
+    PeriodicDIDScheduler& schedule = periodic_[tester_address_];
+    size_t scheduled = 0;
+    for (size_t i = 2; i < request.size(); i++) {
+        if (findDID(PERIODIC_DID_BASE | request[i]) && schedule.schedule(request[i], mode)) {
+            scheduled++;
+        }
+    }
+    if (scheduled == 0) {
+        writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+        return;
+    }
 
-    // Check custom handlers first
-    auto it = did_handlers_.find(did);
-    if (it != did_handlers_.end()) {
-        try {
-            std::vector<uint8_t> data = it->second(did);
-            std::vector<uint8_t> response_data = {
-                static_cast<uint8_t>(did >> 8),
-                static_cast<uint8_t>(did & 0xFF)
-            };
-            response_data.insert(response_data.end(), data.begin(), data.end());
-            return buildPositiveResponse(request[0], response_data);
-        } catch (const std::exception& e) {
-            std::cerr << "DID handler error: " << e.what() << std::endl;
-            return buildNegativeResponse(request[0], UDSNRC::RequestOutOfRange);
+    std::cout << "Periodic read: tester=0x" << std::hex << tester_address_ << ", mode=0x"
+              << static_cast<int>(request[1]) << std::dec << ", " << schedule.size()
+              << " PDIDs scheduled" << std::endl;
+
+    writePositiveResponse(out, request[0]);
+}
+
+void UDSServiceHandler::handleDynamicallyDefineDataIdentifier(ConstByteSpan request, UDSResponseWriter& out) {
+    if (request.size() < 2) {
+        writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+        return;
+    }
+
+    uint8_t sub_function = request[1];
+
+    if (sub_function == 0x03) {
+        // clearDynamicallyDefinedDataIdentifier [DDDID]; without DDDID clears all
+        if (request.size() != 2 && request.size() != 4) {
+            writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+            return;
         }
+        uint16_t dddid = (request.size() == 4) ? static_cast<uint16_t>((request[2] << 8) | request[3]) : 0;
+        if (request.size() == 4 && (dddid < DYNAMIC_DID_FIRST || dddid > DYNAMIC_DID_LAST)) {
+            writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+            return;
+        }
+        did_index_.erase(std::remove_if(did_index_.begin(), did_index_.end(),
+                                        [&](const DIDEntry& entry) {
+                                            return entry.isDynamic() && (request.size() == 2 || entry.did == dddid);
+                                        }),
+                         did_index_.end());
+        plans_dirty_ = true;
+
+        writePositiveResponse(out, request[0]);
+        out.put(sub_function);
+        if (request.size() == 4) {
+            out.putU16(dddid);
+        }
+        return;
     }
 
-    // Built-in DIDs
-    std::string data_str;
-    switch (static_cast<UDSDID>(did)) {
-        case UDSDID::VIN:
-            data_str = vin_;
-            data_str.resize(17, ' ');  // Pad to 17 bytes
-            break;
+    if (sub_function != 0x01 && sub_function != 0x02) {
+        writeNegativeResponse(out, request[0], UDSNRC::SubFunctionNotSupported);
+        return;
+    }
+    if (request.size() < 5) {
+        writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+        return;
+    }
 
-        case UDSDID::ECUSerialNumber:
-            data_str = ecu_serial_;
-            break;
+    uint16_t dddid = (static_cast<uint16_t>(request[2]) << 8) | request[3];
+    if (dddid < DYNAMIC_DID_FIRST || dddid > DYNAMIC_DID_LAST) {
+        writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+        return;
+    }
 
-        case UDSDID::ECUSoftwareVersion:
-            data_str = software_version_;
-            break;
+    // A repeated definition of the same DDDID appends to it
+    const DIDEntry* existing = findDID(dddid);
+    if (existing && !existing->isDynamic()) {
+        writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+        return;
+    }
+    DIDEntry defined;
+    defined.did = dddid;
+    if (existing) {
+        defined.sources = existing->sources;
+    }
 
-        case UDSDID::ECUHardwareVersion:
-            data_str = hardware_version_;
-            break;
+    if (sub_function == 0x01) {
+        // defineByIdentifier: [sourceDID(2) position(1) memorySize(1)]...
+        if ((request.size() - 4) % 4 != 0) {
+            writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+            return;
+        }
+        for (size_t i = 4; i < request.size(); i += 4) {
+            DynamicSource source{false, static_cast<uint16_t>((request[i] << 8) | request[i + 1]), 0,
+                                 request[i + 2], request[i + 3]};
+            if (source.position == 0 || source.size == 0) {
+                writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+                return;
+            }
+            defined.sources.push_back(source);
+        }
+    } else {
+        // defineByMemoryAddress: addressAndLengthFormatIdentifier [address size]...
+        size_t address_len = request[4] & 0x0F;
+        size_t size_len = request[4] >> 4;
+        if (address_len < 1 || address_len > 4 || size_len < 1 || size_len > 2) {
+            writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+            return;
+        }
+        size_t element_len = address_len + size_len;
+        if (request.size() == 5 || (request.size() - 5) % element_len != 0) {
+            writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+            return;
+        }
+        for (size_t i = 5; i < request.size(); i += element_len) {
+            DynamicSource source{true, 0, 0, 0, 0};
+            for (size_t b = 0; b < address_len; b++) {
+                source.address = (source.address << 8) | request[i + b];
+            }
+            for (size_t b = 0; b < size_len; b++) {
+                source.size = static_cast<uint16_t>((source.size << 8) | request[i + address_len + b]);
+            }
+            if (source.size == 0) {
+                writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+                return;
+            }
+            defined.sources.push_back(source);
+        }
+    }
 
-        default:
-            return buildNegativeResponse(request[0], UDSNRC::RequestOutOfRange);
+    // Every source must resolve now; nothing changes on failure
+    if (defined.sources.size() > MAX_DYNAMIC_SOURCES || !compilePlan(defined)) {
+        writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+        return;
     }
 
-    std::vector<uint8_t> response_data = {
-        static_cast<uint8_t>(did >> 8),
-        static_cast<uint8_t>(did & 0xFF)
-    };
-    response_data.insert(response_data.end(), data_str.begin(), data_str.end());
+    DIDEntry& entry = insertDID(dddid);
+    entry.sources = std::move(defined.sources);
+    plans_dirty_ = true;
 
-    return buildPositiveResponse(request[0], response_data);
+    std::cout << "Dynamic DID 0x" << std::hex << dddid << std::dec << ": "
+              << entry.sources.size() << " sources, " << defined.dynamic_size << " bytes" << std::endl;
+
+    writePositiveResponse(out, request[0]);
+    out.put(sub_function);
+    out.putU16(dddid);
 }
 
-std::vector<uint8_t> UDSServiceHandler::handleWriteDataByIdentifier(
-    const std::vector<uint8_t>& request) {
-    
+void UDSServiceHandler::handleWriteDataByIdentifier(ConstByteSpan request, UDSResponseWriter& out) {
     if (request.size() < 4) {
-        return buildNegativeResponse(request[0], UDSNRC::IncorrectMessageLength);
+        writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+        return;
     }
 
-    // Check security
-    if (!security_unlocked_) {
-        return buildNegativeResponse(request[0], UDSNRC::SecurityAccessDenied);
+    uint16_t did = (static_cast<uint16_t>(request[1]) << 8) | request[2];
+    const DIDWriteEntry* writer = nullptr;
+    for (const auto& entry : write_handlers_) {
+        if (entry.did == did) {
+            writer = &entry;
+            break;
+        }
     }
 
-    uint16_t did = (static_cast<uint16_t>(request[1]) << 8) | request[2];
+    // Check security
+    if ((!writer || writer->requires_security) && !securityUnlocked()) {
+        writeNegativeResponse(out, request[0], UDSNRC::SecurityAccessDenied);
+        return;
+    }
 
-    std::cout << "Write DID: 0x" << std::hex << did << std::dec << std::endl;
+    if (writer) {
+        if (!writer->handler(did, ConstByteSpan(request.data() + 3, request.size() - 3))) {
+            writeNegativeResponse(out, request[0], UDSNRC::ConditionsNotCorrect);
+            return;
+        }
+    } else {
+        std::cout << "Write DID: 0x" << std::hex << did << std::dec << std::endl;
+    }
 
     // Echo DID in response
-    return buildPositiveResponse(request[0], {
-        static_cast<uint8_t>(did >> 8),
-        static_cast<uint8_t>(did & 0xFF)
-    });
+    writePositiveResponse(out, request[0]);
+    out.putU16(did);
 }
 
-std::vector<uint8_t> UDSServiceHandler::handleReadDTCInformation(
-    const std::vector<uint8_t>& request) {
-    
+void UDSServiceHandler::handleReadDTCInformation(ConstByteSpan request, UDSResponseWriter& out) {
     if (request.size() < 2) {
-        return buildNegativeResponse(request[0], UDSNRC::IncorrectMessageLength);
+        writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+        return;
     }
 
     uint8_t sub_function = request[1];
+    uint8_t availability = dtc_store_ ? DTCStore::STATUS_AVAILABILITY_MASK : 0x00;
 
-    std::cout << "Read DTC: sub=0x" << std::hex << static_cast<int>(sub_function) << std::dec << std::endl;
+    auto putDTC = [&out](const DTCRecord& record) {
+        out.put(static_cast<uint8_t>(record.dtc >> 16));
+        out.putU16(static_cast<uint16_t>(record.dtc & 0xFFFF));
+        out.put(record.status);
+    };
 
-    // Return empty DTC list (no faults)
-    return buildPositiveResponse(request[0], {sub_function, 0x00});
+    switch (sub_function) {
+        case 0x01:    // reportNumberOfDTCByStatusMask
+        case 0x02: {  // reportDTCByStatusMask
+            if (request.size() != 3) {
+                writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+                return;
+            }
+            uint8_t mask = request[2] & availability;
+
+            writePositiveResponse(out, request[0]);
+            out.put(sub_function);
+            out.put(availability);
+            if (sub_function == 0x01) {
+                out.put(0x01);  // DTCFormatIdentifier: ISO 14229-1
+                out.putU16(static_cast<uint16_t>(
+                    std::min<size_t>(dtc_store_ ? dtc_store_->countByStatusMask(mask) : 0, 0xFFFF)));
+            } else if (dtc_store_) {
+                // DTCAndStatusRecords copied in bulk into the response
+                size_t written;
+                if (dtc_store_->writeStatusRecords(mask, out.tail(), out.room(), written)) {
+                    out.commit(written);
+                } else {
+                    out.markOverflow();
+                }
+            }
+            return;
+        }
+
+        case 0x04:    // reportDTCSnapshotRecordByDTCNumber
+        case 0x06: {  // reportDTCExtDataRecordByDTCNumber
+            if (request.size() != 6) {
+                writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+                return;
+            }
+            uint32_t dtc = (static_cast<uint32_t>(request[2]) << 16) |
+                           (static_cast<uint32_t>(request[3]) << 8) | request[4];
+            uint8_t record_number = request[5];
+
+            DTCRecord record;
+            if (!dtc_store_ || !dtc_store_->find(dtc, record)) {
+                writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+                return;
+            }
+
+            writePositiveResponse(out, request[0]);
+            out.put(sub_function);
+            putDTC(record);
+
+            if (sub_function == 0x04) {
+                // Snapshot record 0x01: one identifier (DID + data)
+                if (record_number != 0x01 && record_number != 0xFF) {
+                    out.reset();
+                    writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+                    return;
+                }
+                if (record.snapshot_len >= 2) {
+                    out.put(0x01);
+                    out.put(0x01);
+                    out.put(record.snapshot.data(), record.snapshot_len);
+                }
+            } else {
+                // Extended record 0x01: occurrence counter, 0x02: reporter data
+                if (record_number != 0x01 && record_number != 0x02 && record_number != 0xFF) {
+                    out.reset();
+                    writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+                    return;
+                }
+                if (record_number != 0x02) {
+                    out.put(0x01);
+                    out.put(static_cast<uint8_t>(std::min<uint16_t>(record.occurrence_count, 0xFF)));
+                }
+                if (record_number != 0x01 && record.extended_len > 0) {
+                    out.put(0x02);
+                    out.put(record.extended.data(), record.extended_len);
+                }
+            }
+            return;
+        }
+
+        default:
+            writeNegativeResponse(out, request[0], UDSNRC::SubFunctionNotSupported);
+            return;
+    }
 }
 
-std::vector<uint8_t> UDSServiceHandler::handleRoutineControl(
-    const std::vector<uint8_t>& request) {
-    
+void UDSServiceHandler::handleClearDiagnosticInformation(ConstByteSpan request, UDSResponseWriter& out) {
+    if (request.size() != 4) {
+        writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+        return;
+    }
+
+    uint32_t group = (static_cast<uint32_t>(request[1]) << 16) |
+                     (static_cast<uint32_t>(request[2]) << 8) | request[3];
+
+    // No DTC memory to clear: a positive response would claim it was erased
+    if (!dtc_store_) {
+        writeNegativeResponse(out, request[0], UDSNRC::ConditionsNotCorrect);
+        return;
+    }
+
+    // All DTCs, or a single stored DTC number
+    if (group != DTC_GROUP_ALL) {
+        DTCRecord record;
+        if (!dtc_store_->find(group, record)) {
+            writeNegativeResponse(out, request[0], UDSNRC::RequestOutOfRange);
+            return;
+        }
+    }
+
+    // Not persisted: the DTCs would reappear after a restart
+    if (!dtc_store_->clear(group)) {
+        writeNegativeResponse(out, request[0], UDSNRC::GeneralProgrammingFailure);
+        return;
+    }
+    writePositiveResponse(out, request[0]);
+}
+
+void UDSServiceHandler::handleRoutineControl(ConstByteSpan request, UDSResponseWriter& out) {
     if (request.size() < 4) {
-        return buildNegativeResponse(request[0], UDSNRC::IncorrectMessageLength);
+        writeNegativeResponse(out, request[0], UDSNRC::IncorrectMessageLength);
+        return;
     }
 
     uint8_t sub_function = request[1];
@@ -328,29 +924,27 @@ std::vector<uint8_t> UDSServiceHandler::handleRoutineControl(
               << ", routine=0x" << routine_id << std::dec << std::endl;
 
     // Echo sub-function and routine ID
-    return buildPositiveResponse(request[0], {
-        sub_function,
-        static_cast<uint8_t>(routine_id >> 8),
-        static_cast<uint8_t>(routine_id & 0xFF)
-    });
+    writePositiveResponse(out, request[0]);
+    out.put(sub_function);
+    out.putU16(routine_id);
+}
+
+void UDSServiceHandler::handleNotSupported(ConstByteSpan request, UDSResponseWriter& out) {
+    writeNegativeResponse(out, request[0], UDSNRC::ServiceNotSupported);
 }
 
 // ============================================================================
 // Response Builders
 // ============================================================================
 
-std::vector<uint8_t> UDSServiceHandler::buildPositiveResponse(
-    uint8_t sid, const std::vector<uint8_t>& data) {
-    
-    std::vector<uint8_t> response;
-    response.push_back(sid + UDS_POSITIVE_RESPONSE_OFFSET);
-    response.insert(response.end(), data.begin(), data.end());
-    return response;
+void UDSServiceHandler::writePositiveResponse(UDSResponseWriter& out, uint8_t sid) {
+    out.put(static_cast<uint8_t>(sid + UDS_POSITIVE_RESPONSE_OFFSET));
 }
 
-std::vector<uint8_t> UDSServiceHandler::buildNegativeResponse(uint8_t sid, UDSNRC nrc) {
-    return {UDS_NEGATIVE_RESPONSE, sid, static_cast<uint8_t>(nrc)};
+void UDSServiceHandler::writeNegativeResponse(UDSResponseWriter& out, uint8_t sid, UDSNRC nrc) {
+    out.put(UDS_NEGATIVE_RESPONSE);
+    out.put(sid);
+    out.put(static_cast<uint8_t>(nrc));
 }
 
 } // namespace vmg
-
@@ -9,8 +9,18 @@
 #include <iostream>
 #include <thread>
 #include <atomic>
+#include <array>
+#include <memory>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
 #include <csignal>
 
+#include "ota_chunk_cache.hpp"
+#include "telemetry_bus.hpp"
+#include "unified_message.hpp"
+
 extern "C" {
 #include "pqc_config.h"
 }
@@ -46,6 +56,79 @@ void signal_handler(int sig) {
     running = false;
 }
 
+// Events between VMG components (DoIP server, OTA manager, MQTT uplink);
+// other processes attach with the same shm name, e.g. vmg_doip_server_plain --bus
+static const char* DEFAULT_BUS_NAME = "/vmg_telemetry";
+
+/**
+ * MQTT uplink stand-in: drains the bus and keeps per-topic counts. The
+ * UnifiedMessage slots already hold the 2.0 binary frame, so a real uplink
+ * forwards view.data as-is without re-encoding.
+ */
+void telemetry_uplink(vmg::TelemetrySubscription subscription,
+                      std::array<std::atomic<uint64_t>, vmg::BUS_TOPIC_COUNT>* counts) {
+    while (running && subscription.valid()) {
+        if (!subscription.waitFor(std::chrono::milliseconds(500))) {
+            continue;
+        }
+        subscription.poll([counts](const vmg::BusMessageView& view) {
+            (*counts)[view.topic].fetch_add(1, std::memory_order_relaxed);
+            if (view.topic == vmg::topicOf(vmg::MessageType::OTA_DOWNLOAD_PROGRESS)) {
+                try {
+                    vmg::UnifiedMessage msg = view.toMessage();
+                    std::cout << "[Uplink] OTA progress "
+                              << msg.getPayload().value("progress_percentage", 0) << "%" << std::endl;
+                } catch (const std::exception& e) {
+                    std::cerr << "[Uplink] Bad OTA progress event: " << e.what() << std::endl;
+                }
+            }
+        }, 256);
+    }
+}
+
+/**
+ * OTA download stand-in: the package is read from a local file instead of
+ * the HTTPS backend and chunked into the manifest the OTA server would send.
+ * Progress goes on the bus as OTA_DOWNLOAD_PROGRESS, one event per percent.
+ */
+bool download_package(vmg::OTAChunkCache& cache, vmg::TelemetryBus& bus, const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "[VMG] Cannot open OTA package " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> package((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    
+    vmg::OTAPackageManifest manifest;
+    manifest.package_id = std::filesystem::path(path).filename().string();
+    manifest.total_size = package.size();
+    for (size_t offset = 0; offset < package.size(); offset += manifest.chunk_size) {
+        size_t len = std::min<size_t>(manifest.chunk_size, package.size() - offset);
+        manifest.chunks.push_back(vmg::OTAChunkCache::computeDigest(package.data() + offset, len));
+    }
+    if (!cache.registerManifest(manifest)) {
+        return false;
+    }
+    
+    int last_percentage = -1;
+    return cache.fetchPackage(manifest.package_id,
+        [&package](const vmg::OTAPackageManifest& m, size_t index, std::vector<uint8_t>& out) {
+            size_t offset = index * m.chunk_size;
+            size_t end = std::min<size_t>(offset + m.chunk_size, package.size());
+            out.assign(package.begin() + offset, package.begin() + end);
+            return true;
+        },
+        [&bus, &last_percentage](const vmg::OTAPackageManifest& m, uint64_t bytes_cached) {
+            int percentage = m.total_size ? static_cast<int>(bytes_cached * 100 / m.total_size) : 100;
+            if (percentage == last_percentage) {
+                return;
+            }
+            last_percentage = percentage;
+            bus.publish(vmg::MessageBuilder::createOTAProgress("local", m.package_id, percentage,
+                                                               bytes_cached, m.total_size));
+        });
+}
+
 void print_banner() {
     std::cout << R"(
 ╔══════════════════════════════════════════════════╗
@@ -86,6 +169,45 @@ int main(int argc, char** argv) {
     std::cout << "  Config ID: " << PQC_CONFIG_ID_FOR_EXTERNAL_SERVER << std::endl;
     std::cout << "\n  To change: Edit PQC_CONFIG_ID_FOR_EXTERNAL_SERVER in vmg_gateway.cpp" << std::endl;
     
+    // OTA chunk cache: one backend download feeds every Zonal Gateway
+    vmg::OTAChunkCache ota_cache;
+    if (!ota_cache.initialize()) {
+        std::cerr << "[VMG] Warning: OTA chunk cache unavailable" << std::endl;
+    }
+    
+    // Telemetry bus (shared memory so out-of-process components can publish)
+    vmg::TelemetryBusConfig bus_config;
+    bus_config.shm_name = DEFAULT_BUS_NAME;
+    bus_config.slot_size = 1024;    // VCI_REPORT carries the zone's ECU list
+    std::string ota_package_path;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--bus") {
+            bus_config.shm_name = argv[i + 1];
+        } else if (std::string(argv[i]) == "--ota-package") {
+            ota_package_path = argv[i + 1];
+        }
+    }
+    auto bus = std::make_unique<vmg::TelemetryBus>(bus_config);
+    if (!bus->open()) {
+        std::cerr << "[VMG] Warning: shared telemetry bus unavailable, using in-process bus" << std::endl;
+        bus_config.shm_name.clear();
+        bus = std::make_unique<vmg::TelemetryBus>(bus_config);
+        bus->open();
+    }
+    std::array<std::atomic<uint64_t>, vmg::BUS_TOPIC_COUNT> topic_counts{};
+    std::thread uplink_thread(telemetry_uplink, bus->subscribe(), &topic_counts);
+    
+    // VCI_REPORT comes from the DoIP server (zone reports, 0x2E F1A1);
+    // OTA_DOWNLOAD_PROGRESS from the downloads into ota_cache below
+    std::thread ota_thread;
+    if (!ota_package_path.empty()) {
+        ota_thread = std::thread([&ota_cache, &bus, &ota_package_path] {
+            bool complete = download_package(ota_cache, *bus, ota_package_path);
+            std::cout << "[VMG] OTA package " << ota_package_path
+                      << (complete ? " cached" : " download failed") << std::endl;
+        });
+    }
+    
     // Setup signal handlers
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
@@ -95,12 +217,44 @@ int main(int argc, char** argv) {
     std::cout << "  - DoIP Server:  Port 13400 (ZG/ECU clients, NO PQC)" << std::endl;
     std::cout << "  - HTTPS Client: External OTA/API (WITH PQC)" << std::endl;
     std::cout << "  - MQTT Client:  Telemetry/Commands (WITH PQC)" << std::endl;
+    std::cout << "  - OTA Cache:    Content-addressed chunks (SHA-256, LRU + disk)" << std::endl;
+    std::cout << "  - Bus:          " << (bus_config.shm_name.empty() ? "in-process" : bus_config.shm_name)
+              << " (" << bus->getStats().slot_count << " slots)" << std::endl;
     std::cout << "\n[VMG] Press Ctrl+C to exit" << std::endl;
     
-    // For now, just keep running
-    // In production, this would spawn DoIP server, HTTPS poller, MQTT client threads
+    // Component threads (DoIP server, HTTPS poller, MQTT client) attach to
+    // the bus; main publishes a periodic status report on it
+    int tick = 0;
     while (running) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (++tick % 10 != 0) {
+            continue;
+        }
+        
+        vmg::OTAChunkCacheStats cache_stats = ota_cache.getStats();
+        bus->publish(vmg::MessageBuilder::createStatusReport("VMG-001", {
+            {"ota_cache_memory_bytes", cache_stats.memory_bytes},
+            {"ota_cache_disk_bytes", cache_stats.disk_bytes},
+            {"ota_cache_misses", cache_stats.misses}
+        }));
+        
+        vmg::TelemetryBusStats bus_stats = bus->getStats();
+        std::cout << "[VMG] Bus: published=" << bus_stats.published
+                  << " subscribers=" << bus_stats.subscribers
+                  << " dropped=" << bus_stats.dropped_full + bus_stats.dropped_oversize
+                  << " diag=" << topic_counts[vmg::TOPIC_DIAGNOSTIC_RESPONSE].load()
+                  << " vci=" << topic_counts[vmg::topicOf(vmg::MessageType::VCI_REPORT)].load()
+                  << " ota=" << topic_counts[vmg::topicOf(vmg::MessageType::OTA_DOWNLOAD_PROGRESS)].load()
+                  << std::endl;
+    }
+    
+    if (ota_thread.joinable()) {
+        ota_thread.join();
+    }
+    uplink_thread.join();
+    bus->close();
+    if (!bus_config.shm_name.empty()) {
+        vmg::TelemetryBus::unlink(bus_config.shm_name);
     }
     
     std::cout << "[VMG] Cleanup complete" << std::endl;
@@ -0,0 +1,154 @@
+/**
+ * @file bench_diagnostic_router.c
+ * @brief DiagnosticRouter_t route lookup benchmark (host build)
+ *
+ * Registers 32, 256 and 4096 ECUs at scattered logical addresses and
+ * reports route lookups/sec through the address index against the
+ * previous linear scan over ecus[]. Also measures register/unregister
+ * churn and verifies every registered address stays reachable.
+ *
+ * Built with DIAG_ROUTER_MAX_ECUS=4096 (see CMakeLists.txt).
+ *
+ * Usage: ./diag_router_bench [lookups]
+ */
+
+#include "diagnostic_router.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static DiagnosticRouter_t g_router;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t xorshift32(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Previous diagnostic_router_find_ecu, kept as baseline
+static const ECURoutingEntry_t* linear_find(const DiagnosticRouter_t* router, uint16_t address) {
+    for (uint32_t i = 0; i < router->ecu_count; i++) {
+        if (router->ecus[i].logical_address == address) {
+            return &router->ecus[i];
+        }
+    }
+    return NULL;
+}
+
+static int populate(uint16_t* addresses, uint32_t count, uint32_t seed) {
+    diagnostic_router_init(&g_router);
+
+    // Distinct scattered addresses from a shuffled 16-bit space
+    static uint16_t pool[65536];
+    for (uint32_t i = 0; i < 65536; i++) {
+        pool[i] = (uint16_t)i;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t j = i + xorshift32(&seed) % (65536 - i);
+        uint16_t tmp = pool[i];
+        pool[i] = pool[j];
+        pool[j] = tmp;
+        addresses[i] = pool[i];
+    }
+
+    char ecu_id[32];
+    for (uint32_t i = 0; i < count; i++) {
+        snprintf(ecu_id, sizeof(ecu_id), "ECU-%04X", addresses[i]);
+        if (diagnostic_router_register_ecu(&g_router, ecu_id, addresses[i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int verify(const uint16_t* addresses, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        const ECURoutingEntry_t* ecu = diagnostic_router_find_ecu(&g_router, addresses[i]);
+        if (!ecu || ecu->logical_address != addresses[i] || ecu != linear_find(&g_router, addresses[i])) {
+            return -1;
+        }
+    }
+    return g_router.ecu_count == count ? 0 : -1;
+}
+
+static void run_case(uint32_t count, uint32_t lookups) {
+    static uint16_t addresses[DIAG_ROUTER_MAX_ECUS];
+    static uint16_t queries[1 << 16];
+
+    if (populate(addresses, count, 0x12345678u ^ count) != 0 || verify(addresses, count) != 0) {
+        fprintf(stderr, "Population failed for %u ECUs\n", count);
+        exit(1);
+    }
+
+    uint32_t seed = 0xC0FFEEu;
+    for (uint32_t i = 0; i < (1u << 16); i++) {
+        queries[i] = addresses[xorshift32(&seed) % count];
+    }
+
+    uintptr_t sink = 0;
+
+    double t0 = now_sec();
+    for (uint32_t i = 0; i < lookups; i++) {
+        sink += (uintptr_t)diagnostic_router_find_ecu(&g_router, queries[i & 0xFFFF]);
+    }
+    double t1 = now_sec();
+
+    // Linear scan is O(n); cap its iterations so large tables finish quickly
+    uint32_t linear_lookups = lookups / (count / 32 ? count / 32 : 1);
+    if (linear_lookups < 1000) linear_lookups = 1000;
+    for (uint32_t i = 0; i < linear_lookups; i++) {
+        sink += (uintptr_t)linear_find(&g_router, queries[i & 0xFFFF]);
+    }
+    double t2 = now_sec();
+
+    // Churn: remove and re-add half of the ECUs
+    uint32_t churn = count / 2;
+    for (uint32_t i = 0; i < churn; i++) {
+        diagnostic_router_unregister_ecu(&g_router, addresses[i]);
+    }
+    for (uint32_t i = 0; i < churn; i++) {
+        diagnostic_router_register_ecu(&g_router, "ECU", addresses[i]);
+    }
+    double t3 = now_sec();
+
+    if (sink == 0 || verify(addresses, count) != 0) {
+        fprintf(stderr, "Lookup verification failed for %u ECUs\n", count);
+        exit(1);
+    }
+
+    printf("  %5u ECUs %14.0f %14.0f %14.0f\n", count,
+           lookups / (t1 - t0),
+           linear_lookups / (t2 - t1),
+           churn ? (2.0 * churn) / (t3 - t2) : 0.0);
+}
+
+int main(int argc, char** argv) {
+    uint32_t lookups = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 20000000u;
+    if (lookups == 0) {
+        fprintf(stderr, "Usage: %s [lookups]\n", argv[0]);
+        return 1;
+    }
+
+    static const uint32_t counts[] = { 32, 256, 4096 };
+
+    printf("DiagnosticRouter lookup benchmark (%u lookups, index %u slots)\n",
+           lookups, DIAG_ROUTER_INDEX_SIZE);
+    printf("  %10s %14s %14s %14s\n", "", "index/s", "linear/s", "reg+unreg/s");
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        if (counts[i] <= DIAG_ROUTER_MAX_ECUS) {
+            run_case(counts[i], lookups);
+        }
+    }
+
+    return 0;
+}
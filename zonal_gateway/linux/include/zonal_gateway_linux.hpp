@@ -5,6 +5,13 @@
  * 노트북/PC 환경에서 Zonal Gateway 역할 시뮬레이션
  * - Downstream: Zone 내 ECU들의 서버 (DoIP Server)
  * - Upstream: VMG의 클라이언트 (DoIP Client)
+ *
+ * ECU 측(DoIP TCP/UDP, JSON)과 VMG 링크는 단일 epoll 이벤트 루프 스레드에서
+ * 처리한다. 모든 소켓은 non-blocking이며, 루프는 고정 sleep 없이 이벤트와
+ * 다음 VMG 보고/재연결 시각에만 깨어난다. 0x8001은 ECU <-> VMG 양방향 중계.
+ *
+ * Zone VCI는 copy-on-write로 관리한다. 읽는 쪽은 불변 스냅샷 포인터를
+ * 받아 쓰고(쓰기 mutex 없음), 쓰는 쪽은 복사본을 수정한 뒤 교체한다.
  */
 
 #ifndef ZONAL_GATEWAY_LINUX_HPP
@@ -17,6 +24,10 @@
 #include <mutex>
 #include <cstdint>
 #include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include "doip_trace.h"
+#include "zone_vci_codec.hpp"
 
 namespace vmg {
 
@@ -24,36 +35,14 @@ namespace vmg {
 constexpr uint8_t ZG_MAX_ECUS = 8;
 constexpr uint16_t ZG_DOIP_SERVER_PORT = 13400;
 constexpr uint16_t ZG_JSON_SERVER_PORT = 8765;
-
-/**
- * @brief Zone 내 ECU 정보
- */
-struct ZoneECUInfo {
-    std::string ecu_id;                 /* ECU ID */
-    uint16_t logical_address;           /* DoIP 논리 주소 */
-    std::string firmware_version;
-    std::string hardware_version;
-    bool is_online;
-    uint64_t last_heartbeat_time;
-    
-    /* Capabilities */
-    bool ota_capable;
-    bool delta_update_supported;
-    uint32_t max_package_size;
-};
-
-/**
- * @brief Zone VCI 집계 데이터
- */
-struct ZoneVCIData {
-    uint8_t zone_id;
-    std::vector<ZoneECUInfo> ecus;
-    
-    /* Zone 통계 */
-    uint32_t total_storage_mb;
-    uint32_t available_storage_mb;
-    uint8_t average_battery_level;
-};
+constexpr size_t ZG_MAX_JSON_LINE = 16384;
+constexpr uint16_t ZG_VMG_LOGICAL_ADDRESS = 0x0100;
+constexpr uint32_t ZG_HEARTBEAT_INTERVAL_MS = 10000;  /* Only after this long without any frame */
+constexpr uint32_t ZG_STATUS_INTERVAL_MS = 30000;     /* Zone status (report header) refresh */
+constexpr uint32_t ZG_VCI_REPORT_INTERVAL_MS = 1000;   /* Delta check; nothing sent if unchanged */
+constexpr uint32_t ZG_VMG_RECONNECT_INTERVAL_MS = 5000;
+constexpr uint32_t ZG_REPORT_ACK_TIMEOUT_MS = 5000;    /* No 0x6E/0x7F by then: resend full */
+constexpr int ZG_MAX_EPOLL_EVENTS = 32;
 
 /**
  * @brief Zonal Gateway 상태
@@ -80,11 +69,11 @@ public:
     void stop();
     void run();
     
-    /* Server Functions (Zone 내부) */
-    void handleECUConnections();
-    void handleVehicleDiscovery();
+    /* Server Functions (Zone 내부, event loop thread) */
+    void handleECUConnections();        /* Accept pending DoIP/JSON connections */
+    void handleVehicleDiscovery();      /* Drain UDP vehicle identification requests */
     
-    /* Client Functions (VMG 연결) */
+    /* Client Functions (VMG 연결, event loop thread) */
     bool connectToVMG();
     bool sendZoneVCIToVMG();
     bool sendHeartbeatToVMG();
@@ -94,12 +83,18 @@ public:
     bool collectZoneVCI();
     bool requestECUVCI(size_t ecu_index);
     bool updateECUInfo(const std::string& ecu_id, const ZoneECUInfo& info);
+    bool updateZoneStatus(uint32_t total_storage_mb, uint32_t available_storage_mb,
+                          uint8_t battery_level);
     
     /* OTA Coordination */
     bool checkOTAReadiness(const std::string& campaign_id);
     bool distributeOTAToZone(const std::vector<uint8_t>& package_data);
     bool reportOTAProgress(uint8_t progress_percentage);
     
+    /* DoIP traffic capture (ECU side) for tools/doip_replay */
+    bool startCapture(const std::string& path);
+    void stopCapture();
+    
     /* Utility */
     std::string getZoneName() const;
     void printZoneVCI() const;
@@ -107,7 +102,7 @@ public:
     /* Getters */
     uint8_t getZoneID() const { return zone_id_; }
     ZGState getState() const { return state_; }
-    const ZoneVCIData& getZoneVCI() const { return zone_vci_; }
+    std::shared_ptr<const ZoneVCIData> getZoneVCI() const { return std::atomic_load(&zone_vci_); }
     
 private:
     /* Identity */
@@ -124,33 +119,93 @@ private:
     std::atomic<bool> running_;
     std::atomic<bool> vmg_connected_;
     
-    /* Data */
-    ZoneVCIData zone_vci_;
-    mutable std::mutex zone_vci_mutex_;
+    /* Data: published snapshot, replaced (never modified) under zone_vci_write_mutex_ */
+    std::shared_ptr<const ZoneVCIData> zone_vci_;
+    std::mutex zone_vci_write_mutex_;   /* Serializes writers only */
+    uint32_t vmg_reported_generation_;  /* Event loop only. Last generation ACKed, 0 = full */
+    uint32_t vmg_pending_generation_;   /* Event loop only. Report awaiting 0x6E, 0 = none */
+    std::chrono::steady_clock::time_point vmg_pending_since_;
+    std::chrono::steady_clock::time_point vmg_last_activity_;  /* Last frame to/from VMG */
+    std::chrono::steady_clock::time_point vmg_last_status_;    /* Last report (carries status) */
+    std::chrono::steady_clock::time_point vmg_next_tick_;      /* Next report check / reconnect */
     
     /* Network */
     int doip_server_tcp_socket_;
     int doip_server_udp_socket_;
     int json_server_socket_;
-    int vmg_client_socket_;
-    
-    /* Threads */
-    std::unique_ptr<std::thread> server_thread_;
-    std::unique_ptr<std::thread> client_thread_;
-    std::unique_ptr<std::thread> discovery_thread_;
+    int vmg_client_socket_;             /* Also a Connection (kind VMG) in connections_ */
+    
+    /* Event loop (epoll over listen sockets, UDP, connections, VMG link, wakeup) */
+    int epoll_fd_;
+    int wakeup_fd_;                     /* eventfd, signalled by stop() */
+    
+    enum class ConnectionKind {
+        DOIP,
+        JSON,
+        VMG                             /* Outgoing DoIP link to the VMG */
+    };
+    
+    /* ECU-side connection or the VMG link (owned by the event loop thread) */
+    struct Connection {
+        int fd;
+        ConnectionKind kind;
+        std::string peer;
+        std::vector<uint8_t> rx;        /* Unparsed input */
+        std::vector<uint8_t> tx;        /* Pending output (EPOLLOUT armed while non-empty) */
+        uint16_t logical_address;       /* Valid once routing is active */
+        bool routing_active;
+        uint32_t trace_id;              /* Connection id in capture traces */
+    };
+    std::unordered_map<int, Connection> connections_;
+    std::unordered_map<uint16_t, int> address_to_fd_;  /* Routed ECU -> connection fd */
+    uint32_t next_trace_id_;
+    
+    /* Active capture, swapped with atomic_load/atomic_store (event loop records) */
+    std::shared_ptr<DoIPTraceWriter> capture_;
+    
+    /* Thread */
+    std::unique_ptr<std::thread> event_thread_;
     
     /* Private methods */
-    void serverThreadFunc();
-    void clientThreadFunc();
-    void discoveryThreadFunc();
+    void eventLoopThreadFunc();
     
     bool createServerSockets();
     void closeServerSockets();
-    
-    bool sendDoIPMessage(int socket, uint16_t payload_type, 
-                         const std::vector<uint8_t>& payload);
-    bool receiveDoIPMessage(int socket, uint16_t& payload_type,
-                            std::vector<uint8_t>& payload);
+    bool createEventLoop();
+    void closeEventLoop();
+    bool watchFd(int fd, uint32_t events, bool modify = false);
+    
+    void acceptConnections(int listen_fd, ConnectionKind kind);
+    void handleConnectionEvent(int fd, uint32_t events);
+    void closeConnection(int fd);
+    void captureFrame(uint32_t connection, uint8_t kind, const uint8_t* frame, size_t len);
+    bool readConnection(Connection& conn);
+    bool flushConnection(Connection& conn);
+    void queueFrame(Connection& conn, uint16_t payload_type,
+                    const uint8_t* payload, size_t len);
+    
+    void processDoIPInput(Connection& conn);
+    void processDoIPFrame(Connection& conn, uint16_t payload_type,
+                          const uint8_t* payload, size_t len);
+    void handleRoutingActivation(Connection& conn, const uint8_t* payload, size_t len);
+    void handleDiagnosticFromECU(Connection& conn, const uint8_t* payload, size_t len);
+    void processJsonInput(Connection& conn);
+    void processJsonLine(const std::string& line);
+    
+    void setECUOnline(uint16_t logical_address, bool online);
+    template <typename Fn>
+    bool updateZoneVCI(Fn&& fn);        /* fn(ZoneVCIData&) -> publish? */
+    void handleLocalDiagnostic(Connection& conn, const uint8_t* uds, size_t uds_len);
+    bool applyECUVCIRecord(uint16_t logical_address, const uint8_t* data, size_t len);
+    
+    /* VMG link (event loop thread) */
+    void serviceVMGLink();              /* Reconnect, report, heartbeat at vmg_next_tick_ */
+    bool finishVMGConnect(Connection& conn);
+    void disconnectFromVMG();
+    void handleVMGFrame(Connection& vmg, uint16_t payload_type, const uint8_t* payload, size_t len);
+    void relayDiagnosticToECU(Connection& vmg, const uint8_t* payload, size_t len);
+    bool sendDiagnosticToVMG(const std::vector<uint8_t>& uds);
+    bool sendZoneReportToVMG(bool force);
 };
 
 } // namespace vmg
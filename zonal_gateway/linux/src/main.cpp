@@ -22,10 +22,12 @@ int main(int argc, char** argv) {
     uint8_t zone_id = 1;
     std::string vmg_ip = "192.168.1.1";
     uint16_t vmg_port = 13400;
+    std::string capture_path;           /* Optional DoIP trace (tools/doip_replay) */
     
     if (argc >= 2) zone_id = std::stoi(argv[1]);
     if (argc >= 3) vmg_ip = argv[2];
     if (argc >= 4) vmg_port = std::stoi(argv[3]);
+    if (argc >= 5) capture_path = argv[4];
     
     std::cout << "╔════════════════════════════════════════╗" << std::endl;
     std::cout << "║  Zonal Gateway (Linux x86)             ║" << std::endl;
@@ -41,6 +43,11 @@ int main(int argc, char** argv) {
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
+    /* Capture before start so the first ECU connections are recorded */
+    if (!capture_path.empty() && !zg.startCapture(capture_path)) {
+        return -1;
+    }
+    
     /* Start */
     if (!zg.start()) {
         std::cerr << "[MAIN] Failed to start Zonal Gateway" << std::endl;
@@ -4,6 +4,9 @@
  */
 
 #include "zonal_gateway_linux.hpp"
+#include "zone_vci_codec.hpp"
+#include "doip_protocol.h"
+#include "uds_standard.h"
 #include <iostream>
 #include <sstream>
 #include <iomanip>
@@ -11,7 +14,12 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
+#include <cerrno>
+#include <algorithm>
 #include <chrono>
 
 namespace vmg {
@@ -23,10 +31,15 @@ ZonalGatewayLinux::ZonalGatewayLinux(uint8_t zone_id, const std::string& vmg_ip,
       state_(ZGState::INIT),
       running_(false),
       vmg_connected_(false),
+      vmg_reported_generation_(0),
+      vmg_pending_generation_(0),
       doip_server_tcp_socket_(-1),
       doip_server_udp_socket_(-1),
       json_server_socket_(-1),
-      vmg_client_socket_(-1)
+      vmg_client_socket_(-1),
+      epoll_fd_(-1),
+      wakeup_fd_(-1),
+      next_trace_id_(1)
 {
     std::ostringstream oss;
     oss << "ZG-" << std::setfill('0') << std::setw(3) << static_cast<int>(zone_id);
@@ -34,7 +47,25 @@ ZonalGatewayLinux::ZonalGatewayLinux(uint8_t zone_id, const std::string& vmg_ip,
     
     logical_address_ = 0x0200 + zone_id; // 0x0201, 0x0202...
     
-    zone_vci_.zone_id = zone_id;
+    auto vci = std::make_shared<ZoneVCIData>();
+    vci->zone_id = zone_id;
+    vci->total_storage_mb = 0;
+    vci->available_storage_mb = 0;
+    vci->average_battery_level = 0;
+    vci->generation = 1;  /* 0 is reserved for "no report sent yet" */
+    zone_vci_ = std::move(vci);
+}
+
+template <typename Fn>
+bool ZonalGatewayLinux::updateZoneVCI(Fn&& fn) {
+    /* Copy-on-write: readers keep whatever snapshot they loaded */
+    std::lock_guard<std::mutex> lock(zone_vci_write_mutex_);
+    auto next = std::make_shared<ZoneVCIData>(*std::atomic_load(&zone_vci_));
+    if (!fn(*next)) {
+        return false;
+    }
+    std::atomic_store(&zone_vci_, std::shared_ptr<const ZoneVCIData>(std::move(next)));
+    return true;
 }
 
 ZonalGatewayLinux::~ZonalGatewayLinux() {
@@ -52,13 +83,17 @@ bool ZonalGatewayLinux::start() {
         return false;
     }
     
+    if (!createEventLoop()) {
+        std::cerr << "[ZG] Failed to create event loop" << std::endl;
+        closeServerSockets();
+        return false;
+    }
+    
     running_ = true;
     state_ = ZGState::READY;
     
-    /* Start threads */
-    server_thread_ = std::make_unique<std::thread>(&ZonalGatewayLinux::serverThreadFunc, this);
-    discovery_thread_ = std::make_unique<std::thread>(&ZonalGatewayLinux::discoveryThreadFunc, this);
-    client_thread_ = std::make_unique<std::thread>(&ZonalGatewayLinux::clientThreadFunc, this);
+    /* Start thread (ECU side and VMG link) */
+    event_thread_ = std::make_unique<std::thread>(&ZonalGatewayLinux::eventLoopThreadFunc, this);
     
     std::cout << "[ZG] Zonal Gateway started" << std::endl;
     return true;
@@ -71,23 +106,58 @@ void ZonalGatewayLinux::stop() {
     
     running_ = false;
     
-    /* Join threads */
-    if (server_thread_ && server_thread_->joinable()) {
-        server_thread_->join();
+    /* Wake the event loop out of epoll_wait */
+    if (wakeup_fd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t ret = write(wakeup_fd_, &one, sizeof(one));
+        (void)ret;
     }
-    if (discovery_thread_ && discovery_thread_->joinable()) {
-        discovery_thread_->join();
-    }
-    if (client_thread_ && client_thread_->joinable()) {
-        client_thread_->join();
+    
+    /* Join thread */
+    if (event_thread_ && event_thread_->joinable()) {
+        event_thread_->join();
     }
     
+    closeEventLoop();
     closeServerSockets();
+    stopCapture();
     
     state_ = ZGState::INIT;
     std::cout << "[ZG] Zonal Gateway stopped" << std::endl;
 }
 
+bool ZonalGatewayLinux::startCapture(const std::string& path) {
+    auto writer = std::shared_ptr<DoIPTraceWriter>(new DoIPTraceWriter(), [](DoIPTraceWriter* w) {
+        doip_trace_writer_close(w);
+        delete w;
+    });
+    if (doip_trace_writer_open(writer.get(), path.c_str()) != 0) {
+        std::cerr << "[ZG] Failed to open capture file " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    std::atomic_store(&capture_, writer);
+    std::cout << "[ZG] DoIP capture: " << path << std::endl;
+    return true;
+}
+
+void ZonalGatewayLinux::stopCapture() {
+    auto writer = std::atomic_exchange(&capture_, std::shared_ptr<DoIPTraceWriter>());
+    if (!writer) {
+        return;
+    }
+    pthread_mutex_lock(&writer->mutex);
+    std::cout << "[ZG] DoIP capture closed: " << writer->records << " records, "
+              << writer->bytes << " bytes, " << writer->dropped << " dropped" << std::endl;
+    pthread_mutex_unlock(&writer->mutex);
+}
+
+void ZonalGatewayLinux::captureFrame(uint32_t connection, uint8_t kind, const uint8_t* frame, size_t len) {
+    auto writer = std::atomic_load(&capture_);
+    if (writer) {
+        doip_trace_record(writer.get(), connection, kind, frame, len);
+    }
+}
+
 void ZonalGatewayLinux::run() {
     /* Main loop - just keep threads running */
     while (running_) {
@@ -95,60 +165,57 @@ void ZonalGatewayLinux::run() {
     }
 }
 
-bool ZonalGatewayLinux::createServerSockets() {
-    /* TCP Socket for DoIP */
-    doip_server_tcp_socket_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (doip_server_tcp_socket_ < 0) {
-        std::cerr << "[ZG] Failed to create TCP socket" << std::endl;
-        return false;
+static int createListenSocket(int type, uint16_t port) {
+    int sock = socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        return -1;
     }
     
     int opt = 1;
-    setsockopt(doip_server_tcp_socket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
     
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(ZG_DOIP_SERVER_PORT);
+    addr.sin_port = htons(port);
     
-    if (bind(doip_server_tcp_socket_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        std::cerr << "[ZG] Failed to bind TCP socket to port " << ZG_DOIP_SERVER_PORT << std::endl;
-        close(doip_server_tcp_socket_);
-        return false;
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        (type == SOCK_STREAM && listen(sock, SOMAXCONN) < 0)) {
+        close(sock);
+        return -1;
     }
     
-    if (listen(doip_server_tcp_socket_, 5) < 0) {
-        std::cerr << "[ZG] Failed to listen on TCP socket" << std::endl;
-        close(doip_server_tcp_socket_);
+    return sock;
+}
+
+bool ZonalGatewayLinux::createServerSockets() {
+    /* TCP Socket for DoIP */
+    doip_server_tcp_socket_ = createListenSocket(SOCK_STREAM, ZG_DOIP_SERVER_PORT);
+    if (doip_server_tcp_socket_ < 0) {
+        std::cerr << "[ZG] Failed to bind TCP socket to port " << ZG_DOIP_SERVER_PORT << std::endl;
         return false;
     }
     
     /* UDP Socket for Vehicle Discovery */
-    doip_server_udp_socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    doip_server_udp_socket_ = createListenSocket(SOCK_DGRAM, ZG_DOIP_SERVER_PORT);
     if (doip_server_udp_socket_ < 0) {
-        std::cerr << "[ZG] Failed to create UDP socket" << std::endl;
-        close(doip_server_tcp_socket_);
+        std::cerr << "[ZG] Failed to bind UDP socket to port " << ZG_DOIP_SERVER_PORT << std::endl;
+        closeServerSockets();
         return false;
     }
     
-    setsockopt(doip_server_udp_socket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-    
-    struct sockaddr_in udp_addr;
-    memset(&udp_addr, 0, sizeof(udp_addr));
-    udp_addr.sin_family = AF_INET;
-    udp_addr.sin_addr.s_addr = INADDR_ANY;
-    udp_addr.sin_port = htons(ZG_DOIP_SERVER_PORT);
-    
-    if (bind(doip_server_udp_socket_, (struct sockaddr*)&udp_addr, sizeof(udp_addr)) < 0) {
-        std::cerr << "[ZG] Failed to bind UDP socket to port " << ZG_DOIP_SERVER_PORT << std::endl;
-        close(doip_server_tcp_socket_);
-        close(doip_server_udp_socket_);
+    /* TCP Socket for JSON (VCI / status) */
+    json_server_socket_ = createListenSocket(SOCK_STREAM, ZG_JSON_SERVER_PORT);
+    if (json_server_socket_ < 0) {
+        std::cerr << "[ZG] Failed to bind JSON socket to port " << ZG_JSON_SERVER_PORT << std::endl;
+        closeServerSockets();
         return false;
     }
     
     std::cout << "[ZG] Server sockets created successfully" << std::endl;
     std::cout << "[ZG] DoIP Server: 0.0.0.0:" << ZG_DOIP_SERVER_PORT << " (TCP/UDP)" << std::endl;
+    std::cout << "[ZG] JSON Server: 0.0.0.0:" << ZG_JSON_SERVER_PORT << " (TCP)" << std::endl;
     
     return true;
 }
@@ -168,66 +235,748 @@ void ZonalGatewayLinux::closeServerSockets() {
     }
 }
 
-void ZonalGatewayLinux::serverThreadFunc() {
-    std::cout << "[ZG] Server thread started" << std::endl;
+bool ZonalGatewayLinux::createEventLoop() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        return false;
+    }
     
-    while (running_) {
-        /* Handle ECU connections */
-        handleECUConnections();
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ < 0) {
+        closeEventLoop();
+        return false;
+    }
+    
+    if (!watchFd(wakeup_fd_, EPOLLIN) ||
+        !watchFd(doip_server_tcp_socket_, EPOLLIN) ||
+        !watchFd(doip_server_udp_socket_, EPOLLIN) ||
+        !watchFd(json_server_socket_, EPOLLIN)) {
+        closeEventLoop();
+        return false;
+    }
+    
+    return true;
+}
+
+void ZonalGatewayLinux::closeEventLoop() {
+    /* Event thread has been joined, connections are no longer in use */
+    for (auto& entry : connections_) {
+        close(entry.first);
     }
+    connections_.clear();
+    address_to_fd_.clear();
+    vmg_client_socket_ = -1;
+    vmg_connected_ = false;
     
-    std::cout << "[ZG] Server thread stopped" << std::endl;
+    if (wakeup_fd_ >= 0) {
+        close(wakeup_fd_);
+        wakeup_fd_ = -1;
+    }
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+}
+
+bool ZonalGatewayLinux::watchFd(int fd, uint32_t events, bool modify) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+    return epoll_ctl(epoll_fd_, modify ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) == 0;
 }
 
-void ZonalGatewayLinux::clientThreadFunc() {
-    std::cout << "[ZG] Client thread started" << std::endl;
+void ZonalGatewayLinux::eventLoopThreadFunc() {
+    std::cout << "[ZG] Event loop thread started" << std::endl;
     
-    /* Connect to VMG */
-    if (connectToVMG()) {
-        std::cout << "[ZG] Connected to VMG: " << vmg_ip_ << ":" << vmg_port_ << std::endl;
+    struct epoll_event events[ZG_MAX_EPOLL_EVENTS];
+    vmg_next_tick_ = std::chrono::steady_clock::now();  /* Connect to the VMG right away */
+    
+    while (running_) {
+        /* Blocks until a socket is ready, the next VMG link deadline, or stop() */
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+            vmg_next_tick_ - std::chrono::steady_clock::now()).count();
+        int n = epoll_wait(epoll_fd_, events, ZG_MAX_EPOLL_EVENTS, wait > 0 ? static_cast<int>(wait) : 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[ZG] epoll_wait failed: " << strerror(errno) << std::endl;
+            break;
+        }
         
-        /* Send heartbeat periodically */
-        while (running_) {
-            if (vmg_connected_) {
-                sendHeartbeatToVMG();
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            
+            if (fd == wakeup_fd_) {
+                uint64_t value;
+                while (read(wakeup_fd_, &value, sizeof(value)) > 0) {}
+            } else if (fd == doip_server_tcp_socket_) {
+                acceptConnections(fd, ConnectionKind::DOIP);
+            } else if (fd == json_server_socket_) {
+                acceptConnections(fd, ConnectionKind::JSON);
+            } else if (fd == doip_server_udp_socket_) {
+                handleVehicleDiscovery();
+            } else {
+                handleConnectionEvent(fd, events[i].events);
             }
-            std::this_thread::sleep_for(std::chrono::seconds(10));
+        }
+        
+        if (std::chrono::steady_clock::now() >= vmg_next_tick_) {
+            serviceVMGLink();
         }
     }
     
-    std::cout << "[ZG] Client thread stopped" << std::endl;
+    disconnectFromVMG();
+    std::cout << "[ZG] Event loop thread stopped" << std::endl;
 }
 
-void ZonalGatewayLinux::discoveryThreadFunc() {
-    std::cout << "[ZG] Discovery thread started" << std::endl;
+void ZonalGatewayLinux::serviceVMGLink() {
+    auto now = std::chrono::steady_clock::now();
+    vmg_next_tick_ = now + std::chrono::milliseconds(ZG_VCI_REPORT_INTERVAL_MS);
     
-    while (running_) {
-        handleVehicleDiscovery();
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    if (vmg_client_socket_ < 0) {
+        if (!connectToVMG()) {
+            vmg_next_tick_ = now + std::chrono::milliseconds(ZG_VMG_RECONNECT_INTERVAL_MS);
+        }
+        return;
     }
     
-    std::cout << "[ZG] Discovery thread stopped" << std::endl;
+    if (!vmg_connected_) {
+        /* connect() still in progress */
+        if (now - vmg_last_activity_ >= std::chrono::milliseconds(ZG_VMG_RECONNECT_INTERVAL_MS)) {
+            closeConnection(vmg_client_socket_);
+        }
+        return;
+    }
+    
+    /* One report frame carries status and VCI changes together */
+    sendZoneReportToVMG(now - vmg_last_status_ >= std::chrono::milliseconds(ZG_STATUS_INTERVAL_MS));
+    
+    /* TesterPresent only on an otherwise idle link */
+    if (vmg_connected_ &&
+        now - vmg_last_activity_ >= std::chrono::milliseconds(ZG_HEARTBEAT_INTERVAL_MS)) {
+        sendHeartbeatToVMG();
+    }
 }
 
 void ZonalGatewayLinux::handleECUConnections() {
-    /* Accept connections from ECUs */
-    /* TODO: Implement with select/poll for non-blocking */
+    /* Accept every pending connection on both ECU-facing listen sockets */
+    acceptConnections(doip_server_tcp_socket_, ConnectionKind::DOIP);
+    acceptConnections(json_server_socket_, ConnectionKind::JSON);
 }
 
-void ZonalGatewayLinux::handleVehicleDiscovery() {
-    /* Handle UDP vehicle discovery requests */
-    /* TODO: Implement UDP receive and response */
+void ZonalGatewayLinux::acceptConnections(int listen_fd, ConnectionKind kind) {
+    /* Edge of readiness may cover several clients: accept until EAGAIN */
+    while (true) {
+        struct sockaddr_in client_addr;
+        socklen_t addr_len = sizeof(client_addr);
+        int fd = accept4(listen_fd, (struct sockaddr*)&client_addr, &addr_len,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "[ZG] accept failed: " << strerror(errno) << std::endl;
+            }
+            return;
+        }
+        
+        int opt = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        
+        if (!watchFd(fd, EPOLLIN | EPOLLRDHUP)) {
+            std::cerr << "[ZG] Failed to watch connection" << std::endl;
+            close(fd);
+            continue;
+        }
+        
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &client_addr.sin_addr, ip, sizeof(ip));
+        
+        Connection conn;
+        conn.fd = fd;
+        conn.kind = kind;
+        conn.peer = std::string(ip) + ":" + std::to_string(ntohs(client_addr.sin_port));
+        conn.logical_address = 0;
+        conn.routing_active = false;
+        conn.trace_id = next_trace_id_++;
+        if (kind == ConnectionKind::DOIP) {
+            captureFrame(conn.trace_id, DOIP_TRACE_OPEN, nullptr, 0);
+        }
+        
+        std::cout << "[ZG] " << (kind == ConnectionKind::DOIP ? "DoIP" : "JSON")
+                  << " client connected: " << conn.peer << std::endl;
+        connections_.emplace(fd, std::move(conn));
+    }
 }
 
-bool ZonalGatewayLinux::connectToVMG() {
-    std::cout << "[ZG] Connecting to VMG: " << vmg_ip_ << ":" << vmg_port_ << std::endl;
+void ZonalGatewayLinux::handleConnectionEvent(int fd, uint32_t events) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) {
+        return;  // Closed earlier in this batch
+    }
+    Connection& conn = it->second;
     
-    vmg_client_socket_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (vmg_client_socket_ < 0) {
-        std::cerr << "[ZG] Failed to create VMG client socket" << std::endl;
+    if (events & EPOLLERR) {
+        closeConnection(fd);
+        return;
+    }
+    
+    if (conn.kind == ConnectionKind::VMG && !vmg_connected_) {
+        /* Non-blocking connect() finished */
+        if (!(events & EPOLLOUT) || !finishVMGConnect(conn)) {
+            closeConnection(fd);
+            return;
+        }
+    }
+    
+    if (events & EPOLLOUT) {
+        if (!flushConnection(conn)) {
+            closeConnection(fd);
+            return;
+        }
+    }
+    
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP)) {
+        bool open = readConnection(conn);
+        
+        /* Parse whatever arrived, even if the peer closed right after */
+        if (conn.kind != ConnectionKind::JSON) {
+            processDoIPInput(conn);
+        } else {
+            processJsonInput(conn);
+        }
+        
+        /* Input processing may have closed this or another connection */
+        it = connections_.find(fd);
+        if (it == connections_.end()) {
+            return;
+        }
+        if (!open || !flushConnection(it->second)) {
+            closeConnection(fd);
+        }
+    }
+}
+
+bool ZonalGatewayLinux::readConnection(Connection& conn) {
+    uint8_t buffer[4096];
+    
+    while (true) {
+        ssize_t n = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn.rx.insert(conn.rx.end(), buffer, buffer + n);
+            continue;
+        }
+        if (n == 0) {
+            return false;  // Peer closed
+        }
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+bool ZonalGatewayLinux::flushConnection(Connection& conn) {
+    size_t offset = 0;
+    while (offset < conn.tx.size()) {
+        ssize_t n = send(conn.fd, conn.tx.data() + offset, conn.tx.size() - offset, MSG_NOSIGNAL);
+        if (n > 0) {
+            offset += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
         return false;
     }
+    conn.tx.erase(conn.tx.begin(), conn.tx.begin() + offset);
+    
+    /* Only ask for EPOLLOUT while there is something left to send */
+    uint32_t events = EPOLLIN | EPOLLRDHUP;
+    if (!conn.tx.empty()) {
+        events |= EPOLLOUT;
+    }
+    return watchFd(conn.fd, events, true);
+}
+
+void ZonalGatewayLinux::closeConnection(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) {
+        return;
+    }
+    
+    Connection& conn = it->second;
+    if (conn.routing_active) {
+        auto route = address_to_fd_.find(conn.logical_address);
+        if (route != address_to_fd_.end() && route->second == fd) {
+            address_to_fd_.erase(route);
+        }
+        setECUOnline(conn.logical_address, false);
+    }
+    
+    if (conn.kind == ConnectionKind::VMG) {
+        std::cout << (vmg_connected_ ? "[ZG] Disconnected from VMG" : "[ZG] Failed to connect to VMG")
+                  << std::endl;
+        vmg_client_socket_ = -1;
+        vmg_connected_ = false;
+        vmg_next_tick_ = std::chrono::steady_clock::now() +
+                         std::chrono::milliseconds(ZG_VMG_RECONNECT_INTERVAL_MS);
+    } else {
+        std::cout << "[ZG] Client disconnected: " << conn.peer << std::endl;
+    }
+    if (conn.kind == ConnectionKind::DOIP) {
+        captureFrame(conn.trace_id, DOIP_TRACE_CLOSE, nullptr, 0);
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections_.erase(it);
+}
+
+void ZonalGatewayLinux::queueFrame(Connection& conn, uint16_t payload_type,
+                                   const uint8_t* payload, size_t len) {
+    uint8_t header[DOIP_HEADER_SIZE] = {
+        DOIP_PROTOCOL_VERSION,
+        DOIP_INVERSE_PROTOCOL_VERSION,
+        static_cast<uint8_t>(payload_type >> 8),
+        static_cast<uint8_t>(payload_type & 0xFF),
+        static_cast<uint8_t>(len >> 24),
+        static_cast<uint8_t>(len >> 16),
+        static_cast<uint8_t>(len >> 8),
+        static_cast<uint8_t>(len & 0xFF)
+    };
+    size_t start = conn.tx.size();
+    conn.tx.insert(conn.tx.end(), header, header + DOIP_HEADER_SIZE);
+    conn.tx.insert(conn.tx.end(), payload, payload + len);
+    
+    /* Recorded when queued; the flush follows within the same loop iteration */
+    if (conn.kind == ConnectionKind::DOIP) {
+        captureFrame(conn.trace_id, DOIP_TRACE_TX, conn.tx.data() + start, DOIP_HEADER_SIZE + len);
+    }
+}
+
+void ZonalGatewayLinux::processDoIPInput(Connection& conn) {
+    const int fd = conn.fd;
+    size_t offset = 0;
+    
+    while (conn.rx.size() - offset >= DOIP_HEADER_SIZE) {
+        const uint8_t* header = conn.rx.data() + offset;
+        
+        if (header[0] != DOIP_PROTOCOL_VERSION || header[1] != DOIP_INVERSE_PROTOCOL_VERSION) {
+            std::cerr << "[ZG] Invalid DoIP header from " << conn.peer << std::endl;
+            closeConnection(fd);
+            return;
+        }
+        
+        uint16_t payload_type = static_cast<uint16_t>((header[2] << 8) | header[3]);
+        uint32_t payload_len = (static_cast<uint32_t>(header[4]) << 24) |
+                               (static_cast<uint32_t>(header[5]) << 16) |
+                               (static_cast<uint32_t>(header[6]) << 8) |
+                               static_cast<uint32_t>(header[7]);
+        
+        if (payload_len > DOIP_MAX_PAYLOAD_SIZE) {
+            std::cerr << "[ZG] DoIP payload too large (" << payload_len
+                      << ") from " << conn.peer << std::endl;
+            closeConnection(fd);
+            return;
+        }
+        if (conn.rx.size() - offset < DOIP_HEADER_SIZE + payload_len) {
+            break;  // Wait for the rest of the frame
+        }
+        
+        if (conn.kind == ConnectionKind::DOIP) {
+            captureFrame(conn.trace_id, DOIP_TRACE_RX, header, DOIP_HEADER_SIZE + payload_len);
+        }
+        processDoIPFrame(conn, payload_type, header + DOIP_HEADER_SIZE, payload_len);
+        offset += DOIP_HEADER_SIZE + payload_len;
+        if (connections_.find(fd) == connections_.end()) {
+            return;  // Closed while handling the frame
+        }
+    }
+    
+    conn.rx.erase(conn.rx.begin(), conn.rx.begin() + offset);
+}
+
+void ZonalGatewayLinux::processDoIPFrame(Connection& conn, uint16_t payload_type,
+                                         const uint8_t* payload, size_t len) {
+    if (conn.kind == ConnectionKind::VMG) {
+        vmg_last_activity_ = std::chrono::steady_clock::now();
+        handleVMGFrame(conn, payload_type, payload, len);
+        return;
+    }
+    
+    switch (payload_type) {
+        case DOIP_ROUTING_ACTIVATION_REQ:
+            handleRoutingActivation(conn, payload, len);
+            break;
+            
+        case DOIP_ALIVE_CHECK_REQ: {
+            uint8_t response[2] = {
+                static_cast<uint8_t>(logical_address_ >> 8),
+                static_cast<uint8_t>(logical_address_ & 0xFF)
+            };
+            queueFrame(conn, DOIP_ALIVE_CHECK_RES, response, sizeof(response));
+            break;
+        }
+        
+        case DOIP_ALIVE_CHECK_RES:
+        case DOIP_DIAGNOSTIC_MESSAGE_POS_ACK:
+        case DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK:
+            break;  // ECU ACKs: the ZG already ACKed relayed requests to the VMG
+            
+        case DOIP_DIAGNOSTIC_MESSAGE:
+            handleDiagnosticFromECU(conn, payload, len);
+            break;
+            
+        default:
+            std::cerr << "[ZG] Unsupported DoIP payload type 0x" << std::hex
+                      << payload_type << std::dec << " from " << conn.peer << std::endl;
+            break;
+    }
+}
+
+void ZonalGatewayLinux::handleRoutingActivation(Connection& conn, const uint8_t* payload, size_t len) {
+    if (len < 7) {
+        return;
+    }
+    
+    uint16_t source_address = static_cast<uint16_t>((payload[0] << 8) | payload[1]);
+    uint8_t code = DOIP_RA_RES_SUCCESS;
+    
+    auto route = address_to_fd_.find(source_address);
+    if (route != address_to_fd_.end() && route->second != conn.fd) {
+        code = DOIP_RA_RES_ALREADY_ACTIVE;
+    } else if (!conn.routing_active && address_to_fd_.size() >= ZG_MAX_ECUS) {
+        code = DOIP_RA_RES_NO_RESOURCES;
+    }
+    
+    if (code == DOIP_RA_RES_SUCCESS) {
+        conn.logical_address = source_address;
+        conn.routing_active = true;
+        address_to_fd_[source_address] = conn.fd;
+        setECUOnline(source_address, true);
+        
+        std::cout << "[ZG] Routing activated: 0x" << std::hex << std::setfill('0')
+                  << std::setw(4) << source_address << std::dec << " (" << conn.peer << ")"
+                  << std::endl;
+    }
+    
+    uint8_t response[9] = {
+        static_cast<uint8_t>(source_address >> 8),
+        static_cast<uint8_t>(source_address & 0xFF),
+        static_cast<uint8_t>(logical_address_ >> 8),
+        static_cast<uint8_t>(logical_address_ & 0xFF),
+        code,
+        0x00, 0x00, 0x00, 0x00
+    };
+    queueFrame(conn, DOIP_ROUTING_ACTIVATION_RES, response, sizeof(response));
+}
+
+void ZonalGatewayLinux::handleDiagnosticFromECU(Connection& conn, const uint8_t* payload, size_t len) {
+    if (len < 4) {
+        return;
+    }
+    
+    uint16_t target_address = static_cast<uint16_t>((payload[2] << 8) | payload[3]);
+    
+    /* ACK/NACK: swap SA and TA of the request */
+    uint8_t ack[5] = { payload[2], payload[3], payload[0], payload[1], DOIP_DIAG_ACK_CONFIRM };
+    
+    if (!conn.routing_active) {
+        ack[4] = DOIP_DIAG_NACK_INVALID_SA;
+        queueFrame(conn, DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK, ack, sizeof(ack));
+        return;
+    }
+    
+    if (target_address == logical_address_) {
+        queueFrame(conn, DOIP_DIAGNOSTIC_MESSAGE_POS_ACK, ack, sizeof(ack));
+        handleLocalDiagnostic(conn, payload + 4, len - 4);
+        return;
+    }
+    
+    auto route = address_to_fd_.find(target_address);
+    auto target = (route != address_to_fd_.end()) ? connections_.find(route->second)
+                                                    : connections_.end();
+    if (target == connections_.end()) {
+        /* Not in this zone (a tester or another zone): up to the VMG */
+        target = vmg_connected_ ? connections_.find(vmg_client_socket_) : connections_.end();
+    }
+    if (target == connections_.end()) {
+        ack[4] = DOIP_DIAG_NACK_UNKNOWN_TA;
+        queueFrame(conn, DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK, ack, sizeof(ack));
+        return;
+    }
+    
+    /* Relay to the link owning the target address; flushed on its EPOLLOUT */
+    queueFrame(target->second, DOIP_DIAGNOSTIC_MESSAGE, payload, len);
+    if (target->first != conn.fd && !flushConnection(target->second)) {
+        closeConnection(target->first);
+        ack[4] = DOIP_DIAG_NACK_TARGET_UNREACHABLE;
+        queueFrame(conn, DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK, ack, sizeof(ack));
+        return;
+    }
+    queueFrame(conn, DOIP_DIAGNOSTIC_MESSAGE_POS_ACK, ack, sizeof(ack));
+}
+
+void ZonalGatewayLinux::handleLocalDiagnostic(Connection& conn, const uint8_t* uds, size_t uds_len) {
+    if (uds_len == 0) {
+        return;
+    }
+    
+    std::vector<uint8_t> response = {
+        static_cast<uint8_t>(logical_address_ >> 8),
+        static_cast<uint8_t>(logical_address_ & 0xFF),
+        static_cast<uint8_t>(conn.logical_address >> 8),
+        static_cast<uint8_t>(conn.logical_address & 0xFF)
+    };
+    
+    uint16_t did = (uds_len >= 3) ? static_cast<uint16_t>((uds[1] << 8) | uds[2]) : 0;
+    
+    if (uds[0] == UDS_SID_TESTER_PRESENT) {
+        /* ECU heartbeat */
+        setECUOnline(conn.logical_address, true);
+        if (uds_len >= 2 && (uds[1] & 0x80)) {
+            return;  // Response suppressed
+        }
+        response.insert(response.end(), { UDS_SID_TESTER_PRESENT + UDS_POSITIVE_RESPONSE_OFFSET, 0x00 });
+    } else if (uds[0] == UDS_SID_WRITE_DATA_BY_IDENTIFIER && did == UDS_DID_ECU_VCI_RECORD) {
+        if (applyECUVCIRecord(conn.logical_address, uds + 3, uds_len - 3)) {
+            response.insert(response.end(), {
+                UDS_SID_WRITE_DATA_BY_IDENTIFIER + UDS_POSITIVE_RESPONSE_OFFSET, uds[1], uds[2] });
+        } else {
+            response.insert(response.end(), {
+                UDS_NEGATIVE_RESPONSE, uds[0], UDS_NRC_INCORRECT_MESSAGE_LENGTH });
+        }
+    } else {
+        response.insert(response.end(), { UDS_NEGATIVE_RESPONSE, uds[0], UDS_NRC_SERVICE_NOT_SUPPORTED });
+    }
+    
+    queueFrame(conn, DOIP_DIAGNOSTIC_MESSAGE, response.data(), response.size());
+}
+
+static bool sameVCI(const ZoneECUInfo& a, const ZoneECUInfo& b) {
+    return a.ecu_id == b.ecu_id &&
+           a.logical_address == b.logical_address &&
+           a.firmware_version == b.firmware_version &&
+           a.hardware_version == b.hardware_version &&
+           a.is_online == b.is_online &&
+           a.ota_capable == b.ota_capable &&
+           a.delta_update_supported == b.delta_update_supported &&
+           a.max_package_size == b.max_package_size;
+}
+
+static void markChanged(ZoneVCIData& vci, ZoneECUInfo& ecu) {
+    ecu.generation = ++vci.generation;
+}
+
+bool ZonalGatewayLinux::applyECUVCIRecord(uint16_t logical_address, const uint8_t* data, size_t len) {
+    ZoneECUInfo record{};
+    const uint8_t* p = data;
+    if (!ZoneVCICodec::decodeECURecord(p, data + len, record) || p != data + len) {
+        std::cerr << "[ZG] Malformed VCI record from 0x" << std::hex << logical_address
+                  << std::dec << std::endl;
+        return false;
+    }
+    
+    /* The routed connection is authoritative for the address */
+    record.logical_address = logical_address;
+    record.is_online = true;
+    record.last_heartbeat_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    
+    return updateZoneVCI([&](ZoneVCIData& vci) {
+        for (auto& ecu : vci.ecus) {
+            if (ecu.logical_address == logical_address) {
+                record.generation = ecu.generation;
+                bool changed = !sameVCI(ecu, record);
+                ecu = record;
+                if (changed) {
+                    markChanged(vci, ecu);
+                }
+                return true;
+            }
+        }
+        
+        if (vci.ecus.size() >= ZG_MAX_ECUS) {
+            return false;
+        }
+        vci.ecus.push_back(record);
+        markChanged(vci, vci.ecus.back());
+        return true;
+    });
+}
+
+void ZonalGatewayLinux::processJsonInput(Connection& conn) {
+    /* Newline-delimited JSON messages */
+    size_t start = 0;
+    for (size_t i = 0; i < conn.rx.size(); i++) {
+        if (conn.rx[i] == '\n') {
+            if (i > start) {
+                processJsonLine(std::string(conn.rx.begin() + start, conn.rx.begin() + i));
+            }
+            start = i + 1;
+        }
+    }
+    conn.rx.erase(conn.rx.begin(), conn.rx.begin() + start);
+    
+    if (conn.rx.size() > ZG_MAX_JSON_LINE) {
+        std::cerr << "[ZG] JSON line too long from " << conn.peer << std::endl;
+        closeConnection(conn.fd);
+    }
+}
+
+static std::string extractJsonString(const std::string& json, const std::string& key) {
+    std::string pattern = "\"" + key + "\"";
+    size_t pos = json.find(pattern);
+    if (pos == std::string::npos) return "";
+    
+    pos = json.find(':', pos + pattern.size());
+    if (pos == std::string::npos) return "";
+    pos = json.find('"', pos + 1);
+    if (pos == std::string::npos) return "";
+    
+    size_t end = json.find('"', pos + 1);
+    if (end == std::string::npos) return "";
+    return json.substr(pos + 1, end - pos - 1);
+}
+
+void ZonalGatewayLinux::processJsonLine(const std::string& line) {
+    std::string device_id = extractJsonString(line, "device_id");
+    if (device_id.empty()) {
+        device_id = extractJsonString(line, "ecu_id");
+    }
+    if (device_id.empty()) {
+        return;
+    }
+    
+    std::string firmware_version = extractJsonString(line, "firmware_version");
+    uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    
+    bool registered = false;
+    updateZoneVCI([&](ZoneVCIData& vci) {
+        for (auto& ecu : vci.ecus) {
+            if (ecu.ecu_id == device_id) {
+                bool changed = !ecu.is_online ||
+                               (!firmware_version.empty() && ecu.firmware_version != firmware_version);
+                ecu.is_online = true;
+                ecu.last_heartbeat_time = now;
+                if (!firmware_version.empty()) {
+                    ecu.firmware_version = firmware_version;
+                }
+                if (changed) {
+                    markChanged(vci, ecu);
+                }
+                return true;
+            }
+        }
+        
+        if (vci.ecus.size() >= ZG_MAX_ECUS) {
+            return false;
+        }
+        
+        ZoneECUInfo info{};
+        info.ecu_id = device_id;
+        info.firmware_version = firmware_version;
+        info.is_online = true;
+        info.last_heartbeat_time = now;
+        vci.ecus.push_back(info);
+        markChanged(vci, vci.ecus.back());
+        registered = true;
+        return true;
+    });
+    
+    if (registered) {
+        std::cout << "[ZG] ECU registered via JSON: " << device_id << std::endl;
+    }
+}
+
+void ZonalGatewayLinux::setECUOnline(uint16_t logical_address, bool online) {
+    uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    
+    updateZoneVCI([&](ZoneVCIData& vci) {
+        for (auto& ecu : vci.ecus) {
+            if (ecu.logical_address == logical_address) {
+                if (online) ecu.last_heartbeat_time = now;
+                if (ecu.is_online != online) {
+                    ecu.is_online = online;
+                    markChanged(vci, ecu);
+                }
+                return true;
+            }
+        }
+        
+        if (!online || vci.ecus.size() >= ZG_MAX_ECUS) {
+            return false;
+        }
+        
+        std::ostringstream oss;
+        oss << "ECU-" << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << logical_address;
+        
+        ZoneECUInfo info{};
+        info.ecu_id = oss.str();
+        info.logical_address = logical_address;
+        info.is_online = true;
+        info.last_heartbeat_time = now;
+        vci.ecus.push_back(info);
+        markChanged(vci, vci.ecus.back());
+        return true;
+    });
+}
+
+void ZonalGatewayLinux::handleVehicleDiscovery() {
+    /* Drain all queued vehicle identification requests */
+    uint8_t buffer[DOIP_HEADER_SIZE + 64];
+    
+    while (true) {
+        struct sockaddr_in client_addr;
+        socklen_t addr_len = sizeof(client_addr);
+        ssize_t n = recvfrom(doip_server_udp_socket_, buffer, sizeof(buffer), 0,
+                             (struct sockaddr*)&client_addr, &addr_len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;  // EAGAIN: queue drained
+        }
+        
+        if (n < static_cast<ssize_t>(DOIP_HEADER_SIZE) ||
+            buffer[0] != DOIP_PROTOCOL_VERSION || buffer[1] != DOIP_INVERSE_PROTOCOL_VERSION) {
+            continue;
+        }
+        
+        uint16_t payload_type = static_cast<uint16_t>((buffer[2] << 8) | buffer[3]);
+        if (payload_type != DOIP_VEHICLE_IDENTIFICATION_REQ) {
+            continue;
+        }
+        captureFrame(DOIP_TRACE_UDP_CONNECTION, DOIP_TRACE_RX, buffer, static_cast<size_t>(n));
+        
+        /* VIN(17) + LA(2) + EID(6) + GID(6) + Further action(1) */
+        uint8_t response[DOIP_HEADER_SIZE + DOIP_VIN_LENGTH + 2 + DOIP_EID_LENGTH + DOIP_GID_LENGTH + 1];
+        uint32_t payload_len = sizeof(response) - DOIP_HEADER_SIZE;
+        memset(response, 0, sizeof(response));
+        
+        response[0] = DOIP_PROTOCOL_VERSION;
+        response[1] = DOIP_INVERSE_PROTOCOL_VERSION;
+        response[2] = DOIP_VEHICLE_IDENTIFICATION_RES >> 8;
+        response[3] = DOIP_VEHICLE_IDENTIFICATION_RES & 0xFF;
+        response[6] = static_cast<uint8_t>(payload_len >> 8);
+        response[7] = static_cast<uint8_t>(payload_len & 0xFF);
+        
+        uint8_t* p = response + DOIP_HEADER_SIZE;
+        memset(p, '0', DOIP_VIN_LENGTH);
+        memcpy(p, zg_id_.data(), std::min<size_t>(zg_id_.size(), DOIP_VIN_LENGTH));
+        p += DOIP_VIN_LENGTH;
+        *p++ = static_cast<uint8_t>(logical_address_ >> 8);
+        *p++ = static_cast<uint8_t>(logical_address_ & 0xFF);
+        p[DOIP_EID_LENGTH - 1] = zone_id_;          /* EID */
+        p += DOIP_EID_LENGTH;
+        p[DOIP_GID_LENGTH - 1] = zone_id_;          /* GID */
+        p += DOIP_GID_LENGTH;
+        *p = 0x00;                                  /* No further action */
+        
+        sendto(doip_server_udp_socket_, response, sizeof(response), 0,
+               (struct sockaddr*)&client_addr, addr_len);
+        captureFrame(DOIP_TRACE_UDP_CONNECTION, DOIP_TRACE_TX, response, sizeof(response));
+    }
+}
+
+bool ZonalGatewayLinux::connectToVMG() {
+    std::cout << "[ZG] Connecting to VMG: " << vmg_ip_ << ":" << vmg_port_ << std::endl;
     
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
@@ -236,17 +985,179 @@ bool ZonalGatewayLinux::connectToVMG() {
     
     if (inet_pton(AF_INET, vmg_ip_.c_str(), &addr.sin_addr) <= 0) {
         std::cerr << "[ZG] Invalid VMG IP address" << std::endl;
-        close(vmg_client_socket_);
         return false;
     }
     
-    if (connect(vmg_client_socket_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        std::cerr << "[ZG] Failed to connect to VMG" << std::endl;
-        close(vmg_client_socket_);
+    /* Non-blocking: completion is reported as EPOLLOUT on the event loop */
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        std::cerr << "[ZG] Failed to create VMG client socket" << std::endl;
+        return false;
+    }
+    
+    if ((connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) ||
+        !watchFd(fd, EPOLLOUT | EPOLLRDHUP)) {
+        std::cerr << "[ZG] Failed to connect to VMG: " << strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+    
+    int opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    
+    Connection conn;
+    conn.fd = fd;
+    conn.kind = ConnectionKind::VMG;
+    conn.peer = vmg_ip_ + ":" + std::to_string(vmg_port_);
+    conn.logical_address = ZG_VMG_LOGICAL_ADDRESS;
+    conn.routing_active = false;
+    conn.trace_id = 0;
+    connections_.emplace(fd, std::move(conn));
+    
+    vmg_client_socket_ = fd;
+    vmg_last_activity_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool ZonalGatewayLinux::finishVMGConnect(Connection& conn) {
+    int error = 0;
+    socklen_t error_len = sizeof(error);
+    if (getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &error, &error_len) < 0 || error != 0) {
         return false;
     }
     
+    /* Routing activation (default type); the response arrives through handleVMGFrame() */
+    uint8_t activation[7] = {
+        static_cast<uint8_t>(logical_address_ >> 8),
+        static_cast<uint8_t>(logical_address_ & 0xFF),
+        0x00, 0x00, 0x00, 0x00, 0x00
+    };
+    queueFrame(conn, DOIP_ROUTING_ACTIVATION_REQ, activation, sizeof(activation));
+    
+    /* New session: VMG state is unknown, start over with a full snapshot */
+    auto now = std::chrono::steady_clock::now();
+    vmg_reported_generation_ = 0;
+    vmg_pending_generation_ = 0;
+    vmg_last_activity_ = now;
     vmg_connected_ = true;
+    std::cout << "[ZG] Connected to VMG: " << conn.peer << std::endl;
+    
+    /* First report right after the activation request */
+    vmg_next_tick_ = now;
+    return flushConnection(conn);
+}
+
+void ZonalGatewayLinux::disconnectFromVMG() {
+    if (vmg_client_socket_ >= 0) {
+        closeConnection(vmg_client_socket_);
+    }
+}
+
+void ZonalGatewayLinux::handleVMGFrame(Connection& vmg, uint16_t payload_type,
+                                       const uint8_t* payload, size_t len) {
+    /* ACKs and diagnostic messages: SA(2) TA(2) ... */
+    uint16_t target_address = (len >= 4) ? static_cast<uint16_t>((payload[2] << 8) | payload[3]) : 0;
+    
+    switch (payload_type) {
+        case DOIP_ROUTING_ACTIVATION_RES:
+            /* SA(2) TA(2) code(1) ... */
+            if (len >= 5 && payload[4] != DOIP_RA_RES_SUCCESS) {
+                std::cerr << "[ZG] VMG rejected routing activation (0x" << std::hex
+                          << static_cast<int>(payload[4]) << std::dec << ")" << std::endl;
+                disconnectFromVMG();
+            }
+            break;
+            
+        case DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK:
+            /* Not routed; the report (if one is in flight) never reached the VMG */
+            if (target_address == logical_address_ && vmg_pending_generation_ != 0) {
+                std::cerr << "[ZG] Zone VCI report NACKed by VMG, resending full snapshot" << std::endl;
+                vmg_pending_generation_ = 0;
+                vmg_reported_generation_ = 0;
+            }
+            break;
+            
+        case DOIP_DIAGNOSTIC_MESSAGE: {
+            if (len < 4 + 1) {
+                break;
+            }
+            if (target_address != logical_address_) {
+                relayDiagnosticToECU(vmg, payload, len);
+                break;
+            }
+            
+            /* Answer to the ZG's own request; only the F1A1 report answer matters */
+            if (len < 4 + 3 || vmg_pending_generation_ == 0) {
+                break;
+            }
+            const uint8_t* uds = payload + 4;
+            if (uds[0] == UDS_SID_WRITE_DATA_BY_IDENTIFIER + UDS_POSITIVE_RESPONSE_OFFSET &&
+                uds[1] == static_cast<uint8_t>(UDS_DID_ZONE_VCI_REPORT >> 8) &&
+                uds[2] == static_cast<uint8_t>(UDS_DID_ZONE_VCI_REPORT & 0xFF)) {
+                vmg_reported_generation_ = vmg_pending_generation_;
+                vmg_pending_generation_ = 0;
+            } else if (uds[0] == UDS_NEGATIVE_RESPONSE && uds[1] == UDS_SID_WRITE_DATA_BY_IDENTIFIER &&
+                       uds[2] != UDS_NRC_RESPONSE_PENDING) {
+                /* VMG copy diverged (e.g. it restarted): next report is a full snapshot */
+                std::cerr << "[ZG] Zone VCI report rejected by VMG (NRC 0x" << std::hex
+                          << static_cast<int>(uds[2]) << std::dec << "), resending full snapshot"
+                          << std::endl;
+                vmg_pending_generation_ = 0;
+                vmg_reported_generation_ = 0;
+            }
+            break;
+        }
+            
+        default:
+            break;  // Diagnostic ACKs, tester present responses
+    }
+}
+
+void ZonalGatewayLinux::relayDiagnosticToECU(Connection& vmg, const uint8_t* payload, size_t len) {
+    uint16_t target_address = static_cast<uint16_t>((payload[2] << 8) | payload[3]);
+    
+    /* ACK/NACK: swap SA and TA of the request */
+    uint8_t ack[5] = { payload[2], payload[3], payload[0], payload[1], DOIP_DIAG_ACK_CONFIRM };
+    
+    auto route = address_to_fd_.find(target_address);
+    auto target = (route != address_to_fd_.end()) ? connections_.find(route->second)
+                                                    : connections_.end();
+    if (target == connections_.end()) {
+        ack[4] = DOIP_DIAG_NACK_UNKNOWN_TA;
+        queueFrame(vmg, DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK, ack, sizeof(ack));
+        return;
+    }
+    
+    /* The ECU answers the tester's SA; that comes back up via handleDiagnosticFromECU() */
+    queueFrame(target->second, DOIP_DIAGNOSTIC_MESSAGE, payload, len);
+    if (!flushConnection(target->second)) {
+        closeConnection(target->first);
+        ack[4] = DOIP_DIAG_NACK_TARGET_UNREACHABLE;
+        queueFrame(vmg, DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK, ack, sizeof(ack));
+        return;
+    }
+    queueFrame(vmg, DOIP_DIAGNOSTIC_MESSAGE_POS_ACK, ack, sizeof(ack));
+}
+
+bool ZonalGatewayLinux::sendDiagnosticToVMG(const std::vector<uint8_t>& uds) {
+    std::vector<uint8_t> payload;
+    payload.reserve(4 + uds.size());
+    payload.push_back(static_cast<uint8_t>(logical_address_ >> 8));
+    payload.push_back(static_cast<uint8_t>(logical_address_ & 0xFF));
+    payload.push_back(static_cast<uint8_t>(ZG_VMG_LOGICAL_ADDRESS >> 8));
+    payload.push_back(static_cast<uint8_t>(ZG_VMG_LOGICAL_ADDRESS & 0xFF));
+    payload.insert(payload.end(), uds.begin(), uds.end());
+    
+    auto vmg = vmg_connected_ ? connections_.find(vmg_client_socket_) : connections_.end();
+    if (vmg == connections_.end()) {
+        return false;
+    }
+    queueFrame(vmg->second, DOIP_DIAGNOSTIC_MESSAGE, payload.data(), payload.size());
+    if (!flushConnection(vmg->second)) {
+        closeConnection(vmg->first);
+        return false;
+    }
+    vmg_last_activity_ = std::chrono::steady_clock::now();
     return true;
 }
 
@@ -254,51 +1165,113 @@ bool ZonalGatewayLinux::sendHeartbeatToVMG() {
     if (!vmg_connected_) return false;
     
     /* Send Tester Present (0x3E 0x00) via DoIP */
-    std::vector<uint8_t> uds_data = {0x3E, 0x00};
-    /* TODO: Wrap in DoIP diagnostic message and send */
-    
-    return true;
+    return sendDiagnosticToVMG({UDS_SID_TESTER_PRESENT, 0x00});
 }
 
 bool ZonalGatewayLinux::sendZoneVCIToVMG() {
+    return sendZoneReportToVMG(false);
+}
+
+bool ZonalGatewayLinux::sendZoneStatusToVMG() {
+    return sendZoneReportToVMG(true);
+}
+
+bool ZonalGatewayLinux::sendZoneReportToVMG(bool force) {
     if (!vmg_connected_) return false;
     
-    std::lock_guard<std::mutex> lock(zone_vci_mutex_);
+    /* One report in flight: a delta is only valid against a generation the VMG ACKed */
+    auto now = std::chrono::steady_clock::now();
+    if (vmg_pending_generation_ != 0) {
+        if (now - vmg_pending_since_ < std::chrono::milliseconds(ZG_REPORT_ACK_TIMEOUT_MS)) {
+            return true;
+        }
+        std::cerr << "[ZG] Zone VCI report not acknowledged, resending full snapshot" << std::endl;
+        vmg_pending_generation_ = 0;
+        vmg_reported_generation_ = 0;
+    }
     
-    /* Build Zone VCI JSON or binary message */
-    /* TODO: Implement VCI serialization and send */
+    std::vector<uint8_t> uds = {
+        UDS_SID_WRITE_DATA_BY_IDENTIFIER,
+        static_cast<uint8_t>(UDS_DID_ZONE_VCI_REPORT >> 8),
+        static_cast<uint8_t>(UDS_DID_ZONE_VCI_REPORT & 0xFF)
+    };
+    auto vci = getZoneVCI();
     
+    bool full = (vmg_reported_generation_ == 0);
+    if (!full && !force && vci->generation == vmg_reported_generation_) {
+        return true;  // Nothing changed since last report
+    }
+    
+    std::vector<uint8_t> report = ZoneVCICodec::encodeReport(*vci, vmg_reported_generation_);
+    uds.insert(uds.end(), report.begin(), report.end());
+    uint32_t generation = vci->generation;
+    
+    if (!sendDiagnosticToVMG(uds)) {
+        return false;  // Reconnect sends a full snapshot
+    }
+    
+    vmg_pending_generation_ = generation;
+    vmg_pending_since_ = now;
+    vmg_last_status_ = now;
+    std::cout << "[ZG] Zone VCI " << (full ? "snapshot" : "delta") << " sent to VMG ("
+              << uds.size() - 3 << " bytes, generation " << generation << ")" << std::endl;
     return true;
 }
 
 bool ZonalGatewayLinux::updateECUInfo(const std::string& ecu_id, const ZoneECUInfo& info) {
-    std::lock_guard<std::mutex> lock(zone_vci_mutex_);
-    
-    /* Find or add ECU */
-    for (auto& ecu : zone_vci_.ecus) {
-        if (ecu.ecu_id == ecu_id) {
-            ecu = info;
+    return updateZoneVCI([&](ZoneVCIData& vci) {
+        /* Find or add ECU */
+        for (auto& ecu : vci.ecus) {
+            if (ecu.ecu_id == ecu_id) {
+                bool changed = !sameVCI(ecu, info);
+                uint32_t generation = ecu.generation;
+                ecu = info;
+                ecu.generation = generation;
+                if (changed) {
+                    markChanged(vci, ecu);
+                }
+                return true;
+            }
+        }
+        
+        /* Add new ECU */
+        if (vci.ecus.size() < ZG_MAX_ECUS) {
+            vci.ecus.push_back(info);
+            markChanged(vci, vci.ecus.back());
             return true;
         }
-    }
-    
-    /* Add new ECU */
-    if (zone_vci_.ecus.size() < ZG_MAX_ECUS) {
-        zone_vci_.ecus.push_back(info);
+        
+        return false;
+    });
+}
+
+bool ZonalGatewayLinux::updateZoneStatus(uint32_t total_storage_mb, uint32_t available_storage_mb,
+                                         uint8_t battery_level) {
+    updateZoneVCI([&](ZoneVCIData& vci) {
+        if (vci.total_storage_mb == total_storage_mb &&
+            vci.available_storage_mb == available_storage_mb &&
+            vci.average_battery_level == battery_level) {
+            return false;
+        }
+        /* Status is carried in every report header; the bump makes it go out now */
+        vci.total_storage_mb = total_storage_mb;
+        vci.available_storage_mb = available_storage_mb;
+        vci.average_battery_level = battery_level;
+        vci.generation++;
         return true;
-    }
-    
-    return false;
+    });
+    return true;
 }
 
 bool ZonalGatewayLinux::checkOTAReadiness(const std::string& campaign_id) {
-    std::lock_guard<std::mutex> lock(zone_vci_mutex_);
+    /* Snapshot: heartbeats keep publishing while this runs */
+    auto vci = getZoneVCI();
     
-    if (zone_vci_.average_battery_level < 50) return false;
-    if (zone_vci_.available_storage_mb < 100) return false;
+    if (vci->average_battery_level < 50) return false;
+    if (vci->available_storage_mb < 100) return false;
     
     /* Check all ECUs online */
-    for (const auto& ecu : zone_vci_.ecus) {
+    for (const auto& ecu : vci->ecus) {
         if (!ecu.is_online) return false;
     }
     
@@ -315,16 +1288,16 @@ bool ZonalGatewayLinux::reportOTAProgress(uint8_t progress_percentage) {
 }
 
 void ZonalGatewayLinux::printZoneVCI() const {
-    std::lock_guard<std::mutex> lock(zone_vci_mutex_);
+    auto vci = getZoneVCI();
     
     std::cout << "\n┌─────────────────────────────────────────┐" << std::endl;
-    std::cout << "│ Zone " << static_cast<int>(zone_vci_.zone_id) << " VCI Summary" << std::string(25, ' ') << "│" << std::endl;
+    std::cout << "│ Zone " << static_cast<int>(vci->zone_id) << " VCI Summary" << std::string(25, ' ') << "│" << std::endl;
     std::cout << "├─────────────────────────────────────────┤" << std::endl;
-    std::cout << "│ ECU Count: " << zone_vci_.ecus.size() << std::string(29, ' ') << "│" << std::endl;
+    std::cout << "│ ECU Count: " << vci->ecus.size() << std::string(29, ' ') << "│" << std::endl;
     std::cout << "├─────────────────────────────────────────┤" << std::endl;
     
-    for (size_t i = 0; i < zone_vci_.ecus.size(); i++) {
-        const auto& ecu = zone_vci_.ecus[i];
+    for (size_t i = 0; i < vci->ecus.size(); i++) {
+        const auto& ecu = vci->ecus[i];
         std::cout << "│ ECU #" << (i + 1) << ": " << ecu.ecu_id << std::endl;
         std::cout << "│   Address: 0x" << std::hex << std::setfill('0') << std::setw(4) 
                   << ecu.logical_address << std::dec << std::endl;
@@ -0,0 +1,67 @@
+/**
+ * @file diag_relay_socket.h
+ * @brief Socket transport for the Diagnostic Router relay path
+ *
+ * - sendv:  writev() of header + payload, no intermediate copy
+ * - splice: Linux splice(2) through a pipe (payload never enters user
+ *           space); other stacks fall back to a small bounce buffer
+ *
+ * Links may be non-blocking. A frame is never abandoned half-written on
+ * EAGAIN: the transport polls the link (up to DIAG_RELAY_IO_TIMEOUT_MS
+ * per stall) until the frame is complete. A failure after that means
+ * the link is broken and must be closed.
+ */
+
+#ifndef DIAG_RELAY_SOCKET_H
+#define DIAG_RELAY_SOCKET_H
+
+#include "diagnostic_router.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+#define DIAG_RELAY_BOUNCE_SIZE      1460    // One TCP segment (fallback path)
+#define DIAG_RELAY_IO_TIMEOUT_MS    2000    // Max wait for a stalled link mid-frame
+
+// ============================================================================
+// Types
+// ============================================================================
+
+/**
+ * @brief Socket relay context
+ */
+typedef struct {
+    int pipe_fds[2];                        // splice pipe (-1 if unavailable)
+    uint8_t bounce[DIAG_RELAY_BOUNCE_SIZE]; // Fallback when splice is unavailable
+} DiagRelaySocket_t;
+
+// ============================================================================
+// API Functions
+// ============================================================================
+
+/**
+ * @brief Initialize socket relay and fill transport
+ *
+ * @param relay Relay context (must outlive the router)
+ * @param transport Output: transport for diagnostic_router_set_transport()
+ * @return 0 on success, -1 on error
+ */
+int diag_relay_socket_init(DiagRelaySocket_t* relay, DiagRouterTransport_t* transport);
+
+/**
+ * @brief Release relay resources
+ *
+ * @param relay Relay context
+ */
+void diag_relay_socket_close(DiagRelaySocket_t* relay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DIAG_RELAY_SOCKET_H */
@@ -3,12 +3,19 @@
  * @brief Diagnostic Message Router for Zonal Gateway
  * 
  * Routes diagnostic messages between VMG and ECUs
+ * 
+ * Diagnostic messages (DoIP 0x8001) are relayed without decoding:
+ * only the SA/TA fields of the received frame are rewritten in place
+ * and the same buffer is handed to the outgoing link. Payloads larger
+ * than the receive buffer (e.g. TransferData) are streamed from the
+ * incoming socket to the outgoing socket via the transport splice hook.
  */
 
 #ifndef DIAGNOSTIC_ROUTER_H
 #define DIAGNOSTIC_ROUTER_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 
 #ifdef __cplusplus
@@ -19,9 +26,41 @@ extern "C" {
 // Configuration
 // ============================================================================
 
+// Override at build time for central-compute variants (hundreds of ECUs)
+#ifndef DIAG_ROUTER_MAX_ECUS
 #define DIAG_ROUTER_MAX_ECUS        32
-#define DIAG_ROUTER_TIMEOUT_MS      5000
+#endif
+
+// Logical address index: open addressing, 2^bits slots, load factor <= 0.5
+#ifndef DIAG_ROUTER_INDEX_BITS
+#define DIAG_ROUTER_INDEX_BITS      6
+#endif
+#define DIAG_ROUTER_INDEX_SIZE      (1u << DIAG_ROUTER_INDEX_BITS)
+#define DIAG_ROUTER_INDEX_EMPTY     0xFFFF
+
+#if DIAG_ROUTER_MAX_ECUS >= DIAG_ROUTER_INDEX_EMPTY || DIAG_ROUTER_INDEX_BITS > 16
+#error "DIAG_ROUTER_MAX_ECUS must fit the 16-bit address index"
+#endif
+#if DIAG_ROUTER_INDEX_SIZE < 2 * DIAG_ROUTER_MAX_ECUS
+#error "DIAG_ROUTER_INDEX_BITS too small for DIAG_ROUTER_MAX_ECUS"
+#endif
+
+#define DIAG_ROUTER_TIMEOUT_MS      5000    // Request -> first response
+#define DIAG_ROUTER_P2_EXT_TIMEOUT_MS 5000  // After NRC 0x78 (P2*server)
+#define DIAG_ROUTER_TIMEOUT_NRC     0x21    // busyRepeatRequest, sent to the tester on expiry
+
+#ifndef DIAG_ROUTER_MAX_PENDING
 #define DIAG_ROUTER_MAX_PENDING     16
+#endif
+#define DIAG_ROUTER_PENDING_DATA_SIZE 32    // Request prefix kept per slot
+#define DIAG_ROUTER_SLOT_NONE       0xFF
+
+#if DIAG_ROUTER_MAX_PENDING >= DIAG_ROUTER_SLOT_NONE
+#error "DIAG_ROUTER_MAX_PENDING must fit the 8-bit slot links"
+#endif
+
+#define DIAG_ROUTER_LINK_NONE       (-1)    // No socket/link attached
+#define DIAG_ROUTER_DIAG_HEADER_SIZE 12     // DoIP header (8) + SA (2) + TA (2)
 
 // ============================================================================
 // Types
@@ -35,36 +74,100 @@ typedef struct {
     uint16_t logical_address;
     bool is_connected;
     uint32_t last_activity_time_ms;
+    int link;                       // Socket to ECU (DIAG_ROUTER_LINK_NONE if detached)
+    uint16_t tester_address;        // Last VMG-side tester, restored on responses
 } ECURoutingEntry_t;
 
+/**
+ * @brief Relay direction
+ */
+typedef enum {
+    DIAG_ROUTE_TO_ECU = 0,          // VMG -> ECU
+    DIAG_ROUTE_TO_VMG               // ECU -> VMG
+} DiagRouteDirection_t;
+
+/**
+ * @brief Scatter/gather element for transport send
+ */
+typedef struct {
+    const uint8_t* base;
+    size_t len;
+} DiagRouterIOVec_t;
+
+/**
+ * @brief Link transport (platform specific, e.g. lwIP or POSIX sockets)
+ * 
+ * sendv:  Send all iovec elements on link as one contiguous stream.
+ *         Returns 0 on success, -1 on error.
+ * splice: Move len bytes still pending on in_link directly to out_link
+ *         without staging them in router memory. Optional; returns 0 on
+ *         success, -1 on error.
+ */
+typedef struct {
+    int (*sendv)(void* ctx, int link, const DiagRouterIOVec_t* iov, int iovcnt);
+    int (*splice)(void* ctx, int in_link, int out_link, size_t len);
+    void* ctx;
+} DiagRouterTransport_t;
+
 /**
  * @brief Pending diagnostic request
+ * 
+ * Keyed by (tester, target, SID). Slots live on one of two deadline
+ * lists (P2 / P2*); each list has a single timeout so it stays sorted
+ * by deadline and expiry only ever inspects list heads.
  */
 typedef struct {
-    uint16_t source_address;
-    uint16_t target_address;
-    uint8_t* uds_data;
-    size_t uds_len;
-    uint32_t timestamp_ms;
+    uint16_t source_address;        // Tester
+    uint16_t target_address;        // ECU
+    uint8_t sid;
+    uint8_t uds_data[DIAG_ROUTER_PENDING_DATA_SIZE];  // Request prefix (no allocation)
+    size_t uds_len;                 // Bytes kept in uds_data
+    uint32_t timestamp_ms;          // Request forwarded
+    uint32_t deadline_ms;
+    uint8_t response_pending_count; // NRC 0x78 received so far
     bool is_active;
+    
+    // Deadline list links (slot indices, DIAG_ROUTER_SLOT_NONE terminates)
+    uint8_t timer_list;
+    uint8_t prev;
+    uint8_t next;
 } PendingDiagRequest_t;
 
 /**
  * @brief Diagnostic Router
  */
 typedef struct {
-    // ECU routing table
+    // ECU routing table (dense: removal moves the last entry into the gap)
     ECURoutingEntry_t ecus[DIAG_ROUTER_MAX_ECUS];
     uint32_t ecu_count;
     
+    // Logical address -> ecus[] position (DIAG_ROUTER_INDEX_EMPTY if free)
+    uint16_t index[DIAG_ROUTER_INDEX_SIZE];
+    
     // Pending requests
     PendingDiagRequest_t pending[DIAG_ROUTER_MAX_PENDING];
+    uint8_t pending_free;           // Free slot list (linked through next)
+    uint8_t timer_head[2];          // [0] P2 list, [1] P2* list (oldest first)
+    uint8_t timer_tail[2];
+    uint32_t pending_count;
+    
+    // Links
+    DiagRouterTransport_t transport;
+    int vmg_link;
+    uint16_t gateway_address;       // Tester address the ECUs see (ZG logical address)
     
     // Statistics
     uint32_t total_requests;
     uint32_t routed_to_ecu;
     uint32_t routed_to_vmg;
     uint32_t routing_errors;
+    uint64_t relayed_bytes;
+    uint64_t spliced_bytes;
+    uint32_t request_timeouts;
+    uint32_t response_pending;      // NRC 0x78 extensions
+    uint32_t unmatched_responses;   // Responses without pending request
+    uint32_t untracked_requests;    // Forwarded while all pending slots were busy
+    uint32_t timeout_nrcs_sent;
     
 } DiagnosticRouter_t;
 
@@ -86,7 +189,7 @@ int diagnostic_router_init(DiagnosticRouter_t* router);
  * @param router Router context
  * @param ecu_id ECU identifier
  * @param logical_address DoIP logical address
- * @return 0 on success, -1 on error
+ * @return 0 on success (existing address is updated), -1 on error
  */
 int diagnostic_router_register_ecu(
     DiagnosticRouter_t* router,
@@ -94,6 +197,92 @@ int diagnostic_router_register_ecu(
     uint16_t logical_address
 );
 
+/**
+ * @brief Unregister ECU
+ * 
+ * The last routing entry is moved into the freed position, so entry
+ * pointers obtained earlier must not be kept across this call.
+ * 
+ * @param router Router context
+ * @param logical_address DoIP logical address
+ * @return 0 on success, -1 if not registered
+ */
+int diagnostic_router_unregister_ecu(
+    DiagnosticRouter_t* router,
+    uint16_t logical_address
+);
+
+/**
+ * @brief Attach link transport
+ * 
+ * @param router Router context
+ * @param transport Link transport (copied)
+ * @param gateway_address ZG logical address used as tester address towards ECUs
+ * @param vmg_link Link to VMG
+ * @return 0 on success, -1 on error
+ */
+int diagnostic_router_set_transport(
+    DiagnosticRouter_t* router,
+    const DiagRouterTransport_t* transport,
+    uint16_t gateway_address,
+    int vmg_link
+);
+
+/**
+ * @brief Attach (or detach with DIAG_ROUTER_LINK_NONE) ECU link
+ * 
+ * @param router Router context
+ * @param logical_address ECU logical address
+ * @param link Socket to ECU
+ * @return 0 on success, -1 if ECU is not registered
+ */
+int diagnostic_router_attach_ecu_link(
+    DiagnosticRouter_t* router,
+    uint16_t logical_address,
+    int link
+);
+
+/**
+ * @brief Relay complete DoIP diagnostic message frame
+ * 
+ * Rewrites SA (to ECU) or TA (to VMG) in place and forwards the
+ * frame buffer unchanged otherwise.
+ * 
+ * @param router Router context
+ * @param direction Relay direction
+ * @param frame DoIP frame (header + payload), modified in place
+ * @param frame_len Frame length
+ * @return 0 on success, -1 on error
+ */
+int diagnostic_router_relay_frame(
+    DiagnosticRouter_t* router,
+    DiagRouteDirection_t direction,
+    uint8_t* frame,
+    size_t frame_len
+);
+
+/**
+ * @brief Relay DoIP diagnostic message whose payload is still in the socket
+ * 
+ * Used for frames larger than the receive buffer (TransferData). The
+ * head (at least DIAG_ROUTER_DIAG_HEADER_SIZE bytes) is rewritten and
+ * sent, the remaining payload is spliced from in_link to the target link.
+ * 
+ * @param router Router context
+ * @param direction Relay direction
+ * @param in_link Socket the frame is being received from
+ * @param head Received part of the frame, modified in place
+ * @param head_len Length of received part
+ * @return 0 on success, -1 on error
+ */
+int diagnostic_router_relay_stream(
+    DiagnosticRouter_t* router,
+    DiagRouteDirection_t direction,
+    int in_link,
+    uint8_t* head,
+    size_t head_len
+);
+
 /**
  * @brief Route diagnostic message from VMG to ECU
  * 
@@ -115,6 +304,10 @@ int diagnostic_router_route_to_ecu(
 /**
  * @brief Route diagnostic response from ECU to VMG
  * 
+ * The response is matched to the oldest pending request for the same
+ * ECU and SID; its tester becomes the target address. NRC 0x78 keeps
+ * the request pending with the P2* deadline.
+ * 
  * @param router Router context
  * @param source_address Source logical address (ECU)
  * @param target_address Target logical address (VMG/Tester)
@@ -147,7 +340,7 @@ int diagnostic_router_broadcast(
 );
 
 /**
- * @brief Find ECU by logical address
+ * @brief Find ECU by logical address (O(1) expected)
  * 
  * @param router Router context
  * @param logical_address DoIP logical address
@@ -172,6 +365,10 @@ void diagnostic_router_update_activity(
 /**
  * @brief Check for timed out requests
  * 
+ * Only expired slots are visited (deadline lists are sorted). The tester
+ * of each expired request gets NRC DIAG_ROUTER_TIMEOUT_NRC on behalf of
+ * the ECU.
+ * 
  * @param router Router context
  */
 void diagnostic_router_check_timeouts(DiagnosticRouter_t* router);
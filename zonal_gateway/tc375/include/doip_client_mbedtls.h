@@ -59,6 +59,16 @@ int doip_client_mbedtls_receive(mbedtls_doip_client* client,
                                  unsigned char* buffer,
                                  size_t buffer_size);
 
+/**
+ * @brief Wait until data from VMG can be read
+ * 
+ * @param client Client context
+ * @param timeout_ms Maximum wait in milliseconds (0 = poll)
+ * @return 1 if readable, 0 on timeout, or -1 on error
+ */
+int doip_client_mbedtls_wait_readable(mbedtls_doip_client* client,
+                                       uint32_t timeout_ms);
+
 /**
  * @brief Close connection and free resources
  * 
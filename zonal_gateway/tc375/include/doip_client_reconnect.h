@@ -2,14 +2,21 @@
  * @file doip_client_reconnect.h
  * @brief DoIP Client with Auto-Reconnection for TC375
  * 
- * Provides automatic reconnection with exponential backoff
- * for reliable in-vehicle network communication.
+ * Provides automatic reconnection for reliable in-vehicle network
+ * communication:
+ * - Decorrelated jitter backoff, so gateways that lost the same VMG do
+ *   not retry in lock-step
+ * - Token bucket limiting connection attempts (TLS handshakes)
+ * - Optional standby connection, TLS-established in the background and
+ *   promoted on failure without waiting for a handshake
+ * - Time-to-reconnect percentiles
  */
 
 #ifndef DOIP_CLIENT_RECONNECT_H
 #define DOIP_CLIENT_RECONNECT_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 
 #ifdef __cplusplus
@@ -24,9 +31,16 @@ extern "C" {
 #define DOIP_MAX_RECONNECT_ATTEMPTS   0      // 0 = infinite retries
 #define DOIP_INITIAL_BACKOFF_MS       1000   // 1 second
 #define DOIP_MAX_BACKOFF_MS           30000  // 30 seconds max
-#define DOIP_KEEPALIVE_INTERVAL_MS    30000  // 30 seconds
+#define DOIP_KEEPALIVE_INTERVAL_MS    30000  // Idle time before a keepalive is sent
 #define DOIP_KEEPALIVE_TIMEOUT_MS     5000   // 5 seconds
 
+#define DOIP_RECONNECT_BUCKET_SIZE        4      // Attempts allowed in a burst
+#define DOIP_RECONNECT_BUCKET_REFILL_MS   10000  // One attempt token per 10 s
+#define DOIP_STANDBY_RETRY_MS             30000  // Standby re-establish interval
+#define DOIP_RECONNECT_HISTORY_SIZE       32     // Time-to-reconnect samples kept
+#define DOIP_KEEPALIVE_TARGET_ADDRESS     0x0100 // VMG; TesterPresent 0x3E 0x80 goes here
+#define DOIP_RECONNECT_DEFAULT_SOURCE     0x0200 // Routing activation SA
+
 // ============================================================================
 // Types
 // ============================================================================
@@ -58,21 +72,65 @@ typedef struct {
     char key_file[128];
     char ca_file[128];
     
+    // Routing activation
+    uint16_t source_address;
+    
     // Reconnection tracking
     uint32_t reconnect_count;
-    uint32_t backoff_ms;
+    uint32_t backoff_ms;                // Current (jittered) delay
     uint32_t last_attempt_time_ms;
-    uint32_t last_keepalive_time_ms;
+    uint32_t last_keepalive_time_ms;    // Start of the current keepalive interval
+    uint32_t last_activity_time_ms;     // Last frame sent or received; keepalive only when idle
+    uint32_t jitter_state;              // xorshift32, seeded per gateway
+    
+    // Attempt token bucket
+    uint32_t tokens;
+    uint32_t last_refill_time_ms;
+    
+    // Standby connection
+    bool standby_enabled;
+    uint32_t standby_next_attempt_ms;
     
     // Statistics
     uint32_t total_reconnects;
     uint32_t total_keepalive_failures;
+    uint32_t keepalives_sent;
+    uint32_t keepalives_suppressed;     // Intervals covered by application traffic
+    uint32_t diag_acks_received;        // 0x8002 replies consumed by recv
+    uint32_t diag_nacks_received;       // 0x8003 replies consumed by recv
+    uint32_t total_failovers;           // Losses covered by the standby
+    uint32_t throttled_attempts;        // Attempts deferred by the bucket
+    uint32_t lost_time_ms;              // When the current outage began
+    bool outage_active;
+    uint32_t reconnect_samples[DOIP_RECONNECT_HISTORY_SIZE];  // ms, ring
+    uint32_t reconnect_sample_count;
     
     // Internal (platform-specific)
     void* client_ctx;  // mbedtls_doip_client* or similar
+    void* standby_ctx; // TLS established, not yet routing-activated
     
 } DoIPClientReconnect_t;
 
+/**
+ * @brief Reconnection statistics
+ */
+typedef struct {
+    uint32_t total_reconnects;          // Failed attempts
+    uint32_t total_failovers;           // Outages served by the standby
+    uint32_t throttled_attempts;
+    uint32_t keepalives_sent;
+    uint32_t keepalives_suppressed;
+    uint32_t diag_acks_received;
+    uint32_t diag_nacks_received;
+    uint32_t current_backoff_ms;
+    uint32_t samples;                   // Outages measured (up to HISTORY_SIZE kept)
+    uint32_t p50_ms;                    // Time from loss to routing active
+    uint32_t p90_ms;
+    uint32_t p99_ms;
+    uint32_t max_ms;
+    bool standby_ready;
+} DoIPReconnectStats_t;
+
 /**
  * @brief Connection event callback
  */
@@ -106,6 +164,30 @@ int doip_client_reconnect_init(
     const char* ca_file
 );
 
+/**
+ * @brief Set routing activation source address
+ *
+ * Also reseeds the backoff jitter, so gateways sharing a VMG diverge.
+ *
+ * @param client Client context
+ * @param source_address Logical address (e.g. 0x0201 for Zone 1)
+ */
+void doip_client_reconnect_set_source_address(DoIPClientReconnect_t* client,
+                                              uint16_t source_address);
+
+/**
+ * @brief Enable/disable the standby connection
+ *
+ * The standby completes TCP+TLS in the background while the primary is
+ * up. On loss it is routing-activated and promoted in one round trip.
+ * Activation is deferred because a DoIP entity rejects a second socket
+ * for a source address that is still active (ISO 13400 0x03).
+ *
+ * @param client Client context
+ * @param enable true to keep a standby connection
+ */
+void doip_client_reconnect_enable_standby(DoIPClientReconnect_t* client, bool enable);
+
 /**
  * @brief Start connection (non-blocking)
  * 
@@ -151,12 +233,17 @@ int doip_client_reconnect_send(
 );
 
 /**
- * @brief Receive data (non-blocking)
+ * @brief Receive data (waits at most timeout_ms)
+ * 
+ * A read error or peer close drops the connection into the
+ * failover/backoff path, like a failed send. Any received frame counts
+ * as link activity (defers the keepalive). Diagnostic ACK/NACK frames
+ * answering our own sends are consumed and counted, not returned.
  * 
  * @param client Client context
  * @param buf Buffer to receive data
  * @param cap Buffer capacity
- * @param timeout_ms Timeout in milliseconds
+ * @param timeout_ms Timeout in milliseconds (0 = poll)
  * @return Number of bytes received, 0 on timeout, -1 on error
  */
 int doip_client_reconnect_recv(
@@ -178,13 +265,11 @@ int doip_client_reconnect_reset(DoIPClientReconnect_t* client);
  * @brief Get connection statistics
  * 
  * @param client Client context
- * @param total_reconnects Output: total reconnection count
- * @param current_backoff_ms Output: current backoff time
+ * @param stats Output: counters and time-to-reconnect percentiles
  */
 void doip_client_reconnect_get_stats(
     const DoIPClientReconnect_t* client,
-    uint32_t* total_reconnects,
-    uint32_t* current_backoff_ms
+    DoIPReconnectStats_t* stats
 );
 
 /**
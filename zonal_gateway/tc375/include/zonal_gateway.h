@@ -13,6 +13,8 @@
 #include "doip_client.h"
 #include "doip_message.h"
 #include "uds_handler.h"
+#include "diagnostic_router.h"
+#include "diag_relay_socket.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -26,6 +28,12 @@ extern "C" {
 #define ZG_DOIP_SERVER_PORT     13400   /* Zone 내부 DoIP 포트 */
 #define ZG_JSON_SERVER_PORT     8765    /* Zone 내부 JSON 포트 */
 
+/* VMG uplink 주기 (ms) */
+#define ZG_HEARTBEAT_INTERVAL_MS    10000   /* 이 시간 동안 프레임이 없을 때만 Tester Present */
+#define ZG_STATUS_INTERVAL_MS       30000   /* Zone 상태 보고 주기 */
+#define ZG_UPLINK_COALESCE_MS       5000    /* 이 안에 도래할 보고는 함께 전송 */
+#define ZG_UPLINK_RESPONSE_TIMEOUT_MS 5000  /* Uplink 요청 응답이 없으면 VMG 연결 끊김으로 처리 */
+
 /**
  * @brief Zone 내 ECU 정보
  */
@@ -56,6 +64,8 @@ typedef struct {
     uint32_t available_storage_mb;
     uint8_t average_battery_level;
     
+    uint32_t generation;            /* 변경 시 증가 (1부터) */
+    
 } ZoneVCIData_t;
 
 /**
@@ -93,10 +103,30 @@ typedef struct {
     /* UDS Handler (ECU 요청 처리용) */
     UDSHandler_t uds_handler;
     
+    /* 진단 중계 (VMG <-> ECU, 0x8001 프레임을 재인코딩 없이 전달) */
+    DiagnosticRouter_t diag_router;
+    DiagRelaySocket_t diag_relay;
+    DiagRouterTransport_t diag_transport;
+    
     /* ========== Client 역할 (VMG 연결) ========== */
     DoIPClient_t vmg_client;        /* VMG 클라이언트 */
     bool vmg_connected;
     
+    /* Uplink 스케줄 (zg_run) */
+    uint32_t vmg_reported_generation;   /* VMG가 수신 확인한 마지막 generation, 0 = 전체 */
+    uint32_t vmg_last_activity_ms;      /* VMG와 마지막 프레임 교환 시각 */
+    uint32_t vmg_last_status_ms;        /* 마지막 Zone 보고 시각 */
+    uint32_t vmg_heartbeat_slot_ms;     /* 고정 주기 heartbeat 기준 시각 (통계용) */
+    uint8_t vmg_pending_sid;            /* 응답 대기 중인 uplink 요청 SID, 0 = 없음 */
+    uint32_t vmg_pending_generation;    /* 대기 중인 보고가 담은 generation */
+    uint32_t vmg_pending_since_ms;
+    
+    /* Uplink 통계 */
+    uint32_t uplink_frames;             /* VMG로 보낸 요청 프레임 */
+    uint32_t heartbeats_sent;
+    uint32_t heartbeats_suppressed;     /* 다른 트래픽으로 대체된 heartbeat */
+    uint32_t reports_coalesced;         /* 주기보다 앞당겨 함께 보낸 상태 보고 */
+    
     /* Buffers */
     uint8_t server_rx_buffer[4096];
     uint8_t server_tx_buffer[4096];
@@ -141,12 +171,28 @@ void zg_run(ZonalGateway_t* zg);
 /**
  * @brief Handle DoIP message from Zone ECU
  * 
+ * Reads one frame. Diagnostic messages (0x8001) are relayed to the VMG
+ * through the diagnostic router (the ECU's link is attached on its first
+ * frame); other payload types are read and dropped.
+ * 
  * @param zg Zonal Gateway context
  * @param client_socket ECU socket
- * @return 0 on success, -1 on error
+ * @return 0 on success, -1 on error (socket should be closed)
  */
 int zg_handle_ecu_doip_message(ZonalGateway_t* zg, int client_socket);
 
+/**
+ * @brief Handle DoIP message from VMG (call when the VMG socket is readable)
+ * 
+ * Diagnostic messages addressed to a Zone ECU are relayed to its link.
+ * ACKs and responses to the ZG's own uplink requests (zone report,
+ * Tester Present) are consumed here; the senders never read the socket.
+ * 
+ * @param zg Zonal Gateway context
+ * @return 0 on success, -1 on error (VMG connection is dropped)
+ */
+int zg_handle_vmg_doip_message(ZonalGateway_t* zg);
+
 /**
  * @brief Handle JSON message from Zone ECU
  * 
@@ -182,6 +228,17 @@ int zg_connect_to_vmg(ZonalGateway_t* zg);
  */
 int zg_send_zone_vci_to_vmg(ZonalGateway_t* zg);
 
+/**
+ * @brief Send Zone report (status + VCI) to VMG in one frame
+ *
+ * UDS 0x2E F1A1, zone_vci_codec.hpp와 같은 형식.
+ * 처음/재연결 후에는 전체 스냅샷, 변경이 없으면 헤더(상태)만 보낸다.
+ *
+ * @param zg Zonal Gateway context
+ * @return 0 on success, -1 on error
+ */
+int zg_send_zone_report_to_vmg(ZonalGateway_t* zg);
+
 /**
  * @brief Send heartbeat to VMG
  * 
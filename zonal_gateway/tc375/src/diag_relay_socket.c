@@ -0,0 +1,198 @@
+/**
+ * @file diag_relay_socket.c
+ * @brief Socket transport for the Diagnostic Router relay path
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     // splice()
+#endif
+
+#include "diag_relay_socket.h"
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#define DIAG_RELAY_MAX_IOV      4
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+// Links may be non-blocking (epoll loop). Once part of a frame is on the
+// wire the rest must follow, so wait for the link instead of giving up.
+static int relay_wait(int link, short events) {
+    struct pollfd pfd = { link, events, 0 };
+
+    while (1) {
+        int n = poll(&pfd, 1, DIAG_RELAY_IO_TIMEOUT_MS);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0 || (pfd.revents & (POLLERR | POLLNVAL))) {
+            return -1;      // Error, or peer stalled for the whole timeout
+        }
+        return 0;
+    }
+}
+
+static bool relay_retry(int link, short events) {
+    if (errno == EINTR) {
+        return true;
+    }
+    return (errno == EAGAIN || errno == EWOULDBLOCK) && relay_wait(link, events) == 0;
+}
+
+#if defined(__linux__)
+// A failed splice can leave bytes in the pipe; they must not leak into
+// the next frame
+static void relay_reset_pipe(DiagRelaySocket_t* relay) {
+    close(relay->pipe_fds[0]);
+    close(relay->pipe_fds[1]);
+    if (pipe2(relay->pipe_fds, O_CLOEXEC) != 0) {
+        relay->pipe_fds[0] = -1;
+        relay->pipe_fds[1] = -1;
+    }
+}
+#endif
+
+// ============================================================================
+// Transport Callbacks
+// ============================================================================
+
+static int relay_sendv(void* ctx, int link, const DiagRouterIOVec_t* iov, int iovcnt) {
+    (void)ctx;
+
+    if (iovcnt <= 0 || iovcnt > DIAG_RELAY_MAX_IOV) {
+        return -1;
+    }
+
+    struct iovec vec[DIAG_RELAY_MAX_IOV];
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        vec[i].iov_base = (void*)iov[i].base;
+        vec[i].iov_len = iov[i].len;
+        total += iov[i].len;
+    }
+
+    // Single writev; only loop when the stack accepted part of it
+    int first = 0;
+    while (total > 0) {
+        ssize_t n = writev(link, &vec[first], iovcnt - first);
+        if (n < 0) {
+            if (relay_retry(link, POLLOUT)) continue;
+            return -1;
+        }
+        if (n == 0) {
+            return -1;
+        }
+
+        total -= (size_t)n;
+        while (first < iovcnt && (size_t)n >= vec[first].iov_len) {
+            n -= (ssize_t)vec[first].iov_len;
+            first++;
+        }
+        if (first < iovcnt) {
+            vec[first].iov_base = (uint8_t*)vec[first].iov_base + n;
+            vec[first].iov_len -= (size_t)n;
+        }
+    }
+
+    return 0;
+}
+
+static int relay_copy(DiagRelaySocket_t* relay, int in_link, int out_link, size_t len) {
+    while (len > 0) {
+        size_t chunk = len < sizeof(relay->bounce) ? len : sizeof(relay->bounce);
+        ssize_t n = recv(in_link, relay->bounce, chunk, 0);
+        if (n < 0 && relay_retry(in_link, POLLIN)) continue;
+        if (n <= 0) {
+            return -1;
+        }
+
+        DiagRouterIOVec_t iov = { relay->bounce, (size_t)n };
+        if (relay_sendv(relay, out_link, &iov, 1) != 0) {
+            return -1;
+        }
+        len -= (size_t)n;
+    }
+
+    return 0;
+}
+
+static int relay_splice(void* ctx, int in_link, int out_link, size_t len) {
+    DiagRelaySocket_t* relay = (DiagRelaySocket_t*)ctx;
+
+#if defined(__linux__)
+    if (relay->pipe_fds[0] >= 0) {
+        while (len > 0) {
+            // socket -> pipe -> socket, pages are moved, not copied
+            ssize_t in = splice(in_link, NULL, relay->pipe_fds[1], NULL, len,
+                                SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (in < 0 && relay_retry(in_link, POLLIN)) continue;
+            if (in <= 0) {
+                return -1;      // Peer closed or failed mid-frame
+            }
+
+            ssize_t pending = in;
+            while (pending > 0) {
+                ssize_t out = splice(relay->pipe_fds[0], NULL, out_link, NULL, (size_t)pending,
+                                     SPLICE_F_MOVE | SPLICE_F_MORE);
+                if (out < 0 && relay_retry(out_link, POLLOUT)) continue;
+                if (out <= 0) {
+                    relay_reset_pipe(relay);
+                    return -1;
+                }
+                pending -= out;
+            }
+            len -= (size_t)in;
+        }
+        return 0;
+    }
+#endif
+
+    return relay_copy(relay, in_link, out_link, len);
+}
+
+// ============================================================================
+// API Implementation
+// ============================================================================
+
+int diag_relay_socket_init(DiagRelaySocket_t* relay, DiagRouterTransport_t* transport) {
+    if (!relay || !transport) {
+        return -1;
+    }
+
+    relay->pipe_fds[0] = -1;
+    relay->pipe_fds[1] = -1;
+
+#if defined(__linux__)
+    if (pipe2(relay->pipe_fds, O_CLOEXEC) != 0) {
+        // Fallback path still works, just with one copy
+        relay->pipe_fds[0] = -1;
+        relay->pipe_fds[1] = -1;
+    }
+#endif
+
+    memset(transport, 0, sizeof(*transport));
+    transport->sendv = relay_sendv;
+    transport->splice = relay_splice;
+    transport->ctx = relay;
+
+    return 0;
+}
+
+void diag_relay_socket_close(DiagRelaySocket_t* relay) {
+    if (!relay) {
+        return;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (relay->pipe_fds[i] >= 0) {
+            close(relay->pipe_fds[i]);
+            relay->pipe_fds[i] = -1;
+        }
+    }
+}
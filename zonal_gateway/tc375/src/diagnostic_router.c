@@ -3,17 +3,38 @@
  * @brief Diagnostic Message Router Implementation
  */
 
+#if defined(__unix__) && !defined(USE_FREERTOS) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L     // clock_gettime()
+#endif
+
 #include "diagnostic_router.h"
+#include "doip_protocol.h"
 #include <string.h>
 #include <stdio.h>
 
+#ifdef USE_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#elif defined(__unix__)
+#include <time.h>
+#endif
+
 // ============================================================================
 // Helper Functions
 // ============================================================================
 
 static uint32_t get_current_time_ms(void) {
-    // TODO: Implement with FreeRTOS xTaskGetTickCount()
+#ifdef USE_FREERTOS
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+#elif defined(__unix__)
+    // Host builds (benchmarks, Linux harness)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000u);
+#else
+    // TODO: Implement for bare metal (STM tick)
     return 0;
+#endif
 }
 
 static void debug_print(const char* format, ...) {
@@ -21,6 +42,413 @@ static void debug_print(const char* format, ...) {
     (void)format;
 }
 
+static uint16_t read_be16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void write_be16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)(value >> 8);
+    p[1] = (uint8_t)(value & 0xFF);
+}
+
+static uint32_t read_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+// ============================================================================
+// Logical Address Index
+// ============================================================================
+
+#define INDEX_MASK (DIAG_ROUTER_INDEX_SIZE - 1u)
+
+static uint32_t index_home(uint16_t logical_address) {
+    // Fibonacci hashing: spreads sequential addresses (0x0101, 0x0102...)
+    return ((uint32_t)(uint16_t)(logical_address * 40503u)) >> (16 - DIAG_ROUTER_INDEX_BITS);
+}
+
+/**
+ * Slot holding logical_address, or -1. Terminates because the table is
+ * never more than half full.
+ */
+static int32_t index_find_slot(const DiagnosticRouter_t* router, uint16_t logical_address) {
+    uint32_t slot = index_home(logical_address);
+    
+    while (router->index[slot] != DIAG_ROUTER_INDEX_EMPTY) {
+        if (router->ecus[router->index[slot]].logical_address == logical_address) {
+            return (int32_t)slot;
+        }
+        slot = (slot + 1) & INDEX_MASK;
+    }
+    
+    return -1;
+}
+
+static void index_insert(DiagnosticRouter_t* router, uint16_t logical_address, uint16_t position) {
+    uint32_t slot = index_home(logical_address);
+    
+    while (router->index[slot] != DIAG_ROUTER_INDEX_EMPTY) {
+        slot = (slot + 1) & INDEX_MASK;
+    }
+    router->index[slot] = position;
+}
+
+/**
+ * Backward-shift deletion: later entries of the probe run move up into
+ * the hole, so no tombstones accumulate under register/unregister churn.
+ */
+static void index_remove_slot(DiagnosticRouter_t* router, uint32_t slot) {
+    uint32_t hole = slot;
+    uint32_t next = (hole + 1) & INDEX_MASK;
+    
+    while (router->index[next] != DIAG_ROUTER_INDEX_EMPTY) {
+        uint32_t home = index_home(router->ecus[router->index[next]].logical_address);
+        
+        // Entry may fill the hole only if that does not move it before its home slot
+        if (((next - home) & INDEX_MASK) >= ((next - hole) & INDEX_MASK)) {
+            router->index[hole] = router->index[next];
+            hole = next;
+        }
+        next = (next + 1) & INDEX_MASK;
+    }
+    
+    router->index[hole] = DIAG_ROUTER_INDEX_EMPTY;
+}
+
+static ECURoutingEntry_t* find_entry(DiagnosticRouter_t* router, uint16_t logical_address) {
+    int32_t slot = index_find_slot(router, logical_address);
+    return (slot < 0) ? NULL : &router->ecus[router->index[slot]];
+}
+
+// ============================================================================
+// Request/Response Correlation
+// ============================================================================
+
+#define TIMER_P2        0
+#define TIMER_P2_EXT    1
+#define UDS_NEGATIVE_RESPONSE       0x7F
+#define UDS_NRC_RESPONSE_PENDING    0x78
+#define UDS_SUPPRESS_POS_RSP        0x80
+
+static bool time_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+static void pending_init(DiagnosticRouter_t* router) {
+    for (uint8_t i = 0; i < DIAG_ROUTER_MAX_PENDING; i++) {
+        router->pending[i].is_active = false;
+        router->pending[i].next = (uint8_t)(i + 1 < DIAG_ROUTER_MAX_PENDING ? i + 1
+                                                                           : DIAG_ROUTER_SLOT_NONE);
+    }
+    router->pending_free = 0;
+    router->pending_count = 0;
+    for (int l = 0; l < 2; l++) {
+        router->timer_head[l] = DIAG_ROUTER_SLOT_NONE;
+        router->timer_tail[l] = DIAG_ROUTER_SLOT_NONE;
+    }
+}
+
+/**
+ * Append to a deadline list. Every slot on a list has the same timeout
+ * and "now" is monotonic, so appending keeps the list sorted.
+ */
+static void timer_append(DiagnosticRouter_t* router, uint8_t list, uint8_t slot) {
+    PendingDiagRequest_t* req = &router->pending[slot];
+    
+    req->timer_list = list;
+    req->prev = router->timer_tail[list];
+    req->next = DIAG_ROUTER_SLOT_NONE;
+    
+    if (req->prev != DIAG_ROUTER_SLOT_NONE) {
+        router->pending[req->prev].next = slot;
+    } else {
+        router->timer_head[list] = slot;
+    }
+    router->timer_tail[list] = slot;
+}
+
+static void timer_unlink(DiagnosticRouter_t* router, uint8_t slot) {
+    PendingDiagRequest_t* req = &router->pending[slot];
+    uint8_t list = req->timer_list;
+    
+    if (req->prev != DIAG_ROUTER_SLOT_NONE) {
+        router->pending[req->prev].next = req->next;
+    } else {
+        router->timer_head[list] = req->next;
+    }
+    if (req->next != DIAG_ROUTER_SLOT_NONE) {
+        router->pending[req->next].prev = req->prev;
+    } else {
+        router->timer_tail[list] = req->prev;
+    }
+}
+
+static void pending_release(DiagnosticRouter_t* router, uint8_t slot) {
+    timer_unlink(router, slot);
+    router->pending[slot].is_active = false;
+    router->pending[slot].next = router->pending_free;
+    router->pending_free = slot;
+    router->pending_count--;
+}
+
+/**
+ * Requests with suppressPosRspMsgIndicationBit set get no positive
+ * response, so they are not tracked.
+ */
+static bool uds_expects_response(const uint8_t* uds_data, size_t uds_len) {
+    if (uds_len >= 2 && (uds_data[1] & UDS_SUPPRESS_POS_RSP)) {
+        switch (uds_data[0]) {
+            case 0x10: case 0x11: case 0x19: case 0x27: case 0x28: case 0x29:
+            case 0x2C: case 0x31: case 0x3E: case 0x85: case 0x87:
+                return false;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+/**
+ * Track forwarded request
+ * 
+ * A full table does not block the request: it is forwarded untracked and
+ * its response goes back to the ECU's last tester, as for unsolicited
+ * responses.
+ * 
+ * @return slot, or DIAG_ROUTER_SLOT_NONE if untracked
+ */
+static int pending_open(DiagnosticRouter_t* router, uint16_t tester, uint16_t target,
+                        const uint8_t* uds_data, size_t uds_len) {
+    if (uds_len == 0 || !uds_expects_response(uds_data, uds_len)) {
+        return DIAG_ROUTER_SLOT_NONE;
+    }
+    if (router->pending_free == DIAG_ROUTER_SLOT_NONE) {
+        debug_print("[DiagRouter] No free pending slot, untracked: 0x%04X -> 0x%04X\n",
+                    tester, target);
+        router->untracked_requests++;
+        return DIAG_ROUTER_SLOT_NONE;
+    }
+    
+    uint8_t slot = router->pending_free;
+    PendingDiagRequest_t* req = &router->pending[slot];
+    router->pending_free = req->next;
+    router->pending_count++;
+    
+    uint32_t now = get_current_time_ms();
+    req->source_address = tester;
+    req->target_address = target;
+    req->sid = uds_data[0];
+    req->uds_len = uds_len < sizeof(req->uds_data) ? uds_len : sizeof(req->uds_data);
+    memcpy(req->uds_data, uds_data, req->uds_len);
+    req->timestamp_ms = now;
+    req->deadline_ms = now + DIAG_ROUTER_TIMEOUT_MS;
+    req->response_pending_count = 0;
+    req->is_active = true;
+    timer_append(router, TIMER_P2, slot);
+    
+    return slot;
+}
+
+static void pending_abort(DiagnosticRouter_t* router, int slot) {
+    if (slot != DIAG_ROUTER_SLOT_NONE) {
+        pending_release(router, (uint8_t)slot);
+    }
+}
+
+/**
+ * Find the oldest pending request for (ECU, SID) an ECU response answers.
+ * The slot is left untouched; pending_complete() settles it once the
+ * response has been forwarded.
+ * 
+ * @param tester Output: originating tester
+ * @return slot, or DIAG_ROUTER_SLOT_NONE if unmatched
+ */
+static int pending_match(DiagnosticRouter_t* router, uint16_t ecu_address,
+                         const uint8_t* uds_data, size_t uds_len, uint16_t* tester) {
+    if (uds_len == 0) {
+        return DIAG_ROUTER_SLOT_NONE;
+    }
+    
+    bool negative = (uds_data[0] == UDS_NEGATIVE_RESPONSE);
+    if (negative && uds_len < 3) {
+        return DIAG_ROUTER_SLOT_NONE;
+    }
+    uint8_t sid = negative ? uds_data[1] : (uint8_t)(uds_data[0] - 0x40);
+    
+    int best = -1;
+    for (uint8_t i = 0; i < DIAG_ROUTER_MAX_PENDING; i++) {
+        const PendingDiagRequest_t* req = &router->pending[i];
+        if (req->is_active && req->target_address == ecu_address && req->sid == sid &&
+            (best < 0 || time_before(req->timestamp_ms, router->pending[best].timestamp_ms))) {
+            best = i;
+        }
+    }
+    if (best < 0) {
+        return DIAG_ROUTER_SLOT_NONE;
+    }
+    
+    *tester = router->pending[best].source_address;
+    return best;
+}
+
+/**
+ * Settle a matched request after its response reached the tester: NRC
+ * 0x78 keeps it pending under P2*, anything else completes it. If the
+ * forward failed the slot stays as it was and times out normally.
+ */
+static void pending_complete(DiagnosticRouter_t* router, int slot, const uint8_t* uds_data) {
+    if (slot == DIAG_ROUTER_SLOT_NONE) {
+        return;
+    }
+    
+    PendingDiagRequest_t* req = &router->pending[slot];
+    if (uds_data[0] == UDS_NEGATIVE_RESPONSE && uds_data[2] == UDS_NRC_RESPONSE_PENDING) {
+        // ECU needs more time: keep pending under P2*
+        timer_unlink(router, (uint8_t)slot);
+        req->deadline_ms = get_current_time_ms() + DIAG_ROUTER_P2_EXT_TIMEOUT_MS;
+        req->response_pending_count++;
+        timer_append(router, TIMER_P2_EXT, (uint8_t)slot);
+        router->response_pending++;
+    } else {
+        pending_release(router, (uint8_t)slot);
+    }
+}
+
+/**
+ * Build DoIP + diagnostic message header for a UDS payload supplied separately
+ */
+static void build_diag_header(uint8_t* out, uint16_t source_address,
+                              uint16_t target_address, size_t uds_len) {
+    uint32_t payload_len = (uint32_t)(uds_len + 4);
+    
+    out[0] = DOIP_PROTOCOL_VERSION;
+    out[1] = DOIP_INVERSE_PROTOCOL_VERSION;
+    write_be16(&out[2], DOIP_DIAGNOSTIC_MESSAGE);
+    out[4] = (uint8_t)(payload_len >> 24);
+    out[5] = (uint8_t)(payload_len >> 16);
+    out[6] = (uint8_t)(payload_len >> 8);
+    out[7] = (uint8_t)(payload_len & 0xFF);
+    write_be16(&out[8], source_address);
+    write_be16(&out[10], target_address);
+}
+
+/**
+ * Send header + UDS payload without copying the payload
+ */
+static int send_diag(DiagnosticRouter_t* router, int link, uint16_t source_address,
+                     uint16_t target_address, const uint8_t* uds_data, size_t uds_len) {
+    if (!router->transport.sendv || link == DIAG_ROUTER_LINK_NONE) {
+        return -1;
+    }
+    
+    uint8_t header[DIAG_ROUTER_DIAG_HEADER_SIZE];
+    build_diag_header(header, source_address, target_address, uds_len);
+    
+    DiagRouterIOVec_t iov[2] = {
+        { header, sizeof(header) },
+        { uds_data, uds_len }
+    };
+    if (router->transport.sendv(router->transport.ctx, link, iov, 2) != 0) {
+        return -1;
+    }
+    
+    router->relayed_bytes += sizeof(header) + uds_len;
+    return 0;
+}
+
+/**
+ * Validate diagnostic message head, rewrite addresses in place and
+ * resolve the outgoing link.
+ * 
+ * To ECU: SA (VMG tester) is replaced by the gateway address, since the
+ *         ECU only has a routing activation with the ZG. The request is
+ *         tracked in a pending slot (returned in *slot).
+ * To VMG: TA (gateway address) is replaced by the tester of the matching
+ *         pending request, or the ECU's last tester if unsolicited.
+ */
+static int prepare_relay(DiagnosticRouter_t* router, DiagRouteDirection_t direction,
+                         uint8_t* head, size_t head_len,
+                         int* out_link, size_t* frame_len, int* slot) {
+    if (head_len < DIAG_ROUTER_DIAG_HEADER_SIZE ||
+        head[0] != DOIP_PROTOCOL_VERSION ||
+        head[1] != DOIP_INVERSE_PROTOCOL_VERSION ||
+        read_be16(&head[2]) != DOIP_DIAGNOSTIC_MESSAGE) {
+        return -1;
+    }
+    
+    uint32_t payload_len = read_be32(&head[4]);
+    if (payload_len < 4) {
+        return -1;
+    }
+    *frame_len = DOIP_HEADER_SIZE + (size_t)payload_len;
+    
+    uint16_t source_address = read_be16(&head[8]);
+    uint16_t target_address = read_be16(&head[10]);
+    const uint8_t* uds_data = head + DIAG_ROUTER_DIAG_HEADER_SIZE;
+    size_t uds_len = head_len - DIAG_ROUTER_DIAG_HEADER_SIZE;
+    
+    *slot = DIAG_ROUTER_SLOT_NONE;
+    
+    if (direction == DIAG_ROUTE_TO_ECU) {
+        ECURoutingEntry_t* ecu = find_entry(router, target_address);
+        if (!ecu || ecu->link == DIAG_ROUTER_LINK_NONE) {
+            debug_print("[DiagRouter] ECU not reachable: 0x%04X\n", target_address);
+            return -1;
+        }
+        
+        *slot = pending_open(router, source_address, target_address, uds_data, uds_len);
+        
+        ecu->tester_address = source_address;
+        if (router->gateway_address != 0) {
+            write_be16(&head[8], router->gateway_address);
+        }
+        *out_link = ecu->link;
+    } else {
+        ECURoutingEntry_t* ecu = find_entry(router, source_address);
+        uint16_t tester = 0;
+        
+        *slot = pending_match(router, source_address, uds_data, uds_len, &tester);
+        if (*slot == DIAG_ROUTER_SLOT_NONE) {
+            router->unmatched_responses++;
+            tester = ecu ? ecu->tester_address : 0;
+        }
+        if (ecu) {
+            ecu->last_activity_time_ms = get_current_time_ms();
+            ecu->is_connected = true;
+        }
+        if (router->gateway_address != 0 && target_address == router->gateway_address &&
+            tester != 0) {
+            write_be16(&head[10], tester);
+        }
+        
+        if (router->vmg_link == DIAG_ROUTER_LINK_NONE) {
+            return -1;
+        }
+        *out_link = router->vmg_link;
+    }
+    
+    return 0;
+}
+
+// Forwarded: a response settles the request it answers
+static void relay_done(DiagnosticRouter_t* router, DiagRouteDirection_t direction,
+                       int slot, const uint8_t* head) {
+    if (direction == DIAG_ROUTE_TO_ECU) {
+        router->routed_to_ecu++;
+    } else {
+        pending_complete(router, slot, head + DIAG_ROUTER_DIAG_HEADER_SIZE);
+        router->routed_to_vmg++;
+    }
+}
+
+// Not forwarded: drop a request's slot, keep a response's request pending
+static void relay_failed(DiagnosticRouter_t* router, DiagRouteDirection_t direction, int slot) {
+    if (direction == DIAG_ROUTE_TO_ECU) {
+        pending_abort(router, slot);
+    }
+    router->routing_errors++;
+}
+
 // ============================================================================
 // API Implementation
 // ============================================================================
@@ -31,6 +459,9 @@ int diagnostic_router_init(DiagnosticRouter_t* router) {
     }
     
     memset(router, 0, sizeof(DiagnosticRouter_t));
+    memset(router->index, 0xFF, sizeof(router->index));
+    router->vmg_link = DIAG_ROUTER_LINK_NONE;
+    pending_init(router);
     
     debug_print("[DiagRouter] Initialized\n");
     
@@ -42,7 +473,19 @@ int diagnostic_router_register_ecu(
     const char* ecu_id,
     uint16_t logical_address
 ) {
-    if (!router || !ecu_id || router->ecu_count >= DIAG_ROUTER_MAX_ECUS) {
+    if (!router || !ecu_id) {
+        return -1;
+    }
+    
+    // Re-registration (e.g. after ECU reboot) keeps link and tester state
+    ECURoutingEntry_t* existing = find_entry(router, logical_address);
+    if (existing) {
+        strncpy(existing->ecu_id, ecu_id, sizeof(existing->ecu_id) - 1);
+        existing->ecu_id[sizeof(existing->ecu_id) - 1] = '\0';
+        return 0;
+    }
+    
+    if (router->ecu_count >= DIAG_ROUTER_MAX_ECUS) {
         return -1;
     }
     
@@ -54,7 +497,10 @@ int diagnostic_router_register_ecu(
     entry->logical_address = logical_address;
     entry->is_connected = false;
     entry->last_activity_time_ms = 0;
+    entry->link = DIAG_ROUTER_LINK_NONE;
+    entry->tester_address = 0;
     
+    index_insert(router, logical_address, (uint16_t)router->ecu_count);
     router->ecu_count++;
     
     debug_print("[DiagRouter] Registered ECU: %s (0x%04X)\n", ecu_id, logical_address);
@@ -62,6 +508,167 @@ int diagnostic_router_register_ecu(
     return 0;
 }
 
+int diagnostic_router_unregister_ecu(
+    DiagnosticRouter_t* router,
+    uint16_t logical_address
+) {
+    if (!router) {
+        return -1;
+    }
+    
+    int32_t slot = index_find_slot(router, logical_address);
+    if (slot < 0) {
+        return -1;
+    }
+    
+    uint16_t position = router->index[slot];
+    uint16_t last = (uint16_t)(router->ecu_count - 1);
+    index_remove_slot(router, (uint32_t)slot);
+    
+    // Keep ecus[] dense: move the last entry into the gap and repoint its slot
+    if (position != last) {
+        int32_t moved_slot = index_find_slot(router, router->ecus[last].logical_address);
+        router->ecus[position] = router->ecus[last];
+        router->index[moved_slot] = position;
+    }
+    
+    memset(&router->ecus[last], 0, sizeof(router->ecus[last]));
+    router->ecu_count--;
+    
+    debug_print("[DiagRouter] Unregistered ECU: 0x%04X\n", logical_address);
+    
+    return 0;
+}
+
+int diagnostic_router_set_transport(
+    DiagnosticRouter_t* router,
+    const DiagRouterTransport_t* transport,
+    uint16_t gateway_address,
+    int vmg_link
+) {
+    if (!router || !transport || !transport->sendv) {
+        return -1;
+    }
+    
+    router->transport = *transport;
+    router->gateway_address = gateway_address;
+    router->vmg_link = vmg_link;
+    
+    return 0;
+}
+
+int diagnostic_router_attach_ecu_link(
+    DiagnosticRouter_t* router,
+    uint16_t logical_address,
+    int link
+) {
+    if (!router) {
+        return -1;
+    }
+    
+    ECURoutingEntry_t* ecu = find_entry(router, logical_address);
+    if (!ecu) {
+        return -1;
+    }
+    
+    ecu->link = link;
+    ecu->is_connected = (link != DIAG_ROUTER_LINK_NONE);
+    if (ecu->is_connected) {
+        ecu->last_activity_time_ms = get_current_time_ms();
+    }
+    
+    return 0;
+}
+
+int diagnostic_router_relay_frame(
+    DiagnosticRouter_t* router,
+    DiagRouteDirection_t direction,
+    uint8_t* frame,
+    size_t frame_len
+) {
+    if (!router || !frame || !router->transport.sendv) {
+        return -1;
+    }
+    
+    if (direction == DIAG_ROUTE_TO_ECU) {
+        router->total_requests++;
+    }
+    
+    int out_link;
+    size_t expected_len;
+    int slot;
+    if (prepare_relay(router, direction, frame, frame_len, &out_link, &expected_len, &slot) != 0) {
+        router->routing_errors++;
+        return -1;
+    }
+    if (expected_len != frame_len) {
+        relay_failed(router, direction, slot);
+        return -1;
+    }
+    
+    // Forward the received buffer as-is
+    DiagRouterIOVec_t iov = { frame, frame_len };
+    if (router->transport.sendv(router->transport.ctx, out_link, &iov, 1) != 0) {
+        relay_failed(router, direction, slot);
+        return -1;
+    }
+    
+    router->relayed_bytes += frame_len;
+    relay_done(router, direction, slot, frame);
+    
+    return 0;
+}
+
+int diagnostic_router_relay_stream(
+    DiagnosticRouter_t* router,
+    DiagRouteDirection_t direction,
+    int in_link,
+    uint8_t* head,
+    size_t head_len
+) {
+    if (!router || !head || !router->transport.sendv) {
+        return -1;
+    }
+    
+    if (direction == DIAG_ROUTE_TO_ECU) {
+        router->total_requests++;
+    }
+    
+    int out_link;
+    size_t frame_len;
+    int slot;
+    if (prepare_relay(router, direction, head, head_len, &out_link, &frame_len, &slot) != 0) {
+        router->routing_errors++;
+        return -1;
+    }
+    
+    // Refuse before anything is written, so the outgoing stream stays framed
+    if (head_len > frame_len || (frame_len > head_len && !router->transport.splice)) {
+        relay_failed(router, direction, slot);
+        return -1;
+    }
+    size_t remaining = frame_len - head_len;
+    
+    DiagRouterIOVec_t iov = { head, head_len };
+    if (router->transport.sendv(router->transport.ctx, out_link, &iov, 1) != 0) {
+        relay_failed(router, direction, slot);
+        return -1;
+    }
+    
+    if (remaining > 0 &&
+        router->transport.splice(router->transport.ctx, in_link, out_link, remaining) != 0) {
+        // Outgoing link now carries a truncated frame; caller must reset it
+        relay_failed(router, direction, slot);
+        return -1;
+    }
+    
+    router->relayed_bytes += head_len;
+    router->spliced_bytes += remaining;
+    relay_done(router, direction, slot, head);
+    
+    return 0;
+}
+
 int diagnostic_router_route_to_ecu(
     DiagnosticRouter_t* router,
     uint16_t source_address,
@@ -76,7 +683,7 @@ int diagnostic_router_route_to_ecu(
     router->total_requests++;
     
     // Find target ECU
-    const ECURoutingEntry_t* ecu = diagnostic_router_find_ecu(router, target_address);
+    ECURoutingEntry_t* ecu = find_entry(router, target_address);
     if (!ecu) {
         debug_print("[DiagRouter] ECU not found: 0x%04X\n", target_address);
         router->routing_errors++;
@@ -86,9 +693,17 @@ int diagnostic_router_route_to_ecu(
     debug_print("[DiagRouter] Routing to ECU: %s (0x%04X -> 0x%04X)\n",
                 ecu->ecu_id, source_address, target_address);
     
-    // TODO: Send via DoIP client to ECU
-    // doip_client_send_diagnostic_message(source_address, target_address, uds_data, uds_len);
+    uint16_t wire_source = router->gateway_address ? router->gateway_address : source_address;
+    
+    int slot = pending_open(router, source_address, target_address, uds_data, uds_len);
     
+    if (send_diag(router, ecu->link, wire_source, target_address, uds_data, uds_len) != 0) {
+        pending_abort(router, slot);
+        router->routing_errors++;
+        return -1;
+    }
+    
+    ecu->tester_address = source_address;
     router->routed_to_ecu++;
     
     return 0;
@@ -111,9 +726,22 @@ int diagnostic_router_route_to_vmg(
     // Update ECU activity
     diagnostic_router_update_activity(router, source_address);
     
-    // TODO: Send via DoIP client to VMG
-    // doip_client_send_diagnostic_message(source_address, target_address, uds_data, uds_len);
+    uint16_t tester;
+    int slot = pending_match(router, source_address, uds_data, uds_len, &tester);
+    if (slot == DIAG_ROUTER_SLOT_NONE) {
+        router->unmatched_responses++;
+    } else if (router->gateway_address != 0 && target_address == router->gateway_address) {
+        target_address = tester;
+    }
+    
+    // On failure the request stays pending and times out
+    if (send_diag(router, router->vmg_link, source_address, target_address,
+                  uds_data, uds_len) != 0) {
+        router->routing_errors++;
+        return -1;
+    }
     
+    pending_complete(router, slot, uds_data);
     router->routed_to_vmg++;
     
     return 0;
@@ -140,10 +768,15 @@ int diagnostic_router_broadcast(
             debug_print("[DiagRouter]   -> %s (0x%04X)\n", 
                         ecu->ecu_id, ecu->logical_address);
             
-            // TODO: Send to ECU
-            // doip_client_send_diagnostic_message(source_address, ecu->logical_address, uds_data, uds_len);
-            
-            sent_count++;
+            // Same UDS buffer for every ECU, only the header differs
+            uint16_t wire_source = router->gateway_address ? router->gateway_address
+                                                           : source_address;
+            if (send_diag(router, ecu->link, wire_source, ecu->logical_address,
+                          uds_data, uds_len) == 0) {
+                sent_count++;
+            } else {
+                router->routing_errors++;
+            }
         }
     }
     
@@ -160,13 +793,7 @@ const ECURoutingEntry_t* diagnostic_router_find_ecu(
         return NULL;
     }
     
-    for (uint32_t i = 0; i < router->ecu_count; i++) {
-        if (router->ecus[i].logical_address == logical_address) {
-            return &router->ecus[i];
-        }
-    }
-    
-    return NULL;
+    return find_entry((DiagnosticRouter_t*)router, logical_address);
 }
 
 void diagnostic_router_update_activity(
@@ -177,12 +804,10 @@ void diagnostic_router_update_activity(
         return;
     }
     
-    for (uint32_t i = 0; i < router->ecu_count; i++) {
-        if (router->ecus[i].logical_address == logical_address) {
-            router->ecus[i].last_activity_time_ms = get_current_time_ms();
-            router->ecus[i].is_connected = true;
-            break;
-        }
+    ECURoutingEntry_t* ecu = find_entry(router, logical_address);
+    if (ecu) {
+        ecu->last_activity_time_ms = get_current_time_ms();
+        ecu->is_connected = true;
     }
 }
 
@@ -193,21 +818,31 @@ void diagnostic_router_check_timeouts(DiagnosticRouter_t* router) {
     
     uint32_t current_time = get_current_time_ms();
     
-    for (uint32_t i = 0; i < DIAG_ROUTER_MAX_PENDING; i++) {
-        PendingDiagRequest_t* req = &router->pending[i];
-        
-        if (req->is_active) {
-            uint32_t elapsed = current_time - req->timestamp_ms;
+    // Lists are sorted by deadline: stop at the first slot still in time
+    for (uint8_t list = 0; list < 2; list++) {
+        while (router->timer_head[list] != DIAG_ROUTER_SLOT_NONE) {
+            uint8_t slot = router->timer_head[list];
+            PendingDiagRequest_t* req = &router->pending[slot];
             
-            if (elapsed > DIAG_ROUTER_TIMEOUT_MS) {
-                debug_print("[DiagRouter] Request timed out: 0x%04X -> 0x%04X\n",
-                            req->source_address, req->target_address);
-                
-                // TODO: Send negative response (timeout)
-                
-                req->is_active = false;
-                router->routing_errors++;
+            if (time_before(current_time, req->deadline_ms)) {
+                break;
             }
+            
+            debug_print("[DiagRouter] Request timed out: 0x%04X -> 0x%04X SID 0x%02X (%u x 0x78)\n",
+                        req->source_address, req->target_address, req->sid,
+                        req->response_pending_count);
+            
+            // Tell the tester instead of leaving it to its own P2 timer; a
+            // late response is still forwarded, as unmatched
+            uint8_t nrc[3] = { UDS_NEGATIVE_RESPONSE, req->sid, DIAG_ROUTER_TIMEOUT_NRC };
+            if (send_diag(router, router->vmg_link, req->target_address, req->source_address,
+                          nrc, sizeof(nrc)) == 0) {
+                router->timeout_nrcs_sent++;
+            }
+            
+            pending_release(router, slot);
+            router->request_timeouts++;
+            router->routing_errors++;
         }
     }
 }
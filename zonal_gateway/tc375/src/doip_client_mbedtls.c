@@ -176,6 +176,24 @@ int doip_client_mbedtls_receive(mbedtls_doip_client* client,
     return ret;
 }
 
+int doip_client_mbedtls_wait_readable(mbedtls_doip_client* client,
+                                       uint32_t timeout_ms) {
+    if (!client) return -1;
+    
+    // Already decrypted, nothing to wait for on the socket
+    if (mbedtls_ssl_get_bytes_avail(&client->ssl) > 0) {
+        return 1;
+    }
+    
+    int ret = mbedtls_net_poll(&client->server_fd, MBEDTLS_NET_POLL_READ, timeout_ms);
+    if (ret < 0) {
+        printf("[DoIP Client] Poll error: -0x%x\n", -ret);
+        return -1;
+    }
+    
+    return (ret & MBEDTLS_NET_POLL_READ) ? 1 : 0;
+}
+
 void doip_client_mbedtls_free(mbedtls_doip_client* client) {
     if (!client) return;
     
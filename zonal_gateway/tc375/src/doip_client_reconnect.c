@@ -3,8 +3,13 @@
  * @brief DoIP Client with Auto-Reconnection Implementation
  */
 
+#if defined(__unix__) && !defined(USE_FREERTOS) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE     // clock_gettime(), usleep()
+#endif
+
 #include "doip_client_reconnect.h"
 #include "doip_client_mbedtls.h"
+#include "doip_protocol.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -14,12 +19,25 @@
 #include "task.h"
 #define TASK_DELAY_MS(ms) vTaskDelay(pdMS_TO_TICKS(ms))
 #define GET_TIME_MS() (xTaskGetTickCount() * portTICK_PERIOD_MS)
+#elif defined(__unix__)
+#include <unistd.h>
+#include <time.h>
+#define TASK_DELAY_MS(ms) usleep((ms) * 1000)
+static uint32_t get_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000u);
+}
+#define GET_TIME_MS() get_time_ms()
 #else
 #include <unistd.h>
 #define TASK_DELAY_MS(ms) usleep((ms) * 1000)
 #define GET_TIME_MS() 0  // TODO: Implement for bare metal
 #endif
 
+#define DOIP_RA_REQ_PAYLOAD_SIZE    7
+#define DOIP_RA_RES_MIN_PAYLOAD     9
+
 // ============================================================================
 // Private Functions
 // ============================================================================
@@ -38,40 +56,270 @@ static void set_state(DoIPClientReconnect_t* client, DoIPConnectionState_t new_s
     }
 }
 
+// ---------------------------------------------------------------------------
+// Backoff (decorrelated jitter) and attempt token bucket
+// ---------------------------------------------------------------------------
+
+static uint32_t next_random(DoIPClientReconnect_t* client) {
+    uint32_t x = client->jitter_state ? client->jitter_state : 0x9E3779B9u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    client->jitter_state = x;
+    return x;
+}
+
+static uint32_t random_between(DoIPClientReconnect_t* client, uint32_t low, uint32_t high) {
+    if (high <= low) {
+        return low;
+    }
+    return low + next_random(client) % (high - low + 1);
+}
+
+static void seed_jitter(DoIPClientReconnect_t* client) {
+    // Gateways share the VMG host, so the source address is what separates them
+    uint32_t seed = 2166136261u;
+    for (const char* p = client->server_host; *p; p++) {
+        seed = (seed ^ (uint8_t)*p) * 16777619u;
+    }
+    seed ^= (uint32_t)client->source_address * 0x9E3779B1u;
+    seed ^= GET_TIME_MS();
+    client->jitter_state = seed ? seed : 1;
+}
+
+// First retry after a loss: anywhere in [0, initial] so peers spread out
+static void reset_backoff(DoIPClientReconnect_t* client) {
+    client->backoff_ms = random_between(client, 0, DOIP_INITIAL_BACKOFF_MS);
+}
+
+// sleep = min(cap, random(base, sleep * 3))
+static void grow_backoff(DoIPClientReconnect_t* client) {
+    uint32_t upper = client->backoff_ms * 3;
+    if (upper < DOIP_INITIAL_BACKOFF_MS) {
+        upper = DOIP_INITIAL_BACKOFF_MS;
+    }
+    if (upper > DOIP_MAX_BACKOFF_MS) {
+        upper = DOIP_MAX_BACKOFF_MS;
+    }
+    client->backoff_ms = random_between(client, DOIP_INITIAL_BACKOFF_MS, upper);
+}
+
+static bool take_token(DoIPClientReconnect_t* client, uint32_t now) {
+    uint32_t elapsed = now - client->last_refill_time_ms;
+    if (elapsed >= DOIP_RECONNECT_BUCKET_REFILL_MS) {
+        uint32_t refill = elapsed / DOIP_RECONNECT_BUCKET_REFILL_MS;
+        client->tokens += refill;
+        client->last_refill_time_ms += refill * DOIP_RECONNECT_BUCKET_REFILL_MS;
+    }
+    if (client->tokens >= DOIP_RECONNECT_BUCKET_SIZE) {
+        // Full bucket does not bank credit
+        client->tokens = DOIP_RECONNECT_BUCKET_SIZE;
+        client->last_refill_time_ms = now;
+    }
+
+    if (client->tokens == 0) {
+        return false;
+    }
+    client->tokens--;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Connection
+// ---------------------------------------------------------------------------
+
+static void* open_tls(DoIPClientReconnect_t* client) {
+    mbedtls_doip_client* ctx = NULL;
+
+    if (doip_client_mbedtls_init(&ctx, client->server_host, client->server_port,
+                                 client->cert_file, client->key_file, client->ca_file) != 0) {
+        return NULL;
+    }
+    return ctx;
+}
+
+static int routing_activate(DoIPClientReconnect_t* client, void* ctx) {
+    uint8_t frame[DOIP_HEADER_SIZE + DOIP_RA_REQ_PAYLOAD_SIZE] = {
+        DOIP_PROTOCOL_VERSION, DOIP_INVERSE_PROTOCOL_VERSION,
+        DOIP_ROUTING_ACTIVATION_REQ >> 8, DOIP_ROUTING_ACTIVATION_REQ & 0xFF,
+        0x00, 0x00, 0x00, DOIP_RA_REQ_PAYLOAD_SIZE,
+        (uint8_t)(client->source_address >> 8), (uint8_t)(client->source_address & 0xFF),
+        0x00,                       // Default activation
+        0x00, 0x00, 0x00, 0x00      // Reserved
+    };
+
+    if (doip_client_mbedtls_send((mbedtls_doip_client*)ctx, frame, sizeof(frame)) != (int)sizeof(frame)) {
+        return -1;
+    }
+
+    uint8_t response[DOIP_HEADER_SIZE + 16];
+    int len = doip_client_mbedtls_receive((mbedtls_doip_client*)ctx, response, sizeof(response));
+    if (len < (int)(DOIP_HEADER_SIZE + DOIP_RA_RES_MIN_PAYLOAD) ||
+        response[0] != DOIP_PROTOCOL_VERSION ||
+        ((response[2] << 8) | response[3]) != DOIP_ROUTING_ACTIVATION_RES) {
+        return -1;
+    }
+
+    uint8_t code = response[DOIP_HEADER_SIZE + 4];
+    if (code != DOIP_RA_RES_SUCCESS) {
+        printf("[DoIP] Routing activation rejected (0x%02X)\n", code);
+        return -1;
+    }
+    return 0;
+}
+
 static int attempt_connection(DoIPClientReconnect_t* client) {
     printf("[DoIP] Connecting to %s:%u (attempt %u)...\n",
            client->server_host, client->server_port, client->reconnect_count + 1);
     
-    // TODO: Replace with actual mbedTLS DoIP client connection
-    // For now, this is a placeholder
-    
-    /*
-    int ret = mbedtls_doip_client_connect(
-        (mbedtls_doip_client*)client->client_ctx,
-        client->server_host,
-        client->server_port,
-        client->cert_file,
-        client->key_file,
-        client->ca_file
-    );
+    void* ctx = open_tls(client);
+    if (!ctx) {
+        return -1;
+    }
     
-    return ret;
-    */
+    if (routing_activate(client, ctx) != 0) {
+        doip_client_mbedtls_free((mbedtls_doip_client*)ctx);
+        return -1;
+    }
     
-    // Placeholder: simulate connection
-    return -1;  // Connection failed (for now)
+    client->client_ctx = ctx;
+    return 0;
 }
 
 static void close_connection(DoIPClientReconnect_t* client) {
     if (client->client_ctx) {
-        // TODO: Close mbedTLS connection
-        // mbedtls_doip_client_close((mbedtls_doip_client*)client->client_ctx);
+        doip_client_mbedtls_free((mbedtls_doip_client*)client->client_ctx);
         client->client_ctx = NULL;
     }
     
     client->is_connected = false;
 }
 
+static void close_standby(DoIPClientReconnect_t* client) {
+    if (client->standby_ctx) {
+        doip_client_mbedtls_free((mbedtls_doip_client*)client->standby_ctx);
+        client->standby_ctx = NULL;
+    }
+}
+
+static void record_connected(DoIPClientReconnect_t* client, uint32_t now) {
+    if (client->outage_active) {
+        client->reconnect_samples[client->reconnect_sample_count % DOIP_RECONNECT_HISTORY_SIZE] =
+            now - client->lost_time_ms;
+        client->reconnect_sample_count++;
+        client->outage_active = false;
+    }
+    
+    client->is_connected = true;
+    client->reconnect_count = 0;
+    client->last_activity_time_ms = now;
+    client->last_keepalive_time_ms = now;
+}
+
+// Primary is gone: promote the standby if it still works, else back off
+static void connection_lost(DoIPClientReconnect_t* client) {
+    uint32_t now = GET_TIME_MS();
+    
+    close_connection(client);
+    if (!client->outage_active) {
+        client->outage_active = true;
+        client->lost_time_ms = now;
+    }
+    
+    if (client->standby_ctx) {
+        void* ctx = client->standby_ctx;
+        client->standby_ctx = NULL;
+        
+        if (routing_activate(client, ctx) == 0) {
+            client->client_ctx = ctx;
+            client->total_failovers++;
+            record_connected(client, GET_TIME_MS());
+            client->standby_next_attempt_ms = now;  // Rebuild standby
+            printf("[DoIP] Failed over to standby connection\n");
+            set_state(client, DOIP_STATE_CONNECTED);
+            return;
+        }
+        
+        doip_client_mbedtls_free((mbedtls_doip_client*)ctx);
+    }
+    
+    set_state(client, DOIP_STATE_RECONNECTING);
+    reset_backoff(client);
+    client->last_attempt_time_ms = now;
+}
+
+// Idle link only: any other frame in the interval already proved it alive
+static int send_keepalive(DoIPClientReconnect_t* client) {
+    uint8_t frame[DOIP_HEADER_SIZE + 6] = {
+        DOIP_PROTOCOL_VERSION, DOIP_INVERSE_PROTOCOL_VERSION,
+        DOIP_DIAGNOSTIC_MESSAGE >> 8, DOIP_DIAGNOSTIC_MESSAGE & 0xFF,
+        0x00, 0x00, 0x00, 6,
+        (uint8_t)(client->source_address >> 8), (uint8_t)(client->source_address & 0xFF),
+        DOIP_KEEPALIVE_TARGET_ADDRESS >> 8, DOIP_KEEPALIVE_TARGET_ADDRESS & 0xFF,
+        0x3E, 0x80                  // TesterPresent, suppress positive response
+    };
+
+    if (doip_client_reconnect_send(client, frame, sizeof(frame)) != (int)sizeof(frame)) {
+        return -1;
+    }
+    client->keepalives_sent++;
+    return 0;
+}
+
+// Drop the VMG's diagnostic ACK/NACK (0x8002/0x8003) replies to our own
+// keepalives and reports from a received buffer; returns the bytes left
+static size_t consume_diag_acks(DoIPClientReconnect_t* client, uint8_t* buf, size_t len) {
+    size_t pos = 0;
+    
+    while (len - pos >= DOIP_HEADER_SIZE) {
+        uint16_t type = (uint16_t)((buf[pos + 2] << 8) | buf[pos + 3]);
+        uint32_t payload = ((uint32_t)buf[pos + 4] << 24) | ((uint32_t)buf[pos + 5] << 16) |
+                           ((uint32_t)buf[pos + 6] << 8) | buf[pos + 7];
+        if (payload > len - pos - DOIP_HEADER_SIZE) {
+            break;  // Partial frame, leave it to the caller
+        }
+        size_t frame_len = DOIP_HEADER_SIZE + payload;
+        
+        if (type == DOIP_DIAGNOSTIC_MESSAGE_POS_ACK) {
+            client->diag_acks_received++;
+        } else if (type == DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK) {
+            client->diag_nacks_received++;
+            if (payload >= 5) {
+                printf("[DoIP] VMG rejected diagnostic message (NACK 0x%02X)\n",
+                       buf[pos + DOIP_HEADER_SIZE + 4]);
+            }
+        } else {
+            pos += frame_len;
+            continue;
+        }
+        
+        memmove(&buf[pos], &buf[pos + frame_len], len - pos - frame_len);
+        len -= frame_len;
+    }
+    
+    return len;
+}
+
+static void maintain_standby(DoIPClientReconnect_t* client, uint32_t now) {
+    if (!client->standby_enabled || client->standby_ctx ||
+        (int32_t)(now - client->standby_next_attempt_ms) < 0) {
+        return;
+    }
+    
+    // Standby handshakes count against the same bucket
+    if (!take_token(client, now)) {
+        client->throttled_attempts++;
+        client->standby_next_attempt_ms = now + DOIP_RECONNECT_BUCKET_REFILL_MS;
+        return;
+    }
+    
+    client->standby_ctx = open_tls(client);
+    if (!client->standby_ctx) {
+        client->standby_next_attempt_ms = now + random_between(client, DOIP_STANDBY_RETRY_MS / 2,
+                                                               DOIP_STANDBY_RETRY_MS);
+    }
+}
+
 // ============================================================================
 // Public API Implementation
 // ============================================================================
@@ -108,17 +356,44 @@ int doip_client_reconnect_init(
     // Initialize reconnection parameters
     client->state = DOIP_STATE_DISCONNECTED;
     client->is_connected = false;
+    client->source_address = DOIP_RECONNECT_DEFAULT_SOURCE;
     client->backoff_ms = DOIP_INITIAL_BACKOFF_MS;
     client->reconnect_count = 0;
     client->total_reconnects = 0;
     client->last_attempt_time_ms = 0;
     client->last_keepalive_time_ms = 0;
+    client->last_activity_time_ms = 0;
+    client->tokens = DOIP_RECONNECT_BUCKET_SIZE;
+    client->last_refill_time_ms = GET_TIME_MS();
+    seed_jitter(client);
     
     printf("[DoIP] Client initialized for %s:%u\n", server_host, server_port);
     
     return 0;
 }
 
+void doip_client_reconnect_set_source_address(DoIPClientReconnect_t* client,
+                                              uint16_t source_address) {
+    if (!client) {
+        return;
+    }
+    
+    client->source_address = source_address;
+    seed_jitter(client);
+}
+
+void doip_client_reconnect_enable_standby(DoIPClientReconnect_t* client, bool enable) {
+    if (!client) {
+        return;
+    }
+    
+    client->standby_enabled = enable;
+    client->standby_next_attempt_ms = GET_TIME_MS();
+    if (!enable) {
+        close_standby(client);
+    }
+}
+
 int doip_client_reconnect_start(DoIPClientReconnect_t* client) {
     if (!client) {
         return -1;
@@ -153,31 +428,32 @@ int doip_client_reconnect_process(DoIPClientReconnect_t* client) {
                 return -2;  // Still waiting
             }
             
-            // Attempt connection
             client->last_attempt_time_ms = current_time;
             
+            // Rate limit handshakes; wait for the next token
+            if (!take_token(client, current_time)) {
+                client->throttled_attempts++;
+                client->backoff_ms = DOIP_RECONNECT_BUCKET_REFILL_MS -
+                                     (current_time - client->last_refill_time_ms);
+                return -2;
+            }
+            
+            // Attempt connection
             if (attempt_connection(client) == 0) {
                 // Connection successful!
                 printf("[DoIP] Connected successfully!\n");
+                record_connected(client, GET_TIME_MS());
                 set_state(client, DOIP_STATE_CONNECTED);
-                client->is_connected = true;
-                client->reconnect_count = 0;
                 client->backoff_ms = DOIP_INITIAL_BACKOFF_MS;
-                client->last_keepalive_time_ms = current_time;
                 return 0;
             }
             
-            // Connection failed
-            printf("[DoIP] Connection failed, will retry in %u ms\n", client->backoff_ms);
-            
             client->reconnect_count++;
             client->total_reconnects++;
             
-            // Exponential backoff
-            client->backoff_ms *= 2;
-            if (client->backoff_ms > DOIP_MAX_BACKOFF_MS) {
-                client->backoff_ms = DOIP_MAX_BACKOFF_MS;
-            }
+            // Decorrelated jitter backoff
+            grow_backoff(client);
+            printf("[DoIP] Connection failed, will retry in %u ms\n", client->backoff_ms);
             
             set_state(client, DOIP_STATE_RECONNECTING);
             return -2;  // Still connecting
@@ -185,26 +461,18 @@ int doip_client_reconnect_process(DoIPClientReconnect_t* client) {
         case DOIP_STATE_CONNECTED:
             // Check keepalive
             if (current_time - client->last_keepalive_time_ms > DOIP_KEEPALIVE_INTERVAL_MS) {
-                // Send keepalive (Alive Check)
-                // TODO: Implement actual keepalive
-                /*
-                int ret = mbedtls_doip_client_send_alive_check(
-                    (mbedtls_doip_client*)client->client_ctx
-                );
+                client->last_keepalive_time_ms = current_time;
                 
-                if (ret != 0) {
+                if (current_time - client->last_activity_time_ms < DOIP_KEEPALIVE_INTERVAL_MS) {
+                    client->keepalives_suppressed++;
+                } else if (send_keepalive(client) != 0) {
                     printf("[DoIP] Keepalive failed, connection lost\n");
-                    close_connection(client);
-                    set_state(client, DOIP_STATE_RECONNECTING);
-                    client->backoff_ms = DOIP_INITIAL_BACKOFF_MS;
                     client->total_keepalive_failures++;
-                    return -1;
+                    return client->is_connected ? 0 : -1;
                 }
-                */
-                
-                client->last_keepalive_time_ms = current_time;
             }
             
+            maintain_standby(client, current_time);
             return 0;  // Connected
     }
     
@@ -224,9 +492,7 @@ int doip_client_reconnect_send(
         return -1;
     }
     
-    // TODO: Implement actual send
-    /*
-    int ret = mbedtls_doip_client_send(
+    int ret = doip_client_mbedtls_send(
         (mbedtls_doip_client*)client->client_ctx,
         data,
         len
@@ -235,15 +501,12 @@ int doip_client_reconnect_send(
     if (ret < 0) {
         // Send failed, connection might be lost
         printf("[DoIP] Send failed, connection lost\n");
-        close_connection(client);
-        set_state(client, DOIP_STATE_RECONNECTING);
-        client->backoff_ms = DOIP_INITIAL_BACKOFF_MS;
+        connection_lost(client);
+    } else {
+        client->last_activity_time_ms = GET_TIME_MS();
     }
     
     return ret;
-    */
-    
-    return -1;  // Placeholder
 }
 
 int doip_client_reconnect_recv(
@@ -256,27 +519,38 @@ int doip_client_reconnect_recv(
         return -1;
     }
     
-    // TODO: Implement actual receive
-    /*
-    int ret = mbedtls_doip_client_recv(
-        (mbedtls_doip_client*)client->client_ctx,
-        buf,
-        cap,
-        timeout_ms
-    );
+    mbedtls_doip_client* ctx = (mbedtls_doip_client*)client->client_ctx;
+    uint32_t start = GET_TIME_MS();
     
-    if (ret < 0) {
-        // Receive failed, connection might be lost
-        printf("[DoIP] Receive failed, connection lost\n");
-        close_connection(client);
-        set_state(client, DOIP_STATE_RECONNECTING);
-        client->backoff_ms = DOIP_INITIAL_BACKOFF_MS;
+    while (1) {
+        uint32_t elapsed = GET_TIME_MS() - start;
+        uint32_t wait = elapsed < timeout_ms ? timeout_ms - elapsed : 0;
+        
+        int ret = doip_client_mbedtls_wait_readable(ctx, wait);
+        if (ret == 0) {
+            return 0;  // Timeout
+        }
+        
+        // Peer close (0) is a lost connection here, not an empty read
+        if (ret > 0) {
+            ret = doip_client_mbedtls_receive(ctx, buf, cap);
+        }
+        if (ret <= 0) {
+            printf("[DoIP] Receive failed, connection lost\n");
+            connection_lost(client);
+            return -1;
+        }
+        
+        client->last_activity_time_ms = GET_TIME_MS();
+        
+        size_t len = consume_diag_acks(client, buf, (size_t)ret);
+        if (len > 0) {
+            return (int)len;
+        }
+        if (GET_TIME_MS() - start >= timeout_ms) {
+            return 0;  // Only acknowledgements arrived
+        }
     }
-    
-    return ret;
-    */
-    
-    return 0;  // Placeholder (timeout)
 }
 
 int doip_client_reconnect_reset(DoIPClientReconnect_t* client) {
@@ -287,29 +561,62 @@ int doip_client_reconnect_reset(DoIPClientReconnect_t* client) {
     printf("[DoIP] Forcing reconnection...\n");
     
     close_connection(client);
+    close_standby(client);
     set_state(client, DOIP_STATE_RECONNECTING);
-    client->backoff_ms = DOIP_INITIAL_BACKOFF_MS;
-    client->last_attempt_time_ms = 0;  // Immediate retry
+    client->backoff_ms = 0;  // Immediate retry (still subject to the token bucket)
+    client->last_attempt_time_ms = GET_TIME_MS();
     
     return 0;
 }
 
+static uint32_t percentile(const uint32_t* sorted, uint32_t count, uint32_t pct) {
+    // Nearest rank
+    uint32_t rank = (pct * count + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
 void doip_client_reconnect_get_stats(
     const DoIPClientReconnect_t* client,
-    uint32_t* total_reconnects,
-    uint32_t* current_backoff_ms
+    DoIPReconnectStats_t* stats
 ) {
-    if (!client) {
+    if (!client || !stats) {
         return;
     }
     
-    if (total_reconnects) {
-        *total_reconnects = client->total_reconnects;
+    memset(stats, 0, sizeof(*stats));
+    stats->total_reconnects = client->total_reconnects;
+    stats->total_failovers = client->total_failovers;
+    stats->throttled_attempts = client->throttled_attempts;
+    stats->keepalives_sent = client->keepalives_sent;
+    stats->keepalives_suppressed = client->keepalives_suppressed;
+    stats->diag_acks_received = client->diag_acks_received;
+    stats->diag_nacks_received = client->diag_nacks_received;
+    stats->current_backoff_ms = client->backoff_ms;
+    stats->samples = client->reconnect_sample_count;
+    stats->standby_ready = client->standby_ctx != NULL;
+    
+    uint32_t count = client->reconnect_sample_count < DOIP_RECONNECT_HISTORY_SIZE ?
+                     client->reconnect_sample_count : DOIP_RECONNECT_HISTORY_SIZE;
+    if (count == 0) {
+        return;
     }
     
-    if (current_backoff_ms) {
-        *current_backoff_ms = client->backoff_ms;
+    // Insertion sort of at most DOIP_RECONNECT_HISTORY_SIZE samples
+    uint32_t sorted[DOIP_RECONNECT_HISTORY_SIZE];
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t value = client->reconnect_samples[i];
+        uint32_t j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
     }
+    
+    stats->p50_ms = percentile(sorted, count, 50);
+    stats->p90_ms = percentile(sorted, count, 90);
+    stats->p99_ms = percentile(sorted, count, 99);
+    stats->max_ms = sorted[count - 1];
 }
 
 void doip_client_reconnect_cleanup(DoIPClientReconnect_t* client) {
@@ -318,6 +625,7 @@ void doip_client_reconnect_cleanup(DoIPClientReconnect_t* client) {
     }
     
     close_connection(client);
+    close_standby(client);
     
     printf("[DoIP] Client cleaned up\n");
 }
@@ -3,6 +3,10 @@
  * @brief Zonal Gateway Implementation for TC375
  */
 
+#if defined(__unix__) && !defined(USE_FREERTOS) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L     // clock_gettime()
+#endif
+
 #include "zonal_gateway.h"
 #include "doip_client.h"
 #include "doip_message.h"
@@ -10,10 +14,302 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifdef USE_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#elif defined(__unix__)
+#include <time.h>
+#endif
+
 /* Platform-specific includes would go here */
 /* #include "lwip/tcp.h" */
 /* #include "lwip/udp.h" */
 
+/* Zone report header (see zone_vci_codec.hpp) */
+#define ZG_REPORT_VERSION       1
+#define ZG_REPORT_FLAG_FULL     0x01
+
+static uint32_t get_current_time_ms(void) {
+#ifdef USE_FREERTOS
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+#elif defined(__unix__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000u);
+#else
+    // TODO: Implement for bare metal (STM tick)
+    return 0;
+#endif
+}
+
+static void zg_vmg_lost(ZonalGateway_t* zg) {
+    doip_client_disconnect(&zg->vmg_client);
+    zg->vmg_connected = false;
+    diagnostic_router_set_transport(&zg->diag_router, &zg->diag_transport,
+                                    zg->logical_address, DIAG_ROUTER_LINK_NONE);
+}
+
+/* Uplink requests are built in place after the DoIP + SA/TA header */
+#define ZG_UPLINK_UDS_OFFSET    (DOIP_HEADER_SIZE + 4)
+
+/* Send the UDS request at server_tx_buffer[ZG_UPLINK_UDS_OFFSET] without
+ * waiting for the answer: the VMG socket is read only by
+ * zg_handle_vmg_doip_message(), which settles the request when its
+ * response arrives. One request is in flight at a time. */
+static int zg_vmg_send(ZonalGateway_t* zg, size_t uds_len, uint32_t generation) {
+    uint8_t* frame = zg->server_tx_buffer;
+    size_t len = doip_build_diagnostic_message(zg->logical_address, zg->vmg_client.target_address,
+                                               NULL, uds_len, frame, sizeof(zg->server_tx_buffer));
+    if (len == 0) {
+        return -1;
+    }
+    
+    zg->uplink_frames++;
+    if (doip_socket_tcp_send(zg->vmg_client.tcp_socket, frame, len) < 0) {
+        zg_vmg_lost(zg);
+        return -1;
+    }
+    
+    uint32_t now = get_current_time_ms();
+    zg->vmg_pending_sid = frame[ZG_UPLINK_UDS_OFFSET];
+    zg->vmg_pending_generation = generation;
+    zg->vmg_pending_since_ms = now;
+    zg->vmg_last_activity_ms = now;
+    return 0;
+}
+
+/* ACK/NACK or UDS response from the VMG addressed to the ZG itself.
+ * Returns false if it does not belong to the outstanding uplink request. */
+static bool zg_vmg_uplink_frame(ZonalGateway_t* zg, uint16_t payload_type,
+                                const uint8_t* payload, size_t payload_len) {
+    if (zg->vmg_pending_sid == 0 || payload_len < 5 ||
+        (uint16_t)((payload[2] << 8) | payload[3]) != zg->logical_address) {
+        return false;
+    }
+    
+    if (payload_type == DOIP_DIAGNOSTIC_MESSAGE_POS_ACK) {
+        return true;    /* Response follows */
+    }
+    if (payload_type == DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK) {
+        zg->vmg_pending_sid = 0;    /* Not taken; the next zg_run() retries */
+        return true;
+    }
+    
+    const uint8_t* uds = &payload[4];
+    size_t uds_len = payload_len - 4;
+    if (uds[0] == UDS_NRC && uds_len >= 3 && uds[1] == zg->vmg_pending_sid) {
+        if (uds[2] == UDS_NRC_RESPONSE_PENDING) {
+            zg->vmg_pending_since_ms = get_current_time_ms();
+        } else {
+            zg->vmg_pending_sid = 0;
+        }
+        return true;
+    }
+    if (uds[0] != (uint8_t)(zg->vmg_pending_sid + UDS_POSITIVE_RESPONSE_OFFSET)) {
+        return false;
+    }
+    
+    /* The report is only known to the VMG once it has been accepted */
+    if (zg->vmg_pending_sid == UDS_SID_WRITE_DATA_BY_IDENTIFIER) {
+        zg->vmg_reported_generation = zg->vmg_pending_generation;
+    }
+    zg->vmg_pending_sid = 0;
+    return true;
+}
+
+static int zg_recv_exact(int sock, uint8_t* buf, size_t len) {
+    while (len > 0) {
+        /* Timeout (0) mid-frame is as fatal as a close */
+        int n = doip_socket_tcp_recv(sock, buf, len, DOIP_SOCKET_TIMEOUT_MS);
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Read one DoIP frame from `sock` and relay it if it is a diagnostic
+ * message. Only the head that fits server_rx_buffer is read here; the
+ * rest of a large frame (TransferData) is spliced socket to socket. */
+static int zg_relay_from(ZonalGateway_t* zg, int sock, DiagRouteDirection_t direction) {
+    uint8_t* buf = zg->server_rx_buffer;
+    
+    if (zg_recv_exact(sock, buf, DOIP_HEADER_SIZE) != 0) {
+        return -1;
+    }
+    if (buf[0] != DOIP_PROTOCOL_VERSION || buf[1] != DOIP_INVERSE_PROTOCOL_VERSION) {
+        return -1;  /* Lost framing, the stream cannot be resynchronized */
+    }
+    
+    uint16_t payload_type = (uint16_t)((buf[2] << 8) | buf[3]);
+    uint32_t payload_len = ((uint32_t)buf[4] << 24) | ((uint32_t)buf[5] << 16) |
+                           ((uint32_t)buf[6] << 8) | buf[7];
+    size_t head_len = sizeof(zg->server_rx_buffer) - DOIP_HEADER_SIZE;
+    if (payload_len < head_len) {
+        head_len = payload_len;
+    }
+    
+    if (direction == DIAG_ROUTE_TO_ECU && payload_len <= head_len &&
+        (payload_type == DOIP_DIAGNOSTIC_MESSAGE_POS_ACK ||
+         payload_type == DOIP_DIAGNOSTIC_MESSAGE_NEG_ACK ||
+         payload_type == DOIP_DIAGNOSTIC_MESSAGE)) {
+        /* Answers to the ZG's own uplink requests share this socket */
+        if (zg_recv_exact(sock, &buf[DOIP_HEADER_SIZE], payload_len) != 0) {
+            return -1;
+        }
+        if (zg_vmg_uplink_frame(zg, payload_type, &buf[DOIP_HEADER_SIZE], payload_len) ||
+            payload_type != DOIP_DIAGNOSTIC_MESSAGE) {
+            return 0;
+        }
+        diagnostic_router_relay_frame(&zg->diag_router, direction, buf,
+                                      DOIP_HEADER_SIZE + payload_len);
+        return 0;
+    }
+    
+    if (payload_type != DOIP_DIAGNOSTIC_MESSAGE) {
+        /* Not relayed: consume the payload so the next frame starts aligned */
+        while (payload_len > 0) {
+            size_t chunk = payload_len < head_len ? payload_len : head_len;
+            if (zg_recv_exact(sock, &buf[DOIP_HEADER_SIZE], chunk) != 0) {
+                return -1;
+            }
+            payload_len -= (uint32_t)chunk;
+        }
+        return 0;
+    }
+    
+    if (zg_recv_exact(sock, &buf[DOIP_HEADER_SIZE], head_len) != 0) {
+        return -1;
+    }
+    head_len += DOIP_HEADER_SIZE;
+    
+    if (direction == DIAG_ROUTE_TO_VMG && head_len >= DIAG_ROUTER_DIAG_HEADER_SIZE) {
+        /* SA identifies the ECU behind this socket */
+        uint16_t ecu_address = (uint16_t)((buf[8] << 8) | buf[9]);
+        const ECURoutingEntry_t* ecu = diagnostic_router_find_ecu(&zg->diag_router, ecu_address);
+        if (ecu && ecu->link != sock) {
+            diagnostic_router_attach_ecu_link(&zg->diag_router, ecu_address, sock);
+        }
+    }
+    
+    if (head_len == DOIP_HEADER_SIZE + payload_len) {
+        /* Whole frame consumed: an unroutable one is dropped (counted in
+         * routing_errors) and the input stream stays aligned */
+        diagnostic_router_relay_frame(&zg->diag_router, direction, buf, head_len);
+        return 0;
+    }
+    /* The rest of the payload is still in the socket, a failure leaves it
+     * mid-frame */
+    return diagnostic_router_relay_stream(&zg->diag_router, direction, sock, buf, head_len);
+}
+
+static size_t put_u32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+    return 4;
+}
+
+static size_t put_string(uint8_t* out, const char* value, size_t max_len) {
+    size_t len = strnlen(value, max_len);
+    out[0] = (uint8_t)len;
+    memcpy(&out[1], value, len);
+    return len + 1;
+}
+
+/* No per-ECU generations here, so a changed zone goes out as a full
+ * snapshot (<= ZG_MAX_ECUS records) and an unchanged one as header only */
+static size_t zg_encode_zone_report(const ZonalGateway_t* zg, uint32_t since_generation,
+                                    uint8_t* out) {
+    const ZoneVCIData_t* vci = &zg->zone_vci;
+    bool full = (since_generation != vci->generation);
+    size_t pos = 0;
+    
+    out[pos++] = 'Z';
+    out[pos++] = 'V';
+    out[pos++] = ZG_REPORT_VERSION;
+    out[pos++] = full ? ZG_REPORT_FLAG_FULL : 0;
+    out[pos++] = vci->zone_id;
+    pos += put_u32(&out[pos], full ? 0 : since_generation);
+    pos += put_u32(&out[pos], vci->generation);
+    pos += put_u32(&out[pos], vci->total_storage_mb);
+    pos += put_u32(&out[pos], vci->available_storage_mb);
+    out[pos++] = vci->average_battery_level;
+    out[pos++] = full ? vci->ecu_count : 0;
+    
+    if (!full) {
+        return pos;
+    }
+    
+    for (uint8_t i = 0; i < vci->ecu_count; i++) {
+        const ZoneECUInfo_t* ecu = &vci->ecus[i];
+        
+        pos += put_u32(&out[pos], vci->generation);
+        out[pos++] = (uint8_t)(ecu->logical_address >> 8);
+        out[pos++] = (uint8_t)(ecu->logical_address & 0xFF);
+        out[pos++] = (ecu->is_online ? 0x01 : 0) |
+                     (ecu->ota_capable ? 0x02 : 0) |
+                     (ecu->delta_update_supported ? 0x04 : 0);
+        pos += put_u32(&out[pos], ecu->max_package_size);
+        pos += put_string(&out[pos], ecu->ecu_id, sizeof(ecu->ecu_id));
+        pos += put_string(&out[pos], ecu->firmware_version, sizeof(ecu->firmware_version));
+        pos += put_string(&out[pos], ecu->hardware_version, sizeof(ecu->hardware_version));
+    }
+    
+    return pos;
+}
+
+static bool zg_same_vci(const ZoneECUInfo_t* a, const ZoneECUInfo_t* b) {
+    return strncmp(a->ecu_id, b->ecu_id, sizeof(a->ecu_id)) == 0 &&
+           a->logical_address == b->logical_address &&
+           strncmp(a->firmware_version, b->firmware_version, sizeof(a->firmware_version)) == 0 &&
+           strncmp(a->hardware_version, b->hardware_version, sizeof(a->hardware_version)) == 0 &&
+           a->is_online == b->is_online &&
+           a->ota_capable == b->ota_capable &&
+           a->delta_update_supported == b->delta_update_supported &&
+           a->max_package_size == b->max_package_size;
+}
+
+static void zg_service_uplink(ZonalGateway_t* zg, uint32_t now) {
+    if (zg->vmg_pending_sid != 0) {
+        /* No answer at all: the link is as good as gone */
+        if (now - zg->vmg_pending_since_ms >= ZG_UPLINK_RESPONSE_TIMEOUT_MS) {
+            zg_vmg_lost(zg);
+        }
+        return;
+    }
+    
+    bool changed = (zg->zone_vci.generation != zg->vmg_reported_generation);
+    uint32_t since_status = now - zg->vmg_last_status_ms;
+    bool status_due = since_status >= ZG_STATUS_INTERVAL_MS;
+    bool idle = (now - zg->vmg_last_activity_ms) >= ZG_HEARTBEAT_INTERVAL_MS;
+    
+    /* Where a fixed 10 s heartbeat would have fired */
+    bool heartbeat_slot = (now - zg->vmg_heartbeat_slot_ms) >= ZG_HEARTBEAT_INTERVAL_MS;
+    if (heartbeat_slot) {
+        zg->vmg_heartbeat_slot_ms = now;
+    }
+    
+    if (!changed && !status_due && !idle) {
+        if (heartbeat_slot) zg->heartbeats_suppressed++;
+        return;
+    }
+    
+    /* A frame is going out anyway: bring forward a status report that is
+     * nearly due rather than waking the link again a few seconds later */
+    if (changed || status_due || since_status + ZG_UPLINK_COALESCE_MS >= ZG_STATUS_INTERVAL_MS) {
+        if (!changed && !status_due) zg->reports_coalesced++;
+        if (heartbeat_slot) zg->heartbeats_suppressed++;
+        zg_send_zone_report_to_vmg(zg);
+        return;
+    }
+    
+    zg_send_heartbeat_to_vmg(zg);
+}
+
 int zg_init(ZonalGateway_t* zg, uint8_t zone_id, const char* vmg_ip, uint16_t vmg_port) {
     if (!zg) return -1;
     
@@ -30,9 +326,18 @@ int zg_init(ZonalGateway_t* zg, uint8_t zone_id, const char* vmg_ip, uint16_t vm
     /* Initialize UDS handler */
     uds_handler_init(&zg->uds_handler);
     
+    /* Diagnostic relay; the VMG link is attached once connected */
+    diagnostic_router_init(&zg->diag_router);
+    if (diag_relay_socket_init(&zg->diag_relay, &zg->diag_transport) != 0) {
+        return -1;
+    }
+    diagnostic_router_set_transport(&zg->diag_router, &zg->diag_transport,
+                                    zg->logical_address, DIAG_ROUTER_LINK_NONE);
+    
     /* Initialize zone VCI */
     zg->zone_vci.zone_id = zone_id;
     zg->zone_vci.ecu_count = 0;
+    zg->zone_vci.generation = 1;    /* 0 is reserved for "nothing reported yet" */
     
     return 0;
 }
@@ -55,8 +360,9 @@ void zg_stop(ZonalGateway_t* zg) {
     
     /* Close all sockets */
     if (zg->vmg_client.tcp_socket >= 0) {
-        doip_client_disconnect(&zg->vmg_client);
+        zg_vmg_lost(zg);
     }
+    diag_relay_socket_close(&zg->diag_relay);
     
     /* Close server sockets */
     /* lwip_close(zg->doip_server_tcp_socket); */
@@ -73,6 +379,30 @@ void zg_run(ZonalGateway_t* zg) {
     /* Handle incoming connections */
     /* Check VMG connection status */
     /* Process queued messages */
+    
+    /* Expire relayed requests the ECU never answered */
+    diagnostic_router_check_timeouts(&zg->diag_router);
+    
+    if (zg->vmg_connected) {
+        zg_service_uplink(zg, get_current_time_ms());
+    }
+}
+
+int zg_handle_ecu_doip_message(ZonalGateway_t* zg, int client_socket) {
+    if (!zg || client_socket < 0) return -1;
+    
+    return zg_relay_from(zg, client_socket, DIAG_ROUTE_TO_VMG);
+}
+
+int zg_handle_vmg_doip_message(ZonalGateway_t* zg) {
+    if (!zg || !zg->vmg_connected) return -1;
+    
+    if (zg_relay_from(zg, zg->vmg_client.tcp_socket, DIAG_ROUTE_TO_ECU) != 0) {
+        zg_vmg_lost(zg);
+        return -1;
+    }
+    zg->vmg_last_activity_ms = get_current_time_ms();
+    return 0;
 }
 
 int zg_connect_to_vmg(ZonalGateway_t* zg) {
@@ -88,37 +418,72 @@ int zg_connect_to_vmg(ZonalGateway_t* zg) {
         return -1;
     }
     
+    diagnostic_router_set_transport(&zg->diag_router, &zg->diag_transport,
+                                    zg->logical_address, zg->vmg_client.tcp_socket);
+    
+    /* New session: VMG copy is unknown, the next report is a full snapshot */
+    uint32_t now = get_current_time_ms();
     zg->vmg_connected = true;
+    zg->vmg_reported_generation = 0;
+    zg->vmg_pending_sid = 0;
+    zg->vmg_last_activity_ms = now;
+    zg->vmg_last_status_ms = now;
+    zg->vmg_heartbeat_slot_ms = now;
     return 0;
 }
 
 int zg_send_zone_vci_to_vmg(ZonalGateway_t* zg) {
     if (!zg || !zg->vmg_connected) return -1;
     
-    /* Build Zone VCI message */
-    /* Send via DoIP diagnostic message */
+    if (zg->zone_vci.generation == zg->vmg_reported_generation) {
+        return 0;   /* Nothing changed since last report */
+    }
+    return zg_send_zone_report_to_vmg(zg);
+}
+
+int zg_send_zone_report_to_vmg(ZonalGateway_t* zg) {
+    if (!zg || !zg->vmg_connected) return -1;
+    
+    if (zg->vmg_pending_sid != 0) return -1;   /* Previous request unanswered */
+    
+    /* Status and VCI share one 0x2E F1A1 frame */
+    uint8_t* request = &zg->server_tx_buffer[ZG_UPLINK_UDS_OFFSET];
+    request[0] = UDS_SID_WRITE_DATA_BY_IDENTIFIER;
+    request[1] = (uint8_t)(UDS_DID_ZONE_VCI_REPORT >> 8);
+    request[2] = (uint8_t)(UDS_DID_ZONE_VCI_REPORT & 0xFF);
+    size_t len = 3 + zg_encode_zone_report(zg, zg->vmg_reported_generation, &request[3]);
+    
+    /* vmg_reported_generation moves when the VMG's 0x6E arrives */
+    if (zg_vmg_send(zg, len, zg->zone_vci.generation) != 0) {
+        return -1;
+    }
     
+    zg->vmg_last_status_ms = zg->vmg_last_activity_ms;
     return 0;
 }
 
 int zg_send_heartbeat_to_vmg(ZonalGateway_t* zg) {
     if (!zg || !zg->vmg_connected) return -1;
     
+    if (zg->vmg_pending_sid != 0) return -1;   /* Previous request unanswered */
+    
     /* Send Tester Present (0x3E 0x00) */
-    uint8_t heartbeat[] = {0x3E, 0x00};
-    uint8_t response[256];
-    size_t resp_len;
+    uint8_t* heartbeat = &zg->server_tx_buffer[ZG_UPLINK_UDS_OFFSET];
+    heartbeat[0] = UDS_SID_TESTER_PRESENT;
+    heartbeat[1] = 0x00;
     
-    return doip_client_send_diagnostic(&zg->vmg_client,
-                                       heartbeat, sizeof(heartbeat),
-                                       response, sizeof(response), &resp_len);
+    if (zg_vmg_send(zg, 2, 0) != 0) {
+        return -1;
+    }
+    zg->heartbeats_sent++;
+    return 0;
 }
 
 int zg_send_zone_status_to_vmg(ZonalGateway_t* zg) {
     if (!zg || !zg->vmg_connected) return -1;
     
-    /* Send zone status */
-    return 0;
+    /* Status is the report header; ECUs ride along if they changed */
+    return zg_send_zone_report_to_vmg(zg);
 }
 
 int zg_update_ecu_info(ZonalGateway_t* zg, const char* ecu_id, const ZoneECUInfo_t* info) {
@@ -139,7 +504,13 @@ int zg_update_ecu_info(ZonalGateway_t* zg, const char* ecu_id, const ZoneECUInfo
         idx = zg->zone_vci.ecu_count++;
     }
     
-    /* Update info */
+    /* Routable by logical address from now on (re-registration keeps the link) */
+    diagnostic_router_register_ecu(&zg->diag_router, ecu_id, info->logical_address);
+    
+    /* Update info; heartbeat time alone is not a VCI change */
+    if (!zg_same_vci(&zg->zone_vci.ecus[idx], info)) {
+        zg->zone_vci.generation++;
+    }
     memcpy(&zg->zone_vci.ecus[idx], info, sizeof(ZoneECUInfo_t));
     
     return 0;